@@ -3,12 +3,12 @@
 
 #include <miniaudio.c>
 
-bool MaSoundInstance::InitFromBuffer(ma_engine& engine, const std::vector<uint8_t>& buffer, const std::string& identity)
+bool MaSoundInstance::InitFromBuffer(ma_engine& engine, const uint8_t* data, size_t size, const std::string& identity)
 {
 	if (!m_Initialized)
 	{
 		ma_decoder_config decoderConfig = ma_decoder_config_init_default();
-		ma_result result = ma_decoder_init_memory(buffer.data(), buffer.size(),
+		ma_result result = ma_decoder_init_memory(data, size,
 												  &decoderConfig, &m_Decoder);
 		if (!MD_ASSERT(result == MA_SUCCESS))
 		{
@@ -9,7 +9,7 @@ inline constexpr float CS_CLIENT_FPS = 61.0f;
 class MaSoundInstance
 {
 public:
-	bool InitFromBuffer(ma_engine& engine, const std::vector<uint8_t>& buffer, const std::string& identity);
+	bool InitFromBuffer(ma_engine& engine, const uint8_t* data, size_t size, const std::string& identity);
 
 	bool InitFromFile(ma_engine& engine, const std::string& filePathOnDisk);
 
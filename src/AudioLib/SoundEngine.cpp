@@ -47,7 +47,8 @@ bool SoundEngine::PlaySound2D(const std::string& name)
 		return false;
 
 	auto& instance = m_Sounds2D[name]; // 2d sounds are persistent, no need to destroy
-	instance.InitFromBuffer(m_Engine, m_Files[name], name);
+	const CPackFileView& file = m_Files[name];
+	instance.InitFromBuffer(m_Engine, file.data(), file.size(), name);
 	instance.Config3D(false);
 	instance.SetVolume(m_SoundVolume);
 	return instance.Play();
@@ -231,7 +232,8 @@ MaSoundInstance* SoundEngine::Internal_GetInstance3D(const std::string& name)
 			if (!instance.IsPlaying())
 			{
 				instance.Destroy();
-				instance.InitFromBuffer(m_Engine, m_Files[name], name);
+				const CPackFileView& file = m_Files[name];
+				instance.InitFromBuffer(m_Engine, file.data(), file.size(), name);
 				return &instance;
 			}
 		}
@@ -243,16 +245,14 @@ bool SoundEngine::Internal_LoadSoundFromPack(const std::string& name)
 {
 	if (m_Files.find(name) == m_Files.end())
 	{
-		TPackFile soundFile;
-		if (!CPackManager::Instance().GetFile(name, soundFile))
+		CPackFileView soundFile;
+		if (!CPackManager::Instance().GetFileView(name, soundFile))
 		{
 			TraceError("Internal_LoadSoundFromPack: SoundEngine: Failed to register file '%s' - not found.", name.c_str());
 			return false;
 		}
 
-		auto& buffer = m_Files[name];
-		buffer.resize(soundFile.size());
-		memcpy(buffer.data(), soundFile.data(), soundFile.size());
+		m_Files.emplace(name, std::move(soundFile));
 	}
 	return true;
 }
@@ -2,6 +2,7 @@
 #include "EterBase/Singleton.h"
 #include "Type.h"
 #include "MaSoundInstance.h"
+#include "PackLib/Pack.h"
 
 //#include <miniaudio.h>
 #include <array>
@@ -81,7 +82,7 @@ private:
 	struct { float x, y, z; } m_CharacterPosition{};
 
 	ma_engine m_Engine{};
-	std::unordered_map<std::string, std::vector<uint8_t>> m_Files;
+	std::unordered_map<std::string, CPackFileView> m_Files; // decoders read straight from these
 	std::unordered_map<std::string, MaSoundInstance> m_Sounds2D;
 	std::array<MaSoundInstance, SOUND_INSTANCE_3D_MAX_NUM> m_Sounds3D;
 	std::unordered_map<std::string, float> m_PlaySoundHistoryMap;
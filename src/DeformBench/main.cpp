@@ -0,0 +1,326 @@
+#include "EterGrnLib/Deform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include <argparse.hpp>
+
+// Skins synthetic PWNT3432 meshes with random bone palettes through the SSE deformer and,
+// where the CPU has AVX2 and FMA, the block deformer, and checks both against a scalar
+// double precision reference. Outputs are followed by guard vertices and, with the padded
+// stride, by a gap after every vertex, neither may be written.
+// Exits with EXIT_FAILURE if an error is over the tolerance or a guard byte changed.
+
+using TClock = std::chrono::steady_clock;
+
+static const int GUARD_VERTICES = 8;
+static const granny_uint8 GUARD_BYTE = 0xCD;
+static const int PALETTE_SIZE = 40;
+
+struct TMesh
+{
+	std::vector<granny_pwnt3432_vertex> vertices;
+	std::vector<granny_int32x> transform_table;
+	std::vector<granny_matrix_4x4> transforms;
+	std::vector<SPWNT3432Block> blocks;
+};
+
+struct TDeformCheck
+{
+	double max_error = 0.0;
+	bool guard_ok = true;
+};
+
+// Same test as GrpDevice, which sets CPU_HAS_AVX2 for the game
+static bool HasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4] = { 0 };
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	const bool has_fma = info[2] & (1 << 12);
+	const bool has_osxsave = info[2] & (1 << 27);
+	const bool has_avx = info[2] & (1 << 28);
+
+	if (!has_fma || !has_osxsave || !has_avx || max_leaf < 7 || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	const bool has_fma = ecx & (1 << 12);
+	const bool has_osxsave = ecx & (1 << 27);
+	const bool has_avx = ecx & (1 << 28);
+
+	unsigned int xcr0_lo, xcr0_hi;
+	if (!has_fma || !has_osxsave || !has_avx)
+		return false;
+
+	__asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	if ((xcr0_lo & 6) != 6 || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return ebx & (1 << 5);
+#endif
+}
+
+// rigid_share of the vertices use one bone, the others one to four with random weights
+static void MakeMesh(int vertex_count, double rigid_share, int bone_count, std::mt19937& rng, TMesh& mesh)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+	mesh.vertices.resize(vertex_count);
+	for (granny_pwnt3432_vertex& vertex : mesh.vertices) {
+		for (int i = 0; i < 3; ++i) {
+			vertex.Position[i] = unit(rng) * 100.0f;
+			vertex.Normal[i] = unit(rng);
+		}
+		vertex.UV[0] = unit(rng);
+		vertex.UV[1] = unit(rng);
+
+		const int influences = chance(rng) < rigid_share ? 1 : 1 + static_cast<int>(rng() % 4);
+		int weight_left = 255;
+		for (int k = 0; k < 4; ++k) {
+			int weight = 0;
+			if (k + 1 == influences)
+				weight = weight_left;
+			else if (k < influences)
+				weight = static_cast<int>(rng() % (weight_left + 1));
+
+			vertex.BoneIndices[k] = static_cast<granny_uint8>(rng() % PALETTE_SIZE);
+			vertex.BoneWeights[k] = static_cast<granny_uint8>(weight);
+			weight_left -= weight;
+		}
+	}
+
+	mesh.transform_table.resize(PALETTE_SIZE);
+	for (granny_int32x& bone : mesh.transform_table)
+		bone = static_cast<granny_int32x>(rng() % bone_count);
+
+	// Enough transforms for the palette to index them directly too
+	mesh.transforms = std::vector<granny_matrix_4x4>(std::max(bone_count, PALETTE_SIZE));
+	for (granny_matrix_4x4& transform : mesh.transforms) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column)
+				transform[row][column] = row == 3 ? unit(rng) * 50.0f : unit(rng);
+		}
+	}
+
+	mesh.blocks.resize(GetPWNT3432BlockCount(vertex_count));
+	RepackPWNT3432(vertex_count, mesh.vertices.data(), sizeof(granny_pwnt3432_vertex), mesh.blocks.data());
+}
+
+static void DeformReference(const TMesh& mesh, const granny_int32x* transform_table, std::vector<granny_pnt332_vertex>& out)
+{
+	out.resize(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		const granny_pwnt3432_vertex& source = mesh.vertices[i];
+		double position[3] = { 0.0, 0.0, 0.0 };
+		double normal[3] = { 0.0, 0.0, 0.0 };
+
+		for (int k = 0; k < 4; ++k) {
+			if (!source.BoneWeights[k])
+				continue;
+
+			const int bone = transform_table ? transform_table[source.BoneIndices[k]] : source.BoneIndices[k];
+			const granny_matrix_4x4& m = mesh.transforms[bone];
+			const double weight = source.BoneWeights[k] / 255.0;
+
+			for (int c = 0; c < 3; ++c) {
+				position[c] += weight * (double(source.Position[0]) * m[0][c] + double(source.Position[1]) * m[1][c] + double(source.Position[2]) * m[2][c] + m[3][c]);
+				normal[c] += weight * (double(source.Normal[0]) * m[0][c] + double(source.Normal[1]) * m[1][c] + double(source.Normal[2]) * m[2][c]);
+			}
+		}
+
+		for (int c = 0; c < 3; ++c) {
+			out[i].Position[c] = static_cast<float>(position[c]);
+			out[i].Normal[c] = static_cast<float>(normal[c]);
+		}
+		out[i].UV[0] = source.UV[0];
+		out[i].UV[1] = source.UV[1];
+	}
+}
+
+// Output of vertex_count vertices dest_stride apart, guard bytes everywhere beforehand
+static void ResetOutput(std::vector<granny_uint8>& out, size_t vertex_count, size_t dest_stride)
+{
+	out.assign((vertex_count + GUARD_VERTICES) * dest_stride, GUARD_BYTE);
+}
+
+static TDeformCheck CheckOutput(const std::vector<granny_uint8>& out, const std::vector<granny_pnt332_vertex>& reference, size_t dest_stride)
+{
+	TDeformCheck check;
+
+	for (size_t i = 0; i < reference.size(); ++i) {
+		const granny_uint8* vertex = &out[i * dest_stride];
+
+		float actual[8];
+		memcpy(actual, vertex, sizeof(actual));
+
+		const float* expected = reinterpret_cast<const float*>(&reference[i]);
+		for (int c = 0; c < 8; ++c) {
+			// std::max would drop a NaN, so it counts as an infinite error
+			const double error = std::fabs(double(actual[c]) - expected[c]) / (1.0 + std::fabs(expected[c]));
+			check.max_error = std::isnan(error) ? INFINITY : std::max(check.max_error, error);
+		}
+
+		for (size_t b = sizeof(granny_pnt332_vertex); b < dest_stride; ++b)
+			check.guard_ok &= vertex[b] == GUARD_BYTE;
+	}
+
+	for (size_t b = reference.size() * dest_stride; b < out.size(); ++b)
+		check.guard_ok &= out[b] == GUARD_BYTE;
+
+	return check;
+}
+
+template <typename TFunc>
+static double TimeNsPerVertex(int vertex_count, int repeat, TFunc deform)
+{
+	const auto start = TClock::now();
+	for (int i = 0; i < repeat; ++i)
+		deform();
+
+	return std::chrono::duration<double, std::nano>(TClock::now() - start).count() / repeat / vertex_count;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("DeformBench");
+
+	program.add_argument("--bones")
+		.default_value(60)
+		.scan<'i', int>()
+		.help("Number of bone transforms the palettes pick from");
+
+	program.add_argument("--vertices")
+		.default_value(2000000)
+		.scan<'i', int>()
+		.help("Vertices skinned per timing, split into repeats of every mesh");
+
+	program.add_argument("--tolerance")
+		.default_value(1e-4)
+		.scan<'g', double>()
+		.help("Largest error allowed against the reference, relative to 1 + |expected|");
+
+	program.add_argument("--seed")
+		.default_value(3)
+		.scan<'i', int>()
+		.help("Random seed of the meshes and palettes");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	const int bone_count = std::max(1, program.get<int>("--bones"));
+	const int vertex_budget = std::max(1, program.get<int>("--vertices"));
+	const double tolerance = program.get<double>("--tolerance");
+
+	std::mt19937 rng(static_cast<unsigned int>(program.get<int>("--seed")));
+
+	const bool has_avx2 = HasAVX2();
+	if (!has_avx2)
+		printf("No AVX2 and FMA on this CPU, only the SSE deformer is checked\n");
+
+	static const int vertex_counts[] = { 1, 7, 37, 1501, 4003, 12000 };
+	static const double rigid_shares[] = { 0.6, 0.0 };
+
+	// Tightly packed like the dynamic vertex buffers, and padded to catch writes between vertices
+	static const size_t dest_strides[] = { sizeof(granny_pnt332_vertex), sizeof(granny_pnt332_vertex) + 8 };
+
+	bool success = true;
+	TMesh mesh;
+	std::vector<granny_pnt332_vertex> reference;
+	std::vector<granny_uint8> out;
+
+	for (int vertex_count : vertex_counts) {
+		for (double rigid_share : rigid_shares) {
+			MakeMesh(vertex_count, rigid_share, bone_count, rng, mesh);
+
+			TDeformCheck sse_check, avx2_check;
+			auto merge = [](TDeformCheck& total, const TDeformCheck& check) {
+				total.max_error = std::max(total.max_error, check.max_error);
+				total.guard_ok &= check.guard_ok;
+			};
+
+			// With the palette, as skinned meshes are drawn, and without it for bone indices
+			// that already address the transforms
+			for (int use_table = 0; use_table < 2; ++use_table) {
+				const granny_int32x* transform_table = use_table ? mesh.transform_table.data() : nullptr;
+				DeformReference(mesh, transform_table, reference);
+
+				for (size_t dest_stride : dest_strides) {
+					ResetOutput(out, vertex_count, dest_stride);
+					DeformPWNT3432toGrannyPNGBT33332(vertex_count, mesh.vertices.data(), out.data(), transform_table, mesh.transforms.data(),
+						sizeof(granny_pwnt3432_vertex), static_cast<granny_int32x>(dest_stride));
+					merge(sse_check, CheckOutput(out, reference, dest_stride));
+
+					if (has_avx2) {
+						ResetOutput(out, vertex_count, dest_stride);
+						DeformPWNT3432BlocktoGrannyPNGBT33332AVX2(vertex_count, mesh.blocks.data(), out.data(), transform_table, mesh.transforms.data(),
+							static_cast<granny_int32x>(dest_stride));
+						merge(avx2_check, CheckOutput(out, reference, dest_stride));
+					}
+				}
+			}
+
+			const int repeat = std::max(1, vertex_budget / vertex_count);
+			out.resize(static_cast<size_t>(vertex_count) * sizeof(granny_pnt332_vertex));
+
+			const double sse_ns = TimeNsPerVertex(vertex_count, repeat, [&] {
+				DeformPWNT3432toGrannyPNGBT33332(vertex_count, mesh.vertices.data(), out.data(), mesh.transform_table.data(), mesh.transforms.data(),
+					sizeof(granny_pwnt3432_vertex), sizeof(granny_pnt332_vertex));
+			});
+
+			printf("%6d vertices, %3.0f%% rigid: SSE %6.2f ns/vertex (error %.1e%s)", vertex_count, rigid_share * 100.0, sse_ns,
+				sse_check.max_error, sse_check.guard_ok ? "" : ", GUARD WRITTEN");
+
+			success &= sse_check.max_error <= tolerance && sse_check.guard_ok;
+
+			if (has_avx2) {
+				const double avx2_ns = TimeNsPerVertex(vertex_count, repeat, [&] {
+					DeformPWNT3432BlocktoGrannyPNGBT33332AVX2(vertex_count, mesh.blocks.data(), out.data(), mesh.transform_table.data(), mesh.transforms.data(),
+						sizeof(granny_pnt332_vertex));
+				});
+
+				printf(", AVX2 %6.2f ns/vertex (error %.1e%s), %.2fx", avx2_ns, avx2_check.max_error,
+					avx2_check.guard_ok ? "" : ", GUARD WRITTEN", sse_ns / avx2_ns);
+
+				success &= avx2_check.max_error <= tolerance && avx2_check.guard_ok;
+			}
+
+			printf("\n");
+		}
+	}
+
+	if (!success)
+		std::cerr << "A deformer is over the tolerance of " << tolerance << " or wrote past its vertices" << std::endl;
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
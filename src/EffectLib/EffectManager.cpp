@@ -7,13 +7,12 @@ void CEffectManager::GetInfo(std::string* pstInfo)
 {
 	char szInfo[256];
 	
-	sprintf(szInfo, "Effect: Inst - ED %zd, EI %zd Pool - PSI %zd, MI %zd, LI %zd, PI %zd, EI %zd, ED %zd, PSD %zd, EM %zd, LD %zd", 		
+	sprintf(szInfo, "Effect: Inst - ED %zd, EI %zd Pool - PSI %zd, MI %zd, LI %zd, EI %zd, ED %zd, PSD %zd, EM %zd, LD %zd", 		
 		m_kEftDataMap.size(),
 		m_kEftInstMap.size(),		
 		CParticleSystemInstance::ms_kPool.GetCapacity(),
 		CEffectMeshInstance::ms_kPool.GetCapacity(),
 		CLightInstance::ms_kPool.GetCapacity(),		
-		CParticleInstance::ms_kPool.GetCapacity(),
 		//CRayParticleInstance::ms_kPool.GetCapacity(),
 		CEffectInstance::ms_kPool.GetCapacity(),
 		CEffectData::ms_kPool.GetCapacity(),
@@ -55,7 +54,6 @@ void CEffectManager::Update()
 		Tracenf("CEffectInstance::ms_LightInstancePool %d", CEffectInstance::ms_LightInstancePool.GetCapacity());
 		Tracenf("CEffectInstance::ms_MeshInstancePool %d", CEffectInstance::ms_MeshInstancePool.GetCapacity());
 		Tracenf("CEffectInstance::ms_ParticleSystemInstancePool %d", CEffectInstance::ms_ParticleSystemInstancePool.GetCapacity());
-		Tracenf("CParticleInstance::ms_ParticleInstancePool %d", CParticleInstance::ms_kPool.GetCapacity());
 		Tracenf("CRayParticleInstance::ms_RayParticleInstancePool %d", CRayParticleInstance::ms_kPool.GetCapacity());		
 		Tracen("---------------------------------------------");
 	}
@@ -70,52 +70,87 @@ bool CEffectMesh::OnIsType(TType type)
 
 bool CEffectMesh::OnLoad(int iSize, const void * c_pvBuf)
 {
-	if (!c_pvBuf)
+	TDecodedDataPtr pkData = DecodeOnWorker(iSize, c_pvBuf);
+
+	if (!pkData)
 		return false;
 
+	return FinalizeOnMain(*pkData);
+}
+
+CResource::TDecodedDataPtr CEffectMesh::DecodeOnWorker(int iSize, const void * c_pvBuf)
+{
+	if (!c_pvBuf)
+		return NULL;
+
 	const BYTE * c_pbBuf = static_cast<const BYTE *> (c_pvBuf);
 
 	char szHeader[10+1];
 	memcpy(szHeader, c_pbBuf, 10+1);
 	c_pbBuf += 10+1;
 
+	std::unique_ptr<SDecodedMesh> pkMesh(new SDecodedMesh);
+
 	if (0 == strcmp("EffectData", szHeader))
 	{
-		if (!__LoadData_Ver001(iSize, c_pbBuf))
-			return false;
+		if (!__LoadData_Ver001(iSize, c_pbBuf, *pkMesh))
+			return NULL;
 	}
 	else if (0 == strcmp("MDEData002", szHeader))
 	{
-		if (!__LoadData_Ver002(iSize, c_pbBuf))
-			return false;
+		if (!__LoadData_Ver002(iSize, c_pbBuf, *pkMesh))
+			return NULL;
 	}
 	else
 	{
-		return false;
+		return NULL;
+	}
+
+	return pkMesh;
+}
+
+bool CEffectMesh::FinalizeOnMain(SDecodedData & rData)
+{
+	SDecodedMesh & rMesh = static_cast<SDecodedMesh &>(rData);
+
+	m_iGeomCount = rMesh.iGeomCount;
+	m_iFrameCount = rMesh.iFrameCount;
+
+	m_pEffectMeshDataVector.clear();
+	m_pEffectMeshDataVector.resize(rMesh.kVct_kMeshData.size());
+
+	for (DWORD n = 0; n < rMesh.kVct_kMeshData.size(); ++n)
+	{
+		SEffectMeshData * pMeshData = SEffectMeshData::New();
+		*pMeshData = std::move(rMesh.kVct_kMeshData[n]);
+
+		__LoadTextures(pMeshData);
+
+		m_pEffectMeshDataVector[n] = pMeshData;
 	}
 
 	m_isData = true;
 	return true;
 }
 
-BOOL CEffectMesh::__LoadData_Ver002(int iSize, const BYTE * c_pbBuf)
+BOOL CEffectMesh::__LoadData_Ver002(int iSize, const BYTE * c_pbBuf, SDecodedMesh & rMesh)
 {
 	std::vector<D3DXVECTOR3> v3VertexVector;
 	std::vector<int> iIndexVector;
 	std::vector<D3DXVECTOR2> v3TextureVertexVector;
 	std::vector<int> iTextureIndexVector;
 
-	m_iGeomCount = *(int *)c_pbBuf;
+	rMesh.iGeomCount = *(int *)c_pbBuf;
 	c_pbBuf += 4;
-	m_iFrameCount = *(int *)c_pbBuf;
+	rMesh.iFrameCount = *(int *)c_pbBuf;
 	c_pbBuf += 4;
 
-	m_pEffectMeshDataVector.clear();
-	m_pEffectMeshDataVector.resize(m_iGeomCount);
+	rMesh.kVct_kMeshData.clear();
+	rMesh.kVct_kMeshData.resize(rMesh.iGeomCount);
 
-	for (short n = 0; n < m_iGeomCount; ++n)
+	for (short n = 0; n < rMesh.iGeomCount; ++n)
 	{
-		SEffectMeshData * pMeshData = SEffectMeshData::New();
+		SEffectMeshData * pMeshData = &rMesh.kVct_kMeshData[n];
 
 		memcpy(pMeshData->szObjectName, c_pbBuf, 32);
 		c_pbBuf += 32;
@@ -123,9 +158,9 @@ BOOL CEffectMesh::__LoadData_Ver002(int iSize, const BYTE * c_pbBuf)
 		c_pbBuf += 128;
 
 		pMeshData->EffectFrameDataVector.clear();
-		pMeshData->EffectFrameDataVector.resize(m_iFrameCount);
+		pMeshData->EffectFrameDataVector.resize(rMesh.iFrameCount);
 
-		for(int i = 0; i < m_iFrameCount; ++i)
+		for(int i = 0; i < rMesh.iFrameCount; ++i)
 		{
 			TEffectFrameData & rFrameData = pMeshData->EffectFrameDataVector[i];
 
@@ -181,79 +216,29 @@ BOOL CEffectMesh::__LoadData_Ver002(int iSize, const BYTE * c_pbBuf)
 				rVertex.texCoord.y *= -1;
 			}
 		}
-
-		////////////////////////////////////
-
-		pMeshData->pImageVector.clear();
-
-		std::string strExtension;
-		GetFileExtension(pMeshData->szDiffuseMapFileName, strlen(pMeshData->szDiffuseMapFileName), &strExtension);
-		stl_lowers(strExtension);
-
-		if (0 == strExtension.compare("ifl"))
-		{
-			TPackFile File;
-
-			if (CPackManager::Instance().GetFile(pMeshData->szDiffuseMapFileName, File))
-			{
-				CMemoryTextFileLoader textFileLoader;
-				std::vector<std::string> stTokenVector;
-
-				textFileLoader.Bind(File.size(), File.data());
-
-				std::string strPathName;
-				GetOnlyPathName(pMeshData->szDiffuseMapFileName, strPathName);
-
-				std::string strTextureFileName;
-				for (DWORD i = 0; i < textFileLoader.GetLineCount(); ++i)
-				{
-					const std::string & c_rstrFileName = textFileLoader.GetLineString(i);
-
-					if (c_rstrFileName.empty())
-						continue;
-
-					strTextureFileName = strPathName;
-					strTextureFileName += c_rstrFileName;
-
-					CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(strTextureFileName.c_str());
-
-					pMeshData->pImageVector.push_back(pImage);
-				}
-			}
-		}
-		else
-		{
-			CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(pMeshData->szDiffuseMapFileName);
-
-			pMeshData->pImageVector.push_back(pImage);
-		}
-
-		////////////////////////////////////
-
-		m_pEffectMeshDataVector[n] = pMeshData;
 	}
 
 	return TRUE;
 }
 
-BOOL CEffectMesh::__LoadData_Ver001(int iSize, const BYTE * c_pbBuf)
+BOOL CEffectMesh::__LoadData_Ver001(int iSize, const BYTE * c_pbBuf, SDecodedMesh & rMesh)
 {
 	std::vector<D3DXVECTOR3> v3VertexVector;
 	std::vector<int> iIndexVector;
 	std::vector<D3DXVECTOR2> v3TextureVertexVector;
 	std::vector<int> iTextureIndexVector;
 
-	m_iGeomCount = *(int *)c_pbBuf;
+	rMesh.iGeomCount = *(int *)c_pbBuf;
 	c_pbBuf += 4;
-	m_iFrameCount = *(int *)c_pbBuf;
+	rMesh.iFrameCount = *(int *)c_pbBuf;
 	c_pbBuf += 4;
 
-	m_pEffectMeshDataVector.clear();
-	m_pEffectMeshDataVector.resize(m_iGeomCount);
+	rMesh.kVct_kMeshData.clear();
+	rMesh.kVct_kMeshData.resize(rMesh.iGeomCount);
 
-	for (short n = 0; n < m_iGeomCount; ++n)
+	for (short n = 0; n < rMesh.iGeomCount; ++n)
 	{
-		SEffectMeshData * pMeshData = SEffectMeshData::New();
+		SEffectMeshData * pMeshData = &rMesh.kVct_kMeshData[n];
 
 		memcpy(pMeshData->szObjectName, c_pbBuf, 32);
 		c_pbBuf += 32;
@@ -276,9 +261,9 @@ BOOL CEffectMesh::__LoadData_Ver001(int iSize, const BYTE * c_pbBuf)
 		c_pbBuf += sizeof(DWORD);
 
 		pMeshData->EffectFrameDataVector.clear();
-		pMeshData->EffectFrameDataVector.resize(m_iFrameCount);
+		pMeshData->EffectFrameDataVector.resize(rMesh.iFrameCount);
 
-		for(int i = 0; i < m_iFrameCount; ++i)
+		for(int i = 0; i < rMesh.iFrameCount; ++i)
 		{
 			TEffectFrameData & rFrameData = pMeshData->EffectFrameDataVector[i];
 
@@ -325,59 +310,56 @@ BOOL CEffectMesh::__LoadData_Ver001(int iSize, const BYTE * c_pbBuf)
 				rVertex.texCoord.y *= -1;
 			}
 		}
+	}
 
-		////////////////////////////////////
+	return TRUE;
+}
 
-		pMeshData->pImageVector.clear();
+void CEffectMesh::__LoadTextures(SEffectMeshData * pMeshData)
+{
+	pMeshData->pImageVector.clear();
 
-		std::string strExtension;
-		GetFileExtension(pMeshData->szDiffuseMapFileName, strlen(pMeshData->szDiffuseMapFileName), &strExtension);
-		stl_lowers(strExtension);
+	std::string strExtension;
+	GetFileExtension(pMeshData->szDiffuseMapFileName, strlen(pMeshData->szDiffuseMapFileName), &strExtension);
+	stl_lowers(strExtension);
 
-		if (0 == strExtension.compare("ifl"))
-		{
-			TPackFile File;
+	if (0 == strExtension.compare("ifl"))
+	{
+		TPackFile File;
 
-			if (CPackManager::Instance().GetFile(pMeshData->szDiffuseMapFileName, File))
-			{
-				CMemoryTextFileLoader textFileLoader;
-				std::vector<std::string> stTokenVector;
+		if (CPackManager::Instance().GetFile(pMeshData->szDiffuseMapFileName, File))
+		{
+			CMemoryTextFileLoader textFileLoader;
+			std::vector<std::string> stTokenVector;
 
-				textFileLoader.Bind(File.size(), File.data());
+			textFileLoader.Bind(File.size(), File.data());
 
-				std::string strPathName;
-				GetOnlyPathName(pMeshData->szDiffuseMapFileName, strPathName);
+			std::string strPathName;
+			GetOnlyPathName(pMeshData->szDiffuseMapFileName, strPathName);
 
-				std::string strTextureFileName;
-				for (DWORD i = 0; i < textFileLoader.GetLineCount(); ++i)
-				{
-					const std::string & c_rstrFileName = textFileLoader.GetLineString(i);
+			std::string strTextureFileName;
+			for (DWORD i = 0; i < textFileLoader.GetLineCount(); ++i)
+			{
+				const std::string & c_rstrFileName = textFileLoader.GetLineString(i);
 
-					if (c_rstrFileName.empty())
-						continue;
+				if (c_rstrFileName.empty())
+					continue;
 
-					strTextureFileName = strPathName;
-					strTextureFileName += c_rstrFileName;
+				strTextureFileName = strPathName;
+				strTextureFileName += c_rstrFileName;
 
-					CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(strTextureFileName.c_str());
+				CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(strTextureFileName.c_str());
 
-					pMeshData->pImageVector.push_back(pImage);
-				}
+				pMeshData->pImageVector.push_back(pImage);
 			}
 		}
-		else
-		{
-			CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(pMeshData->szDiffuseMapFileName);
-
-			pMeshData->pImageVector.push_back(pImage);
-		}
-
-		////////////////////////////////////
-
-		m_pEffectMeshDataVector[n] = pMeshData;
 	}
+	else
+	{
+		CGraphicImage * pImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer(pMeshData->szDiffuseMapFileName);
 
-	return TRUE;
+		pMeshData->pImageVector.push_back(pImage);
+	}
 }
 
 BOOL CEffectMesh::GetMeshElementPointer(DWORD dwMeshIndex, TEffectMeshData ** ppMeshData)
@@ -60,6 +60,18 @@ class CEffectMesh : public CResource
 		// Exceptional function for tool
 		BOOL GetMeshElementPointer(DWORD dwMeshIndex, TEffectMeshData ** ppMeshData);
 
+		// Frames are read on the worker, textures are looked up on the main thread
+		TDecodedDataPtr DecodeOnWorker(int iSize, const void * c_pvBuf);
+		bool FinalizeOnMain(SDecodedData & rData);
+
+	protected:
+		struct SDecodedMesh : public SDecodedData
+		{
+			int								iGeomCount;
+			int								iFrameCount;
+			std::vector<TEffectMeshData>	kVct_kMeshData;
+		};
+
 	protected:
 		bool OnLoad(int iSize, const void * c_pvBuf);
 
@@ -67,8 +79,9 @@ class CEffectMesh : public CResource
 		bool OnIsEmpty() const;
 		bool OnIsType(TType type);		
 
-		BOOL __LoadData_Ver001(int iSize, const BYTE * c_pbBuf);
-		BOOL __LoadData_Ver002(int iSize, const BYTE * c_pbBuf);
+		static BOOL __LoadData_Ver001(int iSize, const BYTE * c_pbBuf, SDecodedMesh & rMesh);
+		static BOOL __LoadData_Ver002(int iSize, const BYTE * c_pbBuf, SDecodedMesh & rMesh);
+		void __LoadTextures(TEffectMeshData * pMeshData);
 
 	protected:
 		int								m_iGeomCount;
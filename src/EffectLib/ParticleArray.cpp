@@ -0,0 +1,309 @@
+#include "StdAfx.h"
+#include "ParticleArray.h"
+#include "ParticleProperty.h"
+
+#include "EterBase/Random.h"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+CParticleArray::CParticleArray() : m_uCount(0), m_uCapacity(0)
+{
+}
+
+CParticleArray::~CParticleArray()
+{
+}
+
+void CParticleArray::Clear()
+{
+	// Keeps the arrays, the system instances are pooled and reused
+	m_uCount = 0;
+}
+
+void CParticleArray::Reserve(UINT uCount)
+{
+	if (uCount > m_uCapacity)
+		__Grow(std::max<UINT>(uCount, m_uCapacity * 2));
+}
+
+UINT CParticleArray::Add()
+{
+	Reserve(m_uCount + 1);
+	return m_uCount++;
+}
+
+void CParticleArray::Remove(UINT uIndex)
+{
+	assert(uIndex < m_uCount);
+
+	const UINT uLast = --m_uCount;
+	if (uIndex == uLast)
+		return;
+
+	for (UINT uField = 0; uField < FIELD_NUM; ++uField)
+	{
+		float * afField = GetField(EField(uField));
+		afField[uIndex] = afField[uLast];
+	}
+
+	m_kVct_byFrameIndex[uIndex] = m_kVct_byFrameIndex[uLast];
+	m_kVct_byTextureAnimationType[uIndex] = m_kVct_byTextureAnimationType[uLast];
+}
+
+void CParticleArray::__Grow(UINT uCapacity)
+{
+	uCapacity = (uCapacity + REGISTER_WIDTH - 1) & ~(REGISTER_WIDTH - 1);
+
+	std::vector<float> kVct_fData(FIELD_NUM * uCapacity, 0.0f);
+	for (UINT uField = 0; uField < FIELD_NUM; ++uField)
+	{
+		if (m_uCount)
+			memcpy(&kVct_fData[uField * uCapacity], GetField(EField(uField)), m_uCount * sizeof(float));
+	}
+
+	// The padding is updated along with the particles, a life of 1 keeps it finite
+	std::fill(kVct_fData.begin() + FIELD_LIFE_TIME * uCapacity + m_uCount, kVct_fData.begin() + (FIELD_LIFE_TIME + 1) * uCapacity, 1.0f);
+
+	m_kVct_fData.swap(kVct_fData);
+	m_kVct_byFrameIndex.resize(uCapacity);
+	m_kVct_byTextureAnimationType.resize(uCapacity);
+	m_uCapacity = uCapacity;
+}
+
+UINT CParticleArray::UpdateLife(float fElapsedTime)
+{
+	float * afLastLifeTime = GetField(FIELD_LAST_LIFE_TIME);
+
+	const __m128 xElapsedTime = _mm_set1_ps(fElapsedTime);
+	for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+		_mm_storeu_ps(afLastLifeTime + i, _mm_sub_ps(_mm_loadu_ps(afLastLifeTime + i), xElapsedTime));
+
+	UINT uDeadCount = 0;
+	for (UINT i = 0; i < m_uCount;)
+	{
+		if (afLastLifeTime[i] < 0.0f)
+		{
+			Remove(i);
+			++uDeadCount;
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	return uDeadCount;
+}
+
+void CParticleArray::Update(const CParticleProperty & c_rProperty, float fElapsedTime, float fAngle, const D3DXVECTOR3 & c_rv3ZAxis)
+{
+	if (!m_uCount)
+		return;
+
+	const __m128 xElapsedTime = _mm_set1_ps(fElapsedTime);
+	const __m128 xOne = _mm_set1_ps(1.0f);
+
+	{
+		const float * c_afLifeTime = GetField(FIELD_LIFE_TIME);
+		const float * c_afLastLifeTime = GetField(FIELD_LAST_LIFE_TIME);
+		float * afLifePercentage = GetField(FIELD_LIFE_PERCENTAGE);
+
+		for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+		{
+			const __m128 xLifeTime = _mm_loadu_ps(c_afLifeTime + i);
+			const __m128 xLastLifeTime = _mm_loadu_ps(c_afLastLifeTime + i);
+			_mm_storeu_ps(afLifePercentage + i, _mm_div_ps(_mm_sub_ps(xLifeTime, xLastLifeTime), xLifeTime));
+		}
+	}
+
+	__UpdateTextureAnimation(c_rProperty, fElapsedTime);
+
+	if (c_rProperty.HasTimeEventSample(CParticleProperty::TIME_EVENT_SCALE_X))
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_SCALE_X), GetField(FIELD_SCALE_X));
+	if (c_rProperty.HasTimeEventSample(CParticleProperty::TIME_EVENT_SCALE_Y))
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_SCALE_Y), GetField(FIELD_SCALE_Y));
+
+	if (c_rProperty.HasTimeEventSample(CParticleProperty::TIME_EVENT_COLOR_R))
+	{
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_COLOR_R), GetField(FIELD_COLOR_R));
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_COLOR_G), GetField(FIELD_COLOR_G));
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_COLOR_B), GetField(FIELD_COLOR_B));
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_COLOR_A), GetField(FIELD_COLOR_A));
+	}
+
+	float * afVelocityX = GetField(FIELD_VELOCITY_X);
+	float * afVelocityY = GetField(FIELD_VELOCITY_Y);
+	float * afVelocityZ = GetField(FIELD_VELOCITY_Z);
+	float * afTemp = GetField(FIELD_TEMP);
+
+	if (c_rProperty.HasTimeEventSample(CParticleProperty::TIME_EVENT_GRAVITY))
+	{
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_GRAVITY), afTemp);
+
+		for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+		{
+			const __m128 xGravity = _mm_mul_ps(_mm_loadu_ps(afTemp + i), xElapsedTime);
+			_mm_storeu_ps(afVelocityZ + i, _mm_sub_ps(_mm_loadu_ps(afVelocityZ + i), xGravity));
+		}
+	}
+
+	if (c_rProperty.HasTimeEventSample(CParticleProperty::TIME_EVENT_AIR_RESISTANCE))
+	{
+		__SampleTimeEvent(c_rProperty.GetTimeEventSample(CParticleProperty::TIME_EVENT_AIR_RESISTANCE), afTemp);
+
+		for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+		{
+			const __m128 xScale = _mm_sub_ps(xOne, _mm_loadu_ps(afTemp + i));
+			_mm_storeu_ps(afVelocityX + i, _mm_mul_ps(_mm_loadu_ps(afVelocityX + i), xScale));
+			_mm_storeu_ps(afVelocityY + i, _mm_mul_ps(_mm_loadu_ps(afVelocityY + i), xScale));
+			_mm_storeu_ps(afVelocityZ + i, _mm_mul_ps(_mm_loadu_ps(afVelocityZ + i), xScale));
+		}
+	}
+
+	for (UINT uAxis = 0; uAxis < 3; ++uAxis)
+	{
+		float * afPosition = GetField(EField(FIELD_POSITION_X + uAxis));
+		float * afLastPosition = GetField(EField(FIELD_LAST_POSITION_X + uAxis));
+		const float * c_afVelocity = GetField(EField(FIELD_VELOCITY_X + uAxis));
+
+		for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+		{
+			const __m128 xPosition = _mm_loadu_ps(afPosition + i);
+			_mm_storeu_ps(afLastPosition + i, xPosition);
+			_mm_storeu_ps(afPosition + i, _mm_add_ps(xPosition, _mm_mul_ps(_mm_loadu_ps(c_afVelocity + i), xElapsedTime)));
+		}
+	}
+
+	if (fAngle)
+		__Rotate(c_rProperty, fAngle, c_rv3ZAxis);
+}
+
+void CParticleArray::__SampleTimeEvent(const float * c_afSample, float * afValue)
+{
+	const float * c_afLifePercentage = GetField(FIELD_LIFE_PERCENTAGE);
+
+	const __m128 xZero = _mm_setzero_ps();
+	const __m128 xSampleCount = _mm_set1_ps(float(CParticleProperty::TIME_EVENT_SAMPLE_COUNT));
+	const __m128 xLastSample = _mm_set1_ps(float(CParticleProperty::TIME_EVENT_SAMPLE_COUNT - 1));
+
+	for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+	{
+		const __m128 xPosition = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(c_afLifePercentage + i), xZero), _mm_set1_ps(1.0f)), xSampleCount);
+		const __m128i xiSample = _mm_cvttps_epi32(_mm_min_ps(xPosition, xLastSample));
+		const __m128 xBlend = _mm_sub_ps(xPosition, _mm_cvtepi32_ps(xiSample));
+
+		alignas(16) int aiSample[REGISTER_WIDTH];
+		_mm_store_si128((__m128i *)aiSample, xiSample);
+
+		const __m128 xLow = _mm_set_ps(c_afSample[aiSample[3]], c_afSample[aiSample[2]], c_afSample[aiSample[1]], c_afSample[aiSample[0]]);
+		const __m128 xHigh = _mm_set_ps(c_afSample[aiSample[3] + 1], c_afSample[aiSample[2] + 1], c_afSample[aiSample[1] + 1], c_afSample[aiSample[0] + 1]);
+
+		_mm_storeu_ps(afValue + i, _mm_add_ps(xLow, _mm_mul_ps(_mm_sub_ps(xHigh, xLow), xBlend)));
+	}
+}
+
+void CParticleArray::__UpdateTextureAnimation(const CParticleProperty & c_rProperty, float fElapsedTime)
+{
+	const BYTE * c_abyType = m_kVct_byTextureAnimationType.data();
+	BYTE * abyFrameIndex = m_kVct_byFrameIndex.data();
+	float * afFrameTime = GetField(FIELD_FRAME_TIME);
+
+	const float fFrameDelay = c_rProperty.GetTextureAnimationFrameDelay();
+	const DWORD dwFrameCount = c_rProperty.GetTextureAnimationFrameCount();
+
+	for (UINT i = 0; i < m_uCount; ++i)
+	{
+		if (c_abyType[i] == CParticleProperty::TEXTURE_ANIMATION_TYPE_NONE)
+			continue;
+
+		afFrameTime[i] += fElapsedTime;
+
+		const uint64_t elapsedFrames = static_cast<uint64_t>(afFrameTime[i] / fFrameDelay);
+		if (0 == elapsedFrames)
+			continue;
+
+		afFrameTime[i] -= elapsedFrames * fFrameDelay;
+
+		switch (c_abyType[i])
+		{
+		case CParticleProperty::TEXTURE_ANIMATION_TYPE_CW:
+			abyFrameIndex[i] += elapsedFrames;
+			if (abyFrameIndex[i] >= dwFrameCount)
+				abyFrameIndex[i] = 0;
+			break;
+
+		case CParticleProperty::TEXTURE_ANIMATION_TYPE_CCW:
+			abyFrameIndex[i] = std::min<uint8_t>(abyFrameIndex[i] - elapsedFrames, dwFrameCount - 1);
+			break;
+
+		case CParticleProperty::TEXTURE_ANIMATION_TYPE_RANDOM_FRAME:
+			if (dwFrameCount != 0)
+				abyFrameIndex[i] = random_range(0, dwFrameCount - 1);
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+void CParticleArray::__Rotate(const CParticleProperty & c_rProperty, float fAngle, const D3DXVECTOR3 & c_rv3ZAxis)
+{
+	// Turns every particle around its start position, the same turn for all of them
+	D3DXVECTOR3 av3Axis[3];
+
+	if (c_rProperty.m_bAttachFlag)
+	{
+		const float fCos = cos(D3DXToRadian(fAngle));
+		const float fSin = sin(D3DXToRadian(fAngle));
+
+		av3Axis[0] = D3DXVECTOR3(fCos, -fSin, 0.0f);
+		av3Axis[1] = D3DXVECTOR3(fSin, fCos, 0.0f);
+		av3Axis[2] = D3DXVECTOR3(0.0f, 0.0f, 1.0f);
+	}
+	else
+	{
+		// The quaternion turn is linear, so it is taken as a matrix from the unit vectors
+		D3DXQUATERNION q, qc;
+		D3DXQuaternionRotationAxis(&q, &c_rv3ZAxis, D3DXToRadian(fAngle));
+		D3DXQuaternionConjugate(&qc, &q);
+
+		for (UINT uAxis = 0; uAxis < 3; ++uAxis)
+		{
+			D3DXQUATERNION qr(uAxis == 0 ? 1.0f : 0.0f, uAxis == 1 ? 1.0f : 0.0f, uAxis == 2 ? 1.0f : 0.0f, 0.0f);
+			D3DXQuaternionMultiply(&qr, &q, &qr);
+			D3DXQuaternionMultiply(&qr, &qr, &qc);
+			av3Axis[uAxis] = D3DXVECTOR3(qr.x, qr.y, qr.z);
+		}
+	}
+
+	float * afPositionX = GetField(FIELD_POSITION_X);
+	float * afPositionY = GetField(FIELD_POSITION_Y);
+	float * afPositionZ = GetField(FIELD_POSITION_Z);
+	const float * c_afStartX = GetField(FIELD_START_POSITION_X);
+	const float * c_afStartY = GetField(FIELD_START_POSITION_Y);
+	const float * c_afStartZ = GetField(FIELD_START_POSITION_Z);
+
+	const __m128 x00 = _mm_set1_ps(av3Axis[0].x), x01 = _mm_set1_ps(av3Axis[0].y), x02 = _mm_set1_ps(av3Axis[0].z);
+	const __m128 x10 = _mm_set1_ps(av3Axis[1].x), x11 = _mm_set1_ps(av3Axis[1].y), x12 = _mm_set1_ps(av3Axis[1].z);
+	const __m128 x20 = _mm_set1_ps(av3Axis[2].x), x21 = _mm_set1_ps(av3Axis[2].y), x22 = _mm_set1_ps(av3Axis[2].z);
+
+	for (UINT i = 0; i < m_uCount; i += REGISTER_WIDTH)
+	{
+		const __m128 xStartX = _mm_loadu_ps(c_afStartX + i);
+		const __m128 xStartY = _mm_loadu_ps(c_afStartY + i);
+		const __m128 xStartZ = _mm_loadu_ps(c_afStartZ + i);
+		const __m128 xRx = _mm_sub_ps(_mm_loadu_ps(afPositionX + i), xStartX);
+		const __m128 xRy = _mm_sub_ps(_mm_loadu_ps(afPositionY + i), xStartY);
+		const __m128 xRz = _mm_sub_ps(_mm_loadu_ps(afPositionZ + i), xStartZ);
+
+		const __m128 xX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x00, xRx), _mm_mul_ps(x10, xRy)), _mm_mul_ps(x20, xRz));
+		const __m128 xY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x01, xRx), _mm_mul_ps(x11, xRy)), _mm_mul_ps(x21, xRz));
+		const __m128 xZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x02, xRx), _mm_mul_ps(x12, xRy)), _mm_mul_ps(x22, xRz));
+
+		_mm_storeu_ps(afPositionX + i, _mm_add_ps(xX, xStartX));
+		_mm_storeu_ps(afPositionY + i, _mm_add_ps(xY, xStartY));
+		_mm_storeu_ps(afPositionZ + i, _mm_add_ps(xZ, xStartZ));
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+
+#include "Type.h"
+
+class CParticleProperty;
+
+// The particles of one CParticleSystemInstance, one array per attribute.
+// Every array holds GetCount() particles and is padded to a multiple of four,
+// so the update kernels always work on whole SSE registers. A dead particle
+// is replaced by the last one, the order is not kept.
+class CParticleArray
+{
+	public:
+		enum EField
+		{
+			FIELD_POSITION_X,
+			FIELD_POSITION_Y,
+			FIELD_POSITION_Z,
+			FIELD_LAST_POSITION_X,
+			FIELD_LAST_POSITION_Y,
+			FIELD_LAST_POSITION_Z,
+			FIELD_START_POSITION_X,
+			FIELD_START_POSITION_Y,
+			FIELD_START_POSITION_Z,
+			FIELD_VELOCITY_X,
+			FIELD_VELOCITY_Y,
+			FIELD_VELOCITY_Z,
+
+			FIELD_HALF_SIZE_X,
+			FIELD_HALF_SIZE_Y,
+			FIELD_SCALE_X,
+			FIELD_SCALE_Y,
+			FIELD_ROTATION,
+
+			FIELD_COLOR_R,
+			FIELD_COLOR_G,
+			FIELD_COLOR_B,
+			FIELD_COLOR_A,
+
+			FIELD_LIFE_TIME,
+			FIELD_LAST_LIFE_TIME,
+			FIELD_FRAME_TIME,
+
+			FIELD_LIFE_PERCENTAGE,	// of the current update
+			FIELD_TEMP,
+
+			FIELD_NUM,
+		};
+
+		enum
+		{
+			REGISTER_WIDTH = 4,
+		};
+
+	public:
+		CParticleArray();
+		~CParticleArray();
+
+		void Clear();
+		void Reserve(UINT uCount);
+
+		// The new particle's fields are left as they are, the caller sets every one
+		UINT Add();
+		void Remove(UINT uIndex);
+
+		UINT GetCount() const { return m_uCount; }
+
+		float * GetField(EField eField) { return m_kVct_fData.data() + eField * m_uCapacity; }
+		const float * GetField(EField eField) const { return m_kVct_fData.data() + eField * m_uCapacity; }
+
+		BYTE * GetFrameIndex() { return m_kVct_byFrameIndex.data(); }
+		const BYTE * GetFrameIndex() const { return m_kVct_byFrameIndex.data(); }
+		BYTE * GetTextureAnimationType() { return m_kVct_byTextureAnimationType.data(); }
+
+		// Ages every particle and removes the dead ones, returns how many died
+		UINT UpdateLife(float fElapsedTime);
+		// Moves, scales, colours and animates every particle by one frame.
+		// c_rv3ZAxis is the axis fAngle turns around when the particles are not attached to the emitter.
+		void Update(const CParticleProperty & c_rProperty, float fElapsedTime, float fAngle, const D3DXVECTOR3 & c_rv3ZAxis);
+
+	protected:
+		void __Grow(UINT uCapacity);
+
+		void __UpdateTextureAnimation(const CParticleProperty & c_rProperty, float fElapsedTime);
+		void __SampleTimeEvent(const float * c_afSample, float * afValue);
+		void __Rotate(const CParticleProperty & c_rProperty, float fAngle, const D3DXVECTOR3 & c_rv3ZAxis);
+
+	protected:
+		UINT					m_uCount;
+		UINT					m_uCapacity;
+
+		std::vector<float>		m_kVct_fData;		// FIELD_NUM arrays of m_uCapacity floats
+		std::vector<BYTE>		m_kVct_byFrameIndex;
+		std::vector<BYTE>		m_kVct_byTextureAnimationType;
+};
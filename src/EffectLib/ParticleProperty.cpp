@@ -53,10 +53,45 @@ void CParticleProperty::Clear()
 	m_TimeEventRotation.clear();
 
 	m_ImageVector.clear();
+
+	BuildTimeEventSample();
+}
+
+void CParticleProperty::BuildTimeEventSample()
+{
+	const TTimeEventTableFloat * c_apTimeEventFloat[] =
+	{
+		&m_TimeEventGravity,
+		&m_TimeEventAirResistance,
+		&m_TimeEventScaleX,
+		&m_TimeEventScaleY,
+	};
+
+	for (UINT uTimeEvent = 0; uTimeEvent < TIME_EVENT_COLOR_R; ++uTimeEvent)
+	{
+		const TTimeEventTableFloat & c_rTimeEvent = *c_apTimeEventFloat[uTimeEvent];
+		m_abTimeEventSample[uTimeEvent] = !c_rTimeEvent.empty();
+
+		for (UINT i = 0; i <= TIME_EVENT_SAMPLE_COUNT; ++i)
+			m_aafTimeEventSample[uTimeEvent][i] = GetTimeEventBlendValue(float(i) / TIME_EVENT_SAMPLE_COUNT, c_rTimeEvent);
+	}
+
+	for (UINT i = 0; i <= TIME_EVENT_SAMPLE_COUNT; ++i)
+	{
+		const D3DXCOLOR c_Color = GetTimeEventBlendValue(float(i) / TIME_EVENT_SAMPLE_COUNT, m_TimeEventColor);
+		m_aafTimeEventSample[TIME_EVENT_COLOR_R][i] = c_Color.r;
+		m_aafTimeEventSample[TIME_EVENT_COLOR_G][i] = c_Color.g;
+		m_aafTimeEventSample[TIME_EVENT_COLOR_B][i] = c_Color.b;
+		m_aafTimeEventSample[TIME_EVENT_COLOR_A][i] = c_Color.a;
+	}
+
+	for (UINT uTimeEvent = TIME_EVENT_COLOR_R; uTimeEvent <= TIME_EVENT_COLOR_A; ++uTimeEvent)
+		m_abTimeEventSample[uTimeEvent] = !m_TimeEventColor.empty();
 }
 
 CParticleProperty::CParticleProperty()
 {
+	BuildTimeEventSample();
 }
 CParticleProperty::~CParticleProperty()
 {
@@ -93,5 +128,7 @@ CParticleProperty & CParticleProperty::operator = ( const CParticleProperty& c_P
 
 	m_ImageVector = c_ParticleProperty.m_ImageVector;
 
+	BuildTimeEventSample();
+
 	return *this;
 }
\ No newline at end of file
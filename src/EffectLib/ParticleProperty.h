@@ -19,6 +19,21 @@ class CParticleProperty
 			ROTATION_TYPE_RANDOM_DIRECTION,
 		};
 
+		enum
+		{
+			TIME_EVENT_GRAVITY,
+			TIME_EVENT_AIR_RESISTANCE,
+			TIME_EVENT_SCALE_X,
+			TIME_EVENT_SCALE_Y,
+			TIME_EVENT_COLOR_R,
+			TIME_EVENT_COLOR_G,
+			TIME_EVENT_COLOR_B,
+			TIME_EVENT_COLOR_A,
+			TIME_EVENT_NUM,
+
+			TIME_EVENT_SAMPLE_COUNT = 64,	// samples over the particle's life, plus the end point
+		};
+
 		enum
 		{
 			TEXTURE_ANIMATION_TYPE_NONE,
@@ -33,21 +48,32 @@ class CParticleProperty
 		virtual ~CParticleProperty();
 
 		void Clear();
+		void BuildTimeEventSample();
+
+		__forceinline bool HasTimeEventSample(UINT uTimeEvent) const
+		{
+			return m_abTimeEventSample[uTimeEvent];
+		}
+
+		__forceinline const float * GetTimeEventSample(UINT uTimeEvent) const
+		{
+			return m_aafTimeEventSample[uTimeEvent];
+		}
 
 		void InsertTexture(const char * c_szFileName);
 		bool SetTexture(const char * c_szFileName);
 
-		__forceinline BYTE GetTextureAnimationType()
+		__forceinline BYTE GetTextureAnimationType() const
 		{
 			return m_byTexAniType;
 		}
 
-		__forceinline DWORD GetTextureAnimationFrameCount()
+		__forceinline DWORD GetTextureAnimationFrameCount() const
 		{
 			return m_ImageVector.size();
 		}
 
-		__forceinline float GetTextureAnimationFrameDelay()
+		__forceinline float GetTextureAnimationFrameDelay() const
 		{
 			return m_fTexAniDelay;
 		}
@@ -79,6 +105,11 @@ class CParticleProperty
 		TTimeEventTableFloat m_TimeEventRotation;
 
 		std::vector<CGraphicImage*> m_ImageVector;
+
+		// The time events above sampled over the life percentage, so updating a particle
+		// does not search them. Rebuilt by BuildTimeEventSample whenever they change.
+		bool m_abTimeEventSample[TIME_EVENT_NUM];
+		float m_aafTimeEventSample[TIME_EVENT_NUM][TIME_EVENT_SAMPLE_COUNT + 1];
 		
 		CParticleProperty & operator = ( const CParticleProperty& c_ParticleProperty );
 		
@@ -1,6 +1,5 @@
 #include "StdAfx.h"
 #include "ParticleSystemData.h"
-#include "ParticleInstance.h"
 
 CDynamicPool<CParticleSystemData>		CParticleSystemData::ms_kPool;
 
@@ -271,6 +270,8 @@ BOOL CParticleSystemData::OnLoadScript(CTextFileLoader & rTextFileLoader)
 
 		m_ParticleProperty.InsertTexture(strTextureFileName.c_str());
 	}
+
+	m_ParticleProperty.BuildTimeEventSample();
 	}
 
 	return TRUE;
@@ -5,9 +5,6 @@
 #include "EffectElementBase.h"
 #include "EmitterProperty.h"
 #include "ParticleProperty.h"
-//#include "ParticleInstance.h"
-
-class CParticleInstance;
 
 class CParticleSystemData : public CEffectElementBase
 {
@@ -1,17 +1,20 @@
 #include "StdAfx.h"
 #include "EterBase/Random.h"
 #include "EterLib/StateManager.h"
+#include "EterLib/Camera.h"
 #include "ParticleSystemData.h"
 #include "ParticleSystemInstance.h"
-#include "ParticleInstance.h"
 
 CDynamicPool<CParticleSystemInstance>	CParticleSystemInstance::ms_kPool;
 
+std::vector<DWORD> CParticleSystemInstance::ms_kVct_dwFrameStart;
+std::vector<DWORD> CParticleSystemInstance::ms_kVct_dwFrameParticle;
+std::vector<TPDTVertex> CParticleSystemInstance::ms_kVct_kQuadVertex;
+std::vector<WORD> CParticleSystemInstance::ms_kVct_wQuadIndex;
+
 void CParticleSystemInstance::DestroySystem()
 {
 	ms_kPool.Destroy();
-
-	CParticleInstance::DestroySystem();
 	//CRayParticleInstance::DestroySystem();
 }
 
@@ -30,7 +33,7 @@ void CParticleSystemInstance::Delete(CParticleSystemInstance* pkPSInst)
 
 DWORD CParticleSystemInstance::GetEmissionCount()
 {
-	return m_dwCurrentEmissionCount;
+	return m_kParticleArray.GetCount();
 }
 
 void CParticleSystemInstance::CreateParticles(float fElapsedTime)
@@ -86,62 +89,72 @@ void CParticleSystemInstance::CreateParticles(float fElapsedTime)
 
 	}
 
-	for (int i = 0; i < iCreatingCount; ++i)
-	{
-		CParticleInstance * pInstance;
+	if (iCreatingCount <= 0)
+		return;
+
+	// Added in place, so the arrays must not move while this runs
+	m_kParticleArray.Reserve(m_kParticleArray.GetCount() + iCreatingCount);
 
-		pInstance = CParticleInstance::New();
-		pInstance->m_pParticleProperty = m_pParticleProperty;
-		pInstance->m_pEmitterProperty = m_pEmitterProperty;
+	float * afField[CParticleArray::FIELD_NUM];
+	for (UINT uField = 0; uField < CParticleArray::FIELD_NUM; ++uField)
+		afField[uField] = m_kParticleArray.GetField(CParticleArray::EField(uField));
 
-		// LifeTime
-		pInstance->m_fLifeTime = fLifeTime;
-		pInstance->m_fLastLifeTime = fLifeTime;
+	const float c_fStartScaleX = m_pParticleProperty->m_TimeEventScaleX.front().m_Value;
+	const float c_fStartScaleY = m_pParticleProperty->m_TimeEventScaleY.front().m_Value;
+	const D3DXCOLOR c_StartColor = m_pParticleProperty->m_TimeEventColor.front().m_Value;
+
+	for (int i = 0; i < iCreatingCount; ++i)
+	{
+		D3DXVECTOR3 v3Position(0.0f, 0.0f, 0.0f);
+		D3DXVECTOR3 v3ParticleVelocity;
+		float fRotation;
+		BYTE byFrameIndex;
+		BYTE byTextureAnimationType;
 
 		// Position
 		switch (m_pEmitterProperty->GetEmitterShape())
 		{
 			case CEmitterProperty::EMITTER_SHAPE_POINT:
-				pInstance->m_v3Position.x = 0.0f;
-				pInstance->m_v3Position.y = 0.0f;
-				pInstance->m_v3Position.z = 0.0f;
+				v3Position.x = 0.0f;
+				v3Position.y = 0.0f;
+				v3Position.z = 0.0f;
 				break;
 
 			case CEmitterProperty::EMITTER_SHAPE_ELLIPSE:
-				pInstance->m_v3Position.x = frandom(-500.0f, 500.0f);
-				pInstance->m_v3Position.y = frandom(-500.0f, 500.0f);
-				pInstance->m_v3Position.z = 0.0f;
-				D3DXVec3Normalize(&pInstance->m_v3Position, &pInstance->m_v3Position);
+				v3Position.x = frandom(-500.0f, 500.0f);
+				v3Position.y = frandom(-500.0f, 500.0f);
+				v3Position.z = 0.0f;
+				D3DXVec3Normalize(&v3Position, &v3Position);
 
 				if (m_pEmitterProperty->isEmitFromEdge())
 				{
-					pInstance->m_v3Position *= (m_pEmitterProperty->m_fEmittingRadius + fEmittingSize);
+					v3Position *= (m_pEmitterProperty->m_fEmittingRadius + fEmittingSize);
 				}
 				else
 				{
-					pInstance->m_v3Position *= (frandom(0.0f, m_pEmitterProperty->m_fEmittingRadius) + fEmittingSize);
+					v3Position *= (frandom(0.0f, m_pEmitterProperty->m_fEmittingRadius) + fEmittingSize);
 				}
 				break;
 
 			case CEmitterProperty::EMITTER_SHAPE_SQUARE:
-				pInstance->m_v3Position.x = (frandom(-m_pEmitterProperty->m_v3EmittingSize.x/2.0f, m_pEmitterProperty->m_v3EmittingSize.x/2.0f) + fEmittingSize);
-				pInstance->m_v3Position.y = (frandom(-m_pEmitterProperty->m_v3EmittingSize.y/2.0f, m_pEmitterProperty->m_v3EmittingSize.y/2.0f) + fEmittingSize);
-				pInstance->m_v3Position.z = (frandom(-m_pEmitterProperty->m_v3EmittingSize.z/2.0f, m_pEmitterProperty->m_v3EmittingSize.z/2.0f) + fEmittingSize);
+				v3Position.x = (frandom(-m_pEmitterProperty->m_v3EmittingSize.x/2.0f, m_pEmitterProperty->m_v3EmittingSize.x/2.0f) + fEmittingSize);
+				v3Position.y = (frandom(-m_pEmitterProperty->m_v3EmittingSize.y/2.0f, m_pEmitterProperty->m_v3EmittingSize.y/2.0f) + fEmittingSize);
+				v3Position.z = (frandom(-m_pEmitterProperty->m_v3EmittingSize.z/2.0f, m_pEmitterProperty->m_v3EmittingSize.z/2.0f) + fEmittingSize);
 				break;
 
 			case CEmitterProperty::EMITTER_SHAPE_SPHERE:
-				pInstance->m_v3Position.x = frandom(-500.0f, 500.0f);
-				pInstance->m_v3Position.y = frandom(-500.0f, 500.0f);
-				pInstance->m_v3Position.z = frandom(-500.0f, 500.0f);
-				D3DXVec3Normalize(&pInstance->m_v3Position, &pInstance->m_v3Position);
+				v3Position.x = frandom(-500.0f, 500.0f);
+				v3Position.y = frandom(-500.0f, 500.0f);
+				v3Position.z = frandom(-500.0f, 500.0f);
+				D3DXVec3Normalize(&v3Position, &v3Position);
 
 				if (m_pEmitterProperty->isEmitFromEdge())
 				{
-					pInstance->m_v3Position *= (m_pEmitterProperty->m_fEmittingRadius + fEmittingSize);
+					v3Position *= (m_pEmitterProperty->m_fEmittingRadius + fEmittingSize);
 				}
 				else
 				{
-					pInstance->m_v3Position *= (frandom(0.0f, m_pEmitterProperty->m_fEmittingRadius) + fEmittingSize);
+					v3Position *= (frandom(0.0f, m_pEmitterProperty->m_fEmittingRadius) + fEmittingSize);
 				}
 				break;
 		}
@@ -149,42 +162,40 @@ void CParticleSystemInstance::CreateParticles(float fElapsedTime)
 		// Position
 		D3DXVECTOR3 v3TimePosition=_v3TimePosition;
 
-		pInstance->m_v3Position += v3TimePosition;
+		v3Position += v3TimePosition;
 
 		if (mc_pmatLocal && !m_pParticleProperty->m_bAttachFlag)
 		{
-			D3DXVec3TransformCoord(&pInstance->m_v3Position,&pInstance->m_v3Position,mc_pmatLocal);
+			D3DXVec3TransformCoord(&v3Position,&v3Position,mc_pmatLocal);
 			D3DXVec3TransformCoord(&v3TimePosition, &v3TimePosition, mc_pmatLocal);
 		}
-		pInstance->m_v3StartPosition = v3TimePosition;
 		// NOTE : Update를 호출하지 않고 Rendering 되기 때문에 length가 0이 되는 문제가 있다.
 		//        Velocity를 구한 후 그만큼 빼준 값으로 초기화 해주도록 바꿨음 - [levites]
-		//pInstance->m_v3LastPosition = pInstance->m_v3Position;
 
 		// Direction & Velocity
-		pInstance->m_v3Velocity.x = 0.0f;
-		pInstance->m_v3Velocity.y = 0.0f;
-		pInstance->m_v3Velocity.z = 0.0f;
+		v3ParticleVelocity.x = 0.0f;
+		v3ParticleVelocity.y = 0.0f;
+		v3ParticleVelocity.z = 0.0f;
 
 		if (CEmitterProperty::EMITTER_ADVANCED_TYPE_INNER == m_pEmitterProperty->GetEmitterAdvancedType())
 		{
-			auto d3dd = (pInstance->m_v3Position - v3TimePosition);
-			D3DXVec3Normalize(&pInstance->m_v3Velocity, &d3dd);
-			pInstance->m_v3Velocity *= -100.0f;
+			auto d3dd = (v3Position - v3TimePosition);
+			D3DXVec3Normalize(&v3ParticleVelocity, &d3dd);
+			v3ParticleVelocity *= -100.0f;
 		}
 		else if (CEmitterProperty::EMITTER_ADVANCED_TYPE_OUTER == m_pEmitterProperty->GetEmitterAdvancedType())
 		{
 			if (m_pEmitterProperty->GetEmitterShape() == CEmitterProperty::EMITTER_SHAPE_POINT)
 			{
-				pInstance->m_v3Velocity.x = frandom(-100.0f, 100.0f);
-				pInstance->m_v3Velocity.y = frandom(-100.0f, 100.0f);
-				pInstance->m_v3Velocity.z = frandom(-100.0f, 100.0f);
+				v3ParticleVelocity.x = frandom(-100.0f, 100.0f);
+				v3ParticleVelocity.y = frandom(-100.0f, 100.0f);
+				v3ParticleVelocity.z = frandom(-100.0f, 100.0f);
 			}
 			else
 			{
-				auto d3dd = (pInstance->m_v3Position - v3TimePosition);
-				D3DXVec3Normalize(&pInstance->m_v3Velocity, &d3dd);
-				pInstance->m_v3Velocity *= 100.0f;
+				auto d3dd = (v3Position - v3TimePosition);
+				D3DXVec3Normalize(&v3ParticleVelocity, &d3dd);
+				v3ParticleVelocity *= 100.0f;
 			}
 		}
 
@@ -194,32 +205,29 @@ void CParticleSystemInstance::CreateParticles(float fElapsedTime)
 			D3DXVec3TransformNormal(&v3Velocity, &v3Velocity, mc_pmatLocal);
 		}
 
-		pInstance->m_v3Velocity += v3Velocity;
+		v3ParticleVelocity += v3Velocity;
 		if (m_pEmitterProperty->m_v3EmittingDirection.x > 0.0f)
-			pInstance->m_v3Velocity.x += frandom(-m_pEmitterProperty->m_v3EmittingDirection.x/2.0f, m_pEmitterProperty->m_v3EmittingDirection.x/2.0f) * 1000.0f;
+			v3ParticleVelocity.x += frandom(-m_pEmitterProperty->m_v3EmittingDirection.x/2.0f, m_pEmitterProperty->m_v3EmittingDirection.x/2.0f) * 1000.0f;
 		if (m_pEmitterProperty->m_v3EmittingDirection.y > 0.0f)
-			pInstance->m_v3Velocity.y += frandom(-m_pEmitterProperty->m_v3EmittingDirection.y/2.0f, m_pEmitterProperty->m_v3EmittingDirection.y/2.0f) * 1000.0f;
+			v3ParticleVelocity.y += frandom(-m_pEmitterProperty->m_v3EmittingDirection.y/2.0f, m_pEmitterProperty->m_v3EmittingDirection.y/2.0f) * 1000.0f;
 		if (m_pEmitterProperty->m_v3EmittingDirection.z > 0.0f)
-			pInstance->m_v3Velocity.z += frandom(-m_pEmitterProperty->m_v3EmittingDirection.z/2.0f, m_pEmitterProperty->m_v3EmittingDirection.z/2.0f) * 1000.0f;
-
-		pInstance->m_v3Velocity *= fVelocity;
+			v3ParticleVelocity.z += frandom(-m_pEmitterProperty->m_v3EmittingDirection.z/2.0f, m_pEmitterProperty->m_v3EmittingDirection.z/2.0f) * 1000.0f;
 
-		// Size
-		pInstance->m_v2HalfSize = v2HalfSize;
+		v3ParticleVelocity *= fVelocity;
 
 		// Rotation
-		pInstance->m_fRotation = m_pParticleProperty->m_wRotationRandomStartingBegin;
-		pInstance->m_fRotation = frandom(m_pParticleProperty->m_wRotationRandomStartingBegin,m_pParticleProperty->m_wRotationRandomStartingEnd);
+		fRotation = m_pParticleProperty->m_wRotationRandomStartingBegin;
+		fRotation = frandom(m_pParticleProperty->m_wRotationRandomStartingBegin,m_pParticleProperty->m_wRotationRandomStartingEnd);
 		// Rotation - Lie 일 경우 LocalMatrix 의 Rotation 값을 Random 에 적용한다.
 		//            매번 할 필요는 없을듯. 어느 정도의 최적화가 필요. - [levites]
 		if (BILLBOARD_TYPE_LIE == m_pParticleProperty->m_byBillboardType && mc_pmatLocal)
 		{
-			pInstance->m_fRotation += fLieRotation;
+			fRotation += fLieRotation;
 		}
 
 		// Texture Animation
-		pInstance->m_byFrameIndex = 0;
-		pInstance->m_byTextureAnimationType = m_pParticleProperty->GetTextureAnimationType();
+		byFrameIndex = 0;
+		byTextureAnimationType = m_pParticleProperty->GetTextureAnimationType();
 
 		if (m_pParticleProperty->GetTextureAnimationFrameCount() > 1)
 		{
@@ -227,32 +235,55 @@ void CParticleSystemInstance::CreateParticles(float fElapsedTime)
 			{
 				if (random() & 1)
 				{
-					pInstance->m_byFrameIndex = 0;
-					pInstance->m_byTextureAnimationType = CParticleProperty::TEXTURE_ANIMATION_TYPE_CW;
+					byFrameIndex = 0;
+					byTextureAnimationType = CParticleProperty::TEXTURE_ANIMATION_TYPE_CW;
 				}
 				else
 				{
-					pInstance->m_byFrameIndex = m_pParticleProperty->GetTextureAnimationFrameCount() - 1;
-					pInstance->m_byTextureAnimationType = CParticleProperty::TEXTURE_ANIMATION_TYPE_CCW;
+					byFrameIndex = m_pParticleProperty->GetTextureAnimationFrameCount() - 1;
+					byTextureAnimationType = CParticleProperty::TEXTURE_ANIMATION_TYPE_CCW;
 				}
 			}
 			if (m_pParticleProperty->m_bTexAniRandomStartFrameFlag)
 			{
-				pInstance->m_byFrameIndex = random_range(0,m_pParticleProperty->GetTextureAnimationFrameCount()-1);
+				byFrameIndex = random_range(0,m_pParticleProperty->GetTextureAnimationFrameCount()-1);
 			}
 		}
 
-		// Simple Update
-		{
-			pInstance->m_v3LastPosition = pInstance->m_v3Position - (pInstance->m_v3Velocity * fElapsedTime);
-			pInstance->m_v2Scale.x = m_pParticleProperty->m_TimeEventScaleX.front().m_Value;
-			pInstance->m_v2Scale.y= m_pParticleProperty->m_TimeEventScaleY.front().m_Value;
-			//pInstance->m_v2Scale = m_pParticleProperty->m_TimeEventScaleXY.front().m_Value;
-			pInstance->m_Color = m_pParticleProperty->m_TimeEventColor.front().m_Value;
-		}
+		const UINT uIndex = m_kParticleArray.Add();
+
+		afField[CParticleArray::FIELD_LIFE_TIME][uIndex] = fLifeTime;
+		afField[CParticleArray::FIELD_LAST_LIFE_TIME][uIndex] = fLifeTime;
+		afField[CParticleArray::FIELD_FRAME_TIME][uIndex] = 0.0f;
 
-		m_ParticleInstanceListVector[pInstance->m_byFrameIndex].push_back(pInstance);
-		m_dwCurrentEmissionCount++;
+		afField[CParticleArray::FIELD_POSITION_X][uIndex] = v3Position.x;
+		afField[CParticleArray::FIELD_POSITION_Y][uIndex] = v3Position.y;
+		afField[CParticleArray::FIELD_POSITION_Z][uIndex] = v3Position.z;
+		afField[CParticleArray::FIELD_START_POSITION_X][uIndex] = v3TimePosition.x;
+		afField[CParticleArray::FIELD_START_POSITION_Y][uIndex] = v3TimePosition.y;
+		afField[CParticleArray::FIELD_START_POSITION_Z][uIndex] = v3TimePosition.z;
+		afField[CParticleArray::FIELD_VELOCITY_X][uIndex] = v3ParticleVelocity.x;
+		afField[CParticleArray::FIELD_VELOCITY_Y][uIndex] = v3ParticleVelocity.y;
+		afField[CParticleArray::FIELD_VELOCITY_Z][uIndex] = v3ParticleVelocity.z;
+
+		// Simple Update
+		afField[CParticleArray::FIELD_LAST_POSITION_X][uIndex] = v3Position.x - v3ParticleVelocity.x * fElapsedTime;
+		afField[CParticleArray::FIELD_LAST_POSITION_Y][uIndex] = v3Position.y - v3ParticleVelocity.y * fElapsedTime;
+		afField[CParticleArray::FIELD_LAST_POSITION_Z][uIndex] = v3Position.z - v3ParticleVelocity.z * fElapsedTime;
+
+		afField[CParticleArray::FIELD_HALF_SIZE_X][uIndex] = v2HalfSize.x;
+		afField[CParticleArray::FIELD_HALF_SIZE_Y][uIndex] = v2HalfSize.y;
+		afField[CParticleArray::FIELD_SCALE_X][uIndex] = c_fStartScaleX;
+		afField[CParticleArray::FIELD_SCALE_Y][uIndex] = c_fStartScaleY;
+		afField[CParticleArray::FIELD_ROTATION][uIndex] = fRotation;
+
+		afField[CParticleArray::FIELD_COLOR_R][uIndex] = c_StartColor.r;
+		afField[CParticleArray::FIELD_COLOR_G][uIndex] = c_StartColor.g;
+		afField[CParticleArray::FIELD_COLOR_B][uIndex] = c_StartColor.b;
+		afField[CParticleArray::FIELD_COLOR_A][uIndex] = c_StartColor.a;
+
+		m_kParticleArray.GetFrameIndex()[uIndex] = byFrameIndex;
+		m_kParticleArray.GetTextureAnimationType()[uIndex] = byTextureAnimationType;
 	}
 }
 
@@ -281,9 +312,6 @@ bool CParticleSystemInstance::OnUpdate(float fElapsedTime)
 
 	/////
 
-	int dwFrameIndex;
-	int dwFrameCount = m_pParticleProperty->GetTextureAnimationFrameCount();
-
 	float fAngularVelocity;
 	m_pEmitterProperty->GetEmittingAngularVelocity(m_fLocalTime,&fAngularVelocity);
 	
@@ -293,161 +321,323 @@ bool CParticleSystemInstance::OnUpdate(float fElapsedTime)
 		D3DXVec3TransformNormal(&m_pParticleProperty->m_v3ZAxis,&d3dd,mc_pmatLocal);
 	}
 
-	for (dwFrameIndex = 0; dwFrameIndex < dwFrameCount; dwFrameIndex++)
+	m_kParticleArray.UpdateLife(fElapsedTime);
+	m_kParticleArray.Update(*m_pParticleProperty, fElapsedTime, fAngularVelocity, m_pParticleProperty->m_v3ZAxis);
+
+	if (isActive() && bMakeParticle)
+		CreateParticles(fElapsedTime);
+
+	return true;
+}
+
+bool CParticleSystemInstance::__InFrustum(UINT uIndex)
+{
+	const CParticleArray & c_rArray = m_kParticleArray;
+
+	Vector3d v3Position(
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_X)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_Y)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_Z)[uIndex]);
+
+	if (m_pParticleProperty->m_bAttachFlag)
 	{
-		TParticleInstanceList::iterator itor = m_ParticleInstanceListVector[dwFrameIndex].begin();
-		for (; itor != m_ParticleInstanceListVector[dwFrameIndex].end();)
-		{
-			CParticleInstance * pInstance = *itor;
+		v3Position.x += mc_pmatLocal->_41;
+		v3Position.y += mc_pmatLocal->_42;
+		v3Position.z += mc_pmatLocal->_43;
+	}
+
+	const float fRadius =
+		c_rArray.GetField(CParticleArray::FIELD_HALF_SIZE_Y)[uIndex] * c_rArray.GetField(CParticleArray::FIELD_SCALE_Y)[uIndex] +
+		c_rArray.GetField(CParticleArray::FIELD_HALF_SIZE_X)[uIndex] * c_rArray.GetField(CParticleArray::FIELD_SCALE_X)[uIndex];
+
+	return CScreen::GetFrustum().ViewVolumeTest(v3Position, fRadius) != VS_OUTSIDE;
+}
+
+void CParticleSystemInstance::__BuildQuad(UINT uIndex, float fZRotation, TPDTVertex * pVertex)
+{
+	const CParticleArray & c_rArray = m_kParticleArray;
+	const D3DXMATRIX * c_matLocal = m_pParticleProperty->m_bAttachFlag ? mc_pmatLocal : NULL;
+
+	const D3DXVECTOR3 v3Position(
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_X)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_Y)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_POSITION_Z)[uIndex]);
+	const float fRotation = c_rArray.GetField(CParticleArray::FIELD_ROTATION)[uIndex];
 
-			if (!pInstance->Update(fElapsedTime,fAngularVelocity)) [[unlikely]] {
-				pInstance->DeleteThis();
+	D3DXVECTOR3 v3Up;
+	D3DXVECTOR3 v3Cross;
 
-				itor = m_ParticleInstanceListVector[dwFrameIndex].erase(itor);
-				m_dwCurrentEmissionCount--;
+	if (!m_pParticleProperty->m_bStretchFlag)
+	{
+		switch(m_pParticleProperty->m_byBillboardType) {
+		case BILLBOARD_TYPE_LIE:
+			{
+				float fCos = cosf(D3DXToRadian(fRotation)), fSin = sinf(D3DXToRadian(fRotation));
+				v3Up.x = fCos;
+				v3Up.y = -fSin;
+				v3Up.z = 0;
+				v3Cross.x = fSin;
+				v3Cross.y = fCos;
+				v3Cross.z = 0;
 			}
-			else [[likely]] {
-				if (pInstance->m_byFrameIndex != dwFrameIndex)
+			break;
+		case BILLBOARD_TYPE_2FACE:
+		case BILLBOARD_TYPE_3FACE:
+			// using setting with y, and local rotation at render
+		case BILLBOARD_TYPE_Y:
+			{
+				v3Up = D3DXVECTOR3(0.0f,0.0f,1.0f);
+				if (v3Up.x * m_v3CameraView.y - v3Up.y * m_v3CameraView.x<0)
+					v3Up*=-1;
+				auto d3dd = D3DXVECTOR3(m_v3CameraView.x, m_v3CameraView.y, 0);
+				D3DXVec3Cross(&v3Cross, &v3Up, &d3dd);
+				D3DXVec3Normalize(&v3Cross, &v3Cross);
+
+				if (fRotation)
 				{
-					m_ParticleInstanceListVector[dwFrameCount+pInstance->m_byFrameIndex].push_back(*itor);
-					itor = m_ParticleInstanceListVector[dwFrameIndex].erase(itor);
+					float fCos = -sinf(D3DXToRadian(fRotation)); // + 90
+					float fSin = cosf(D3DXToRadian(fRotation));
+					
+					D3DXVECTOR3 v3Temp = v3Up * fCos - v3Cross * fSin;
+					v3Cross = v3Cross * fCos + v3Up * fSin;
+					v3Up = v3Temp;
+				}
+			}
+			break;
+		case BILLBOARD_TYPE_ALL:
+		default:
+			{
+				// NOTE : Rotation Routine. Camera의 Up Vector와 Cross Vector 자체를 View Vector 기준으로
+				//        Rotation 시킨다.
+				if (fRotation==0.0f)
+				{
+					v3Up = -m_v3CameraCross;
+					v3Cross = m_v3CameraUp;
 				}
 				else
-					++itor;
+				{
+					D3DXQUATERNION q,qc;
+					D3DXQuaternionRotationAxis(&q, &m_v3CameraView, D3DXToRadian(fRotation));
+					D3DXQuaternionConjugate(&qc, &q);
+					
+					{
+						D3DXQUATERNION qr(-m_v3CameraCross.x, -m_v3CameraCross.y, -m_v3CameraCross.z, 0);
+						D3DXQuaternionMultiply(&qr,&qc,&qr);
+						D3DXQuaternionMultiply(&qr,&qr,&q);
+						v3Up.x = qr.x;
+						v3Up.y = qr.y;
+						v3Up.z = qr.z;
+					}
+					{
+						D3DXQUATERNION qr(m_v3CameraUp.x, m_v3CameraUp.y, m_v3CameraUp.z, 0);
+						D3DXQuaternionMultiply(&qr,&qc,&qr);
+						D3DXQuaternionMultiply(&qr,&qr,&q);
+						v3Cross.x = qr.x;
+						v3Cross.y = qr.y;
+						v3Cross.z = qr.z;
+					}
+				}
 			}
+			break;
+		} 
+	}
+	else
+	{
+		v3Up.x = v3Position.x - c_rArray.GetField(CParticleArray::FIELD_LAST_POSITION_X)[uIndex];
+		v3Up.y = v3Position.y - c_rArray.GetField(CParticleArray::FIELD_LAST_POSITION_Y)[uIndex];
+		v3Up.z = v3Position.z - c_rArray.GetField(CParticleArray::FIELD_LAST_POSITION_Z)[uIndex];
+
+		if (c_matLocal)
+			D3DXVec3TransformNormal(&v3Up, &v3Up, c_matLocal);
+
+		// NOTE: 속도가 길이에 주는 영향 : log(velocity)만큼 늘어난다.
+		float length = D3DXVec3Length(&v3Up);
+		if (length == 0.0f)
+		{
+			v3Up = D3DXVECTOR3(0.0f,0.0f,1.0f);
 		}
+		else
+			v3Up *=(1+log(1+length))/length;
+
+		D3DXVec3Cross(&v3Cross, &v3Up, &m_v3CameraView);
+		D3DXVec3Normalize(&v3Cross, &v3Cross);
 	}
-	if (isActive() && bMakeParticle)
-		CreateParticles(fElapsedTime);
 
-	for (dwFrameIndex = 0; dwFrameIndex < dwFrameCount; ++dwFrameIndex)
+	if (fZRotation)
 	{
-		m_ParticleInstanceListVector[dwFrameIndex].splice(m_ParticleInstanceListVector[dwFrameIndex].end(),m_ParticleInstanceListVector[dwFrameIndex+dwFrameCount]);
-		m_ParticleInstanceListVector[dwFrameIndex+dwFrameCount].clear();
+		float x, y;
+		float fCos = cosf(fZRotation);
+		float fSin = sinf(fZRotation);
+
+		x = v3Up.x;
+		y = v3Up.y;
+		v3Up.x = x * fCos - y * fSin;
+		v3Up.y = y * fCos + x * fSin;
+
+		x = v3Cross.x;
+		y = v3Cross.y;
+		v3Cross.x = x * fCos - y * fSin;
+		v3Cross.y = y * fCos + x * fSin;
 	}
 
-	return true;
+	v3Cross = -(c_rArray.GetField(CParticleArray::FIELD_HALF_SIZE_X)[uIndex] * c_rArray.GetField(CParticleArray::FIELD_SCALE_X)[uIndex]) * v3Cross;
+	v3Up = (c_rArray.GetField(CParticleArray::FIELD_HALF_SIZE_Y)[uIndex] * c_rArray.GetField(CParticleArray::FIELD_SCALE_Y)[uIndex]) * v3Up;
+
+	D3DXVECTOR3 v3Center = v3Position;
+	if (c_matLocal)
+		D3DXVec3TransformCoord(&v3Center, &v3Position, c_matLocal);
+
+	const DWORD dwColor = D3DXCOLOR(
+		c_rArray.GetField(CParticleArray::FIELD_COLOR_R)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_COLOR_G)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_COLOR_B)[uIndex],
+		c_rArray.GetField(CParticleArray::FIELD_COLOR_A)[uIndex]);
+
+	pVertex[0].position = v3Center - v3Up + v3Cross;
+	pVertex[1].position = v3Center - v3Up - v3Cross;
+	pVertex[2].position = v3Center + v3Up + v3Cross;
+	pVertex[3].position = v3Center + v3Up - v3Cross;
+
+	pVertex[0].texCoord = D3DXVECTOR2(0.0f, 1.0f);
+	pVertex[1].texCoord = D3DXVECTOR2(0.0f, 0.0f);
+	pVertex[2].texCoord = D3DXVECTOR2(1.0f, 1.0f);
+	pVertex[3].texCoord = D3DXVECTOR2(1.0f, 0.0f);
+
+	for (int i = 0; i < 4; ++i)
+		pVertex[i].diffuse = dwColor;
+}
+
+void CParticleSystemInstance::__FlushQuad(UINT uQuadCount)
+{
+	STATEMANAGER.DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, 0, uQuadCount * 4, uQuadCount * 2,
+										&ms_kVct_wQuadIndex[0], D3DFMT_INDEX16,
+										&ms_kVct_kQuadVertex[0], sizeof(TPDTVertex));
 }
 
-namespace NParticleRenderer
+void CParticleSystemInstance::OnRender()
 {
-	struct TwoSideRenderer
+	const UINT uParticleCount = m_kParticleArray.GetCount();
+	const UINT uFrameCount = m_kVct_pkImgInst.size();
+	if (!uParticleCount || !uFrameCount)
+		return;
+
+	if (ms_kVct_wQuadIndex.empty())
 	{
-		const D3DXMATRIX * pmat;
-		TwoSideRenderer(const D3DXMATRIX * pmat=NULL)
-			: pmat(pmat)
+		ms_kVct_kQuadVertex.resize(MAX_BATCH_QUAD_COUNT * 4);
+		ms_kVct_wQuadIndex.resize(MAX_BATCH_QUAD_COUNT * 6);
+
+		for (WORD i = 0; i < MAX_BATCH_QUAD_COUNT; ++i)
 		{
+			// The strip order the quads were built for, 0 1 2 and 2 1 3
+			WORD * pwIndex = &ms_kVct_wQuadIndex[i * 6];
+			pwIndex[0] = i * 4 + 0;
+			pwIndex[1] = i * 4 + 1;
+			pwIndex[2] = i * 4 + 2;
+			pwIndex[3] = i * 4 + 2;
+			pwIndex[4] = i * 4 + 1;
+			pwIndex[5] = i * 4 + 3;
 		}
-		
-		inline void operator () (CParticleInstance * pInstance)
-		{
-			pInstance->Transform(pmat,D3DXToRadian(-30.0f));
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
+	}
 
-			pInstance->Transform(pmat,D3DXToRadian(+30.0f));
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-		}
-	};
-	
-	struct ThreeSideRenderer
+	// The visible particles of each texture frame, by a counting sort
+	ms_kVct_dwFrameStart.assign(uFrameCount + 1, 0);
+	ms_kVct_dwFrameParticle.resize(uParticleCount * 2);
+
+	DWORD * adwFrameKey = &ms_kVct_dwFrameParticle[uParticleCount];
+	const BYTE * c_abyFrameIndex = m_kParticleArray.GetFrameIndex();
+
+	for (UINT i = 0; i < uParticleCount; ++i)
 	{
-		const D3DXMATRIX * pmat;
-		ThreeSideRenderer(const D3DXMATRIX * pmat=NULL)
-			: pmat(pmat)
-		{
-		}
-		
-		inline void operator () (CParticleInstance * pInstance)
-		{
-			pInstance->Transform(pmat);
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-			pInstance->Transform(pmat,D3DXToRadian(-60.0f));
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-			pInstance->Transform(pmat,D3DXToRadian(+60.0f));
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-		}
-	};
-	
-	struct NormalRenderer
+		adwFrameKey[i] = uFrameCount;
+		if (c_abyFrameIndex[i] >= uFrameCount || !__InFrustum(i))
+			continue;
+
+		adwFrameKey[i] = c_abyFrameIndex[i];
+		++ms_kVct_dwFrameStart[c_abyFrameIndex[i] + 1];
+	}
+
+	for (UINT uFrame = 0; uFrame < uFrameCount; ++uFrame)
+		ms_kVct_dwFrameStart[uFrame + 1] += ms_kVct_dwFrameStart[uFrame];
+
+	// Leaves each start at the end of its frame, which is where the next one begins
+	for (UINT i = 0; i < uParticleCount; ++i)
 	{
-		inline void operator () (CParticleInstance * pInstance)
-		{
-			pInstance->Transform();
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-		}
-	};
-	struct AttachRenderer
+		if (adwFrameKey[i] < uFrameCount)
+			ms_kVct_dwFrameParticle[ms_kVct_dwFrameStart[adwFrameKey[i]]++] = i;
+	}
+
+	float afZRotation[3] = { 0.0f, 0.0f, 0.0f };
+	UINT uFaceCount = 1;
+	if (m_pParticleProperty->m_byBillboardType == BILLBOARD_TYPE_2FACE)
 	{
-		const D3DXMATRIX* pmat;
-		AttachRenderer(const D3DXMATRIX * pmat)
-			: pmat(pmat)
-		{
-		}
-		
-		inline void operator () (CParticleInstance * pInstance)
-		{
-			pInstance->Transform(pmat);
-			STATEMANAGER.DrawPrimitiveUP(D3DPT_TRIANGLESTRIP, 2, pInstance->GetParticleMeshPointer(), sizeof(TPTVertex));
-		}
-	};
-}
+		afZRotation[0] = D3DXToRadian(-30.0f);
+		afZRotation[1] = D3DXToRadian(+30.0f);
+		uFaceCount = 2;
+	}
+	else if (m_pParticleProperty->m_byBillboardType == BILLBOARD_TYPE_3FACE)
+	{
+		afZRotation[1] = D3DXToRadian(-60.0f);
+		afZRotation[2] = D3DXToRadian(+60.0f);
+		uFaceCount = 3;
+	}
+
+	CCamera * pCurrentCamera = CCameraManager::Instance().GetCurrentCamera();
+	m_v3CameraUp = pCurrentCamera->GetUp();
+	m_v3CameraCross = pCurrentCamera->GetCross();
+	m_v3CameraView = pCurrentCamera->GetView();
 
-void CParticleSystemInstance::OnRender()
-{
 	CScreen::Identity();
 	STATEMANAGER.SetRenderState(D3DRS_SRCBLEND, m_pParticleProperty->m_bySrcBlendType);
 	STATEMANAGER.SetRenderState(D3DRS_DESTBLEND, m_pParticleProperty->m_byDestBlendType);
 	STATEMANAGER.SetTextureStageState(0,D3DTSS_COLOROP,m_pParticleProperty->m_byColorOperationType);
-	if (m_pParticleProperty->m_byBillboardType < BILLBOARD_TYPE_2FACE)
-	{
-		if (!m_pParticleProperty->m_bAttachFlag)
-		{
-			auto obj = NParticleRenderer::NormalRenderer();
-			ForEachParticleRendering(obj);
-		}
-		else
-		{
-			auto obj = NParticleRenderer::AttachRenderer(mc_pmatLocal);
-			ForEachParticleRendering(obj);
-		}
-	}
-	else if (m_pParticleProperty->m_byBillboardType == BILLBOARD_TYPE_2FACE)
-	{
-		if (!m_pParticleProperty->m_bAttachFlag)
-		{
-			auto obj = NParticleRenderer::TwoSideRenderer();
-			ForEachParticleRendering(obj);
-		}
-		else
-		{
-			auto obj = NParticleRenderer::TwoSideRenderer(mc_pmatLocal);
-			ForEachParticleRendering(obj);
-		}
-	}
-	else if (m_pParticleProperty->m_byBillboardType == BILLBOARD_TYPE_3FACE)
+
+	// The colour comes with the vertices, so a whole frame goes in one call
+	STATEMANAGER.SaveFVF(D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1);
+	STATEMANAGER.SaveTextureStageState(0, D3DTSS_COLORARG1, D3DTA_DIFFUSE);
+	STATEMANAGER.SaveTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_DIFFUSE);
+
+	for (UINT uFrame = 0; uFrame < uFrameCount; ++uFrame)
 	{
-		if (!m_pParticleProperty->m_bAttachFlag)
-		{
-			auto obj = NParticleRenderer::ThreeSideRenderer();
-			ForEachParticleRendering(obj);
-		}
-		else
+		const DWORD dwStart = uFrame ? ms_kVct_dwFrameStart[uFrame - 1] : 0;
+		const DWORD dwEnd = ms_kVct_dwFrameStart[uFrame];
+		if (dwStart == dwEnd)
+			continue;
+
+		STATEMANAGER.SetTexture(0, m_kVct_pkImgInst[uFrame]->GetTextureReference().GetD3DTexture());
+
+		UINT uQuadCount = 0;
+		for (DWORD j = dwStart; j < dwEnd; ++j)
 		{
-			auto obj = NParticleRenderer::ThreeSideRenderer(mc_pmatLocal);
-			ForEachParticleRendering(obj);
+			for (UINT uFace = 0; uFace < uFaceCount; ++uFace)
+			{
+				if (uQuadCount == MAX_BATCH_QUAD_COUNT)
+				{
+					__FlushQuad(uQuadCount);
+					uQuadCount = 0;
+				}
+
+				__BuildQuad(ms_kVct_dwFrameParticle[j], afZRotation[uFace], &ms_kVct_kQuadVertex[uQuadCount * 4]);
+				++uQuadCount;
+			}
 		}
+
+		if (uQuadCount)
+			__FlushQuad(uQuadCount);
 	}
+
+	STATEMANAGER.RestoreTextureStageState(0, D3DTSS_ALPHAARG1);
+	STATEMANAGER.RestoreTextureStageState(0, D3DTSS_COLORARG1);
+	STATEMANAGER.RestoreFVF();
 }
 
 void CParticleSystemInstance::OnSetDataPointer(CEffectElementBase * pElement)
 {
 	m_pData = (CParticleSystemData *)pElement;
 
-	m_dwCurrentEmissionCount = 0;
 	m_pParticleProperty = m_pData->GetParticlePropertyPointer();
 	m_pEmitterProperty = m_pData->GetEmitterPropertyPointer();
 	m_iLoopCount = m_pEmitterProperty->GetLoopCount();
-	m_ParticleInstanceListVector.resize(m_pParticleProperty->GetTextureAnimationFrameCount()*2+2);
+	m_kParticleArray.Clear();
 
 	/////
 
@@ -465,29 +655,14 @@ void CParticleSystemInstance::OnSetDataPointer(CEffectElementBase * pElement)
 
 void CParticleSystemInstance::OnInitialize()
 {
-	m_dwCurrentEmissionCount = 0;
+	m_kParticleArray.Clear();
 	m_iLoopCount = 0;
 	m_fEmissionResidue = 0.0f;
 }
 
 void CParticleSystemInstance::OnDestroy()
 {
-	// 2004. 3. 1. myevan. 파티클 제거 루틴
-	TParticleInstanceListVector::iterator i;
-	for(i = m_ParticleInstanceListVector.begin(); i!=m_ParticleInstanceListVector.end(); ++i)
-	{
-		TParticleInstanceList& rkLst_kParticleInst=*i;
-
-		TParticleInstanceList::iterator j;
-		for(j = rkLst_kParticleInst.begin(); j!=rkLst_kParticleInst.end(); ++j)
-		{
-			CParticleInstance* pkParticleInst=*j;
-			pkParticleInst->DeleteThis();
-		}
-
-		rkLst_kParticleInst.clear();	
-	}
-	m_ParticleInstanceListVector.clear();
+	m_kParticleArray.Clear();
 
 	std::for_each(m_kVct_pkImgInst.begin(), m_kVct_pkImgInst.end(), CGraphicImageInstance::Delete);
 	m_kVct_pkImgInst.clear();
@@ -500,6 +675,5 @@ CParticleSystemInstance::CParticleSystemInstance()
 
 CParticleSystemInstance::~CParticleSystemInstance()
 {
-	assert(m_ParticleInstanceListVector.empty());
 	assert(m_kVct_pkImgInst.empty());
 }
@@ -1,6 +1,6 @@
 #pragma once
 #include "EffectElementBaseInstance.h"
-#include "ParticleInstance.h"
+#include "ParticleArray.h"
 #include "ParticleProperty.h"
 
 #include "Eterlib/GrpScreen.h"
@@ -19,24 +19,6 @@ class CParticleSystemInstance : public CEffectElementBaseInstance
 		static CDynamicPool<CParticleSystemInstance>	ms_kPool;
 
 	public:
-		template <typename T>
-		inline void ForEachParticleRendering(T & FunObj)
-		{
-			DWORD dwFrameIndex;
-			for(dwFrameIndex=0; dwFrameIndex<m_kVct_pkImgInst.size(); dwFrameIndex++)
-			{
-				STATEMANAGER.SetTexture(0, m_kVct_pkImgInst[dwFrameIndex]->GetTextureReference().GetD3DTexture());
-				TParticleInstanceList::iterator itor = m_ParticleInstanceListVector[dwFrameIndex].begin();
-				for (; itor != m_ParticleInstanceListVector[dwFrameIndex].end(); ++itor)
-				{
-					if (!InFrustum(*itor))
-						continue;
-
-					FunObj(*itor);
-				}
-			}
-		}
-
 		CParticleSystemInstance();
 		virtual ~CParticleSystemInstance();
 
@@ -44,18 +26,6 @@ class CParticleSystemInstance : public CEffectElementBaseInstance
 
 		void CreateParticles(float fElapsedTime);
 
-		inline bool InFrustum(CParticleInstance * pInstance)
-		{
-			if (m_pParticleProperty->m_bAttachFlag)
-				return CScreen::GetFrustum().ViewVolumeTest(Vector3d(
-					pInstance->m_v3Position.x + mc_pmatLocal->_41,
-					pInstance->m_v3Position.y + mc_pmatLocal->_42,
-					pInstance->m_v3Position.z + mc_pmatLocal->_43
-					),pInstance->GetRadiusApproximation())!=VS_OUTSIDE;
-			else
-				return CScreen::GetFrustum().ViewVolumeTest(Vector3d(pInstance->m_v3Position.x,pInstance->m_v3Position.y,pInstance->m_v3Position.z),pInstance->GetRadiusApproximation())!=VS_OUTSIDE;
-		}
-		
 		DWORD GetEmissionCount();
 
 	protected:
@@ -65,15 +35,16 @@ class CParticleSystemInstance : public CEffectElementBaseInstance
 		bool OnUpdate(float fElapsedTime);
 		void OnRender();
 
+		bool __InFrustum(UINT uIndex);
+		void __BuildQuad(UINT uIndex, float fZRotation, TPDTVertex * pVertex);
+		void __FlushQuad(UINT uQuadCount);
+
 	protected:
 		float m_fEmissionResidue;
 		
-		DWORD m_dwCurrentEmissionCount;
 		int	m_iLoopCount;
 
-		typedef std::list<CParticleInstance*> TParticleInstanceList;
-		typedef std::vector<TParticleInstanceList> TParticleInstanceListVector;
-		TParticleInstanceListVector m_ParticleInstanceListVector;
+		CParticleArray m_kParticleArray;
 
 		typedef std::vector<CGraphicImageInstance*> TImageInstanceVector;
 		TImageInstanceVector m_kVct_pkImgInst;
@@ -82,4 +53,20 @@ class CParticleSystemInstance : public CEffectElementBaseInstance
 
 		CParticleProperty * m_pParticleProperty;
 		CEmitterProperty * m_pEmitterProperty;
+
+		// OnRender's camera, set before building the quads
+		D3DXVECTOR3 m_v3CameraUp;
+		D3DXVECTOR3 m_v3CameraCross;
+		D3DXVECTOR3 m_v3CameraView;
+
+		// Particles are drawn a texture frame at a time, up to MAX_BATCH_QUAD_COUNT quads a call
+		enum
+		{
+			MAX_BATCH_QUAD_COUNT = 4096,
+		};
+
+		static std::vector<DWORD> ms_kVct_dwFrameStart;
+		static std::vector<DWORD> ms_kVct_dwFrameParticle;
+		static std::vector<TPDTVertex> ms_kVct_kQuadVertex;
+		static std::vector<WORD> ms_kVct_wQuadIndex;
 };
@@ -23,7 +23,7 @@
 #include "EffectElementBaseInstance.h"
 
 #include "ParticleProperty.h"
-#include "ParticleInstance.h"
+#include "ParticleArray.h"
 #include "EmitterProperty.h"
 
 #include "ParticleSystemData.h"
@@ -150,7 +150,7 @@ void CMemoryTextFileLoader::Bind(int bufSize, const void* c_pvBuf)
 	m_stLineVector.clear();
 
 	const char * c_pcBuf = (const char *)c_pvBuf;
-	std::string stLine;
+	int lineBegin = 0;
 	int pos = 0;
 
 	while (pos < bufSize)
@@ -159,25 +159,22 @@ void CMemoryTextFileLoader::Bind(int bufSize, const void* c_pvBuf)
 
 		if ('\n' == c || '\r' == c)
 		{
+			m_stLineVector.emplace_back(c_pcBuf + lineBegin, pos - 1 - lineBegin);
+
 			if (pos < bufSize)
 				if ('\n' == c_pcBuf[pos] || '\r' == c_pcBuf[pos])
 					++pos;
 
-			m_stLineVector.push_back(stLine);
-			stLine = "";
+			lineBegin = pos;
 		}
 		else if (c < 0)
 		{
-			stLine.append(c_pcBuf + (pos-1), 2);
-			++pos;
-		}
-		else
-		{
-			stLine += c;
+			// Lead byte, the trail byte belongs to the line even if it is a line break
+			pos = std::min(pos + 1, bufSize);
 		}
 	}
 
-	m_stLineVector.push_back(stLine);
+	m_stLineVector.emplace_back(c_pcBuf + lineBegin, bufSize - lineBegin);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,107 @@
+#include "StdAfx.h"
+#include "PathHash.h"
+#include "Debug.h"
+
+#include <mutex>
+
+CPathTable::CPathTable(char cSeparator) : m_cSeparator(cSeparator), m_uBlockUsed(BLOCK_SIZE)
+{
+}
+
+CPathTable::~CPathTable()
+{
+}
+
+const char * CPathTable::Intern(std::string_view path)
+{
+	return Intern(path, HashPath(path));
+}
+
+const char * CPathTable::Intern(std::string_view path, uint64_t uKey)
+{
+	thread_local std::string s_stPath;
+
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		auto f = m_kMap_pszPath.find(uKey);
+		if (m_kMap_pszPath.end() != f)
+		{
+#ifdef _DEBUG
+			NormalizePath(path, s_stPath, m_cSeparator);
+			if (s_stPath != f->second)
+			{
+				TraceError("CPathTable::Intern: %s and %s share the key %016llx", f->second, s_stPath.c_str(), (unsigned long long) uKey);
+				assert(!"CPathTable::Intern: path key collision");
+			}
+#endif
+			return f->second;
+		}
+	}
+
+	NormalizePath(path, s_stPath, m_cSeparator);
+
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+	// Another thread may have stored it in between
+	auto f = m_kMap_pszPath.find(uKey);
+	if (m_kMap_pszPath.end() != f)
+		return f->second;
+
+	const char * c_pszPath = __Store(s_stPath);
+	m_kMap_pszPath.emplace(uKey, c_pszPath);
+	return c_pszPath;
+}
+
+const char * CPathTable::Find(uint64_t uKey) const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+	auto f = m_kMap_pszPath.find(uKey);
+	if (m_kMap_pszPath.end() == f)
+		return NULL;
+
+	return f->second;
+}
+
+size_t CPathTable::GetCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_kMap_pszPath.size();
+}
+
+void CPathTable::Clear()
+{
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+	m_kMap_pszPath.clear();
+	m_kVct_pBlock.clear();
+	m_uBlockUsed = BLOCK_SIZE;
+}
+
+const char * CPathTable::__Store(const std::string& c_rstPath)
+{
+	const size_t c_uSize = c_rstPath.size() + 1;
+
+	// Longer paths than a block get one of their own, the current block stays last
+	if (c_uSize > BLOCK_SIZE)
+	{
+		std::unique_ptr<char[]> pBlock = std::make_unique<char[]>(c_uSize);
+		memcpy(pBlock.get(), c_rstPath.c_str(), c_uSize);
+
+		const char * c_pszPath = pBlock.get();
+		m_kVct_pBlock.insert(m_kVct_pBlock.empty() ? m_kVct_pBlock.end() : m_kVct_pBlock.end() - 1, std::move(pBlock));
+		return c_pszPath;
+	}
+
+	if (m_uBlockUsed + c_uSize > BLOCK_SIZE)
+	{
+		m_kVct_pBlock.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+		m_uBlockUsed = 0;
+	}
+
+	char * pszPath = m_kVct_pBlock.back().get() + m_uBlockUsed;
+	memcpy(pszPath, c_rstPath.c_str(), c_uSize);
+	m_uBlockUsed += c_uSize;
+	return pszPath;
+}
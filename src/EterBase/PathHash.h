@@ -0,0 +1,140 @@
+#ifndef __INC_ETERBASE_PATHHASH_H__
+#define __INC_ETERBASE_PATHHASH_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+
+// Paths are compared in ASCII lower case with '/' and '\\' as the same separator.
+// HashPath folds both itself, "D:\\Ymir Work\\A.gr2" and "d:/ymir work/a.gr2" get the
+// same key without being normalized first. The keys are never stored on disk, the pack
+// index has its own PackHashPath.
+
+inline void NormalizePath(std::string_view in, std::string& out, char cSeparator = '/')
+{
+	out.resize(in.size());
+	for (size_t i = 0; i < in.size(); ++i)
+	{
+		const char c = in[i];
+		if (c == '/' || c == '\\')
+			out[i] = cSeparator;
+		else if (c >= 'A' && c <= 'Z')
+			out[i] = c - 'A' + 'a';
+		else
+			out[i] = c;
+	}
+}
+
+namespace NPathHash
+{
+	const uint64_t c_uPrime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t c_uPrime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t c_uPrime3 = 0x165667B19E3779F9ull;
+	const uint64_t c_uOnes = 0x0101010101010101ull;
+
+	// Eight characters at once, 'A'-'Z' to lower case and '\\' to '/'
+	inline uint64_t NormalizeWord(uint64_t w)
+	{
+		const uint64_t c_uLow7 = w & (c_uOnes * 0x7f);
+		const uint64_t c_uFromA = c_uLow7 + c_uOnes * (0x80 - 'A');
+		const uint64_t c_uPastZ = c_uLow7 + c_uOnes * (0x80 - 'Z' - 1);
+		w |= ((c_uFromA & ~c_uPastZ & ~w) & (c_uOnes * 0x80)) >> 2;
+
+		const uint64_t c_uBackslash = w ^ (c_uOnes * '\\');
+		const uint64_t c_uIsBackslash = ~(((c_uBackslash & (c_uOnes * 0x7f)) + c_uOnes * 0x7f) | c_uBackslash | (c_uOnes * 0x7f));
+		return w ^ ((c_uIsBackslash >> 7) * ('\\' ^ '/'));
+	}
+
+	inline uint64_t LoadWord(const char* p, size_t uSize)
+	{
+		uint64_t w = 0;
+		memcpy(&w, p, uSize);
+		return w;
+	}
+
+	inline uint64_t Round(uint64_t uAcc, uint64_t uWord)
+	{
+		uAcc += uWord * c_uPrime2;
+		uAcc = (uAcc << 31) | (uAcc >> 33);
+		return uAcc * c_uPrime1;
+	}
+}
+
+// Two lanes of xxHash64 rounds over the folded path, 16 characters per step
+inline uint64_t HashPath(std::string_view path)
+{
+	using namespace NPathHash;
+
+	const char* p = path.data();
+	size_t uLeft = path.size();
+
+	uint64_t uLane1 = c_uPrime1 + path.size();
+	uint64_t uLane2 = c_uPrime2 - path.size();
+
+	for (; uLeft >= 16; uLeft -= 16, p += 16)
+	{
+		uLane1 = Round(uLane1, NormalizeWord(LoadWord(p, 8)));
+		uLane2 = Round(uLane2, NormalizeWord(LoadWord(p + 8, 8)));
+	}
+
+	if (uLeft >= 8)
+	{
+		uLane1 = Round(uLane1, NormalizeWord(LoadWord(p, 8)));
+		uLeft -= 8;
+		p += 8;
+	}
+
+	// The length is part of the seed, so the zero padding cannot collide
+	if (uLeft)
+		uLane2 = Round(uLane2, NormalizeWord(LoadWord(p, uLeft)));
+
+	uint64_t h = ((uLane1 << 1) | (uLane1 >> 63)) + ((uLane2 << 7) | (uLane2 >> 57));
+	h ^= h >> 33;
+	h *= c_uPrime2;
+	h ^= h >> 29;
+	h *= c_uPrime3;
+	h ^= h >> 32;
+	return h;
+}
+
+// Every distinct path once, normalized, for the life of the table. Callers can keep
+// the key and the returned pointer instead of a string of their own. Thread-safe.
+class CPathTable
+{
+	public:
+		CPathTable(char cSeparator = '/');
+		~CPathTable();
+
+		// Debug builds report two paths sharing a key
+		const char *	Intern(std::string_view path);
+		const char *	Intern(std::string_view path, uint64_t uKey);
+
+		// NULL if the key was never interned
+		const char *	Find(uint64_t uKey) const;
+
+		size_t			GetCount() const;
+		void			Clear();
+
+	protected:
+		const char *	__Store(const std::string& c_rstPath);
+
+	protected:
+		enum
+		{
+			BLOCK_SIZE = 64 * 1024,
+		};
+
+		char										m_cSeparator;
+
+		mutable std::shared_mutex					m_mutex;
+		std::unordered_map<uint64_t, const char *>	m_kMap_pszPath;
+		std::vector<std::unique_ptr<char[]> >		m_kVct_pBlock;
+		size_t										m_uBlockUsed;
+};
+
+#endif
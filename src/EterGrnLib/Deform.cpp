@@ -1,6 +1,7 @@
 #include "Deform.h"
 #include <xmmintrin.h>
 #include <emmintrin.h>
+#include <vector>
 
 namespace
 {
@@ -198,3 +199,58 @@ void DeformPWNT3432toGrannyPNGBT33332(granny_int32x Count, void const* SourceIni
 		DeformPWNT3432toGrannyPNGBT33332D(Count, SourceInit, DestInit, Transforms, SourceStride, DestStride);
 	}
 }
+
+void RepackPWNT3432(granny_int32x Count, void const* SourceInit, granny_int32x SourceStride, SPWNT3432Block* Blocks)
+{
+    const granny_uint8* src = (const granny_uint8*)SourceInit;
+
+    // Counting sort by influence count, so rigid vertices share blocks and skip the other three bones
+    std::vector<granny_int32> order(Count);
+    granny_int32 influenceStart[6] = { 0 };
+
+    auto getInfluenceCount = [&](granny_int32x vertex) {
+        const granny_pwnt3432_vertex* v = (const granny_pwnt3432_vertex*)(src + vertex * SourceStride);
+        for (int k = 4; k > 0; --k)
+            if (v->BoneWeights[k - 1])
+                return k;
+        return 0;
+    };
+
+    for (granny_int32x vertex = 0; vertex < Count; ++vertex)
+        ++influenceStart[getInfluenceCount(vertex) + 1];
+    for (int k = 1; k < 6; ++k)
+        influenceStart[k] += influenceStart[k - 1];
+    for (granny_int32x vertex = 0; vertex < Count; ++vertex)
+        order[influenceStart[getInfluenceCount(vertex)]++] = vertex;
+
+    for (granny_int32x blockBase = 0; blockBase < Count; blockBase += 8, ++Blocks) {
+        SPWNT3432Block& block = *Blocks;
+        block.VertexCount = Count - blockBase < 8 ? Count - blockBase : 8;
+        block.InfluenceCount = 0;
+
+        for (granny_int32x lane = 0; lane < 8; ++lane) {
+            // The padding after the last vertex repeats the block's first one without any weight
+            const bool isPadding = lane >= block.VertexCount;
+            const granny_int32 vertex = order[isPadding ? blockBase : blockBase + lane];
+            const granny_pwnt3432_vertex* v = (const granny_pwnt3432_vertex*)(src + vertex * SourceStride);
+
+            block.VertexIndex[lane] = vertex;
+
+            for (int i = 0; i < 3; ++i) {
+                block.Position[i][lane] = v->Position[i];
+                block.Normal[i][lane] = v->Normal[i];
+            }
+            block.UV[0][lane] = v->UV[0];
+            block.UV[1][lane] = v->UV[1];
+
+            for (int k = 0; k < 4; ++k) {
+                const granny_uint8 weight = isPadding ? 0 : v->BoneWeights[k];
+                block.BoneWeights[k][lane] = static_cast<float>(weight) * kInv255;
+                block.BoneIndices[k][lane] = weight ? v->BoneIndices[k] : v->BoneIndices[0];
+
+                if (weight && block.InfluenceCount < k + 1)
+                    block.InfluenceCount = k + 1;
+            }
+        }
+    }
+}
@@ -1,6 +1,30 @@
 #pragma once
 #include <granny.h>
 
+// Eight PWNT3432 vertices with every component in its own row, the source of the AVX2 deformer.
+// Vertices are grouped by how many bones they use, VertexIndex is where each one is written back.
+// Unused influences keep the first bone with a zero weight, so every index stays valid to load.
+struct alignas(32) SPWNT3432Block
+{
+	granny_real32 Position[3][8];
+	granny_real32 Normal[3][8];
+	granny_real32 UV[2][8];
+	granny_real32 BoneWeights[4][8];	// already divided by 255
+	granny_int32 BoneIndices[4][8];
+	granny_int32 VertexIndex[8];
+	granny_int32 VertexCount;
+	granny_int32 InfluenceCount;		// the most influences any of the eight uses
+};
+
+inline granny_int32x GetPWNT3432BlockCount(granny_int32x Count) { return (Count + 7) / 8; }
+
+void RepackPWNT3432(granny_int32x Count, void const* SourceInit, granny_int32x SourceStride, SPWNT3432Block* Blocks);
+
 void DeformPWNT3432toGrannyPNGBT33332(granny_int32x Count, void const* SourceInit, void* DestInit,
 	granny_int32x const* TransformTable, granny_matrix_4x4 const* Transforms,
-	granny_int32x SourceStride, granny_int32x DestStride);
\ No newline at end of file
+	granny_int32x SourceStride, granny_int32x DestStride);
+
+// Needs AVX2 and FMA, check CPU_HAS_AVX2 first. DestStride must hold at least a granny_pnt332_vertex.
+void DeformPWNT3432BlocktoGrannyPNGBT33332AVX2(granny_int32x Count, SPWNT3432Block const* Blocks, void* DestInit,
+	granny_int32x const* TransformTable, granny_matrix_4x4 const* Transforms,
+	granny_int32x DestStride);
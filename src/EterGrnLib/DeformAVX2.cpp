@@ -0,0 +1,124 @@
+#include "Deform.h"
+#include <immintrin.h>
+
+// Built with /arch:AVX2, only reached through CPU_HAS_AVX2. Keep it free of inline
+// library code, the linker could otherwise pick these AVX2 copies for every caller.
+
+namespace
+{
+    // Row r of the eight lanes' matrices as three columns, the translation column is not needed.
+    // A load and transpose beats eight-wide gathers, which are slow on most cores.
+    inline void LoadMatrixRow(const float* const matrix[8], const int r, __m256& c0, __m256& c1, __m256& c2)
+    {
+        const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrix[0] + r * 4)), _mm_loadu_ps(matrix[4] + r * 4), 1);
+        const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrix[1] + r * 4)), _mm_loadu_ps(matrix[5] + r * 4), 1);
+        const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrix[2] + r * 4)), _mm_loadu_ps(matrix[6] + r * 4), 1);
+        const __m256 d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrix[3] + r * 4)), _mm_loadu_ps(matrix[7] + r * 4), 1);
+
+        const __m256 t0 = _mm256_unpacklo_ps(a, b);
+        const __m256 t1 = _mm256_unpackhi_ps(a, b);
+        const __m256 t2 = _mm256_unpacklo_ps(c, d);
+        const __m256 t3 = _mm256_unpackhi_ps(c, d);
+
+        c0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        c1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        c2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    }
+
+    // 8 rows of 8 floats into 8 columns, row i becomes the i-th float of every output
+    inline void Transpose8x8(__m256 r[8])
+    {
+        const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+        const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+        const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+        const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+        const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+        const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+        const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+        const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+        const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
+}
+
+void DeformPWNT3432BlocktoGrannyPNGBT33332AVX2(granny_int32x Count, SPWNT3432Block const* Blocks, void* DestInit,
+    granny_int32x const* TransformTable, granny_matrix_4x4 const* Transforms,
+    granny_int32x DestStride)
+{
+    const float* transforms = (const float*)Transforms;
+    granny_uint8* dst = (granny_uint8*)DestInit;
+
+    for (granny_int32x blockCount = GetPWNT3432BlockCount(Count); blockCount > 0; --blockCount, ++Blocks) {
+        const SPWNT3432Block& block = *Blocks;
+
+        const __m256 px = _mm256_load_ps(block.Position[0]);
+        const __m256 py = _mm256_load_ps(block.Position[1]);
+        const __m256 pz = _mm256_load_ps(block.Position[2]);
+
+        const __m256 nx = _mm256_load_ps(block.Normal[0]);
+        const __m256 ny = _mm256_load_ps(block.Normal[1]);
+        const __m256 nz = _mm256_load_ps(block.Normal[2]);
+
+        __m256 r[8] = {
+            _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(),
+            _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(),
+            _mm256_load_ps(block.UV[0]), _mm256_load_ps(block.UV[1]),
+        };
+
+        for (granny_int32x k = 0; k < block.InfluenceCount; ++k) {
+            const float* matrix[8];
+            for (int lane = 0; lane < 8; ++lane) {
+                const granny_int32 bone = block.BoneIndices[k][lane];
+                matrix[lane] = transforms + (TransformTable ? TransformTable[bone] : bone) * 16;
+            }
+
+            const __m256 w = _mm256_load_ps(block.BoneWeights[k]);
+
+            // Weighting the source once is cheaper than weighting both results
+            const __m256 wp[3] = { _mm256_mul_ps(px, w), _mm256_mul_ps(py, w), _mm256_mul_ps(pz, w) };
+            const __m256 wn[3] = { _mm256_mul_ps(nx, w), _mm256_mul_ps(ny, w), _mm256_mul_ps(nz, w) };
+
+            __m256 m0, m1, m2;
+            LoadMatrixRow(matrix, 3, m0, m1, m2);
+            r[0] = _mm256_fmadd_ps(w, m0, r[0]);
+            r[1] = _mm256_fmadd_ps(w, m1, r[1]);
+            r[2] = _mm256_fmadd_ps(w, m2, r[2]);
+
+            for (int row = 0; row < 3; ++row) {
+                LoadMatrixRow(matrix, row, m0, m1, m2);
+
+                r[0] = _mm256_fmadd_ps(wp[row], m0, r[0]);
+                r[1] = _mm256_fmadd_ps(wp[row], m1, r[1]);
+                r[2] = _mm256_fmadd_ps(wp[row], m2, r[2]);
+
+                r[3] = _mm256_fmadd_ps(wn[row], m0, r[3]);
+                r[4] = _mm256_fmadd_ps(wn[row], m1, r[4]);
+                r[5] = _mm256_fmadd_ps(wn[row], m2, r[5]);
+            }
+        }
+
+        // Position, normal and UV are exactly one granny_pnt332_vertex
+        Transpose8x8(r);
+
+        for (granny_int32x i = 0; i < block.VertexCount; ++i)
+            _mm256_storeu_ps((float*)(dst + block.VertexIndex[i] * DestStride), r[i]);
+    }
+
+    _mm256_zeroupper();
+}
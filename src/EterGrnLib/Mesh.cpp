@@ -61,7 +61,17 @@ void CGrannyMesh::DeformPNTVertices(void* dstBaseVertices, D3DXMATRIX* boneMatri
 	// END_OF_WORK
 
 	extern bool CPU_HAS_SSE2;
-	if (CPU_HAS_SSE2) {
+	if (!m_deformBlockVector.empty()) {
+		DeformPWNT3432BlocktoGrannyPNGBT33332AVX2(
+			vtxCount,
+			m_deformBlockVector.data(),
+			dstVertices,
+			boneIndices,
+			(granny_matrix_4x4 const*)boneMatrices,
+			sizeof(granny_pnt332_vertex)
+		);
+	}
+	else if (CPU_HAS_SSE2) {
 		DeformPWNT3432toGrannyPNGBT33332(
 			vtxCount,
 			srcVertices,
@@ -153,6 +163,15 @@ bool CGrannyMesh::CreateFromGrannyMeshPointer(granny_skeleton * pgrnSkeleton, gr
 
 		m_pgrnMeshDeformer = GrannyNewMeshDeformer(pgrnInputType, pgrnOutputType, GrannyDeformPositionNormal, GrannyAllowUncopiedTail);
 		assert(m_pgrnMeshDeformer != NULL && "Cannot create mesh deformer");
+
+		// The AVX2 deformer reads its own copy of the vertices, eight at a time
+		extern bool CPU_HAS_AVX2;
+		if (CPU_HAS_AVX2 && GrannyDataTypesAreEqual(pgrnInputType, GrannyPWNT3432VertexType))
+		{
+			int vtxCount = GrannyGetMeshVertexCount(m_pgrnMesh);
+			m_deformBlockVector.resize(GetPWNT3432BlockCount(vtxCount));
+			RepackPWNT3432(vtxCount, GrannyGetMeshVertices(m_pgrnMesh), sizeof(granny_pwnt3432_vertex), m_deformBlockVector.data());
+		}
 	}
 
 	// Two Side Mesh
@@ -255,6 +274,7 @@ void CGrannyMesh::Destroy()
 		delete [] m_triGroupNodes;
 
 	m_mtrlIndexVector.clear();
+	m_deformBlockVector.clear();
 
 	// WORK
 	if (m_pgrnMeshBindingTemp) 
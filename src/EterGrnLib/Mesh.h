@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Material.h"
+#include "Deform.h"
 
 extern granny_data_type_definition GrannyPNT3322VertexType[5];
 
@@ -78,6 +79,7 @@ class CGrannyMesh
 		// END_OF_WORK
 
 		granny_mesh_deformer *	m_pgrnMeshDeformer;
+		std::vector<SPWNT3432Block>	m_deformBlockVector;	// only with CPU_HAS_AVX2
 
 		// Granny Material Data
 		std::vector<DWORD>		m_mtrlIndexVector;
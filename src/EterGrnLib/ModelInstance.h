@@ -23,6 +23,10 @@ class CGrannyModelInstance : public CGraphicCollisionObject
 
 		static CDynamicPool<CGrannyModelInstance>		ms_kPool;
 
+		// Deform on a pool worker skins into a staging copy, because D3D resources may only be
+		// locked on the render thread. This uploads the copies, call it on the render thread.
+		static void FlushDeferredDeforms();
+
 	public:
 		struct FCreateDeviceObjects
 		{
@@ -148,6 +152,7 @@ class CGrannyModelInstance : public CGraphicCollisionObject
 		void	UpdateWorldPose();
 		void	UpdateWorldMatrices(const D3DXMATRIX * c_pWorldMatrix);
 		void	DeformPNTVertices(void * pvDest);
+		void	__UploadDeferredDeform();
 
 		void	RenderMeshNodeListWithOneTexture(CGrannyMesh::EType eMeshType, CGrannyMaterial::EType eMtrlType);
 		void	RenderMeshNodeListWithTwoTexture(CGrannyMesh::EType eMeshType, CGrannyMaterial::EType eMtrlType);
@@ -189,6 +194,7 @@ class CGrannyModelInstance : public CGraphicCollisionObject
 		CGraphicVertexBuffer*			m_pkSharedDeformableVertexBuffer;
 		CGraphicVertexBuffer			m_kLocalDeformableVertexBuffer;
 		bool							m_isDeformableVertexBuffer;		
+		std::vector<TPNTVertex>			m_kVct_kDeferredDeformVertex;	// skinned off the render thread
 		// END_OF_WORK
 
 		// TEST
@@ -2,6 +2,12 @@
 #include "Eterbase/Debug.h"
 #include "ModelInstance.h"
 #include "Model.h"
+#include "EterLib/GameThreadPool.h"
+
+#include <mutex>
+
+static std::mutex s_deferredDeformMutex;
+static std::vector<CGrannyModelInstance*> s_deferredDeformInstances;
 
 
 void CGrannyModelInstance::Update(DWORD dwAniFPS)
@@ -68,6 +74,16 @@ void CGrannyModelInstance::Deform(const D3DXMATRIX * c_pWorldMatrix)
 
 	if (m_pModel->CanDeformPNTVertices())
 	{
+		if (CGameThreadPool::IsWorkerThread())
+		{
+			m_kVct_kDeferredDeformVertex.resize(m_pModel->GetDeformVertexCount());
+			DeformPNTVertices(m_kVct_kDeferredDeformVertex.data());
+
+			std::lock_guard<std::mutex> lock(s_deferredDeformMutex);
+			s_deferredDeformInstances.push_back(this);
+			return;
+		}
+
 		// WORK
 		CGraphicVertexBuffer& rkDeformableVertexBuffer = __GetDeformableVertexBufferRef();
 		TPNTVertex* pntVertices;
@@ -84,6 +100,31 @@ void CGrannyModelInstance::Deform(const D3DXMATRIX * c_pWorldMatrix)
 	}	
 }
 
+void CGrannyModelInstance::FlushDeferredDeforms()
+{
+	std::lock_guard<std::mutex> lock(s_deferredDeformMutex);
+
+	for (CGrannyModelInstance* pkInst : s_deferredDeformInstances)
+		pkInst->__UploadDeferredDeform();
+
+	s_deferredDeformInstances.clear();
+}
+
+void CGrannyModelInstance::__UploadDeferredDeform()
+{
+	CGraphicVertexBuffer& rkDeformableVertexBuffer = __GetDeformableVertexBufferRef();
+	TPNTVertex* pntVertices;
+	if (rkDeformableVertexBuffer.LockRange(m_kVct_kDeferredDeformVertex.size(), (void **)&pntVertices))
+	{
+		memcpy(pntVertices, m_kVct_kDeferredDeformVertex.data(), m_kVct_kDeferredDeformVertex.size() * sizeof(TPNTVertex));
+		rkDeformableVertexBuffer.Unlock();
+	}
+	else
+	{
+		TraceError("GRANNY DEFORM DYNAMIC BUFFER LOCK ERROR");
+	}
+}
+
 //////////////////////////////////////////////////////
 class CGrannyLocalPose
 {
@@ -140,7 +181,8 @@ void CGrannyModelInstance::UpdateWorldPose()
 		if (*m_ppkSkeletonInst!=this)
 			return;
 	
-	static CGrannyLocalPose s_SharedLocalPose;
+	// One scratch pose per thread, skeletons may be sampled on pool workers
+	static thread_local CGrannyLocalPose s_SharedLocalPose;
 
 	granny_skeleton * pgrnSkeleton = GrannyGetSourceSkeleton(m_pgrnModelInstance);
 	granny_local_pose * pgrnLocalPose = s_SharedLocalPose.Get(pgrnSkeleton->BoneCount);	
@@ -3,6 +3,22 @@
 #include "Thing.h"
 #include "ThingInstance.h"
 
+namespace
+{
+	struct SDecodedThing : public CResource::SDecodedData
+	{
+		granny_file *		pgrnFile;
+		granny_file_info *	pgrnFileInfo;
+
+		SDecodedThing() : pgrnFile(NULL), pgrnFileInfo(NULL) {}
+		~SDecodedThing()
+		{
+			if (pgrnFile)
+				GrannyFreeFile(pgrnFile);
+		}
+	};
+}
+
 CGraphicThing::CGraphicThing(const char* c_szFileName) : CResource(c_szFileName)
 {
 	Initialize();	
@@ -156,18 +172,40 @@ int CGraphicThing::GetMotionCount() const
 
 bool CGraphicThing::OnLoad(int iSize, const void * c_pvBuf)
 {
-	if (!c_pvBuf)
+	TDecodedDataPtr pkData = DecodeOnWorker(iSize, c_pvBuf);
+
+	if (!pkData)
 		return false;
 
-	m_pgrnFile = GrannyReadEntireFileFromMemory(iSize, (void *) c_pvBuf);
+	return FinalizeOnMain(*pkData);
+}
 
-	if (!m_pgrnFile)
-		return false;
+CResource::TDecodedDataPtr CGraphicThing::DecodeOnWorker(int iSize, const void * c_pvBuf)
+{
+	if (!c_pvBuf)
+		return NULL;
 
-    m_pgrnFileInfo = GrannyGetFileInfo(m_pgrnFile);
+	std::unique_ptr<SDecodedThing> pkThing(new SDecodedThing);
+	pkThing->pgrnFile = GrannyReadEntireFileFromMemory(iSize, (void *) c_pvBuf);
 
-	if (!m_pgrnFileInfo)
-		return false;
+	if (!pkThing->pgrnFile)
+		return NULL;
+
+	pkThing->pgrnFileInfo = GrannyGetFileInfo(pkThing->pgrnFile);
+
+	if (!pkThing->pgrnFileInfo)
+		return NULL;
+
+	return pkThing;
+}
+
+bool CGraphicThing::FinalizeOnMain(SDecodedData & rData)
+{
+	SDecodedThing & rThing = static_cast<SDecodedThing &>(rData);
+
+	m_pgrnFile = rThing.pgrnFile;
+	m_pgrnFileInfo = rThing.pgrnFileInfo;
+	rThing.pgrnFile = NULL;
 
 	LoadModels();
 	LoadMotions();
@@ -26,6 +26,10 @@ class CGraphicThing : public CResource
 		CGrannyMotion *			GetMotionPointer(int iMotion);
 		int						GetMotionCount() const;
 
+		// The granny file is read on the worker, models and motions are bound on the main thread
+		TDecodedDataPtr			DecodeOnWorker(int iSize, const void* c_pvBuf);
+		bool					FinalizeOnMain(SDecodedData& rData);
+
 	protected:
 		void					Initialize();
 
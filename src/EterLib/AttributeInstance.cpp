@@ -3,6 +3,9 @@
 #include "AttributeInstance.h"
 #include "GrpMath.h"
 
+#include <algorithm>
+#include <cfloat>
+
 CDynamicPool<CAttributeInstance> CAttributeInstance::ms_kPool;
 
 const float c_fStepSize = 50.0f;
@@ -80,14 +83,20 @@ BOOL CAttributeInstance::GetHeight(float fx, float fy, float * pfHeight)
 	if (!IsInHeight(fx, fy))
 		return FALSE;
 
+	// Outside of every triangle
+	if (!(fx >= m_fHeightGridMinX && fx <= m_fHeightGridMaxX && fy >= m_fHeightGridMinY && fy <= m_fHeightGridMaxY))
+		return FALSE;
+
 	BOOL bFlag = FALSE;
 
-	for (DWORD i = 0; i < m_v3HeightDataVector.size(); ++i)
-	for (DWORD j = 0; j < m_v3HeightDataVector[i].size(); j+=3)
+	const UINT uCell = __GetHeightCellY(fy) * m_uHeightGridX + __GetHeightCellX(fx);
+	const DWORD dwEnd = m_kVct_dwHeightCellStart[uCell + 1];
+	for (DWORD i = m_kVct_dwHeightCellStart[uCell]; i < dwEnd; ++i)
 	{
-		const D3DXVECTOR3 & c_rv3Vertex0 = m_v3HeightDataVector[i][j];
-		const D3DXVECTOR3 & c_rv3Vertex1 = m_v3HeightDataVector[i][j+1];
-		const D3DXVECTOR3 & c_rv3Vertex2 = m_v3HeightDataVector[i][j+2];
+		const SHeightTriangle & c_rkTriangle = m_kVct_kHeightTriangle[m_kVct_dwHeightCellTriangle[i]];
+		const D3DXVECTOR3 & c_rv3Vertex0 = c_rkTriangle.av3Vertex[0];
+		const D3DXVECTOR3 & c_rv3Vertex1 = c_rkTriangle.av3Vertex[1];
+		const D3DXVECTOR3 & c_rv3Vertex2 = c_rkTriangle.av3Vertex[2];
 
 		if (
 			fx<c_rv3Vertex0.x && fx<c_rv3Vertex1.x && fx<c_rv3Vertex2.x ||
@@ -101,25 +110,128 @@ BOOL CAttributeInstance::GetHeight(float fx, float fy, float * pfHeight)
 						   c_rv3Vertex1.x, c_rv3Vertex1.y,
 						   c_rv3Vertex2.x, c_rv3Vertex2.y, fx, fy))
 		{
-			D3DXVECTOR3 v3Line1 = c_rv3Vertex1 - c_rv3Vertex0;
-			D3DXVECTOR3 v3Line2 = c_rv3Vertex2 - c_rv3Vertex0;
-			D3DXVECTOR3 v3Cross;
+			const D3DXVECTOR3 & c_rv3Normal = c_rkTriangle.v3Normal;
+			float fm = (c_rv3Normal.x*fx + c_rv3Normal.y*fy);
+			*pfHeight = fMAX((c_rkTriangle.fDistance - fm) / c_rv3Normal.z, *pfHeight);
+
+			bFlag = TRUE;
+		}
+	}
 
-			D3DXVec3Cross(&v3Cross, &v3Line1, &v3Line2);
-			D3DXVec3Normalize(&v3Cross, &v3Cross);
+	return bFlag;
+}
 
-			if (0.0f != v3Cross.z)
-			{
-				float fd = (v3Cross.x*c_rv3Vertex0.x + v3Cross.y*c_rv3Vertex0.y + v3Cross.z*c_rv3Vertex0.z);
-				float fm = (v3Cross.x*fx + v3Cross.y*fy);
-				*pfHeight = fMAX((fd - fm) / v3Cross.z, *pfHeight);
+UINT CAttributeInstance::__GetHeightCellX(float fx) const
+{
+	const int ix = int((fx - m_fHeightGridMinX) * m_fHeightGridInvCellX);
+	return std::min<UINT>(std::max(ix, 0), m_uHeightGridX - 1);
+}
+
+UINT CAttributeInstance::__GetHeightCellY(float fy) const
+{
+	const int iy = int((fy - m_fHeightGridMinY) * m_fHeightGridInvCellY);
+	return std::min<UINT>(std::max(iy, 0), m_uHeightGridY - 1);
+}
+
+void CAttributeInstance::__ClearHeightGrid()
+{
+	m_kVct_kHeightTriangle.clear();
+	m_kVct_dwHeightCellStart.clear();
+	m_kVct_dwHeightCellTriangle.clear();
+
+	m_fHeightGridMinX = m_fHeightGridMinY = FLT_MAX;
+	m_fHeightGridMaxX = m_fHeightGridMaxY = -FLT_MAX;
+	m_fHeightGridInvCellX = m_fHeightGridInvCellY = 0.0f;
+	m_uHeightGridX = m_uHeightGridY = 0;
+}
+
+void CAttributeInstance::__BuildHeightGrid()
+{
+	__ClearHeightGrid();
+
+	for (DWORD i = 0; i < m_v3HeightDataVector.size(); ++i)
+	for (DWORD j = 0; j + 2 < m_v3HeightDataVector[i].size(); j+=3)
+	{
+		SHeightTriangle kTriangle;
+		kTriangle.av3Vertex[0] = m_v3HeightDataVector[i][j];
+		kTriangle.av3Vertex[1] = m_v3HeightDataVector[i][j+1];
+		kTriangle.av3Vertex[2] = m_v3HeightDataVector[i][j+2];
 
-				bFlag = TRUE;
+		D3DXVECTOR3 v3Line1 = kTriangle.av3Vertex[1] - kTriangle.av3Vertex[0];
+		D3DXVECTOR3 v3Line2 = kTriangle.av3Vertex[2] - kTriangle.av3Vertex[0];
+
+		D3DXVec3Cross(&kTriangle.v3Normal, &v3Line1, &v3Line2);
+		D3DXVec3Normalize(&kTriangle.v3Normal, &kTriangle.v3Normal);
+
+		// Walls never give a height
+		if (0.0f == kTriangle.v3Normal.z)
+			continue;
+
+		const D3DXVECTOR3 & c_rv3Normal = kTriangle.v3Normal;
+		const D3DXVECTOR3 & c_rv3Vertex0 = kTriangle.av3Vertex[0];
+		kTriangle.fDistance = (c_rv3Normal.x*c_rv3Vertex0.x + c_rv3Normal.y*c_rv3Vertex0.y + c_rv3Normal.z*c_rv3Vertex0.z);
+
+		for (int k = 0; k < 3; ++k)
+		{
+			m_fHeightGridMinX = std::min(m_fHeightGridMinX, kTriangle.av3Vertex[k].x);
+			m_fHeightGridMinY = std::min(m_fHeightGridMinY, kTriangle.av3Vertex[k].y);
+			m_fHeightGridMaxX = std::max(m_fHeightGridMaxX, kTriangle.av3Vertex[k].x);
+			m_fHeightGridMaxY = std::max(m_fHeightGridMaxY, kTriangle.av3Vertex[k].y);
+		}
+
+		m_kVct_kHeightTriangle.push_back(kTriangle);
+	}
+
+	if (m_kVct_kHeightTriangle.empty())
+		return;
+
+	// Square cells holding a couple of triangles each on average
+	const float fWidth = m_fHeightGridMaxX - m_fHeightGridMinX;
+	const float fHeight = m_fHeightGridMaxY - m_fHeightGridMinY;
+	const float fCellSize = sqrtf(std::max(fWidth * fHeight, 1.0f) * HEIGHT_GRID_TRIANGLES_PER_CELL / m_kVct_kHeightTriangle.size());
+
+	m_uHeightGridX = std::clamp((int) ceilf(fWidth / fCellSize), 1, (int) HEIGHT_GRID_MAX_SIZE);
+	m_uHeightGridY = std::clamp((int) ceilf(fHeight / fCellSize), 1, (int) HEIGHT_GRID_MAX_SIZE);
+	m_fHeightGridInvCellX = fWidth > 0.0f ? m_uHeightGridX / fWidth : 0.0f;
+	m_fHeightGridInvCellY = fHeight > 0.0f ? m_uHeightGridY / fHeight : 0.0f;
+
+	// Every triangle goes into each cell its bounds touch, in their original order
+	m_kVct_dwHeightCellStart.assign(m_uHeightGridX * m_uHeightGridY + 1, 0);
+
+	for (int iPass = 0; iPass < 2; ++iPass)
+	{
+		for (DWORD i = 0; i < m_kVct_kHeightTriangle.size(); ++i)
+		{
+			const D3DXVECTOR3 * c_av3Vertex = m_kVct_kHeightTriangle[i].av3Vertex;
+			const UINT uMinX = __GetHeightCellX(std::min(std::min(c_av3Vertex[0].x, c_av3Vertex[1].x), c_av3Vertex[2].x));
+			const UINT uMaxX = __GetHeightCellX(std::max(std::max(c_av3Vertex[0].x, c_av3Vertex[1].x), c_av3Vertex[2].x));
+			const UINT uMinY = __GetHeightCellY(std::min(std::min(c_av3Vertex[0].y, c_av3Vertex[1].y), c_av3Vertex[2].y));
+			const UINT uMaxY = __GetHeightCellY(std::max(std::max(c_av3Vertex[0].y, c_av3Vertex[1].y), c_av3Vertex[2].y));
+
+			for (UINT y = uMinY; y <= uMaxY; ++y)
+			for (UINT x = uMinX; x <= uMaxX; ++x)
+			{
+				const UINT uCell = y * m_uHeightGridX + x;
+				if (0 == iPass)
+					++m_kVct_dwHeightCellStart[uCell + 1];
+				else
+					m_kVct_dwHeightCellTriangle[m_kVct_dwHeightCellStart[uCell]++] = i;
 			}
 		}
+
+		if (0 == iPass)
+		{
+			for (UINT uCell = 0; uCell < m_uHeightGridX * m_uHeightGridY; ++uCell)
+				m_kVct_dwHeightCellStart[uCell + 1] += m_kVct_dwHeightCellStart[uCell];
+
+			m_kVct_dwHeightCellTriangle.resize(m_kVct_dwHeightCellStart.back());
+		}
 	}
 
-	return bFlag;
+	// The second pass moved every start onto the next cell's
+	for (UINT uCell = m_uHeightGridX * m_uHeightGridY; uCell > 0; --uCell)
+		m_kVct_dwHeightCellStart[uCell] = m_kVct_dwHeightCellStart[uCell - 1];
+	m_kVct_dwHeightCellStart[0] = 0;
 }
 
 CAttributeData * CAttributeInstance::GetObjectPointer() const
@@ -168,6 +280,8 @@ void CAttributeInstance::RefreshObject(const D3DXMATRIX & c_rmatGlobal)
 			D3DXVec3TransformCoord(&m_v3HeightDataVector[i][j], &c_pHeightData->v3VertexVector[j], &m_matGlobal);
 		}
 	}
+
+	__BuildHeightGrid();
 }
 
 const char * CAttributeInstance::GetDataFileName() const
@@ -210,12 +324,14 @@ void CAttributeInstance::Clear()
 	D3DXMatrixIdentity(&m_matGlobal);
 
 	m_v3HeightDataVector.clear();
+	__ClearHeightGrid();
 
 	m_roAttributeData.SetPointer(NULL);
 }
 
 CAttributeInstance::CAttributeInstance()
 {
+	__ClearHeightGrid();
 }
 CAttributeInstance::~CAttributeInstance()
 {
@@ -31,6 +31,11 @@ class CAttributeInstance
 		void SetGlobalMatrix(const D3DXMATRIX & c_rmatGlobal);
 		void SetGlobalPosition(const D3DXVECTOR3 & c_rv3Position);
 
+		void __BuildHeightGrid();
+		void __ClearHeightGrid();
+		UINT __GetHeightCellX(float fx) const;
+		UINT __GetHeightCellY(float fy) const;
+
 	protected:
 		float m_fCollisionRadius;
 		float m_fHeightRadius;
@@ -39,6 +44,33 @@ class CAttributeInstance
 
 		std::vector< std::vector<D3DXVECTOR3> > m_v3HeightDataVector;
 
+		// The height triangles in world space with their planes, bucketed on a uniform XY grid
+		// by RefreshObject so GetHeight only tests the triangles of one cell
+		enum
+		{
+			HEIGHT_GRID_MAX_SIZE = 64,
+			HEIGHT_GRID_TRIANGLES_PER_CELL = 2,
+		};
+
+		struct SHeightTriangle
+		{
+			D3DXVECTOR3	av3Vertex[3];
+			D3DXVECTOR3	v3Normal;
+			float		fDistance;
+		};
+
+		std::vector<SHeightTriangle>	m_kVct_kHeightTriangle;
+		std::vector<DWORD>				m_kVct_dwHeightCellStart;		// per cell, into m_kVct_dwHeightCellTriangle, plus the end
+		std::vector<DWORD>				m_kVct_dwHeightCellTriangle;
+		float							m_fHeightGridMinX;
+		float							m_fHeightGridMinY;
+		float							m_fHeightGridMaxX;
+		float							m_fHeightGridMaxY;
+		float							m_fHeightGridInvCellX;
+		float							m_fHeightGridInvCellY;
+		UINT							m_uHeightGridX;
+		UINT							m_uHeightGridY;
+
 		CAttributeData::TRef					m_roAttributeData;
 
 		/*
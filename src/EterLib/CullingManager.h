@@ -100,6 +100,12 @@ public:
 		m_Factory->PointTest2d(p, callback);
 	}
 
+	// Every leaf whose circle in the XY plane touches the one around p
+	void RangeTest2d(const Vector3d& p, float radius, SpherePackCallback* callback)
+	{
+		m_Factory->RangeTest2d(p, radius, callback);
+	}
+
 	template <class T>
 	void ForInRange2d(const Vector3d& p, T* pFunc)
 	{
@@ -14,6 +14,7 @@ struct TDecodedImageData
 		FORMAT_RGBA8,
 		FORMAT_RGB8,
 		FORMAT_DDS,
+		FORMAT_BGRA8,	// D3DFMT_A8R8G8B8 order, uploaded without conversion
 	};
 
 	std::vector<uint8_t> pixels;
@@ -26,6 +26,20 @@ void CFileLoaderThread::Shutdown()
 {
 	m_bShutdowned = true;
 
+	// Requests still running may decode into resources that are about to go away
+	CGameThreadPool* pThreadPool = CGameThreadPool::InstancePtr();
+	if (pThreadPool)
+	{
+		try
+		{
+			pThreadPool->WaitAll(m_kGroup);
+		}
+		catch (const std::exception& e)
+		{
+			TraceError("CFileLoaderThread::Shutdown: %s", e.what());
+		}
+	}
+
 	// Clear any pending completed items
 	{
 		std::lock_guard<std::mutex> lock(m_CompleteMutex);
@@ -33,24 +47,30 @@ void CFileLoaderThread::Shutdown()
 	}
 }
 
-void CFileLoaderThread::Request(const std::string& c_rstFileName)
+void CFileLoaderThread::Request(const std::string& c_rstFileName, CResource * pResource)
 {
 	if (m_bShutdowned)
 		return;
 
+	TData * pData = new TData;
+	pData->stFileName = c_rstFileName;
+	pData->uFileSize = 0;
+	pData->pResource = pResource;
+	pData->tRequest = std::chrono::steady_clock::now();
+
 	// Enqueue file loading to the global thread pool
 	CGameThreadPool* pThreadPool = CGameThreadPool::InstancePtr();
 	if (pThreadPool)
 	{
-		pThreadPool->Enqueue([this, c_rstFileName]()
+		pThreadPool->Submit([this, pData]()
 		{
-			ProcessFile(c_rstFileName);
-		});
+			ProcessFile(pData);
+		}, CGameThreadPool::PRIORITY_LOW, &m_kGroup);
 	}
 	else
 	{
 		// Fallback to synchronous loading if thread pool not available
-		ProcessFile(c_rstFileName);
+		ProcessFile(pData);
 	}
 }
 
@@ -67,16 +87,38 @@ bool CFileLoaderThread::Fetch(TData ** ppData)
 	return true;
 }
 
-void CFileLoaderThread::ProcessFile(const std::string& fileName)
+size_t CFileLoaderThread::GetCompleteCount()
+{
+	std::lock_guard<std::mutex> lock(m_CompleteMutex);
+	return m_pCompleteDeque.size();
+}
+
+void CFileLoaderThread::ProcessFile(TData * pData)
 {
 	if (m_bShutdowned)
+	{
+		delete pData;
 		return;
-
-	TData * pData = new TData;
-	pData->File.clear();
-	pData->stFileName = fileName;
+	}
 
 	CPackManager::instance().GetFile(pData->stFileName, pData->File);
+	pData->uFileSize = pData->File.size();
+
+	if (pData->pResource && !pData->File.empty())
+	{
+		// A failed decode still reaches the main thread, which then loads through OnLoad
+		try
+		{
+			pData->pDecoded = pData->pResource->DecodeOnWorker(pData->File.size(), pData->File.data());
+		}
+		catch (const std::exception& e)
+		{
+			TraceError("CFileLoaderThread: cannot decode %s: %s", pData->stFileName.c_str(), e.what());
+		}
+
+		if (pData->pDecoded)
+			TPackFile().swap(pData->File);
+	}
 
 	// Add to completed queue
 	{
@@ -3,7 +3,10 @@
 
 #include <deque>
 #include <mutex>
+#include <chrono>
 #include "PackLib/PackManager.h"
+#include "Resource.h"
+#include "GameThreadPool.h"
 
 class CFileLoaderThread
 {
@@ -11,7 +14,12 @@ class CFileLoaderThread
 		typedef struct SData
 		{
 			std::string	stFileName;
-			TPackFile	File;
+			TPackFile	File;		// empty once pDecoded holds the result
+			size_t		uFileSize;
+
+			CResource *					pResource;
+			CResource::TDecodedDataPtr	pDecoded;
+			std::chrono::steady_clock::time_point	tRequest;
 		} TData;
 
 	public:
@@ -22,16 +30,20 @@ class CFileLoaderThread
 		void Shutdown();
 
 	public:
-		void	Request(const std::string& c_rstFileName);
+		// pResource, if any, gets its bytes decoded on the worker as well
+		void	Request(const std::string& c_rstFileName, CResource * pResource = NULL);
 		bool	Fetch(TData ** ppData);
 
+		size_t	GetCompleteCount();
+
 	private:
-		void	ProcessFile(const std::string& fileName);
+		void	ProcessFile(TData * pData);
 
 	private:
 		std::deque<TData*>		m_pCompleteDeque;
 		std::mutex				m_CompleteMutex;
 		bool					m_bShutdowned;
+		CGameTaskGroup			m_kGroup;
 };
 
 #endif
\ No newline at end of file
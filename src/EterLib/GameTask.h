@@ -0,0 +1,112 @@
+#ifndef __INC_ETERLIB_GAMETASK_H__
+#define __INC_ETERLIB_GAMETASK_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only void() callable. Callables up to INLINE_SIZE bytes are stored in place,
+// larger ones fall back to the heap. Replaces std::function for pool tasks.
+class CGameTask
+{
+public:
+	static constexpr size_t INLINE_SIZE = 48;
+
+	CGameTask() = default;
+
+	template<typename TFunc, typename = std::enable_if_t<!std::is_same_v<std::decay_t<TFunc>, CGameTask>>>
+	CGameTask(TFunc&& func)
+	{
+		using TStored = std::decay_t<TFunc>;
+
+		if constexpr (sizeof(TStored) <= INLINE_SIZE && alignof(TStored) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<TStored>)
+		{
+			new (m_storage) TStored(std::forward<TFunc>(func));
+			m_pVTable = &s_inlineVTable<TStored>;
+		}
+		else
+		{
+			*reinterpret_cast<TStored**>(m_storage) = new TStored(std::forward<TFunc>(func));
+			m_pVTable = &s_heapVTable<TStored>;
+		}
+	}
+
+	CGameTask(CGameTask&& other) noexcept
+	{
+		MoveFrom(other);
+	}
+
+	CGameTask& operator=(CGameTask&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	CGameTask(const CGameTask&) = delete;
+	CGameTask& operator=(const CGameTask&) = delete;
+
+	~CGameTask()
+	{
+		Reset();
+	}
+
+	explicit operator bool() const { return m_pVTable != nullptr; }
+
+	void operator()()
+	{
+		m_pVTable->invoke(m_storage);
+	}
+
+	void Reset()
+	{
+		if (m_pVTable)
+		{
+			m_pVTable->destroy(m_storage);
+			m_pVTable = nullptr;
+		}
+	}
+
+private:
+	struct TVTable
+	{
+		void (*invoke)(void* storage);
+		void (*move)(void* dst, void* src); // leaves src destroyed
+		void (*destroy)(void* storage);
+	};
+
+	template<typename T>
+	static constexpr TVTable s_inlineVTable =
+	{
+		[](void* p) { (*static_cast<T*>(p))(); },
+		[](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); static_cast<T*>(src)->~T(); },
+		[](void* p) { static_cast<T*>(p)->~T(); },
+	};
+
+	template<typename T>
+	static constexpr TVTable s_heapVTable =
+	{
+		[](void* p) { (**static_cast<T**>(p))(); },
+		[](void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+		[](void* p) { delete *static_cast<T**>(p); },
+	};
+
+	void MoveFrom(CGameTask& other)
+	{
+		if (other.m_pVTable)
+		{
+			other.m_pVTable->move(m_storage, other.m_storage);
+			m_pVTable = other.m_pVTable;
+			other.m_pVTable = nullptr;
+		}
+	}
+
+	alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+	const TVTable* m_pVTable = nullptr;
+};
+
+#endif // __INC_ETERLIB_GAMETASK_H__
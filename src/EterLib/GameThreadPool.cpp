@@ -1,9 +1,34 @@
 #include "StdAfx.h"
 #include "GameThreadPool.h"
+#include "Profiler.h"
+
+namespace
+{
+	thread_local CGameThreadPool* s_pCurrentPool = nullptr;
+	thread_local void* s_pCurrentWorker = nullptr;
+
+	// Rounds of searching for work before a worker parks
+	const int SPIN_ROUNDS = 64;
+}
+
+CGameTaskGroup::~CGameTaskGroup()
+{
+	// Tasks still reference the group, so never let it go away under them
+	uint32_t uPending;
+	while ((uPending = m_uPending.load(std::memory_order_acquire)) != 0)
+		m_uPending.wait(uPending, std::memory_order_acquire);
+}
 
 CGameThreadPool::CGameThreadPool()
 	: m_bShutdown(false)
 	, m_bInitialized(false)
+	, m_uWakeEpoch(0)
+	, m_iSleeping(0)
+	, m_iLowRunning(0)
+	, m_iLowLimit(1)
+	, m_uQueuedCount(0)
+	, m_uExecutedCount(0)
+	, m_uStolenCount(0)
 {
 }
 
@@ -14,8 +39,8 @@ CGameThreadPool::~CGameThreadPool()
 
 void CGameThreadPool::Initialize(int iWorkerCount)
 {
-	std::lock_guard<std::mutex> lock(m_lifecycleMutex);
-	
+	std::unique_lock<std::shared_mutex> lock(m_lifecycleMutex);
+
 	if (m_bInitialized.load(std::memory_order_acquire))
 	{
 		TraceError("CGameThreadPool::Initialize - Already initialized!");
@@ -36,6 +61,7 @@ void CGameThreadPool::Initialize(int iWorkerCount)
 	Tracef("CGameThreadPool::Initialize - Creating %d worker threads\n", iWorkerCount);
 
 	m_bShutdown.store(false, std::memory_order_release);
+	m_iLowLimit = std::max(1, iWorkerCount - 1);
 	m_workers.clear();
 	m_workers.reserve(iWorkerCount);
 
@@ -43,8 +69,8 @@ void CGameThreadPool::Initialize(int iWorkerCount)
 	for (int i = 0; i < iWorkerCount; ++i)
 	{
 		auto pWorker = std::make_unique<TWorkerThread>();
-		pWorker->pTaskQueue = std::make_unique<SPSCQueue<TTask>>(QUEUE_SIZE);
-		pWorker->uTaskCount.store(0, std::memory_order_relaxed);
+		pWorker->uIndex = static_cast<uint32_t>(i);
+		pWorker->uRandom = 0x9E3779B9u * static_cast<uint32_t>(i + 1);
 		m_workers.push_back(std::move(pWorker));
 	}
 
@@ -55,27 +81,27 @@ void CGameThreadPool::Initialize(int iWorkerCount)
 	for (int i = 0; i < iWorkerCount; ++i)
 	{
 		TWorkerThread* pWorker = m_workers[i].get();
-		// Pass worker pointer directly instead of index
 		pWorker->thread = std::thread(&CGameThreadPool::WorkerThreadProc, this, pWorker);
 	}
 }
 
 void CGameThreadPool::Destroy()
 {
-	std::lock_guard<std::mutex> lock(m_lifecycleMutex);
-	
+	std::unique_lock<std::shared_mutex> lock(m_lifecycleMutex);
+
 	if (!m_bInitialized.load(std::memory_order_acquire))
 		return;
 
-	Tracef("CGameThreadPool::Destroy - Shutting down %d worker threads\n", GetWorkerCount());
+	Tracef("CGameThreadPool::Destroy - Shutting down %d worker threads (%llu tasks run, %llu stolen)\n", GetWorkerCount(),
+		static_cast<unsigned long long>(m_uExecutedCount.load()), static_cast<unsigned long long>(m_uStolenCount.load()));
 
-	// Signal shutdown first
-	m_bShutdown.store(true, std::memory_order_release);
-	
-	// Mark as not initialized to prevent new enqueues
+	// Mark as not initialized so new submissions run inline, then wake everyone up
 	m_bInitialized.store(false, std::memory_order_release);
+	m_bShutdown.store(true, std::memory_order_release);
+	m_uWakeEpoch.fetch_add(1, std::memory_order_seq_cst);
+	m_uWakeEpoch.notify_all();
 
-	// Join all worker threads
+	// Join all worker threads, they drain the queues first
 	for (auto& pWorker : m_workers)
 	{
 		if (pWorker->thread.joinable())
@@ -85,125 +111,291 @@ void CGameThreadPool::Destroy()
 	m_workers.clear();
 }
 
-void CGameThreadPool::WorkerThreadProc(TWorkerThread* pWorker)
+bool CGameThreadPool::IsWorkerThread()
 {
-	int iIdleCount = 0;
+	return s_pCurrentPool != nullptr;
+}
+
+CGameThreadPool::TWorkerThread* CGameThreadPool::GetCurrentWorker() const
+{
+	return s_pCurrentPool == this ? static_cast<TWorkerThread*>(s_pCurrentWorker) : nullptr;
+}
 
-	while (!m_bShutdown.load(std::memory_order_acquire))
+void CGameThreadPool::Submit(CGameTask task, EPriority ePriority, CGameTaskGroup* pGroup)
+{
+	if (!task)
+		return;
+
+	if (pGroup)
+		pGroup->m_uPending.fetch_add(1, std::memory_order_relaxed);
+
+	// Workers cannot outlive the pool, so they skip the lifecycle lock. Destroy holds it
+	// exclusively while joining them.
+	TWorkerThread* pWorker = GetCurrentWorker();
+	std::shared_lock<std::shared_mutex> lock(m_lifecycleMutex, std::defer_lock);
+	if (!pWorker)
+		lock.lock();
+
+	if (!m_bInitialized.load(std::memory_order_acquire))
 	{
-		TTask task;
-		
-		// Pop from queue with minimal locking
-		bool bHasTask = false;
-		{
-			std::lock_guard<std::mutex> lock(pWorker->queueMutex);
-			bHasTask = pWorker->pTaskQueue->Pop(task);
-		}
-		
-		if (bHasTask)
-		{
-			iIdleCount = 0;
+		// If not initialized, execute on calling thread
+		if (lock.owns_lock())
+			lock.unlock();
 
-			// Execute the task
-			try
-			{
-				task();
-			}
-			catch (const std::exception& e)
-			{
-				TraceError("CGameThreadPool::WorkerThreadProc - Exception: %s", e.what());
-			}
-			catch (...)
-			{
-				TraceError("CGameThreadPool::WorkerThreadProc - Unknown exception");
-			}
+		RunInline(task, pGroup);
+		return;
+	}
 
-			pWorker->uTaskCount.fetch_sub(1, std::memory_order_relaxed);
-		}
-		else
-		{
-			// No work available - idle strategy
-			++iIdleCount;
+	TTaskNode* pNode = new TTaskNode{ std::move(task), pGroup, ePriority };
+	m_uQueuedCount.fetch_add(1, std::memory_order_relaxed);
 
-			if (iIdleCount < 100)
-			{
-				// Spin briefly for immediate work
-				std::this_thread::yield();
-			}
-			else if (iIdleCount < 1000)
-			{
-				// Short sleep for moderate idle
-				std::this_thread::sleep_for(std::chrono::microseconds(10));
-			}
-			else
-			{
-				// Longer sleep for extended idle
-				std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				// Reset idle count to prevent overflow
-				if (iIdleCount > 10000)
-					iIdleCount = 1000;
-			}
-		}
+	// Workers spawning work keep it local, everyone else goes through the injector
+	if (pWorker)
+	{
+		pWorker->aDeque[ePriority].Push(pNode);
+	}
+	else
+	{
+		TInjector& rInjector = m_aInjector[ePriority];
+		std::lock_guard<std::mutex> queueLock(rInjector.mutex);
+		rInjector.queue.push_back(pNode);
+		rInjector.uSize.store(rInjector.queue.size(), std::memory_order_release);
 	}
 
-	// Process remaining tasks before shutdown
-	TTask task;
-	while (true)
+	WakeWorker();
+}
+
+void CGameThreadPool::WaitAll(CGameTaskGroup& group)
+{
+	TWorkerThread* pWorker = GetCurrentWorker();
+
+	while (!group.IsDone())
 	{
-		bool bHasTask = false;
+		// Help out instead of blocking, but never pick up streaming work while someone waits
+		TTaskNode* pNode;
+		if (FindTask(pWorker, PRIORITY_NORMAL, false, pNode))
 		{
-			std::lock_guard<std::mutex> lock(pWorker->queueMutex);
-			bHasTask = pWorker->pTaskQueue->Pop(task);
+			Execute(pNode);
+			continue;
 		}
-		
-		if (!bHasTask)
+
+		const uint32_t uPending = group.m_uPending.load(std::memory_order_acquire);
+		if (uPending == 0)
 			break;
-			
-		try
+
+		group.m_uPending.wait(uPending, std::memory_order_acquire);
+	}
+
+	std::exception_ptr exception;
+	{
+		std::lock_guard<std::mutex> lock(group.m_exceptionMutex);
+		std::swap(exception, group.m_exception);
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+void CGameThreadPool::WakeWorker()
+{
+	m_uWakeEpoch.fetch_add(1, std::memory_order_seq_cst);
+	if (m_iSleeping.load(std::memory_order_seq_cst) > 0)
+		m_uWakeEpoch.notify_one();
+}
+
+bool CGameThreadPool::TryReserveLowSlot()
+{
+	int iRunning = m_iLowRunning.load(std::memory_order_relaxed);
+	while (iRunning < m_iLowLimit)
+	{
+		if (m_iLowRunning.compare_exchange_weak(iRunning, iRunning + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+bool CGameThreadPool::StealTask(TWorkerThread* pWorker, int iPriority, TTaskNode*& rpNode)
+{
+	const size_t uWorkerCount = m_workers.size();
+	if (uWorkerCount == 0)
+		return false;
+
+	uint32_t uStart = 0;
+	if (pWorker)
+	{
+		// xorshift, so workers do not all hammer the same victim
+		pWorker->uRandom ^= pWorker->uRandom << 13;
+		pWorker->uRandom ^= pWorker->uRandom >> 17;
+		pWorker->uRandom ^= pWorker->uRandom << 5;
+		uStart = pWorker->uRandom;
+	}
+
+	for (size_t i = 0; i < uWorkerCount; ++i)
+	{
+		TWorkerThread* pVictim = m_workers[(uStart + i) % uWorkerCount].get();
+		if (pVictim == pWorker)
+			continue;
+
+		if (pVictim->aDeque[iPriority].Steal(rpNode))
 		{
-			task();
+			m_uStolenCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
 		}
-		catch (const std::exception& e)
+	}
+
+	return false;
+}
+
+bool CGameThreadPool::FindTask(TWorkerThread* pWorker, int iMaxPriority, bool bIgnoreLowLimit, TTaskNode*& rpNode)
+{
+	for (int iPriority = PRIORITY_HIGH; iPriority <= iMaxPriority; ++iPriority)
+	{
+		// Keep one worker free of streaming work for latency-critical tasks
+		const bool bLow = (iPriority == PRIORITY_LOW);
+		if (bLow && !bIgnoreLowLimit && !TryReserveLowSlot())
+			continue;
+
+		bool bFound = false;
+		if (pWorker && pWorker->aDeque[iPriority].Pop(rpNode))
+			bFound = true;
+
+		if (!bFound)
 		{
-			TraceError("CGameThreadPool::WorkerThreadProc - Exception during shutdown: %s", e.what());
+			TInjector& rInjector = m_aInjector[iPriority];
+			if (rInjector.uSize.load(std::memory_order_acquire) != 0)
+			{
+				std::lock_guard<std::mutex> queueLock(rInjector.mutex);
+				if (!rInjector.queue.empty())
+				{
+					rpNode = rInjector.queue.front();
+					rInjector.queue.pop_front();
+					rInjector.uSize.store(rInjector.queue.size(), std::memory_order_release);
+					bFound = true;
+				}
+			}
 		}
-		catch (...)
+
+		if (!bFound)
+			bFound = StealTask(pWorker, iPriority, rpNode);
+
+		if (bFound)
 		{
-			TraceError("CGameThreadPool::WorkerThreadProc - Unknown exception during shutdown");
+			// Bypassed tasks still count against the limit while they run
+			if (bLow && bIgnoreLowLimit)
+				m_iLowRunning.fetch_add(1, std::memory_order_relaxed);
+
+			m_uQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+			return true;
 		}
-		
-		pWorker->uTaskCount.fetch_sub(1, std::memory_order_relaxed);
+
+		if (bLow && !bIgnoreLowLimit)
+			m_iLowRunning.fetch_sub(1, std::memory_order_release);
 	}
+
+	return false;
 }
 
-int CGameThreadPool::SelectLeastBusyWorker() const
+void CGameThreadPool::Execute(TTaskNode* pNode)
 {
-	if (m_workers.empty())
-		return 0;
+	CGameTaskGroup* pGroup = pNode->pGroup;
 
-	// Simple load balancing: find worker with least pending tasks
-	int iBestWorker = 0;
-	uint32_t uMinTasks = m_workers[0]->uTaskCount.load(std::memory_order_relaxed);
-
-	for (size_t i = 1; i < m_workers.size(); ++i)
+	try
+	{
+		PROFILE_ZONE("Pool task");
+		pNode->task();
+	}
+	catch (const std::exception& e)
 	{
-		uint32_t uTasks = m_workers[i]->uTaskCount.load(std::memory_order_relaxed);
-		if (uTasks < uMinTasks)
+		TraceError("CGameThreadPool::Execute - Exception: %s", e.what());
+		if (pGroup)
 		{
-			uMinTasks = uTasks;
-			iBestWorker = static_cast<int>(i);
+			std::lock_guard<std::mutex> lock(pGroup->m_exceptionMutex);
+			if (!pGroup->m_exception)
+				pGroup->m_exception = std::current_exception();
+		}
+	}
+	catch (...)
+	{
+		TraceError("CGameThreadPool::Execute - Unknown exception");
+		if (pGroup)
+		{
+			std::lock_guard<std::mutex> lock(pGroup->m_exceptionMutex);
+			if (!pGroup->m_exception)
+				pGroup->m_exception = std::current_exception();
 		}
 	}
 
-	return iBestWorker;
+	if (pNode->ePriority == PRIORITY_LOW)
+		m_iLowRunning.fetch_sub(1, std::memory_order_release);
+
+	delete pNode;
+	m_uExecutedCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (pGroup && pGroup->m_uPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		pGroup->m_uPending.notify_all();
 }
 
-size_t CGameThreadPool::GetPendingTaskCount() const
+void CGameThreadPool::RunInline(CGameTask& task, CGameTaskGroup* pGroup)
 {
-	size_t uTotal = 0;
-	for (const auto& pWorker : m_workers)
+	try
+	{
+		task();
+	}
+	catch (...)
 	{
-		uTotal += pWorker->uTaskCount.load(std::memory_order_relaxed);
+		if (!pGroup)
+			throw;
+
+		std::lock_guard<std::mutex> lock(pGroup->m_exceptionMutex);
+		if (!pGroup->m_exception)
+			pGroup->m_exception = std::current_exception();
 	}
-	return uTotal;
+
+	if (pGroup && pGroup->m_uPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		pGroup->m_uPending.notify_all();
+}
+
+void CGameThreadPool::WorkerThreadProc(TWorkerThread* pWorker)
+{
+	s_pCurrentPool = this;
+	s_pCurrentWorker = pWorker;
+
+	CProfiler::SetThreadName("Pool worker");
+
+	int iIdleRounds = 0;
+	while (true)
+	{
+		const uint32_t uEpoch = m_uWakeEpoch.load(std::memory_order_seq_cst);
+
+		TTaskNode* pNode;
+		if (FindTask(pWorker, PRIORITY_LOW, false, pNode))
+		{
+			iIdleRounds = 0;
+			Execute(pNode);
+			continue;
+		}
+
+		if (m_bShutdown.load(std::memory_order_acquire))
+			break;
+
+		// Spin briefly for immediate work, then park until the next submission
+		if (++iIdleRounds < SPIN_ROUNDS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		m_iSleeping.fetch_add(1, std::memory_order_seq_cst);
+		m_uWakeEpoch.wait(uEpoch, std::memory_order_seq_cst);
+		m_iSleeping.fetch_sub(1, std::memory_order_relaxed);
+		iIdleRounds = 0;
+	}
+
+	// Process remaining tasks before shutdown
+	TTaskNode* pNode;
+	while (FindTask(pWorker, PRIORITY_LOW, true, pNode))
+		Execute(pNode);
+
+	s_pCurrentPool = nullptr;
+	s_pCurrentWorker = nullptr;
 }
@@ -1,19 +1,50 @@
 #pragma once
 
-#include "SPSCQueue.h"
+#include "GameTask.h"
+#include "WorkStealingDeque.h"
 #include "EterBase/Singleton.h"
 #include <thread>
 #include <vector>
-#include <functional>
+#include <deque>
 #include <future>
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <exception>
 
+// Counts the tasks submitted with it, so a caller can wait for all of them without futures
+class CGameTaskGroup
+{
+public:
+	CGameTaskGroup() : m_uPending(0) {}
+	~CGameTaskGroup();
+
+	CGameTaskGroup(const CGameTaskGroup&) = delete;
+	CGameTaskGroup& operator=(const CGameTaskGroup&) = delete;
+
+	bool IsDone() const { return m_uPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class CGameThreadPool;
+
+	std::atomic<uint32_t> m_uPending;
+	std::mutex m_exceptionMutex;
+	std::exception_ptr m_exception; // first exception thrown by a task of the group
+};
+
+// Work-stealing pool: each worker owns a Chase-Lev deque per priority, tasks submitted from
+// other threads go through an injector queue. Idle workers park on an atomic wait instead of polling.
 class CGameThreadPool : public CSingleton<CGameThreadPool>
 {
 public:
-	using TTask = std::function<void()>;
+	enum EPriority
+	{
+		PRIORITY_HIGH,   // per-frame work the render thread waits for
+		PRIORITY_NORMAL,
+		PRIORITY_LOW,    // streaming/loading, never occupies every worker
+		PRIORITY_MAX_NUM,
+	};
 
 	CGameThreadPool();
 	~CGameThreadPool();
@@ -25,123 +56,100 @@ public:
 	// Shutdown and join all worker threads
 	void Destroy();
 
+	// Fire-and-forget submission. Runs on the calling thread if the pool is not initialized.
+	void Submit(CGameTask task, EPriority ePriority = PRIORITY_NORMAL, CGameTaskGroup* pGroup = nullptr);
+
+	// Blocks until every task of the group has finished, running queued work meanwhile.
+	// Rethrows the first exception thrown by one of the tasks.
+	void WaitAll(CGameTaskGroup& group);
+
 	// Enqueue a task and get a future to track completion
 	template<typename TFunc>
-	std::future<void> Enqueue(TFunc&& func);
+	std::future<void> Enqueue(TFunc&& func, EPriority ePriority = PRIORITY_NORMAL);
 
 	// Get number of active workers
 	int GetWorkerCount() const { return static_cast<int>(m_workers.size()); }
 
 	// Get approximate number of pending tasks across all queues
-	size_t GetPendingTaskCount() const;
+	size_t GetPendingTaskCount() const { return m_uQueuedCount.load(std::memory_order_relaxed); }
 
 	// Check if pool is initialized
 	bool IsInitialized() const { return m_bInitialized.load(std::memory_order_acquire); }
 
+	// True on the pool's own worker threads
+	static bool IsWorkerThread();
+
 private:
+	struct TTaskNode
+	{
+		CGameTask task;
+		CGameTaskGroup* pGroup;
+		EPriority ePriority;
+	};
+
 	struct TWorkerThread
 	{
 		std::thread thread;
-		std::unique_ptr<SPSCQueue<TTask>> pTaskQueue;
-		std::mutex queueMutex; // Mutex to protect SPSC queue from multiple producers
-		std::atomic<uint32_t> uTaskCount;
+		WorkStealingDeque<TTaskNode*> aDeque[PRIORITY_MAX_NUM];
+		uint32_t uIndex;
+		uint32_t uRandom; // victim selection
+	};
 
-		TWorkerThread()
-			: uTaskCount(0)
-		{
-		}
+	struct TInjector
+	{
+		std::mutex mutex;
+		std::deque<TTaskNode*> queue;
+		std::atomic<size_t> uSize;
+
+		TInjector() : uSize(0) {}
 	};
 
 	void WorkerThreadProc(TWorkerThread* pWorker);
-	int SelectLeastBusyWorker() const;
+	TWorkerThread* GetCurrentWorker() const;
+	bool FindTask(TWorkerThread* pWorker, int iMaxPriority, bool bIgnoreLowLimit, TTaskNode*& rpNode);
+	bool StealTask(TWorkerThread* pWorker, int iPriority, TTaskNode*& rpNode);
+	bool TryReserveLowSlot();
+	void Execute(TTaskNode* pNode);
+	void RunInline(CGameTask& task, CGameTaskGroup* pGroup);
+	void WakeWorker();
 
 	std::vector<std::unique_ptr<TWorkerThread>> m_workers;
+	TInjector m_aInjector[PRIORITY_MAX_NUM];
 	std::atomic<bool> m_bShutdown;
 	std::atomic<bool> m_bInitialized;
-	mutable std::mutex m_lifecycleMutex; // Protects initialization/destruction
+	std::shared_mutex m_lifecycleMutex; // Submit holds it shared, Initialize/Destroy exclusively
+
+	// Parking: a worker sleeps on the epoch it saw before its last search for work
+	std::atomic<uint32_t> m_uWakeEpoch;
+	std::atomic<int> m_iSleeping;
 
-	static const size_t QUEUE_SIZE = 8192;
+	std::atomic<int> m_iLowRunning;
+	int m_iLowLimit;
+
+	std::atomic<size_t> m_uQueuedCount;
+	std::atomic<uint64_t> m_uExecutedCount;
+	std::atomic<uint64_t> m_uStolenCount;
 };
 
 // Template implementation
 template<typename TFunc>
-std::future<void> CGameThreadPool::Enqueue(TFunc&& func)
+std::future<void> CGameThreadPool::Enqueue(TFunc&& func, EPriority ePriority)
 {
-	// Lock to ensure thread pool isn't being destroyed
-	std::unique_lock<std::mutex> lock(m_lifecycleMutex);
-	
-	if (!m_bInitialized.load(std::memory_order_acquire))
-	{
-		// If not initialized, execute on calling thread
-		lock.unlock(); // No need to hold lock
-		
-		auto promise = std::make_shared<std::promise<void>>();
-		auto future = promise->get_future();
-		try
-		{
-			func();
-			promise->set_value();
-		}
-		catch (...)
-		{
-			promise->set_exception(std::current_exception());
-		}
-		return future;
-	}
+	std::promise<void> promise;
+	std::future<void> future = promise.get_future();
 
-	// Create a promise to track task completion
-	auto promise = std::make_shared<std::promise<void>>();
-	auto future = promise->get_future();
-
-	// Wrap function in shared_ptr to avoid move issues with std::function
-	auto pFunc = std::make_shared<typename std::decay<TFunc>::type>(std::forward<TFunc>(func));
-
-	// Wrap the task with promise completion
-	TTask task = [promise, pFunc]()
+	Submit([promise = std::move(promise), func = std::forward<TFunc>(func)]() mutable
 	{
 		try
 		{
-			(*pFunc)();
-			promise->set_value();
-		}
-		catch (...)
-		{
-			promise->set_exception(std::current_exception());
-		}
-	};
-
-	// Select worker with least load
-	int iWorkerIndex = SelectLeastBusyWorker();
-	TWorkerThread* pWorker = m_workers[iWorkerIndex].get();
-
-	// Increment task count before pushing
-	pWorker->uTaskCount.fetch_add(1, std::memory_order_relaxed);
-	
-	// Try to enqueue the task with mutex protection for SPSC queue
-	bool bPushed = false;
-	{
-		std::lock_guard<std::mutex> queueLock(pWorker->queueMutex);
-		bPushed = pWorker->pTaskQueue->Push(std::move(task));
-	}
-	
-	if (!bPushed)
-	{
-		// Queue is full, decrement count and execute on calling thread as fallback
-		pWorker->uTaskCount.fetch_sub(1, std::memory_order_relaxed);
-		
-		// Release lifecycle lock before executing task
-		lock.unlock();
-		
-		try
-		{
-			(*pFunc)();
-			promise->set_value();
+			func();
+			promise.set_value();
 		}
 		catch (...)
 		{
-			promise->set_exception(std::current_exception());
+			promise.set_exception(std::current_exception());
 		}
-	}
+	}, ePriority);
 
 	return future;
 }
@@ -7,6 +7,7 @@
 #include <utf8.h>
 
 bool CPU_HAS_SSE2 = false;
+bool CPU_HAS_AVX2 = false;
 bool GRAPHICS_CAPS_CAN_NOT_DRAW_LINE = false;
 bool GRAPHICS_CAPS_CAN_NOT_DRAW_SHADOW = false;
 bool GRAPHICS_CAPS_HALF_SIZE_IMAGE = false;
@@ -599,6 +600,20 @@ RETRY:
 
 	CPU_HAS_SSE2 = cpuInfo[3] & (1 << 26);
 
+	// AVX2 also needs FMA and an OS that saves the YMM registers
+	const bool hasFMA = cpuInfo[2] & (1 << 12);
+	const bool hasOSXSAVE = cpuInfo[2] & (1 << 27);
+	const bool hasAVX = cpuInfo[2] & (1 << 28);
+
+	int cpuMaxLeaf[4] = { 0 };
+	__cpuid(cpuMaxLeaf, 0);
+
+	if (hasFMA && hasOSXSAVE && hasAVX && cpuMaxLeaf[0] >= 7 && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(cpuInfo, 7, 0);
+		CPU_HAS_AVX2 = cpuInfo[1] & (1 << 5);
+	}
+
 	return (iRet);
 }
 
@@ -1,6 +1,15 @@
 #include "StdAfx.h"
 #include "GrpImage.h"
 #include "DecodedImageData.h"
+#include "ImageDecoder.h"
+
+namespace
+{
+	struct SDecodedImage : public CResource::SDecodedData
+	{
+		TDecodedImageData kImage;
+	};
+}
 
 CGraphicImage::CGraphicImage(const char * c_szFileName, DWORD dwFilter) : 
 CResource(c_szFileName),
@@ -57,6 +66,49 @@ CGraphicTexture* CGraphicImage::GetTexturePointer()
 	return &m_imageTexture;
 }
 
+size_t CGraphicImage::GetMemorySize() const
+{
+	LPDIRECT3DTEXTURE9 lpd3dTexture = m_imageTexture.GetD3DTexture();
+	D3DSURFACE_DESC kDesc;
+
+	if (!lpd3dTexture || FAILED(lpd3dTexture->GetLevelDesc(0, &kDesc)))
+		return CResource::GetMemorySize();
+
+	size_t uBitsPerPixel;
+	switch (kDesc.Format)
+	{
+		case D3DFMT_DXT1:
+			uBitsPerPixel = 4;
+			break;
+
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+			uBitsPerPixel = 8;
+			break;
+
+		case D3DFMT_R5G6B5:
+		case D3DFMT_X1R5G5B5:
+		case D3DFMT_A1R5G5B5:
+		case D3DFMT_A4R4G4B4:
+			uBitsPerPixel = 16;
+			break;
+
+		default:
+			uBitsPerPixel = 32;
+			break;
+	}
+
+	size_t uBytes = size_t(kDesc.Width) * kDesc.Height * uBitsPerPixel / 8;
+
+	// The mip chain adds about a third
+	if (lpd3dTexture->GetLevelCount() > 1)
+		uBytes += uBytes / 3;
+
+	return uBytes;
+}
+
 const RECT& CGraphicImage::GetRectReference() const
 {
 	return m_rect;
@@ -97,6 +149,28 @@ bool CGraphicImage::OnLoadFromDecodedData(const TDecodedImageData& decodedImage)
 	return true;
 }
 
+CResource::TDecodedDataPtr CGraphicImage::DecodeOnWorker(int iSize, const void * c_pvBuf)
+{
+	if (!c_pvBuf || iSize < 4)
+		return NULL;
+
+	if (*(const DWORD *) c_pvBuf == MAKEFOURCC('D', 'D', 'S', ' '))
+		return NULL;
+
+	std::unique_ptr<SDecodedImage> pkImage(new SDecodedImage);
+
+	// Anything stb cannot read is left to D3DX in OnLoad
+	if (!CImageDecoder::DecodeImage(c_pvBuf, iSize, pkImage->kImage))
+		return NULL;
+
+	return pkImage;
+}
+
+bool CGraphicImage::FinalizeOnMain(SDecodedData & rData)
+{
+	return OnLoadFromDecodedData(static_cast<SDecodedImage &>(rData).kImage);
+}
+
 void CGraphicImage::OnClear()
 {
 //	Tracef("Image Destroy : %s\n", m_pszFileName);
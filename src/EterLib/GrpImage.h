@@ -30,8 +30,15 @@ class CGraphicImage : public CResource
 		const CGraphicTexture & GetTextureReference() const;
 		CGraphicTexture * GetTexturePointer();
 
+		// Estimated from the texture, sub images own none and count their file
+		size_t GetMemorySize() const;
+
 		bool OnLoadFromDecodedData(const TDecodedImageData& decodedImage);
 
+		// Decodes to pixels on the worker, DDS files are uploaded as they are and go through OnLoad
+		TDecodedDataPtr DecodeOnWorker(int iSize, const void * c_pvBuf);
+		bool FinalizeOnMain(SDecodedData & rData);
+
 	protected:
 		bool OnLoad(int iSize, const void * c_pvBuf);
 		
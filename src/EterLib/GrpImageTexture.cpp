@@ -58,8 +58,8 @@ bool CGraphicImageTexture::CreateDeviceObjects()
 	}
 	else
 	{
-		TPackFile	mappedFile;
-		if (!CPackManager::Instance().GetFile(m_stFileName, mappedFile))
+		CPackFileView	mappedFile;
+		if (!CPackManager::Instance().GetFileView(m_stFileName, mappedFile))
 			return false;
 
 		return CreateFromMemoryFile(mappedFile.size(), mappedFile.data(), m_d3dFmt, m_dwFilter);
@@ -274,7 +274,7 @@ bool CGraphicImageTexture::CreateFromDecodedData(const TDecodedImageData& decode
 		if (!CreateFromDDSTexture(decodedImage.pixels.size(), decodedImage.pixels.data()))
 			return false;
 	}
-	else if (decodedImage.format == TDecodedImageData::FORMAT_RGBA8)
+	else if (decodedImage.format == TDecodedImageData::FORMAT_RGBA8 || decodedImage.format == TDecodedImageData::FORMAT_BGRA8)
 	{
 		LPDIRECT3DTEXTURE9 texture;
 		D3DFORMAT format = D3DFMT_A8R8G8B8;
@@ -295,38 +295,51 @@ bool CGraphicImageTexture::CreateFromDecodedData(const TDecodedImageData& decode
 		D3DLOCKED_RECT rect;
 		if (SUCCEEDED(texture->LockRect(0, &rect, nullptr, 0)))
 		{
-			uint8_t* dstData = (uint8_t*)rect.pBits;
-			const uint8_t* srcData = decodedImage.pixels.data();
-			size_t pixelCount = decodedImage.width * decodedImage.height;
+			const size_t rowSize = decodedImage.width * 4;
 
-			#if defined(_M_IX86) || defined(_M_X64)
+			// Rows are copied one by one, the locked pitch may be wider than the image
+			for (int y = 0; y < decodedImage.height; ++y)
 			{
-				size_t simdPixels = pixelCount & ~3;
-				__m128i shuffle_mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+				uint8_t* dstData = (uint8_t*)rect.pBits + y * rect.Pitch;
+				const uint8_t* srcData = decodedImage.pixels.data() + y * rowSize;
 
-				for (size_t i = 0; i < simdPixels; i += 4) {
-					__m128i pixels = _mm_loadu_si128((__m128i*)(srcData + i * 4));
-					pixels = _mm_shuffle_epi8(pixels, shuffle_mask);
-					_mm_storeu_si128((__m128i*)(dstData + i * 4), pixels);
+				if (decodedImage.format == TDecodedImageData::FORMAT_BGRA8)
+				{
+					memcpy(dstData, srcData, rowSize);
+					continue;
 				}
 
-				for (size_t i = simdPixels; i < pixelCount; ++i) {
+				size_t pixelCount = decodedImage.width;
+
+				#if defined(_M_IX86) || defined(_M_X64)
+				{
+					size_t simdPixels = pixelCount & ~3;
+					__m128i shuffle_mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+					for (size_t i = 0; i < simdPixels; i += 4) {
+						__m128i pixels = _mm_loadu_si128((__m128i*)(srcData + i * 4));
+						pixels = _mm_shuffle_epi8(pixels, shuffle_mask);
+						_mm_storeu_si128((__m128i*)(dstData + i * 4), pixels);
+					}
+
+					for (size_t i = simdPixels; i < pixelCount; ++i) {
+						size_t idx = i * 4;
+						dstData[idx + 0] = srcData[idx + 2];
+						dstData[idx + 1] = srcData[idx + 1];
+						dstData[idx + 2] = srcData[idx + 0];
+						dstData[idx + 3] = srcData[idx + 3];
+					}
+				}
+				#else
+				for (size_t i = 0; i < pixelCount; ++i) {
 					size_t idx = i * 4;
 					dstData[idx + 0] = srcData[idx + 2];
 					dstData[idx + 1] = srcData[idx + 1];
 					dstData[idx + 2] = srcData[idx + 0];
 					dstData[idx + 3] = srcData[idx + 3];
 				}
+				#endif
 			}
-			#else
-			for (size_t i = 0; i < pixelCount; ++i) {
-				size_t idx = i * 4;
-				dstData[idx + 0] = srcData[idx + 2];
-				dstData[idx + 1] = srcData[idx + 1];
-				dstData[idx + 2] = srcData[idx + 0];
-				dstData[idx + 3] = srcData[idx + 3];
-			}
-			#endif
 
 			texture->UnlockRect(0);
 
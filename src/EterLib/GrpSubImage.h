@@ -25,6 +25,12 @@ class CGraphicSubImage : public CGraphicImage
 
 		static void SetSearchPath(const char * c_szFileName);
 
+		// A .sub only names another image, there is nothing to decode
+		TDecodedDataPtr DecodeOnWorker(int iSize, const void * c_pvBuf) { return NULL; }
+
+		// The texture belongs to the parent image and is charged there, only the file counts here
+		size_t GetMemorySize() const { return CResource::GetMemorySize(); }
+
 	protected:
 		void SetImagePointer(CGraphicImage* pImage);
 
@@ -3,6 +3,10 @@
 #include "EterImageLib/DDSTextureLoader9.h"
 #include <stb_image.h>
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <tmmintrin.h>
+#endif
+
 bool CImageDecoder::DecodeImage(const void* pData, size_t dataSize, TDecodedImageData& outImage)
 {
 	if (!pData || dataSize == 0)
@@ -78,13 +82,32 @@ bool CImageDecoder::DecodeSTB(const void* pData, size_t dataSize, TDecodedImageD
 
 	outImage.width = width;
 	outImage.height = height;
-	outImage.format = TDecodedImageData::FORMAT_RGBA8;
+	outImage.format = TDecodedImageData::FORMAT_BGRA8;
 	outImage.isDDS = false;
 	outImage.mipLevels = 1;
 
-	size_t pixelDataSize = width * height * 4;
-	outImage.pixels.resize(pixelDataSize);
-	memcpy(outImage.pixels.data(), imageData, pixelDataSize);
+	size_t pixelCount = width * height;
+	outImage.pixels.resize(pixelCount * 4);
+
+	// Swapped here on the worker, so the upload is a plain copy
+	const uint8_t* srcData = imageData;
+	uint8_t* dstData = outImage.pixels.data();
+	size_t i = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+	const __m128i shuffle_mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+	for (; i + 4 <= pixelCount; i += 4)
+		_mm_storeu_si128((__m128i*)(dstData + i * 4), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(srcData + i * 4)), shuffle_mask));
+#endif
+
+	for (; i < pixelCount; ++i)
+	{
+		dstData[i * 4 + 0] = srcData[i * 4 + 2];
+		dstData[i * 4 + 1] = srcData[i * 4 + 1];
+		dstData[i * 4 + 2] = srcData[i * 4 + 0];
+		dstData[i * 4 + 3] = srcData[i * 4 + 3];
+	}
 
 	stbi_image_free(imageData);
 
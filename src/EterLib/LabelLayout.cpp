@@ -0,0 +1,129 @@
+#include "StdAfx.h"
+#include "LabelLayout.h"
+
+#include <algorithm>
+
+CLabelLayout::CLabelLayout()
+{
+}
+
+CLabelLayout::~CLabelLayout()
+{
+}
+
+void CLabelLayout::Arrange(std::vector<TLabel*> & rkVct_pLabel)
+{
+	// Top to bottom, and a label only moves down, so only the ones already placed have to be checked
+	std::sort(rkVct_pLabel.begin(), rkVct_pLabel.end(), [](const TLabel * c_pLeft, const TLabel * c_pRight)
+	{
+		if (c_pLeft->y != c_pRight->y)
+			return c_pLeft->y < c_pRight->y;
+		if (c_pLeft->x != c_pRight->x)
+			return c_pLeft->x < c_pRight->x;
+		return c_pLeft->dwVirtualID < c_pRight->dwVirtualID;
+	});
+
+	for (size_t i = 0; i < rkVct_pLabel.size(); ++i)
+	{
+		TLabel * pLabel = rkVct_pLabel[i];
+		const float fyProjected = pLabel->y;
+		float fyBottom;
+
+		if (pLabel->isArranged && pLabel->xLast == pLabel->x && pLabel->yLast == fyProjected)
+		{
+			pLabel->y = pLabel->yArranged;
+
+			if (__FindCollision(pLabel, &fyBottom))
+				pLabel->y = fyProjected;
+		}
+
+		pLabel->xLast = pLabel->x;
+		pLabel->yLast = fyProjected;
+
+		for (int iCount = 0; iCount < LIMIT_COUNT && __FindCollision(pLabel, &fyBottom); ++iCount)
+			pLabel->y = fyBottom + 5.0f;
+
+		pLabel->yArranged = pLabel->y;
+		pLabel->isArranged = true;
+		__Insert(pLabel);
+	}
+
+	__Clear();
+}
+
+bool CLabelLayout::IsOverlapped(const TLabel * c_pSource, const TLabel * c_pTarget)
+{
+	return c_pSource->x + c_pSource->xStart <= c_pTarget->x + c_pTarget->xEnd &&
+		c_pSource->x + c_pSource->xEnd >= c_pTarget->x + c_pTarget->xStart &&
+		c_pSource->y + c_pSource->yStart <= c_pTarget->y + c_pTarget->yEnd &&
+		c_pSource->y + c_pSource->yEnd >= c_pTarget->y + c_pTarget->yStart;
+}
+
+// Finds the lowest bottom edge of the placed labels c_pLabel overlaps
+bool CLabelLayout::__FindCollision(const TLabel * c_pLabel, float * pfyBottom) const
+{
+	int ixStart, iyStart, ixEnd, iyEnd;
+	__GetCellRange(c_pLabel, &ixStart, &iyStart, &ixEnd, &iyEnd);
+
+	bool isCollided = false;
+
+	for (int iy = iyStart; iy <= iyEnd; ++iy)
+	for (int ix = ixStart; ix <= ixEnd; ++ix)
+	{
+		const std::vector<TLabel*> & c_rkVct_pBucket = m_akVct_pBucket[__GetBucketIndex(ix, iy)];
+		for (size_t i = 0; i < c_rkVct_pBucket.size(); ++i)
+		{
+			const TLabel * c_pPlaced = c_rkVct_pBucket[i];
+			if (!IsOverlapped(c_pLabel, c_pPlaced))
+				continue;
+
+			const float fyBottom = c_pPlaced->y + c_pPlaced->yEnd;
+			if (!isCollided || fyBottom > *pfyBottom)
+				*pfyBottom = fyBottom;
+
+			isCollided = true;
+		}
+	}
+
+	return isCollided;
+}
+
+void CLabelLayout::__Insert(TLabel * pLabel)
+{
+	int ixStart, iyStart, ixEnd, iyEnd;
+	__GetCellRange(pLabel, &ixStart, &iyStart, &ixEnd, &iyEnd);
+
+	for (int iy = iyStart; iy <= iyEnd; ++iy)
+	for (int ix = ixStart; ix <= ixEnd; ++ix)
+	{
+		const int iIndex = __GetBucketIndex(ix, iy);
+		if (m_akVct_pBucket[iIndex].empty())
+			m_kVct_iUsedBucket.push_back(iIndex);
+
+		m_akVct_pBucket[iIndex].push_back(pLabel);
+	}
+}
+
+void CLabelLayout::__Clear()
+{
+	for (size_t i = 0; i < m_kVct_iUsedBucket.size(); ++i)
+		m_akVct_pBucket[m_kVct_iUsedBucket[i]].clear();
+
+	m_kVct_iUsedBucket.clear();
+}
+
+void CLabelLayout::__GetCellRange(const TLabel * c_pLabel, int * pixStart, int * piyStart, int * pixEnd, int * piyEnd)
+{
+	// Positions projected from behind the camera can be far off, keep them in int range
+	const float c_fLimit = 65536.0f;
+	*pixStart = int(floorf(std::clamp(c_pLabel->x + c_pLabel->xStart, -c_fLimit, c_fLimit) / float(CELL_WIDTH)));
+	*piyStart = int(floorf(std::clamp(c_pLabel->y + c_pLabel->yStart, -c_fLimit, c_fLimit) / float(CELL_HEIGHT)));
+	*pixEnd = int(floorf(std::clamp(c_pLabel->x + c_pLabel->xEnd, -c_fLimit, c_fLimit) / float(CELL_WIDTH)));
+	*piyEnd = int(floorf(std::clamp(c_pLabel->y + c_pLabel->yEnd, -c_fLimit, c_fLimit) / float(CELL_HEIGHT)));
+}
+
+int CLabelLayout::__GetBucketIndex(int ix, int iy)
+{
+	// Cells sharing a bucket only cost a few extra overlap tests
+	return int((DWORD(ix) * 73856093u ^ DWORD(iy) * 19349663u) & (BUCKET_COUNT - 1));
+}
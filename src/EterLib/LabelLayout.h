@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+// Lays out screen space labels, the names of items on the ground for one. Labels are placed
+// top to bottom into a hash of screen cells, and one that overlaps labels placed before it
+// moves below the lowest of them. A label whose anchor did not move since the last Arrange
+// keeps its place unless a label placed before it now covers that spot.
+class CLabelLayout
+{
+	public:
+		typedef struct SLabel
+		{
+			DWORD			dwVirtualID;		// orders labels at the same position
+
+			float			x, y;				// projected anchor, Arrange moves y down
+			float			xStart, yStart;		// box around the anchor
+			float			xEnd, yEnd;
+
+			float			xLast, yLast;		// anchor at the last Arrange
+			float			yArranged;
+			bool			isArranged;
+		} TLabel;
+
+		enum
+		{
+			CELL_WIDTH = 64,
+			CELL_HEIGHT = 32,
+			BUCKET_COUNT = 1024,
+			LIMIT_COUNT = 20,		// moves per label and Arrange
+		};
+
+	public:
+		CLabelLayout();
+		~CLabelLayout();
+
+		// Sorts the labels into placing order and arranges them
+		void			Arrange(std::vector<TLabel*> & rkVct_pLabel);
+
+		static bool		IsOverlapped(const TLabel * c_pSource, const TLabel * c_pTarget);
+
+	protected:
+		bool			__FindCollision(const TLabel * c_pLabel, float * pfyBottom) const;
+		void			__Insert(TLabel * pLabel);
+		void			__Clear();
+
+		static void		__GetCellRange(const TLabel * c_pLabel, int * pixStart, int * piyStart, int * pixEnd, int * piyEnd);
+		static int		__GetBucketIndex(int ix, int iy);
+
+	protected:
+		std::vector<TLabel*>	m_akVct_pBucket[BUCKET_COUNT];
+		std::vector<int>		m_kVct_iUsedBucket;
+};
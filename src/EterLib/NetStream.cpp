@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "NetStream.h"
+#include "NetworkThread.h"
 #include <iomanip>
 #include <sstream>
 
@@ -19,6 +20,13 @@ bool CNetworkStream::IsSecurityMode()
 
 void CNetworkStream::DecryptPendingRecvData()
 {
+	// The network thread stopped decrypting at KEY_COMPLETE, nothing encrypted reached m_recvBuf yet
+	if (m_pNetworkThread)
+	{
+		m_pNetworkThread->OnCipherActivated();
+		return;
+	}
+
 	size_t remaining = m_recvBuf.ReadableBytes();
 	if (remaining > 0 && m_secureCipher.IsActivated())
 		m_secureCipher.DecryptInPlace(m_recvBuf.DataAt(m_recvBuf.ReadPos()), remaining);
@@ -75,8 +83,9 @@ bool CNetworkStream::__SendInternalBuffer()
 	if (sendSize < 0)
 	{
 		int err = WSAGetLastError();
-		TraceError("__SendInternalBuffer: send() failed, sock=%llu, dataSize=%d, error=%d",
-			(unsigned long long)m_sock, dataSize, err);
+		if (err != WSAEWOULDBLOCK)
+			TraceError("__SendInternalBuffer: send() failed, sock=%llu, dataSize=%d, error=%d",
+				(unsigned long long)m_sock, dataSize, err);
 		return false;
 	}
 
@@ -87,11 +96,53 @@ bool CNetworkStream::__SendInternalBuffer()
 
 #pragma warning(push)
 #pragma warning(disable:4127)
+void CNetworkStream::__StartNetworkThread()
+{
+	m_pNetworkThread = std::make_unique<CNetworkThread>(m_sock, m_secureCipher);
+	if (!m_pNetworkThread->Start())
+	{
+		TraceError("CNetworkStream - network thread failed to start, receiving on the main thread");
+		m_pNetworkThread.reset();
+	}
+}
+
+// The socket's receive side belongs to the network thread, this only collects its frames and sends
+void CNetworkStream::__ProcessNetworkThread()
+{
+	// Read before draining: the thread queues its last frames before it sets the flag, so
+	// every frame that arrived before a disconnect seen here is in this drain
+	const bool bDisconnected = m_pNetworkThread->IsDisconnected();
+
+	m_pNetworkThread->Drain(m_recvBuf);
+
+	if (m_sendBuf.ReadableBytes() > 0 && !__SendInternalBuffer())
+	{
+		if (WSAGetLastError() != WSAEWOULDBLOCK)
+		{
+			OnRemoteDisconnect();
+			Clear();
+			return;
+		}
+	}
+
+	if (!OnProcess() || (bDisconnected && m_pNetworkThread))
+	{
+		OnRemoteDisconnect();
+		Clear();
+	}
+}
+
 void CNetworkStream::Process()
 {
 	if (m_sock == INVALID_SOCKET)
 		return;
 
+	if (m_pNetworkThread)
+	{
+		__ProcessNetworkThread();
+		return;
+	}
+
 	fd_set fdsRecv;
 	fd_set fdsSend;
 
@@ -114,6 +165,10 @@ void CNetworkStream::Process()
 		if (FD_ISSET(m_sock, &fdsSend))
 		{
 			m_isOnline = true;
+
+			if (m_bUseNetworkThread)
+				__StartNetworkThread();
+
 			OnConnectSuccess();
 		}
 		else if (time(NULL) > m_connectLimitTime)
@@ -168,6 +223,9 @@ void CNetworkStream::Disconnect()
 
 void CNetworkStream::Clear()
 {
+	// Join the network thread before the socket and the cipher go away under it
+	m_pNetworkThread.reset();
+
 	// Always clean cipher state (erase key material promptly)
 	m_secureCipher.CleanUp();
 
@@ -527,6 +585,28 @@ bool CNetworkStream::Recv(int size, char * pDestBuf)
 	return true;
 }
 
+bool CNetworkStream::ConsumeRecv(int size)
+{
+	if (!Peek(size))
+		return false;
+
+#ifdef _PACKETDUMP
+	if (size >= 2)
+	{
+		const uint8_t* pData = m_recvBuf.ReadPtr();
+		uint16_t kHeader;
+		memcpy(&kHeader, pData, sizeof(kHeader));
+		PacketDumpf("RECV< %s 0x%04X (%d bytes)", GetHeaderName(kHeader), kHeader, size);
+
+		const auto contents = dump_hex(pData, size);
+		PacketDumpf("%s", contents.c_str());
+	}
+#endif
+
+	m_recvBuf.Discard(static_cast<size_t>(size));
+	return true;
+}
+
 int CNetworkStream::__GetSendBufferSize()
 {
 	return static_cast<int>(m_sendBuf.ReadableBytes());
@@ -727,6 +807,7 @@ CNetworkStream::CNetworkStream()
 	m_isOnline = false;
 	m_connectLimitTime = 0;
 
+	m_bUseNetworkThread = false;
 }
 
 CNetworkStream::~CNetworkStream()
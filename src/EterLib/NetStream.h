@@ -5,6 +5,9 @@
 #include "RingBuffer.h"
 #include "ControlPackets.h"
 
+#include <memory>
+
+class CNetworkThread;
 
 class CNetworkStream
 {
@@ -43,6 +46,10 @@ class CNetworkStream
 
 		bool IsOnline();
 
+		// Receive and decrypt on a dedicated thread from the next connection on
+		void SetNetworkThreadEnabled(bool bEnable) { m_bUseNetworkThread = bEnable; }
+		bool IsNetworkThreadEnabled() const { return m_bUseNetworkThread; }
+
 	protected:
 		virtual void OnConnectSuccess();
 		virtual void OnConnectFailure();
@@ -52,6 +59,16 @@ class CNetworkStream
 
 		bool __SendInternalBuffer();
 		bool __RecvInternalBuffer();
+		void __StartNetworkThread();
+		void __ProcessNetworkThread();
+
+		// In-place access to received data for zero-copy packet dispatch.
+		// The pointer stays valid until the recv buffer is consumed, cleared or refilled by Process().
+		const uint8_t* GetRecvReadPtr() const { return m_recvBuf.ReadPtr(); }
+		size_t GetRecvReadableBytes() const { return m_recvBuf.ReadableBytes(); }
+
+		// Drops a frame that was handled in place, with the same packet dump as Recv()
+		bool ConsumeRecv(int len);
 
 		int __GetSendBufferSize();
 
@@ -99,4 +116,7 @@ class CNetworkStream
 
 		CNetworkAddress m_addr;
 
+		bool m_bUseNetworkThread;
+		std::unique_ptr<CNetworkThread> m_pNetworkThread;
+
 };
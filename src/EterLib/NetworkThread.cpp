@@ -0,0 +1,331 @@
+#include "StdAfx.h"
+#include "NetworkThread.h"
+#include "ControlPackets.h"
+
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace
+{
+	// Stop reading and hand over what we have once this much is staged
+	const size_t MAX_STAGE_BYTES = 1024 * 1024;
+
+	// Larger chunks are freed instead of recycled after a burst
+	const size_t MAX_RECYCLED_CHUNK = 256 * 1024;
+
+	bool IsWouldBlock()
+	{
+#ifdef _WIN32
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+	}
+}
+
+CNetworkThread::CNetworkThread(SOCKET sock, SecureCipher& rCipher)
+	: m_sock(sock)
+	, m_rCipher(rCipher)
+	, m_bStop(false)
+	, m_bDisconnected(false)
+	, m_bCipherActivated(false)
+	, m_uRecvBytes(0)
+	, m_uPlainBytes(0)
+	, m_eCipherState(CIPHER_OFF)
+	, m_filledChunks(CHUNK_QUEUE_SIZE)
+	, m_freeChunks(CHUNK_QUEUE_SIZE)
+#ifndef _WIN32
+	, m_iEpoll(-1)
+	, m_iWakeEvent(-1)
+#endif
+{
+}
+
+CNetworkThread::~CNetworkThread()
+{
+	Stop();
+
+	std::vector<uint8_t>* pChunk;
+	while (m_filledChunks.Pop(pChunk))
+		delete pChunk;
+	while (m_freeChunks.Pop(pChunk))
+		delete pChunk;
+}
+
+bool CNetworkThread::Start()
+{
+	if (m_thread.joinable())
+		return true;
+
+	// Started before the key exchange, or for a stream that is already encrypted
+	if (m_rCipher.IsActivated())
+	{
+		m_eCipherState = CIPHER_ON;
+		m_bCipherActivated.store(true, std::memory_order_release);
+	}
+
+#ifndef _WIN32
+	m_iEpoll = epoll_create1(0);
+	m_iWakeEvent = eventfd(0, EFD_NONBLOCK);
+	if (m_iEpoll < 0 || m_iWakeEvent < 0)
+	{
+		TraceError("CNetworkThread::Start - epoll setup failed (%d)", errno);
+		Stop();
+		return false;
+	}
+
+	epoll_event kEvent = {};
+	kEvent.events = EPOLLIN | EPOLLRDHUP;
+	kEvent.data.fd = m_sock;
+	epoll_ctl(m_iEpoll, EPOLL_CTL_ADD, m_sock, &kEvent);
+
+	kEvent.events = EPOLLIN;
+	kEvent.data.fd = m_iWakeEvent;
+	epoll_ctl(m_iEpoll, EPOLL_CTL_ADD, m_iWakeEvent, &kEvent);
+#endif
+
+	m_bStop.store(false, std::memory_order_relaxed);
+	m_thread = std::thread(&CNetworkThread::ThreadProc, this);
+	return true;
+}
+
+void CNetworkThread::Stop()
+{
+	m_bStop.store(true, std::memory_order_release);
+
+#ifndef _WIN32
+	if (m_iWakeEvent >= 0)
+	{
+		const uint64_t uOne = 1;
+		(void)write(m_iWakeEvent, &uOne, sizeof(uOne));
+	}
+#endif
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+#ifndef _WIN32
+	if (m_iEpoll >= 0)
+		close(m_iEpoll);
+	if (m_iWakeEvent >= 0)
+		close(m_iWakeEvent);
+
+	m_iEpoll = -1;
+	m_iWakeEvent = -1;
+#endif
+}
+
+size_t CNetworkThread::Drain(RingBuffer& rDest)
+{
+	size_t uBytes = 0;
+
+	std::vector<uint8_t>* pChunk;
+	while (m_filledChunks.Pop(pChunk))
+	{
+		rDest.Write(pChunk->data(), pChunk->size());
+		uBytes += pChunk->size();
+
+		pChunk->clear();
+		if (pChunk->capacity() > MAX_RECYCLED_CHUNK || !m_freeChunks.Push(pChunk))
+			delete pChunk;
+	}
+
+	return uBytes;
+}
+
+void CNetworkThread::OnCipherActivated()
+{
+	m_bCipherActivated.store(true, std::memory_order_release);
+
+#ifndef _WIN32
+	const uint64_t uOne = 1;
+	(void)write(m_iWakeEvent, &uOne, sizeof(uOne));
+#endif
+}
+
+void CNetworkThread::ThreadProc()
+{
+	while (!m_bStop.load(std::memory_order_acquire))
+	{
+		if (!WaitReadable())
+		{
+			m_bDisconnected.store(true, std::memory_order_release);
+			break;
+		}
+
+		const bool bAlive = RecvAvailable();
+
+		DecryptPending();
+
+		const size_t uFrameBytes = ScanFrames();
+		if (uFrameBytes > 0 && !Publish(uFrameBytes))
+			break;
+
+		if (!bAlive)
+		{
+			m_bDisconnected.store(true, std::memory_order_release);
+			break;
+		}
+	}
+}
+
+bool CNetworkThread::WaitReadable()
+{
+	// Poll quickly while the game thread is about to activate the cipher
+	const int iTimeout = (m_eCipherState == CIPHER_WAIT) ? 1 : WAIT_TIMEOUT_MS;
+
+#ifdef _WIN32
+	fd_set fdsRecv;
+	FD_ZERO(&fdsRecv);
+	FD_SET(m_sock, &fdsRecv);
+
+	TIMEVAL delay;
+	delay.tv_sec = 0;
+	delay.tv_usec = iTimeout * 1000;
+
+	return select(0, &fdsRecv, NULL, NULL, &delay) != SOCKET_ERROR;
+#else
+	epoll_event aEvents[2];
+	const int iCount = epoll_wait(m_iEpoll, aEvents, 2, iTimeout);
+	if (iCount < 0)
+		return errno == EINTR;
+
+	for (int i = 0; i < iCount; ++i)
+	{
+		if (aEvents[i].data.fd == m_iWakeEvent)
+		{
+			uint64_t uValue;
+			(void)read(m_iWakeEvent, &uValue, sizeof(uValue));
+		}
+	}
+
+	return true;
+#endif
+}
+
+bool CNetworkThread::RecvAvailable()
+{
+	while (m_stage.ReadableBytes() < MAX_STAGE_BYTES)
+	{
+		m_stage.EnsureWritable(RECV_SIZE);
+
+		const int iRecv = recv(m_sock, reinterpret_cast<char*>(m_stage.WritePtr()), static_cast<int>(m_stage.WritableBytes()), 0);
+		if (iRecv > 0)
+		{
+			m_stage.CommitWrite(static_cast<size_t>(iRecv));
+			m_uRecvBytes.fetch_add(static_cast<uint64_t>(iRecv), std::memory_order_relaxed);
+			continue;
+		}
+
+		if (iRecv == 0)
+			return false;
+
+		return IsWouldBlock();
+	}
+
+	return true;
+}
+
+void CNetworkThread::DecryptPending()
+{
+	switch (m_eCipherState)
+	{
+		case CIPHER_OFF:
+			m_uPlainBytes = m_stage.ReadableBytes();
+			return;
+
+		case CIPHER_WAIT:
+			if (!m_bCipherActivated.load(std::memory_order_acquire))
+				return;
+
+			m_eCipherState = CIPHER_ON;
+			break;
+
+		case CIPHER_ON:
+			break;
+	}
+
+	const size_t uReadable = m_stage.ReadableBytes();
+	if (uReadable > m_uPlainBytes)
+	{
+		m_rCipher.DecryptInPlace(m_stage.DataAt(m_stage.ReadPos() + m_uPlainBytes), uReadable - m_uPlainBytes);
+		m_uPlainBytes = uReadable;
+	}
+}
+
+// Returns how many leading plaintext bytes form complete frames
+size_t CNetworkThread::ScanFrames()
+{
+	const uint8_t* pData = m_stage.ReadPtr();
+	size_t uPos = 0;
+
+	while (m_uPlainBytes - uPos >= sizeof(uint16_t))
+	{
+		uint16_t wHeader;
+		memcpy(&wHeader, pData + uPos, sizeof(wHeader));
+
+		// Zero padding, the dispatcher skips it two bytes at a time
+		if (0 == wHeader)
+		{
+			uPos += sizeof(uint16_t);
+			continue;
+		}
+
+		if (m_uPlainBytes - uPos < 2 * sizeof(uint16_t))
+			break;
+
+		uint16_t wLength;
+		memcpy(&wLength, pData + uPos + sizeof(uint16_t), sizeof(wLength));
+
+		// Broken stream, pass it on as is and let the dispatcher report it
+		if (wLength < 2 * sizeof(uint16_t) || wLength > MAX_FRAME_LENGTH)
+			return m_uPlainBytes;
+
+		if (m_uPlainBytes - uPos < wLength)
+			break;
+
+		uPos += wLength;
+
+		if (GC::KEY_COMPLETE == wHeader && CIPHER_OFF == m_eCipherState)
+		{
+			// Whatever follows is encrypted with keys the game thread sets while handling this frame
+			m_eCipherState = CIPHER_WAIT;
+			m_uPlainBytes = uPos;
+			break;
+		}
+	}
+
+	return uPos;
+}
+
+bool CNetworkThread::Publish(size_t uBytes)
+{
+	std::vector<uint8_t>* pChunk;
+	if (!m_freeChunks.Pop(pChunk))
+		pChunk = new std::vector<uint8_t>;
+
+	pChunk->assign(m_stage.ReadPtr(), m_stage.ReadPtr() + uBytes);
+
+	// The game thread is behind, wait for it instead of growing without bound
+	while (!m_filledChunks.Push(pChunk))
+	{
+		if (m_bStop.load(std::memory_order_acquire))
+		{
+			delete pChunk;
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	m_stage.Discard(uBytes);
+	m_uPlainBytes -= uBytes;
+	return true;
+}
@@ -0,0 +1,85 @@
+#ifndef __INC_ETERLIB_NETWORKTHREAD_H__
+#define __INC_ETERLIB_NETWORKTHREAD_H__
+
+#include "RingBuffer.h"
+#include "SPSCQueue.h"
+#include "EterBase/SecureCipher.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Owns the receive side of a connected socket on its own thread. It waits for readiness
+// (epoll, select on Windows), recv()s until the socket would block, decrypts and hands
+// complete frames to the game thread in chunks through a lock-free SPSC queue.
+// Sending stays on the game thread, so the cipher's tx and rx state never share a thread.
+class CNetworkThread
+{
+	public:
+		enum
+		{
+			CHUNK_QUEUE_SIZE = 256,
+			RECV_SIZE = 16 * 1024,
+			WAIT_TIMEOUT_MS = 50,
+			MAX_FRAME_LENGTH = 65000,
+		};
+
+		CNetworkThread(SOCKET sock, SecureCipher& rCipher);
+		~CNetworkThread();
+
+		CNetworkThread(const CNetworkThread&) = delete;
+		CNetworkThread& operator=(const CNetworkThread&) = delete;
+
+		bool Start();
+		void Stop();
+
+		// Game thread: appends every frame received so far to rDest, returns the byte count
+		size_t Drain(RingBuffer& rDest);
+
+		// Game thread: the cipher has been activated after KEY_COMPLETE, decrypt from the next byte on
+		void OnCipherActivated();
+
+		// Set once the peer closed the connection or recv() failed, after the last frame was queued
+		bool IsDisconnected() const { return m_bDisconnected.load(std::memory_order_acquire); }
+
+		uint64_t GetRecvBytes() const { return m_uRecvBytes.load(std::memory_order_relaxed); }
+
+	private:
+		enum ECipherState
+		{
+			CIPHER_OFF,		// plaintext, watching for KEY_COMPLETE
+			CIPHER_WAIT,	// KEY_COMPLETE handed over, the rest is ciphertext until the keys are set
+			CIPHER_ON,
+		};
+
+		void ThreadProc();
+		bool WaitReadable();
+		bool RecvAvailable();
+		void DecryptPending();
+		size_t ScanFrames();
+		bool Publish(size_t uBytes);
+
+		SOCKET m_sock;
+		SecureCipher& m_rCipher;
+
+		std::thread m_thread;
+		std::atomic<bool> m_bStop;
+		std::atomic<bool> m_bDisconnected;
+		std::atomic<bool> m_bCipherActivated;
+		std::atomic<uint64_t> m_uRecvBytes;
+
+		// Network thread only
+		RingBuffer m_stage;
+		size_t m_uPlainBytes;	// leading bytes of m_stage that are plaintext
+		ECipherState m_eCipherState;
+
+		SPSCQueue<std::vector<uint8_t>*> m_filledChunks;	// network -> game
+		SPSCQueue<std::vector<uint8_t>*> m_freeChunks;		// game -> network, for reuse
+
+#ifndef _WIN32
+		int m_iEpoll;
+		int m_iWakeEvent;
+#endif
+};
+
+#endif // __INC_ETERLIB_NETWORKTHREAD_H__
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "GameThreadPool.h"
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+// Data-parallel helpers on top of CGameThreadPool.
+// The range is cut into chunks of at least uGrainSize items. The calling thread runs the
+// first chunk itself and helps with the rest while it waits. Without an initialized pool,
+// or for ranges that fit in one chunk, everything runs in order on the calling thread.
+namespace ParallelDetail
+{
+	// At most a few chunks per thread, so stealing can even out uneven items
+	const size_t CHUNKS_PER_THREAD = 4;
+
+	inline size_t GetChunkCount(size_t uCount, size_t uGrainSize)
+	{
+		uGrainSize = std::max<size_t>(1, uGrainSize);
+		const size_t uMaxChunks = (uCount + uGrainSize - 1) / uGrainSize;
+
+		CGameThreadPool* pPool = CGameThreadPool::InstancePtr();
+		if (!pPool || !pPool->IsInitialized() || uMaxChunks <= 1)
+			return 1;
+
+		const size_t uThreads = static_cast<size_t>(pPool->GetWorkerCount()) + 1;
+		return std::min(uMaxChunks, uThreads * CHUNKS_PER_THREAD);
+	}
+
+	inline size_t GetChunkBegin(size_t uCount, size_t uChunks, size_t uChunk)
+	{
+		return uCount * uChunk / uChunks;
+	}
+}
+
+// func(TIndex begin, TIndex end) is called once per chunk
+template<typename TIndex, typename TFunc>
+void ParallelForRange(TIndex begin, TIndex end, size_t uGrainSize, TFunc&& func, CGameThreadPool::EPriority ePriority = CGameThreadPool::PRIORITY_HIGH)
+{
+	if (end <= begin)
+		return;
+
+	const size_t uCount = static_cast<size_t>(end - begin);
+	const size_t uChunks = ParallelDetail::GetChunkCount(uCount, uGrainSize);
+
+	if (uChunks == 1)
+	{
+		func(begin, end);
+		return;
+	}
+
+	CGameThreadPool& rPool = CGameThreadPool::Instance();
+	CGameTaskGroup group;
+
+	for (size_t uChunk = 1; uChunk < uChunks; ++uChunk)
+	{
+		const TIndex chunkBegin = begin + static_cast<TIndex>(ParallelDetail::GetChunkBegin(uCount, uChunks, uChunk));
+		const TIndex chunkEnd = begin + static_cast<TIndex>(ParallelDetail::GetChunkBegin(uCount, uChunks, uChunk + 1));
+		rPool.Submit([&func, chunkBegin, chunkEnd]() { func(chunkBegin, chunkEnd); }, ePriority, &group);
+	}
+
+	func(begin, begin + static_cast<TIndex>(ParallelDetail::GetChunkBegin(uCount, uChunks, 1)));
+	rPool.WaitAll(group);
+}
+
+// func(TIndex i) is called for every index of [begin, end)
+template<typename TIndex, typename TFunc>
+void ParallelFor(TIndex begin, TIndex end, size_t uGrainSize, TFunc&& func, CGameThreadPool::EPriority ePriority = CGameThreadPool::PRIORITY_HIGH)
+{
+	ParallelForRange(begin, end, uGrainSize, [&func](TIndex chunkBegin, TIndex chunkEnd)
+	{
+		for (TIndex i = chunkBegin; i != chunkEnd; ++i)
+			func(i);
+	}, ePriority);
+}
+
+// func(element) is called for every element of a random access range
+template<typename TIterator, typename TFunc>
+void ParallelForEach(TIterator first, TIterator last, size_t uGrainSize, TFunc&& func, CGameThreadPool::EPriority ePriority = CGameThreadPool::PRIORITY_HIGH)
+{
+	static_assert(std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<TIterator>::iterator_category>,
+		"ParallelForEach needs random access iterators, copy the elements into a vector first");
+
+	using TDiff = typename std::iterator_traits<TIterator>::difference_type;
+	ParallelForRange(TDiff(0), TDiff(last - first), uGrainSize, [&func, first](TDiff chunkBegin, TDiff chunkEnd)
+	{
+		for (TIterator it = first + chunkBegin; it != first + chunkEnd; ++it)
+			func(*it);
+	}, ePriority);
+}
+
+// Each chunk folds its items with map(TValue acc, TIndex begin, TIndex end) starting from identity,
+// then the partial results are combined in chunk order. The chunking only depends on the range,
+// the grain size and the worker count, so results are reproducible from frame to frame.
+template<typename TValue, typename TIndex, typename TMap, typename TCombine>
+TValue ParallelReduce(TIndex begin, TIndex end, size_t uGrainSize, const TValue& identity, TMap&& map, TCombine&& combine, CGameThreadPool::EPriority ePriority = CGameThreadPool::PRIORITY_HIGH)
+{
+	if (end <= begin)
+		return identity;
+
+	const size_t uCount = static_cast<size_t>(end - begin);
+	const size_t uChunks = ParallelDetail::GetChunkCount(uCount, uGrainSize);
+
+	if (uChunks == 1)
+		return map(identity, begin, end);
+
+	std::vector<TValue> partials(uChunks, identity);
+	ParallelFor(size_t(0), uChunks, 1, [&](size_t uChunk)
+	{
+		const TIndex chunkBegin = begin + static_cast<TIndex>(ParallelDetail::GetChunkBegin(uCount, uChunks, uChunk));
+		const TIndex chunkEnd = begin + static_cast<TIndex>(ParallelDetail::GetChunkBegin(uCount, uChunks, uChunk + 1));
+		partials[uChunk] = map(identity, chunkBegin, chunkEnd);
+	}, ePriority);
+
+	TValue result = std::move(partials[0]);
+	for (size_t uChunk = 1; uChunk < uChunks; ++uChunk)
+		result = combine(std::move(result), std::move(partials[uChunk]));
+
+	return result;
+}
@@ -2,6 +2,9 @@
 
 #include "EterBase/Debug.h"
 #include <mutex>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
 
 template<typename T>
 class CDynamicPool
@@ -102,3 +105,80 @@ class CDynamicPool
 		std::vector<T*> m_Chunks;
 		std::recursive_mutex m_mutex;
 };
+
+// Bump allocator for data that lives and dies together, e.g. everything parsed from one file.
+// Objects are never destroyed individually, so only trivially destructible types are allowed.
+class CLinearArena
+{
+	public:
+		explicit CLinearArena(size_t uBlockSize = 16 * 1024) : m_uBlockSize(uBlockSize), m_pCur(nullptr), m_pEnd(nullptr), m_uUsed(0)
+		{
+		}
+
+		CLinearArena(const CLinearArena&) = delete;
+		CLinearArena& operator=(const CLinearArena&) = delete;
+
+		void* Alloc(size_t uSize, size_t uAlign = alignof(std::max_align_t))
+		{
+			uintptr_t uCur = (reinterpret_cast<uintptr_t>(m_pCur) + (uAlign - 1)) & ~(uintptr_t)(uAlign - 1);
+			if (!m_pCur || uCur + uSize > reinterpret_cast<uintptr_t>(m_pEnd))
+			{
+				Grow(uSize + uAlign);
+				uCur = (reinterpret_cast<uintptr_t>(m_pCur) + (uAlign - 1)) & ~(uintptr_t)(uAlign - 1);
+			}
+
+			m_pCur = reinterpret_cast<char*>(uCur + uSize);
+			m_uUsed += uSize;
+			return reinterpret_cast<void*>(uCur);
+		}
+
+		template<typename T>
+		T* NewArray(size_t uCount)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "CLinearArena never runs destructors");
+
+			T* p = static_cast<T*>(Alloc(sizeof(T) * (uCount ? uCount : 1), alignof(T)));
+			for (size_t i = 0; i < uCount; ++i)
+				new (p + i) T();
+			return p;
+		}
+
+		template<typename T, typename... TArgs>
+		T* New(TArgs&&... args)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "CLinearArena never runs destructors");
+			return new (Alloc(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+		}
+
+		// Keeps the first block for reuse, frees the rest
+		void Reset()
+		{
+			if (m_blocks.size() > 1)
+				m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+
+			if (!m_blocks.empty())
+			{
+				m_pCur = m_blocks[0].first.get();
+				m_pEnd = m_pCur + m_blocks[0].second;
+			}
+
+			m_uUsed = 0;
+		}
+
+		size_t GetUsedSize() const { return m_uUsed; }
+
+	private:
+		void Grow(size_t uMinSize)
+		{
+			const size_t uSize = std::max(m_uBlockSize, uMinSize);
+			m_blocks.emplace_back(std::unique_ptr<char[]>(new char[uSize]), uSize);
+			m_pCur = m_blocks.back().first.get();
+			m_pEnd = m_pCur + uSize;
+		}
+
+		size_t m_uBlockSize;
+		std::vector<std::pair<std::unique_ptr<char[]>, size_t>> m_blocks;
+		char* m_pCur;
+		char* m_pEnd;
+		size_t m_uUsed;
+};
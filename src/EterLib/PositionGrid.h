@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Objects bucketed by 2D position on a uniform grid, each with a type bit for filtering.
+// Positions and types are taken in Refresh, so queries see them as of the last refresh
+// and callers that need exact answers test the candidates again.
+template<typename T>
+class CPositionGrid
+{
+	public:
+		enum
+		{
+			CELL_SIZE = 800,
+		};
+
+		enum
+		{
+			TYPE_MASK_ALL = 0xffffffff,
+		};
+
+		typedef std::vector<T*> TObjectVector;
+
+		static DWORD TypeMask(UINT eType) { return 1 << eType; }
+
+	public:
+		CPositionGrid() {}
+		~CPositionGrid() {}
+
+		void Clear();
+
+		// Inserts on first sight, moves the object to its current cell afterwards
+		void Refresh(T* pkObj, float fX, float fY, DWORD dwTypeMask);
+		void Remove(T* pkObj);
+
+		size_t GetCount() const;
+
+		// Results are appended in no particular order
+		void FindInRadius(float fX, float fY, float fRadius, DWORD dwTypeMask, TObjectVector* pkVct_pkObj) const;
+		void FindInRect(float fLeft, float fTop, float fRight, float fBottom, DWORD dwTypeMask, TObjectVector* pkVct_pkObj) const;
+
+		// Up to uCount objects within fMaxRadius, nearest first
+		void FindNearest(float fX, float fY, UINT uCount, float fMaxRadius, DWORD dwTypeMask, TObjectVector* pkVct_pkObj, bool (*pfnFilter)(T*) = NULL) const;
+
+	protected:
+		typedef struct SEntry
+		{
+			T*				pkObj;
+			float			fX;
+			float			fY;
+			DWORD			dwTypeMask;
+		} TEntry;
+
+		typedef std::vector<TEntry> TCell;
+
+		typedef struct SLocation
+		{
+			uint64_t		uCellKey;
+			UINT			uIndex;
+		} TLocation;
+
+		static int __GetCellCoord(float f);
+		static uint64_t __GetCellKey(int iX, int iY);
+
+		void __Insert(uint64_t uCellKey, const TEntry& c_rkEntry);
+		void __Erase(const TLocation& c_rkLocation);
+
+		// Looks the cells up one by one, or walks every occupied cell when that is fewer
+		template<typename TFunc>
+		void __ForEachCell(int iMinX, int iMinY, int iMaxX, int iMaxY, TFunc f) const;
+
+	protected:
+		std::unordered_map<uint64_t, TCell>		m_kMap_kCell;
+		std::unordered_map<T*, TLocation>		m_kMap_kLocation;
+};
+
+template<typename T>
+int CPositionGrid<T>::__GetCellCoord(float f)
+{
+	return int(floorf(f / float(CELL_SIZE)));
+}
+
+template<typename T>
+uint64_t CPositionGrid<T>::__GetCellKey(int iX, int iY)
+{
+	return (uint64_t(uint32_t(iX)) << 32) | uint64_t(uint32_t(iY));
+}
+
+template<typename T>
+void CPositionGrid<T>::Clear()
+{
+	m_kMap_kCell.clear();
+	m_kMap_kLocation.clear();
+}
+
+template<typename T>
+size_t CPositionGrid<T>::GetCount() const
+{
+	return m_kMap_kLocation.size();
+}
+
+template<typename T>
+void CPositionGrid<T>::__Insert(uint64_t uCellKey, const TEntry& c_rkEntry)
+{
+	TCell& rkCell = m_kMap_kCell[uCellKey];
+
+	TLocation& rkLocation = m_kMap_kLocation[c_rkEntry.pkObj];
+	rkLocation.uCellKey = uCellKey;
+	rkLocation.uIndex = UINT(rkCell.size());
+
+	rkCell.push_back(c_rkEntry);
+}
+
+template<typename T>
+void CPositionGrid<T>::__Erase(const TLocation& c_rkLocation)
+{
+	auto f = m_kMap_kCell.find(c_rkLocation.uCellKey);
+	if (m_kMap_kCell.end() == f)
+		return;
+
+	// The last entry takes the hole, so its location moves with it
+	TCell& rkCell = f->second;
+	if (c_rkLocation.uIndex + 1 != rkCell.size())
+	{
+		rkCell[c_rkLocation.uIndex] = rkCell.back();
+		m_kMap_kLocation[rkCell[c_rkLocation.uIndex].pkObj].uIndex = c_rkLocation.uIndex;
+	}
+	rkCell.pop_back();
+
+	if (rkCell.empty())
+		m_kMap_kCell.erase(f);
+}
+
+template<typename T>
+void CPositionGrid<T>::Refresh(T* pkObj, float fX, float fY, DWORD dwTypeMask)
+{
+	TEntry kEntry;
+	kEntry.pkObj = pkObj;
+	kEntry.fX = fX;
+	kEntry.fY = fY;
+	kEntry.dwTypeMask = dwTypeMask;
+
+	const uint64_t uCellKey = __GetCellKey(__GetCellCoord(fX), __GetCellCoord(fY));
+
+	auto f = m_kMap_kLocation.find(pkObj);
+	if (m_kMap_kLocation.end() == f)
+	{
+		__Insert(uCellKey, kEntry);
+		return;
+	}
+
+	const TLocation kLocation = f->second;
+	if (kLocation.uCellKey == uCellKey)
+	{
+		m_kMap_kCell[uCellKey][kLocation.uIndex] = kEntry;
+		return;
+	}
+
+	__Erase(kLocation);
+	__Insert(uCellKey, kEntry);
+}
+
+template<typename T>
+void CPositionGrid<T>::Remove(T* pkObj)
+{
+	auto f = m_kMap_kLocation.find(pkObj);
+	if (m_kMap_kLocation.end() == f)
+		return;
+
+	const TLocation kLocation = f->second;
+	m_kMap_kLocation.erase(f);
+
+	__Erase(kLocation);
+}
+
+template<typename T>
+template<typename TFunc>
+void CPositionGrid<T>::__ForEachCell(int iMinX, int iMinY, int iMaxX, int iMaxY, TFunc f) const
+{
+	const int64_t c_iCellCount = (int64_t(iMaxX) - iMinX + 1) * (int64_t(iMaxY) - iMinY + 1);
+
+	if (c_iCellCount > int64_t(m_kMap_kCell.size()))
+	{
+		for (auto i = m_kMap_kCell.begin(); i != m_kMap_kCell.end(); ++i)
+		{
+			const int iX = int(int32_t(i->first >> 32));
+			const int iY = int(int32_t(i->first));
+			if (iX < iMinX || iX > iMaxX || iY < iMinY || iY > iMaxY)
+				continue;
+
+			f(i->second);
+		}
+		return;
+	}
+
+	for (int iY = iMinY; iY <= iMaxY; ++iY)
+	{
+		for (int iX = iMinX; iX <= iMaxX; ++iX)
+		{
+			auto i = m_kMap_kCell.find(__GetCellKey(iX, iY));
+			if (m_kMap_kCell.end() != i)
+				f(i->second);
+		}
+	}
+}
+
+template<typename T>
+void CPositionGrid<T>::FindInRadius(float fX, float fY, float fRadius, DWORD dwTypeMask, TObjectVector* pkVct_pkObj) const
+{
+	const float c_fRadiusSq = fRadius * fRadius;
+
+	__ForEachCell(__GetCellCoord(fX - fRadius), __GetCellCoord(fY - fRadius), __GetCellCoord(fX + fRadius), __GetCellCoord(fY + fRadius),
+		[&](const TCell& c_rkCell)
+		{
+			for (const TEntry& c_rkEntry : c_rkCell)
+			{
+				if (!(c_rkEntry.dwTypeMask & dwTypeMask))
+					continue;
+
+				const float fdx = c_rkEntry.fX - fX;
+				const float fdy = c_rkEntry.fY - fY;
+				if (fdx * fdx + fdy * fdy <= c_fRadiusSq)
+					pkVct_pkObj->push_back(c_rkEntry.pkObj);
+			}
+		});
+}
+
+template<typename T>
+void CPositionGrid<T>::FindInRect(float fLeft, float fTop, float fRight, float fBottom, DWORD dwTypeMask, TObjectVector* pkVct_pkObj) const
+{
+	__ForEachCell(__GetCellCoord(fLeft), __GetCellCoord(fTop), __GetCellCoord(fRight), __GetCellCoord(fBottom),
+		[&](const TCell& c_rkCell)
+		{
+			for (const TEntry& c_rkEntry : c_rkCell)
+			{
+				if (!(c_rkEntry.dwTypeMask & dwTypeMask))
+					continue;
+
+				if (c_rkEntry.fX >= fLeft && c_rkEntry.fX <= fRight && c_rkEntry.fY >= fTop && c_rkEntry.fY <= fBottom)
+					pkVct_pkObj->push_back(c_rkEntry.pkObj);
+			}
+		});
+}
+
+template<typename T>
+void CPositionGrid<T>::FindNearest(float fX, float fY, UINT uCount, float fMaxRadius, DWORD dwTypeMask, TObjectVector* pkVct_pkObj, bool (*pfnFilter)(T*)) const
+{
+	if (0 == uCount || m_kMap_kCell.empty())
+		return;
+
+	typedef std::pair<float, T*> TCandidate;
+	std::vector<TCandidate> kVct_kCandidate;
+
+	const float c_fMaxRadiusSq = fMaxRadius * fMaxRadius;
+
+	auto AddCell = [&](const TCell& c_rkCell)
+	{
+		for (const TEntry& c_rkEntry : c_rkCell)
+		{
+			if (!(c_rkEntry.dwTypeMask & dwTypeMask))
+				continue;
+
+			const float fdx = c_rkEntry.fX - fX;
+			const float fdy = c_rkEntry.fY - fY;
+			const float fDistanceSq = fdx * fdx + fdy * fdy;
+			if (fDistanceSq > c_fMaxRadiusSq)
+				continue;
+
+			if (pfnFilter && !pfnFilter(c_rkEntry.pkObj))
+				continue;
+
+			kVct_kCandidate.push_back(TCandidate(fDistanceSq, c_rkEntry.pkObj));
+		}
+	};
+
+	const int c_iCenterX = __GetCellCoord(fX);
+	const int c_iCenterY = __GetCellCoord(fY);
+	const int c_iMaxRing = int(ceilf(fMaxRadius / float(CELL_SIZE)));
+
+	// A search wider than the occupied cells is one pass over all of them
+	if ((2 * int64_t(c_iMaxRing) + 1) * (2 * int64_t(c_iMaxRing) + 1) > int64_t(m_kMap_kCell.size()))
+	{
+		for (auto i = m_kMap_kCell.begin(); i != m_kMap_kCell.end(); ++i)
+			AddCell(i->second);
+	}
+	else
+	{
+		auto AddCellAt = [&](int iX, int iY)
+		{
+			auto i = m_kMap_kCell.find(__GetCellKey(iX, iY));
+			if (m_kMap_kCell.end() != i)
+				AddCell(i->second);
+		};
+
+		// Everything outside ring r is at least r cells away, so stop once enough are closer
+		for (int iRing = 0; iRing <= c_iMaxRing; ++iRing)
+		{
+			if (0 == iRing)
+			{
+				AddCellAt(c_iCenterX, c_iCenterY);
+			}
+			else
+			{
+				for (int iX = c_iCenterX - iRing; iX <= c_iCenterX + iRing; ++iX)
+				{
+					AddCellAt(iX, c_iCenterY - iRing);
+					AddCellAt(iX, c_iCenterY + iRing);
+				}
+				for (int iY = c_iCenterY - iRing + 1; iY <= c_iCenterY + iRing - 1; ++iY)
+				{
+					AddCellAt(c_iCenterX - iRing, iY);
+					AddCellAt(c_iCenterX + iRing, iY);
+				}
+			}
+
+			if (kVct_kCandidate.size() < uCount)
+				continue;
+
+			const float c_fReach = float(iRing) * float(CELL_SIZE);
+			const float c_fReachSq = c_fReach * c_fReach;
+
+			UINT uSettled = 0;
+			for (const TCandidate& c_rkCandidate : kVct_kCandidate)
+				if (c_rkCandidate.first <= c_fReachSq)
+					++uSettled;
+
+			if (uSettled >= uCount)
+				break;
+		}
+	}
+
+	const size_t c_uFound = std::min<size_t>(uCount, kVct_kCandidate.size());
+	std::partial_sort(kVct_kCandidate.begin(), kVct_kCandidate.begin() + c_uFound, kVct_kCandidate.end(),
+		[](const TCandidate& c_rkLeft, const TCandidate& c_rkRight) { return c_rkLeft.first < c_rkRight.first; });
+
+	for (size_t i = 0; i < c_uFound; ++i)
+		pkVct_pkObj->push_back(kVct_kCandidate[i].second);
+}
@@ -0,0 +1,243 @@
+#include "StdAfx.h"
+#include "Profiler.h"
+#include "GameThreadPool.h"
+
+#include "EterBase/Timer.h"
+
+thread_local CProfiler::TThreadBuffer * CProfiler::ms_pThreadBuffer = NULL;
+
+CProfiler::CProfiler() : m_isEnabled(false), m_uFrameCount(0), m_dwSpikeThreshold(0), m_uSpikeFrameCount(DEFAULT_DUMP_FRAME_COUNT), m_dwLastSpikeDumpTime(0)
+{
+	memset(m_allFrameTime, 0, sizeof(m_allFrameTime));
+}
+
+CProfiler::~CProfiler()
+{
+}
+
+void CProfiler::SetEnable(bool isEnable)
+{
+	m_isEnabled.store(isEnable, std::memory_order_relaxed);
+}
+
+void CProfiler::SetSpikeDump(DWORD dwThresholdMS, UINT uFrameCount)
+{
+	m_dwSpikeThreshold = dwThresholdMS;
+	m_uSpikeFrameCount = std::max(1u, std::min<UINT>(uFrameCount, FRAME_HISTORY_COUNT));
+}
+
+void CProfiler::Frame()
+{
+	if (!IsEnabled())
+		return;
+
+	const int64_t llNow = GetTime();
+
+	if (m_dwSpikeThreshold && m_uFrameCount)
+	{
+		const int64_t llLast = m_allFrameTime[(m_uFrameCount - 1) % FRAME_HISTORY_COUNT];
+		const int64_t llElapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration(llNow - llLast)).count();
+
+		if (llElapsedMS >= int64_t(m_dwSpikeThreshold) && ELTimer_GetMSec() - m_dwLastSpikeDumpTime >= SPIKE_DUMP_INTERVAL)
+		{
+			m_dwLastSpikeDumpTime = ELTimer_GetMSec();
+			std::string stFileName = Dump(NULL, m_uSpikeFrameCount);
+			Tracenf("CProfiler::Frame: %lld ms frame, trace written to %s", (long long) llElapsedMS, stFileName.c_str());
+		}
+	}
+
+	m_allFrameTime[m_uFrameCount % FRAME_HISTORY_COUNT] = llNow;
+	Record(EVENT_FRAME, "Frame", double(m_uFrameCount));
+	++m_uFrameCount;
+}
+
+const char * CProfiler::Intern(const char * c_szName)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_kSet_stName.insert(c_szName).first->c_str();
+}
+
+void CProfiler::SetThreadName(const char * c_szName)
+{
+	CProfiler * pProfiler = InstancePtr();
+	if (!pProfiler)
+		return;
+
+	TThreadBuffer * pBuffer = ms_pThreadBuffer ? ms_pThreadBuffer : pProfiler->__RegisterThread();
+
+	std::lock_guard<std::mutex> lock(pProfiler->m_mutex);
+	pBuffer->stName = c_szName;
+}
+
+CProfiler::TThreadBuffer * CProfiler::__RegisterThread()
+{
+	std::unique_ptr<TThreadBuffer> pBuffer = std::make_unique<TThreadBuffer>();
+	pBuffer->dwThreadID = GetCurrentThreadId();
+	pBuffer->uHead.store(0, std::memory_order_relaxed);
+	pBuffer->pEvents = std::make_unique<TEvent[]>(THREAD_EVENT_COUNT);
+
+	ms_pThreadBuffer = pBuffer.get();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_kVct_pThreadBuffer.push_back(std::move(pBuffer));
+	return ms_pThreadBuffer;
+}
+
+void CProfiler::__CopyEvents(int64_t llSince, std::vector<TThreadEvents>* pkVct_kThreadEvents)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (const std::unique_ptr<TThreadBuffer>& c_rpBuffer : m_kVct_pThreadBuffer)
+	{
+		TThreadEvents kThreadEvents;
+		kThreadEvents.dwThreadID = c_rpBuffer->dwThreadID;
+		kThreadEvents.stName = c_rpBuffer->stName;
+
+		const uint64_t uHead = c_rpBuffer->uHead.load(std::memory_order_acquire);
+		const uint64_t uFirst = uHead > THREAD_EVENT_COUNT ? uHead - THREAD_EVENT_COUNT : 0;
+
+		std::vector<TEvent>& rkVct_kEvent = kThreadEvents.kVct_kEvent;
+		rkVct_kEvent.reserve(size_t(uHead - uFirst));
+		for (uint64_t i = uFirst; i < uHead; ++i)
+			rkVct_kEvent.push_back(c_rpBuffer->pEvents[i & (THREAD_EVENT_COUNT - 1)]);
+
+		// The owner kept writing meanwhile, the slots it reached no longer hold what was copied
+		const uint64_t uHeadAfter = c_rpBuffer->uHead.load(std::memory_order_acquire);
+		const uint64_t uValidFirst = uHeadAfter + 1 > THREAD_EVENT_COUNT ? uHeadAfter + 1 - THREAD_EVENT_COUNT : 0;
+
+		size_t uDrop = uValidFirst > uFirst ? size_t(std::min(uValidFirst, uHead) - uFirst) : 0;
+		while (uDrop < rkVct_kEvent.size() && rkVct_kEvent[uDrop].llTime < llSince)
+			++uDrop;
+
+		rkVct_kEvent.erase(rkVct_kEvent.begin(), rkVct_kEvent.begin() + uDrop);
+
+		if (!rkVct_kEvent.empty())
+			pkVct_kThreadEvents->push_back(std::move(kThreadEvents));
+	}
+}
+
+std::string CProfiler::Dump(const char * c_szFileName, UINT uFrameCount)
+{
+	std::string stFileName;
+	if (c_szFileName && *c_szFileName)
+	{
+		stFileName = c_szFileName;
+	}
+	else
+	{
+		time_t ct = time(0);
+		struct tm ctm = *localtime(&ct);
+
+		char szFileName[64];
+		snprintf(szFileName, sizeof(szFileName), "profile_%04d%02d%02d_%02d%02d%02d.json",
+			ctm.tm_year + 1900, ctm.tm_mon + 1, ctm.tm_mday, ctm.tm_hour, ctm.tm_min, ctm.tm_sec);
+		stFileName = szFileName;
+	}
+
+	// From the start of the oldest requested frame still in the history
+	int64_t llSince = 0;
+	const uint64_t c_uFrames = std::min<uint64_t>(std::min<uint64_t>(uFrameCount, FRAME_HISTORY_COUNT), m_uFrameCount);
+	if (c_uFrames)
+		llSince = m_allFrameTime[(m_uFrameCount - c_uFrames) % FRAME_HISTORY_COUNT];
+
+	std::vector<TThreadEvents> kVct_kThreadEvents;
+	__CopyEvents(llSince, &kVct_kThreadEvents);
+
+	int64_t llOrigin = INT64_MAX;
+	for (const TThreadEvents& c_rkThreadEvents : kVct_kThreadEvents)
+		llOrigin = std::min(llOrigin, c_rkThreadEvents.kVct_kEvent.front().llTime);
+
+	CGameThreadPool::Instance().Submit([stFileName, kVct_kThreadEvents = std::move(kVct_kThreadEvents), llOrigin]()
+	{
+		if (!__WriteTrace(stFileName, kVct_kThreadEvents, llOrigin))
+			TraceError("CProfiler::Dump: cannot write %s", stFileName.c_str());
+	}, CGameThreadPool::PRIORITY_LOW);
+
+	return stFileName;
+}
+
+static void WriteJsonString(FILE * fp, const char * c_szText)
+{
+	fputc('"', fp);
+	for (const unsigned char * p = (const unsigned char *) c_szText; *p; ++p)
+	{
+		if (*p == '"' || *p == '\\')
+			fprintf(fp, "\\%c", *p);
+		else if (*p < 0x20)
+			fprintf(fp, "\\u%04x", *p);
+		else
+			fputc(*p, fp);
+	}
+	fputc('"', fp);
+}
+
+bool CProfiler::__WriteTrace(const std::string& c_rstFileName, const std::vector<TThreadEvents>& c_rkVct_kThreadEvents, int64_t llOrigin)
+{
+	FILE * fp = fopen(c_rstFileName.c_str(), "w");
+	if (!fp)
+		return false;
+
+	typedef std::chrono::steady_clock::period TPeriod;
+	const double c_dToMicroSecond = 1000000.0 * double(TPeriod::num) / double(TPeriod::den);
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fp);
+
+	bool isFirst = true;
+	for (const TThreadEvents& c_rkThreadEvents : c_rkVct_kThreadEvents)
+	{
+		const DWORD dwTID = c_rkThreadEvents.dwThreadID;
+
+		if (!isFirst)
+			fputs(",\n", fp);
+		isFirst = false;
+
+		fprintf(fp, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":", (unsigned long) dwTID);
+		if (c_rkThreadEvents.stName.empty())
+			fprintf(fp, "\"Thread %lu\"", (unsigned long) dwTID);
+		else
+			WriteJsonString(fp, c_rkThreadEvents.stName.c_str());
+		fputs("}}", fp);
+
+		// An end whose begin fell out of the window would close a zone it never opened
+		UINT uDepth = 0;
+
+		for (const TEvent& c_rkEvent : c_rkThreadEvents.kVct_kEvent)
+		{
+			const double dTime = double(c_rkEvent.llTime - llOrigin) * c_dToMicroSecond;
+
+			switch (c_rkEvent.uType)
+			{
+				case EVENT_BEGIN:
+					++uDepth;
+					fprintf(fp, ",\n{\"ph\":\"B\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"name\":", (unsigned long) dwTID, dTime);
+					WriteJsonString(fp, c_rkEvent.c_szName);
+					fputc('}', fp);
+					break;
+
+				case EVENT_END:
+					if (!uDepth)
+						break;
+
+					--uDepth;
+					fprintf(fp, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f}", (unsigned long) dwTID, dTime);
+					break;
+
+				case EVENT_COUNTER:
+					fprintf(fp, ",\n{\"ph\":\"C\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"name\":", (unsigned long) dwTID, dTime);
+					WriteJsonString(fp, c_rkEvent.c_szName);
+					fprintf(fp, ",\"args\":{\"value\":%g}}", c_rkEvent.dValue);
+					break;
+
+				case EVENT_FRAME:
+					fprintf(fp, ",\n{\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"name\":", (unsigned long) dwTID, dTime);
+					WriteJsonString(fp, c_rkEvent.c_szName);
+					fprintf(fp, ",\"args\":{\"frame\":%.0f}}", c_rkEvent.dValue);
+					break;
+			}
+		}
+	}
+
+	fputs("\n]}\n", fp);
+	fclose(fp);
+	return true;
+}
@@ -1 +1,143 @@
 #pragma once
+
+#include "EterBase/Singleton.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Scoped zones, counters and frame markers, recorded into a ring per thread. Only the
+// owning thread writes its ring, so recording takes no lock. A dump copies the rings and
+// drops what was overwritten while copying. Names are kept by pointer, so they must be
+// string literals or come from Intern.
+class CProfiler : public CSingleton<CProfiler>
+{
+	public:
+		enum EEventType
+		{
+			EVENT_BEGIN,
+			EVENT_END,
+			EVENT_COUNTER,
+			EVENT_FRAME,
+		};
+
+		enum
+		{
+			THREAD_EVENT_COUNT = 64 * 1024,		// per thread, a power of two
+			FRAME_HISTORY_COUNT = 1024,
+			DEFAULT_DUMP_FRAME_COUNT = 300,
+			SPIKE_DUMP_INTERVAL = 10000,		// ms between two spike dumps
+		};
+
+		typedef struct SEvent
+		{
+			int64_t			llTime;
+			const char *	c_szName;
+			double			dValue;
+			UINT			uType;
+		} TEvent;
+
+	public:
+		CProfiler();
+		virtual ~CProfiler();
+
+		void			SetEnable(bool isEnable);
+		bool			IsEnabled() const { return m_isEnabled.load(std::memory_order_relaxed); }
+
+		// Frames over dwThresholdMS dump the uFrameCount frames before them, 0 turns it off
+		void			SetSpikeDump(DWORD dwThresholdMS, UINT uFrameCount);
+
+		// Main thread, once at the start of every frame
+		void			Frame();
+
+		// Writes the last uFrameCount frames as Chrome trace JSON, a timestamped name if
+		// c_szFileName is NULL. The file is written on the thread pool.
+		std::string		Dump(const char * c_szFileName = NULL, UINT uFrameCount = DEFAULT_DUMP_FRAME_COUNT);
+
+		// For names that are not string literals, the same text always gives the same pointer
+		const char *	Intern(const char * c_szName);
+
+		static void		SetThreadName(const char * c_szName);
+
+		static void		Begin(const char * c_szName) { Record(EVENT_BEGIN, c_szName, 0.0); }
+		static void		End(const char * c_szName) { Record(EVENT_END, c_szName, 0.0); }
+		static void		Counter(const char * c_szName, double dValue) { Record(EVENT_COUNTER, c_szName, dValue); }
+
+		static int64_t	GetTime() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+		static void		Record(UINT uType, const char * c_szName, double dValue)
+		{
+			CProfiler * pProfiler = InstancePtr();
+			if (!pProfiler || !pProfiler->IsEnabled())
+				return;
+
+			TThreadBuffer * pBuffer = ms_pThreadBuffer ? ms_pThreadBuffer : pProfiler->__RegisterThread();
+
+			const uint64_t uHead = pBuffer->uHead.load(std::memory_order_relaxed);
+			TEvent& rkEvent = pBuffer->pEvents[uHead & (THREAD_EVENT_COUNT - 1)];
+			rkEvent.llTime = GetTime();
+			rkEvent.c_szName = c_szName;
+			rkEvent.dValue = dValue;
+			rkEvent.uType = uType;
+			pBuffer->uHead.store(uHead + 1, std::memory_order_release);
+		}
+
+	protected:
+		typedef struct SThreadBuffer
+		{
+			DWORD						dwThreadID;
+			std::string					stName;
+			std::atomic<uint64_t>		uHead;
+			std::unique_ptr<TEvent[]>	pEvents;
+		} TThreadBuffer;
+
+		typedef struct SThreadEvents
+		{
+			DWORD						dwThreadID;
+			std::string					stName;
+			std::vector<TEvent>			kVct_kEvent;
+		} TThreadEvents;
+
+		TThreadBuffer *	__RegisterThread();
+		void			__CopyEvents(int64_t llSince, std::vector<TThreadEvents>* pkVct_kThreadEvents);
+
+		static bool		__WriteTrace(const std::string& c_rstFileName, const std::vector<TThreadEvents>& c_rkVct_kThreadEvents, int64_t llOrigin);
+
+	protected:
+		std::atomic<bool>							m_isEnabled;
+
+		std::mutex									m_mutex;
+		std::vector<std::unique_ptr<TThreadBuffer> >	m_kVct_pThreadBuffer;
+		std::unordered_set<std::string>				m_kSet_stName;
+
+		// Main thread only
+		int64_t										m_allFrameTime[FRAME_HISTORY_COUNT];
+		uint64_t									m_uFrameCount;
+		DWORD										m_dwSpikeThreshold;
+		UINT										m_uSpikeFrameCount;
+		DWORD										m_dwLastSpikeDumpTime;
+
+		static thread_local TThreadBuffer *			ms_pThreadBuffer;
+};
+
+class CProfileZone
+{
+	public:
+		CProfileZone(const char * c_szName) : m_c_szName(c_szName) { CProfiler::Begin(c_szName); }
+		~CProfileZone() { CProfiler::End(m_c_szName); }
+
+	protected:
+		const char * m_c_szName;
+};
+
+#define PROFILE_CONCAT_INNER(a, b)		a##b
+#define PROFILE_CONCAT(a, b)			PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name)				CProfileZone PROFILE_CONCAT(kProfileZone, __LINE__)(name)
+#define PROFILE_FUNCTION()				PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_COUNTER(name, value)	CProfiler::Counter(name, double(value))
@@ -9,7 +9,7 @@
 
 bool CResource::ms_bDeleteImmediately = false;
 
-CResource::CResource(const char* c_szFileName) : me_state(STATE_EMPTY)
+CResource::CResource(const char* c_szFileName) : me_state(STATE_EMPTY), m_uFileSize(0), m_uResidentSize(0), m_byResidencyType(0), m_isResident(false)
 {
 	SetFileName(c_szFileName);
 }
@@ -44,18 +44,20 @@ void CResource::Load()
 	const char * c_szFileName = GetFileName();
 
 	DWORD		dwStart = ELTimer_GetMSec();
-	TPackFile	file;
+	CPackFileView	file;
 
 	//Tracenf("Load %s", c_szFileName);
 
-	if (CPackManager::Instance().GetFile(c_szFileName, file))
+	if (CPackManager::Instance().GetFileView(c_szFileName, file))
 	{
 		m_dwLoadCostMiliiSecond = ELTimer_GetMSec() - dwStart;
+		m_uFileSize = file.size();
 		//Tracef("CResource::Load %s (%d bytes) in %d ms\n", c_szFileName, file.Size(), m_dwLoadCostMiliiSecond);
 
 		if (OnLoad(file.size(), file.data()))
 		{
 			me_state = STATE_EXIST;
+			CResourceManager::Instance().OnResourceLoad(this);
 		}
 		else
 		{
@@ -66,8 +68,13 @@ void CResource::Load()
 	}
 	else
 	{
+		m_uFileSize = 0;
+
 		if (OnLoad(0, NULL))
+		{
 			me_state = STATE_EXIST;
+			CResourceManager::Instance().OnResourceLoad(this);
+		}
 		else
 		{
 			Tracef("CResource::Load file not exist %s\n", c_szFileName);
@@ -81,12 +88,15 @@ void CResource::Reload()
 	Clear();
 	Tracef("CResource::Reload %s\n", GetFileName());
 
-	TPackFile	file;
-	if (CPackManager::Instance().GetFile(GetFileName(), file))
+	CPackFileView	file;
+	if (CPackManager::Instance().GetFileView(GetFileName(), file))
 	{
+		m_uFileSize = file.size();
+
 		if (OnLoad(file.size(), file.data()))
 		{
 			me_state = STATE_EXIST;
+			CResourceManager::Instance().OnResourceLoad(this);
 		}
 		else
 		{
@@ -96,8 +106,13 @@ void CResource::Reload()
 	}
 	else
 	{
+		m_uFileSize = 0;
+
 		if (OnLoad(0, NULL))
+		{
 			me_state = STATE_EXIST;
+			CResourceManager::Instance().OnResourceLoad(this);
+		}
 		else
 		{
 			me_state = STATE_ERROR;
@@ -138,6 +153,14 @@ void CResource::Clear()
 {
 	OnClear();
 	me_state = STATE_EMPTY;
+
+	if (m_isResident)
+		CResourceManager::Instance().OnResourceClear(this);
+}
+
+size_t CResource::GetMemorySize() const
+{
+	return m_uFileSize;
 }
 
 bool CResource::IsType(TType type)
@@ -169,6 +192,16 @@ bool CResource::IsEmpty() const
 	return OnIsEmpty();
 }
 
+CResource::TDecodedDataPtr CResource::DecodeOnWorker(int iSize, const void * c_pvBuf)
+{
+	return NULL;
+}
+
+bool CResource::FinalizeOnMain(SDecodedData & rData)
+{
+	return false;
+}
+
 bool CResource::CreateDeviceObjects()
 {
 	return true;
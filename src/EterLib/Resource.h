@@ -2,9 +2,12 @@
 
 #include "ReferenceObject.h"
 #include <string>
+#include <memory>
 
 class CResource : public CReferenceObject
 {
+	friend class CResourceManager;
+
 	public:
 		typedef DWORD TType;
 
@@ -17,6 +20,13 @@ class CResource : public CReferenceObject
 			STATE_FREE
 		};
 
+		// What DecodeOnWorker hands over to FinalizeOnMain
+		struct SDecodedData
+		{
+			virtual ~SDecodedData() {}
+		};
+		typedef std::unique_ptr<SDecodedData> TDecodedDataPtr;
+
 	public:
 		void			Clear();
 
@@ -46,8 +56,17 @@ class CResource : public CReferenceObject
 		const char *	GetFileName() const			{ return m_stFileName.c_str();				}
 		const std::string& GetFileNameString() const { return m_stFileName;	}
 
+		// Bytes the loaded data keeps in memory, the size of its source file unless overridden
+		virtual size_t	GetMemorySize() const;
+
 		virtual bool	OnLoad(int iSize, const void * c_pvBuf) = 0;
 
+		// Background loading in two steps. DecodeOnWorker runs on a pool thread and may only parse
+		// the bytes, without touching the device or other resources. FinalizeOnMain then creates the
+		// device objects on the main thread. Returning NULL loads through OnLoad on the main thread.
+		virtual TDecodedDataPtr	DecodeOnWorker(int iSize, const void * c_pvBuf);
+		virtual bool	FinalizeOnMain(SDecodedData & rData);
+
 	protected:
 		void			SetFileName(const char* c_szFileName);
 
@@ -64,6 +83,12 @@ class CResource : public CReferenceObject
 		DWORD			m_dwLoadCostMiliiSecond;
 		EState			me_state;
 
+		// Residency, accounted by CResourceManager while the data is loaded
+		size_t			m_uFileSize;
+		size_t			m_uResidentSize;
+		BYTE			m_byResidencyType;
+		bool			m_isResident;
+
 	protected:
 		static bool		ms_bDeleteImmediately;
 };
@@ -1,20 +1,18 @@
 #include "StdAfx.h"
 #include <io.h>
-#include "EterBase/CRC32.h"
 #include "EterBase/Timer.h"
 #include "EterBase/Stl.h"
 #include "PackLib/PackManager.h"
 
 #include "ResourceManager.h"
 #include "GrpImage.h"
-#include "TextureCache.h"
 #include "DecodedImageData.h"
 
 int g_iLoadingDelayTime = 1;  // Reduced from 20ms to 1ms for faster async loading
 
-const long c_Deleting_Wait_Time = 30000;			// 삭제 대기 시간 (30초)
-const long c_DeletingCountPerFrame = 30;			// 프레임당 체크 리소스 갯수
-const long c_Reference_Decrease_Wait_Time = 30000;	// 선로딩 리소스의 해제 대기 시간 (30초)
+const long c_DeletingCountPerFrame = 30;			// 프레임당 해제할 최대 리소스 갯수
+const DWORD c_Eviction_Min_Idle_Time = 1000;		// released resources are kept at least this long (ms), a quick re-request should not reload
+const DWORD c_Default_Finalize_Budget = 4000;		// main thread time per frame for finalizing background loads (us)
 
 CFileLoaderThread CResourceManager::ms_loadingThread;
 
@@ -42,13 +40,13 @@ void CResourceManager::LoadStaticCache(const char* c_szFileName)
 		return;
 	}
 
-	DWORD dwCacheKey=GetCRC32(c_szFileName, strlen(c_szFileName));
-	TResourcePointerMap::iterator f=m_pCacheMap.find(dwCacheKey);
+	uint64_t uCacheKey=HashPath(c_szFileName);
+	TResourcePointerMap::iterator f=m_pCacheMap.find(uCacheKey);
 	if (m_pCacheMap.end()!=f)
 		return;
 
 	pkRes->AddReference();
-	m_pCacheMap.insert(TResourcePointerMap::value_type(dwCacheKey, pkRes));	
+	m_pCacheMap.insert(TResourcePointerMap::value_type(uCacheKey, pkRes));	
 
 }
 
@@ -58,73 +56,111 @@ void CResourceManager::ProcessBackgroundLoading()
 
 	while (itor != m_RequestMap.end())
 	{
-		DWORD dwFileCRC = itor->first;
-		std::string & stFileName = itor->second;
+		uint64_t uFileKey = itor->first;
+		const char * c_szFileName = itor->second;
 
-		if (isResourcePointerData(dwFileCRC) ||
-			(m_WaitingMap.end() != m_WaitingMap.find(dwFileCRC)))
+		if (isResourcePointerData(uFileKey) ||
+			(m_WaitingMap.end() != m_WaitingMap.find(uFileKey)))
 		{
-			//printf("SKP %s\n", stFileName.c_str());
+			//printf("SKP %s\n", c_szFileName);
 			itor = m_RequestMap.erase(itor);
 			continue;
 		}
 
-		//printf("REQ %s\n", stFileName.c_str());
+		//printf("REQ %s\n", c_szFileName);
 
-		ms_loadingThread.Request(stFileName);
+		// The resource object is created right away so its bytes can be decoded on the worker
+		CResource * pResource = GetResourcePointer(c_szFileName);
+		ms_loadingThread.Request(c_szFileName, pResource && pResource->IsEmpty() ? pResource : NULL);
 
-		m_WaitingMap.insert(TResourceRequestMap::value_type(dwFileCRC, stFileName));
+		m_WaitingMap.insert(TResourceRequestMap::value_type(uFileKey, c_szFileName));
 		itor = m_RequestMap.erase(itor);
 		//break; // NOTE: 여기서 break 하면 천천히 로딩 된다.
 	}
 
-	DWORD dwCurrentTime = ELTimer_GetMSec();
+	const auto c_tStart = std::chrono::steady_clock::now();
+	const auto c_tBudgetEnd = c_tStart + std::chrono::microseconds(m_dwFinalizeBudgetMicroSec);
 
-	// Process thread results
+	// Process thread results, the rest waits for the next frame once the budget is spent
 	CFileLoaderThread::TData * pData;
 	while (ms_loadingThread.Fetch(&pData))
 	{
 		//printf("LOD %s\n", pData->stFileName.c_str());
-		CResource * pResource = GetResourcePointer(pData->stFileName.c_str());
+		CResource * pResource = pData->pResource ? pData->pResource : GetResourcePointer(pData->stFileName.c_str());
 
 		if (pResource)
 		{
 			if (pResource->IsEmpty())
-			{				
-				pResource->OnLoad(pData->File.size(), pData->File.data());
-				pResource->AddReferenceOnly();
-
-				// 여기서 올라간 레퍼런스 카운트를 일정 시간이 지난 뒤에 풀어주기 위하여
-				m_pResRefDecreaseWaitingMap.insert(TResourceRefDecreaseWaitingMap::value_type(dwCurrentTime, pResource));
+			{
+				bool isLoaded;
+				if (pData->pDecoded)
+					isLoaded = pResource->FinalizeOnMain(*pData->pDecoded);
+				else
+					isLoaded = pResource->OnLoad(pData->File.size(), pData->File.data());
+
+				// On failure it stays empty and loads the usual way once referenced
+				if (isLoaded)
+				{
+					pResource->m_uFileSize = pData->uFileSize;
+					pResource->me_state = CResource::STATE_EXIST;
+					OnResourceLoad(pResource);
+
+					// Nobody holds it yet, it waits on the eviction list like any released resource
+					if (pResource->canDestroy())
+						ReserveDeletingResource(pResource);
+				}
 			}
 		}
 
-		m_WaitingMap.erase(GetCRC32(pData->stFileName.c_str(), pData->stFileName.size()));
+		m_WaitingMap.erase(HashPath(pData->stFileName));
+
+		const auto c_tNow = std::chrono::steady_clock::now();
+		const uint64_t c_uLatency = std::chrono::duration_cast<std::chrono::microseconds>(c_tNow - pData->tRequest).count();
+
+		++m_uFinalizedCount;
+		m_uLatencyMicroSec += c_uLatency;
+		m_uMaxLatencyMicroSec = std::max(m_uMaxLatencyMicroSec, c_uLatency);
 
 		delete pData;
-	}
 
-	// DO : 일정 시간이 지나고 난뒤 미리 로딩해 두었던 리소스의 레퍼런스 카운트를 감소 시킨다 - [levites]
-	long lCurrentTime = ELTimer_GetMSec();
+		if (c_tNow >= c_tBudgetEnd)
+			break;
+	}
 
-	TResourceRefDecreaseWaitingMap::iterator itorRef = m_pResRefDecreaseWaitingMap.begin();
+	m_uFinalizeMicroSec += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c_tStart).count();
+}
 
-	while (itorRef != m_pResRefDecreaseWaitingMap.end())
+void CResourceManager::GetBackgroundLoadingStats(TBackgroundLoadingStats * pStats, bool bReset)
+{
+	pStats->uRequested = m_RequestMap.size();
+	pStats->uReady = ms_loadingThread.GetCompleteCount();
+	pStats->uInFlight = m_WaitingMap.size() > pStats->uReady ? m_WaitingMap.size() - pStats->uReady : 0;
+	pStats->uFinalized = m_uFinalizedCount;
+	pStats->uLatencyMicroSec = m_uLatencyMicroSec;
+	pStats->uMaxLatencyMicroSec = m_uMaxLatencyMicroSec;
+	pStats->uFinalizeMicroSec = m_uFinalizeMicroSec;
+
+	if (bReset)
 	{
-		const long & rCreatingTime = itorRef->first;
+		m_uFinalizedCount = 0;
+		m_uLatencyMicroSec = 0;
+		m_uMaxLatencyMicroSec = 0;
+		m_uFinalizeMicroSec = 0;
+	}
+}
 
-		if (lCurrentTime - rCreatingTime > c_Reference_Decrease_Wait_Time)
-		{
-			CResource * pResource = itorRef->second;
+void CResourceManager::TraceBackgroundLoadingStats(const char * c_szWhen)
+{
+	TBackgroundLoadingStats kStats;
+	GetBackgroundLoadingStats(&kStats, true);
 
-			// Decrease Reference Count
-			pResource->Release();
-			itorRef = m_pResRefDecreaseWaitingMap.erase(itorRef);
-			//Tracef("Decrease Pre Loading Resource\n", rCreatingTime);
-		}
-		else
-			++itorRef;
-	}
+	if (!kStats.uFinalized)
+		return;
+
+	Tracef("%s - background loading: %u finalized in %llu us, latency avg %llu us max %llu us, %u queued %u in flight %u ready\n", c_szWhen,
+		kStats.uFinalized, (unsigned long long)kStats.uFinalizeMicroSec,
+		(unsigned long long)(kStats.uLatencyMicroSec / kStats.uFinalized), (unsigned long long)kStats.uMaxLatencyMicroSec,
+		(unsigned)kStats.uRequested, (unsigned)kStats.uInFlight, (unsigned)kStats.uReady);
 }
 
 void CResourceManager::PushBackgroundLoadingSet(std::set<std::string> & LoadingSet)
@@ -133,15 +169,15 @@ void CResourceManager::PushBackgroundLoadingSet(std::set<std::string> & LoadingS
 
 	while (itor != LoadingSet.end())
 	{
-		DWORD dwFileCRC = __GetFileCRC(itor->c_str());
+		uint64_t uFileKey = __GetFileKey(itor->c_str());
 
-		if (NULL != isResourcePointerData(dwFileCRC))
+		if (isResourcePointerData(uFileKey))
 		{
 			++itor;
 			continue;
 		}
 
-		m_RequestMap.insert(TResourceRequestMap::value_type(dwFileCRC, itor->c_str()));
+		m_RequestMap.insert(TResourceRequestMap::value_type(uFileKey, m_kPathTable.Intern(*itor, uFileKey)));
 		++itor;
 	}
 }
@@ -161,10 +197,18 @@ void CResourceManager::__DestroyCacheMap()
 void CResourceManager::__DestroyDeletingResourceMap()
 {
 	Tracenf("CResourceManager::__DestroyDeletingResourceMap %d", m_ResourceDeletingMap.size());
-	for (TResourceDeletingMap::iterator i = m_ResourceDeletingMap.begin(); i != m_ResourceDeletingMap.end(); ++i)
-		(i->first)->Clear();
 
-	m_ResourceDeletingMap.clear();
+	TResourceDeletingMap kMap_kDeleting;
+	kMap_kDeleting.swap(m_ResourceDeletingMap);
+
+	for (TResidencyType & rkType : m_kDeq_kResidencyType)
+		rkType.kList_kEvictable.clear();
+
+	for (TResourceDeletingMap::iterator i = kMap_kDeleting.begin(); i != kMap_kDeleting.end(); ++i)
+	{
+		if ((i->first)->canDestroy())
+			(i->first)->Clear();
+	}
 }
 
 void CResourceManager::__DestroyResourceMap()
@@ -191,13 +235,19 @@ void CResourceManager::DestroyDeletingList()
 
 void CResourceManager::Destroy()
 {	
+	// Requests in flight still point at the resources deleted here
+	ms_loadingThread.Shutdown();
+
 	assert(m_ResourceDeletingMap.empty() && "CResourceManager::Destroy - YOU MUST CALL DestroyDeletingList");
 	__DestroyResourceMap();
 }
 
-void CResourceManager::RegisterResourceNewFunctionPointer(const char* c_szFileExt, CResource* (*pNewFunc)(const char* c_szFileName))
+void CResourceManager::RegisterResourceNewFunctionPointer(const char* c_szFileExt, CResource* (*pNewFunc)(const char* c_szFileName), const char * c_szResidencyType)
 {
 	m_pResNewFuncMap[c_szFileExt] = pNewFunc;
+
+	if (c_szResidencyType)
+		m_kMap_stExt_byResidencyType[c_szFileExt] = __GetResidencyType(c_szResidencyType);
 }
 
 void CResourceManager::RegisterResourceNewFunctionByTypePointer(int iType, CResource* (*pNewFunc) (const char* c_szFileName))
@@ -206,12 +256,12 @@ void CResourceManager::RegisterResourceNewFunctionByTypePointer(int iType, CReso
 	m_pResNewFuncByTypeMap[iType] = pNewFunc;
 }
 
-CResource * CResourceManager::InsertResourcePointer(DWORD dwFileCRC, CResource* pResource)
+CResource * CResourceManager::InsertResourcePointer(uint64_t uFileKey, CResource* pResource)
 {
 	// Thread-safe check and insert
 	std::lock_guard<std::mutex> lock(m_ResourceMapMutex);
 
-	TResourcePointerMap::iterator itor = m_pResMap.find(dwFileCRC);
+	TResourcePointerMap::iterator itor = m_pResMap.find(uFileKey);
 
 	if (m_pResMap.end() != itor)
 	{		
@@ -221,7 +271,7 @@ CResource * CResourceManager::InsertResourcePointer(DWORD dwFileCRC, CResource*
 		return itor->second;
 	}
 
-	m_pResMap.insert(TResourcePointerMap::value_type(dwFileCRC, pResource));
+	m_pResMap.insert(TResourcePointerMap::value_type(uFileKey, pResource));
 	return pResource;
 }
 
@@ -251,12 +301,16 @@ CResource * CResourceManager::GetTypeResourcePointer(const char * c_szFileName,
 		return NULL;
 	}
 
-	const char * c_pszFile;
-	DWORD dwFileCRC = __GetFileCRC(c_szFileName, &c_pszFile);
-	CResource * pResource = FindResourcePointer(dwFileCRC);
+	uint64_t uFileKey = __GetFileKey(c_szFileName);
+	CResource * pResource = FindResourcePointer(uFileKey);
 
 	if (pResource)	// 이미 리소스가 있으면 리턴 한다.
+	{
+		__CountLookup(pResource);
 		return pResource;
+	}
+
+	const char * c_pszFile = m_kPathTable.Intern(c_szFileName, uFileKey);
 
 	CResource *	(*newFunc) (const char *) = NULL;
 
@@ -273,10 +327,10 @@ CResource * CResourceManager::GetTypeResourcePointer(const char * c_szFileName,
 
 		if (pcFileExt)
 		{
-			static char s_szFileExt[8 + 1];
-			strncpy(s_szFileExt, pcFileExt + 1, 8);
+			char szFileExt[8 + 1] = {};
+			strncpy(szFileExt, pcFileExt + 1, 8);
 
-			TResourceNewFunctionPointerMap::iterator f = m_pResNewFuncMap.find(s_szFileExt);
+			TResourceNewFunctionPointerMap::iterator f = m_pResNewFuncMap.find(szFileExt);
 
 			if (m_pResNewFuncMap.end() != f)
 				newFunc = f->second;
@@ -289,7 +343,9 @@ CResource * CResourceManager::GetTypeResourcePointer(const char * c_szFileName,
 		return NULL;
 	}
 
-	pResource = InsertResourcePointer(dwFileCRC, newFunc(c_pszFile));
+	pResource = InsertResourcePointer(uFileKey, newFunc(c_pszFile));
+	__SetResidencyType(pResource);
+	__CountLookup(pResource);
 	return pResource;
 }
 
@@ -301,12 +357,16 @@ CResource * CResourceManager::GetResourcePointer(const char * c_szFileName)
 		return NULL;
 	}
 
-	const char * c_pszFile;
-	DWORD dwFileCRC = __GetFileCRC(c_szFileName, &c_pszFile);
-	CResource * pResource = FindResourcePointer(dwFileCRC);
+	uint64_t uFileKey = __GetFileKey(c_szFileName);
+	CResource * pResource = FindResourcePointer(uFileKey);
 
 	if (pResource)	// 이미 리소스가 있으면 리턴 한다.
+	{
+		__CountLookup(pResource);
 		return pResource;
+	}
+
+	const char * c_pszFile = m_kPathTable.Intern(c_szFileName, uFileKey);
 
 	const char * pcFileExt = strrchr(c_pszFile, '.');
 
@@ -323,10 +383,10 @@ CResource * CResourceManager::GetResourcePointer(const char * c_szFileName)
 
 	if (pcFileExt)
 	{
-		static char s_szFileExt[8 + 1];
-		strncpy(s_szFileExt, pcFileExt + 1, 8);
+		char szFileExt[8 + 1] = {};
+		strncpy(szFileExt, pcFileExt + 1, 8);
 
-		TResourceNewFunctionPointerMap::iterator f = m_pResNewFuncMap.find(s_szFileExt);
+		TResourceNewFunctionPointerMap::iterator f = m_pResNewFuncMap.find(szFileExt);
 
 		if (m_pResNewFuncMap.end() != f)
 			newFunc = f->second;
@@ -338,13 +398,15 @@ CResource * CResourceManager::GetResourcePointer(const char * c_szFileName)
 		return NULL;
 	}
 
-	pResource = InsertResourcePointer(dwFileCRC, newFunc(c_pszFile));
+	pResource = InsertResourcePointer(uFileKey, newFunc(c_pszFile));
+	__SetResidencyType(pResource);
+	__CountLookup(pResource);
 	return pResource;
 }
 
-CResource * CResourceManager::FindResourcePointer(DWORD dwFileCRC)
+CResource * CResourceManager::FindResourcePointer(uint64_t uFileKey)
 {
-	TResourcePointerMap::iterator itor = m_pResMap.find(dwFileCRC);
+	TResourcePointerMap::iterator itor = m_pResMap.find(uFileKey);
 
 	if (m_pResMap.end() == itor)
 		return NULL;
@@ -352,39 +414,26 @@ CResource * CResourceManager::FindResourcePointer(DWORD dwFileCRC)
 	return itor->second;
 }
 
-bool CResourceManager::isResourcePointerData(DWORD dwFileCRC)
+bool CResourceManager::isResourcePointerData(uint64_t uFileKey)
 {
-	TResourcePointerMap::iterator itor = m_pResMap.find(dwFileCRC);
+	TResourcePointerMap::iterator itor = m_pResMap.find(uFileKey);
 
 	if (m_pResMap.end() == itor)
-		return NULL;
+		return false;
 
 	return (itor->second)->IsData();
 }
 
-DWORD CResourceManager::__GetFileCRC(const char * c_szFileName, const char ** c_ppszLowerFileName)
+uint64_t CResourceManager::__GetFileKey(const char * c_szFileName)
 {
-	static char s_szFullPathFileName[MAX_PATH];
-	const char * src = c_szFileName;
-	char * dst = s_szFullPathFileName;
-	int	len = 0;
-
-	while (src[len])
-	{
-		if (src[len]=='/')
-			dst[len] = '\\';
-		else
-			dst[len] = (char) ascii_tolower(src[len]);
-
-		++len;
-	}
-
-	dst[len] = '\0';
+	const uint64_t c_uFileKey = HashPath(c_szFileName);
 
-	if (c_ppszLowerFileName)
-		*c_ppszLowerFileName = &s_szFullPathFileName[0];
+#ifdef _DEBUG
+	// Interning compares the name with the one already stored under the key
+	m_kPathTable.Intern(c_szFileName, c_uFileKey);
+#endif
 
-	return (GetCRC32(s_szFullPathFileName, len));
+	return c_uFileKey;
 }
 
 typedef struct SDumpData
@@ -499,57 +548,294 @@ bool CResourceManager::IsFileExist(const char * c_szFileName)
 
 void CResourceManager::Update()
 {
-	DWORD CurrentTime = ELTimer_GetMSec();
-	CResource * pResource;
-	int Count = 0;
+	__EvictOverBudget();
+	ProcessBackgroundLoading();
+}
 
-	TResourceDeletingMap::iterator itor = m_ResourceDeletingMap.begin();
+void CResourceManager::ReserveDeletingResource(CResource * pResource)
+{
+	TResidencyType & rkType = m_kDeq_kResidencyType[pResource->m_byResidencyType];
+	TEvictable kEvictable = { pResource, ELTimer_GetMSec() };
 
-	while (itor != m_ResourceDeletingMap.end())
+	TResourceDeletingMap::iterator f = m_ResourceDeletingMap.find(pResource);
+
+	if (m_ResourceDeletingMap.end() != f)
 	{
-		pResource = itor->first;
+		*f->second = kEvictable;
+		rkType.kList_kEvictable.splice(rkType.kList_kEvictable.end(), rkType.kList_kEvictable, f->second);
+		return;
+	}
 
-		if (CurrentTime >= itor->second)
-		{
-			if (pResource->canDestroy())
-			{
-				//Tracef("Resource Clear %s\n", pResource->GetFileName());
-				pResource->Clear();
-			}
+	m_ResourceDeletingMap.insert(TResourceDeletingMap::value_type(pResource, rkType.kList_kEvictable.insert(rkType.kList_kEvictable.end(), kEvictable)));
+}
+
+void CResourceManager::OnResourceLoad(CResource * pResource)
+{
+	TResidencyStats & rkStats = m_kDeq_kResidencyType[pResource->m_byResidencyType].kStats;
+
+	// Reloaded in place, the old size is replaced
+	if (pResource->m_isResident)
+	{
+		rkStats.uResidentBytes -= pResource->m_uResidentSize;
+		--rkStats.uResidentCount;
+		m_uResidentBytes -= pResource->m_uResidentSize;
+	}
+
+	pResource->m_uResidentSize = pResource->GetMemorySize();
+	pResource->m_isResident = true;
+
+	rkStats.uResidentBytes += pResource->m_uResidentSize;
+	++rkStats.uResidentCount;
+	m_uResidentBytes += pResource->m_uResidentSize;
+}
+
+void CResourceManager::OnResourceClear(CResource * pResource)
+{
+	TResidencyType & rkType = m_kDeq_kResidencyType[pResource->m_byResidencyType];
 
-			itor = m_ResourceDeletingMap.erase(itor);
+	rkType.kStats.uResidentBytes -= pResource->m_uResidentSize;
+	--rkType.kStats.uResidentCount;
+	m_uResidentBytes -= pResource->m_uResidentSize;
+
+	pResource->m_uResidentSize = 0;
+	pResource->m_isResident = false;
+
+	TResourceDeletingMap::iterator f = m_ResourceDeletingMap.find(pResource);
+
+	if (m_ResourceDeletingMap.end() != f)
+	{
+		rkType.kList_kEvictable.erase(f->second);
+		m_ResourceDeletingMap.erase(f);
+	}
+}
+
+int CResourceManager::__FindResidencyType(const char * c_szResidencyType)
+{
+	for (size_t i = 0; i < m_kDeq_kResidencyType.size(); ++i)
+	{
+		if (m_kDeq_kResidencyType[i].kStats.stName == c_szResidencyType)
+			return int(i);
+	}
+
+	return -1;
+}
+
+BYTE CResourceManager::__GetResidencyType(const char * c_szResidencyType)
+{
+	const int iType = __FindResidencyType(c_szResidencyType);
+	if (iType >= 0)
+		return BYTE(iType);
+
+	if (m_kDeq_kResidencyType.size() > 0xff)
+	{
+		TraceError("CResourceManager::__GetResidencyType: too many types, %s is accounted as other", c_szResidencyType);
+		return 0;
+	}
+
+	TResidencyType kType;
+	kType.kStats = TResidencyStats();
+	kType.kStats.stName = c_szResidencyType;
+	m_kDeq_kResidencyType.push_back(kType);
+
+	return BYTE(m_kDeq_kResidencyType.size() - 1);
+}
 
-			if (++Count >= c_DeletingCountPerFrame)
+void CResourceManager::__SetResidencyType(CResource * pResource)
+{
+	const char * pcFileExt = strrchr(pResource->GetFileName(), '.');
+
+	if (!pcFileExt)
+		return;
+
+	TResidencyTypeByExtMap::iterator f = m_kMap_stExt_byResidencyType.find(pcFileExt + 1);
+
+	if (m_kMap_stExt_byResidencyType.end() != f)
+		pResource->m_byResidencyType = f->second;
+}
+
+void CResourceManager::__CountLookup(CResource * pResource)
+{
+	TResidencyStats & rkStats = m_kDeq_kResidencyType[pResource->m_byResidencyType].kStats;
+
+	if (pResource->IsEmpty())
+		++rkStats.uMissCount;
+	else
+		++rkStats.uHitCount;
+}
+
+bool CResourceManager::__EvictOldest(TResidencyType & rkType, DWORD dwCurrentTime)
+{
+	while (!rkType.kList_kEvictable.empty())
+	{
+		const TEvictable & c_rkEvictable = rkType.kList_kEvictable.front();
+		CResource * pResource = c_rkEvictable.pResource;
+
+		// Everything behind was released even later
+		if (pResource->canDestroy() && dwCurrentTime - c_rkEvictable.dwReleaseTime < c_Eviction_Min_Idle_Time)
+			return false;
+
+		m_ResourceDeletingMap.erase(pResource);
+		rkType.kList_kEvictable.pop_front();
+
+		// Referenced again since it was released
+		if (!pResource->canDestroy())
+			continue;
+
+		//Tracef("Resource Evict %s\n", pResource->GetFileName());
+		pResource->Clear();
+		++rkType.kStats.uEvictionCount;
+		return true;
+	}
+
+	return false;
+}
+
+void CResourceManager::__EvictOverBudget()
+{
+	DWORD dwCurrentTime = ELTimer_GetMSec();
+	int iCount = 0;
+
+	// Types over their own budget give back memory first
+	for (TResidencyType & rkType : m_kDeq_kResidencyType)
+	{
+		while (rkType.kStats.uBudget && rkType.kStats.uResidentBytes > rkType.kStats.uBudget && iCount < c_DeletingCountPerFrame)
+		{
+			if (!__EvictOldest(rkType, dwCurrentTime))
 				break;
+
+			++iCount;
 		}
-		else
-			++itor;
 	}
 
-	ProcessBackgroundLoading();
+	// Then the least recently released of any type
+	while (m_uResidencyBudget && m_uResidentBytes > m_uResidencyBudget && iCount < c_DeletingCountPerFrame)
+	{
+		TResidencyType * pkOldest = NULL;
+
+		for (TResidencyType & rkType : m_kDeq_kResidencyType)
+		{
+			if (rkType.kList_kEvictable.empty())
+				continue;
+
+			if (!pkOldest || long(rkType.kList_kEvictable.front().dwReleaseTime - pkOldest->kList_kEvictable.front().dwReleaseTime) < 0)
+				pkOldest = &rkType;
+		}
+
+		if (!pkOldest || !__EvictOldest(*pkOldest, dwCurrentTime))
+			break;
+
+		++iCount;
+	}
 }
 
-void CResourceManager::ReserveDeletingResource(CResource * pResource)
+bool CResourceManager::SetResidencyBudget(const char * c_szResidencyType, size_t uBytes)
 {
-	DWORD dwCurrentTime = ELTimer_GetMSec();
-	m_ResourceDeletingMap.insert(TResourceDeletingMap::value_type(pResource, dwCurrentTime + c_Deleting_Wait_Time));
+	if (!c_szResidencyType || !strcmp(c_szResidencyType, "total"))
+	{
+		m_uResidencyBudget = uBytes;
+		return true;
+	}
+
+	const int iType = __FindResidencyType(c_szResidencyType);
+	if (iType < 0)
+	{
+		TraceError("CResourceManager::SetResidencyBudget: unknown type %s", c_szResidencyType);
+		return false;
+	}
+
+	m_kDeq_kResidencyType[iType].kStats.uBudget = uBytes;
+	return true;
+}
+
+void CResourceManager::GetResidencyStats(TResidencyStats * pTotal, std::vector<TResidencyStats> * pkVct_kStats)
+{
+	*pTotal = TResidencyStats();
+	pTotal->stName = "total";
+	pTotal->uBudget = m_uResidencyBudget;
+
+	pkVct_kStats->clear();
+
+	for (TResidencyType & rkType : m_kDeq_kResidencyType)
+	{
+		TResidencyStats kStats = rkType.kStats;
+		kStats.uEvictableCount = (uint32_t) rkType.kList_kEvictable.size();
+
+		pTotal->uResidentBytes += kStats.uResidentBytes;
+		pTotal->uResidentCount += kStats.uResidentCount;
+		pTotal->uEvictableCount += kStats.uEvictableCount;
+		pTotal->uHitCount += kStats.uHitCount;
+		pTotal->uMissCount += kStats.uMissCount;
+		pTotal->uEvictionCount += kStats.uEvictionCount;
+
+		pkVct_kStats->push_back(kStats);
+	}
+}
+
+bool CResourceManager::DumpResidencyStats(const char * c_szFileName)
+{
+	FILE * fp = fopen(c_szFileName, "w");
+
+	if (!fp)
+		return false;
+
+	TResidencyStats kTotal;
+	std::vector<TResidencyStats> kVct_kStats;
+	GetResidencyStats(&kTotal, &kVct_kStats);
+	kVct_kStats.insert(kVct_kStats.begin(), kTotal);
+
+	fprintf(fp, "%-12s %10s %10s %8s %8s %12s %12s %10s %6s\n", "type", "budget(KB)", "bytes(KB)", "count", "idle", "hit", "miss", "evicted", "hit%");
+
+	for (size_t i = 0; i < kVct_kStats.size(); ++i)
+	{
+		const TResidencyStats & c_rkStats = kVct_kStats[i];
+		const uint64_t c_uLookupCount = c_rkStats.uHitCount + c_rkStats.uMissCount;
+
+		fprintf(fp, "%-12s %10u %10u %8u %8u %12llu %12llu %10llu %6.1f\n", c_rkStats.stName.c_str(),
+			(unsigned)(c_rkStats.uBudget >> 10), (unsigned)(c_rkStats.uResidentBytes >> 10),
+			c_rkStats.uResidentCount, c_rkStats.uEvictableCount,
+			(unsigned long long)c_rkStats.uHitCount, (unsigned long long)c_rkStats.uMissCount, (unsigned long long)c_rkStats.uEvictionCount,
+			c_uLookupCount ? 100.0 * c_rkStats.uHitCount / c_uLookupCount : 0.0);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+// An eighth of the physical memory, within what the address space allows
+static size_t __GetDefaultResidencyBudget()
+{
+	const size_t c_uMinBudget = size_t(256) << 20;
+#ifdef _WIN64
+	const size_t c_uMaxBudget = size_t(2048) << 20;
+#else
+	const size_t c_uMaxBudget = size_t(768) << 20;
+#endif
+
+	MEMORYSTATUSEX kMemStatus;
+	kMemStatus.dwLength = sizeof(kMemStatus);
+
+	if (!GlobalMemoryStatusEx(&kMemStatus))
+		return c_uMinBudget;
+
+	return (size_t) std::min<uint64_t>(std::max<uint64_t>(kMemStatus.ullTotalPhys / 8, c_uMinBudget), c_uMaxBudget);
 }
 
 CResourceManager::CResourceManager()
-	: m_pTextureCache(nullptr)
+	: m_uResidencyBudget(__GetDefaultResidencyBudget())
+	, m_uResidentBytes(0)
+	, m_dwFinalizeBudgetMicroSec(c_Default_Finalize_Budget)
+	, m_uFinalizedCount(0)
+	, m_uLatencyMicroSec(0)
+	, m_uMaxLatencyMicroSec(0)
+	, m_uFinalizeMicroSec(0)
 {
+	__GetResidencyType("other");
+
 	ms_loadingThread.Create(0);
-	m_pTextureCache = new CTextureCache(512);
 }
 
 CResourceManager::~CResourceManager()
 {
 	Destroy();
 	ms_loadingThread.Shutdown();
-
-	if (m_pTextureCache)
-	{
-		delete m_pTextureCache;
-		m_pTextureCache = nullptr;
-	}
 }
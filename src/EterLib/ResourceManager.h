@@ -2,14 +2,17 @@
 
 #include "Resource.h"
 #include "FileLoaderThread.h"
+#include "EterBase/PathHash.h"
 
 #include <set>
 #include <map>
+#include <deque>
+#include <list>
+#include <vector>
+#include <unordered_map>
 #include <string>
 #include <mutex>
 
-class CTextureCache;
-
 class CResourceManager : public CSingleton<CResourceManager>
 {
 	public:
@@ -24,43 +27,105 @@ class CResourceManager : public CSingleton<CResourceManager>
 		void		BeginThreadLoading();
 		void		EndThreadLoading();
 
-		CResource *	InsertResourcePointer(DWORD dwFileCRC, CResource* pResource);
-		CResource *	FindResourcePointer(DWORD dwFileCRC);
+		// Resources are keyed by HashPath of their file name
+		CResource *	InsertResourcePointer(uint64_t uFileKey, CResource* pResource);
+		CResource *	FindResourcePointer(uint64_t uFileKey);
 		CResource *	GetResourcePointer(const char * c_szFileName);
 		CResource *	GetTypeResourcePointer(const char * c_szFileName, int iType=-1);
 
 		// 추가
-		bool		isResourcePointerData(DWORD dwFileCRC);
+		bool		isResourcePointerData(uint64_t uFileKey);
 
-		void		RegisterResourceNewFunctionPointer(const char* c_szFileExt, CResource* (*pResNewFunc)(const char* c_szFileName));
+		// Resources of the extension are accounted under c_szResidencyType, "other" if NULL
+		void		RegisterResourceNewFunctionPointer(const char* c_szFileExt, CResource* (*pResNewFunc)(const char* c_szFileName), const char * c_szResidencyType = NULL);
 		void		RegisterResourceNewFunctionByTypePointer(int iType, CResource* (*pNewFunc) (const char* c_szFileName));
 		
 		void		DumpFileListToTextFile(const char* c_szFileName);
 		bool		IsFileExist(const char * c_szFileName);
 
 		void		Update();
+
+		// Unreferenced resources wait here, least recently released first, until a budget needs their memory
 		void		ReserveDeletingResource(CResource * pResource);
 
 	public:
+		typedef struct SResidencyStats
+		{
+			std::string	stName;
+			size_t		uBudget;				// 0 for none
+			size_t		uResidentBytes;
+			uint32_t	uResidentCount;
+			uint32_t	uEvictableCount;		// released, waiting for eviction unless referenced again
+			uint64_t	uHitCount;				// lookups that found the data loaded
+			uint64_t	uMissCount;
+			uint64_t	uEvictionCount;
+		} TResidencyStats;
+
+		void		OnResourceLoad(CResource * pResource);
+		void		OnResourceClear(CResource * pResource);
+
+		// A NULL type sets the budget over all resources, 0 bytes removes a budget.
+		// Only types registered with a resource extension are known, others are refused.
+		bool		SetResidencyBudget(const char * c_szResidencyType, size_t uBytes);
+		void		GetResidencyStats(TResidencyStats * pTotal, std::vector<TResidencyStats> * pkVct_kStats);
+		bool		DumpResidencyStats(const char * c_szFileName);
+
+	public:
+		typedef struct SBackgroundLoadingStats
+		{
+			size_t		uRequested;				// not yet handed to the thread pool
+			size_t		uInFlight;				// being read or decoded on the pool
+			size_t		uReady;					// decoded, waiting to be finalized
+			uint32_t	uFinalized;				// since the last reset
+			uint64_t	uLatencyMicroSec;		// request to finalize, summed over uFinalized
+			uint64_t	uMaxLatencyMicroSec;
+			uint64_t	uFinalizeMicroSec;		// main thread time spent finalizing
+		} TBackgroundLoadingStats;
+
 		void		ProcessBackgroundLoading();
 		void		PushBackgroundLoadingSet(std::set<std::string> & LoadingSet);
 
-		CTextureCache* GetTextureCache() { return m_pTextureCache; }
+		// Main thread time per frame for finalizing background loads, at least one is always done
+		void		SetFinalizeBudget(DWORD dwMicroSec) { m_dwFinalizeBudgetMicroSec = dwMicroSec; }
+		void		GetBackgroundLoadingStats(TBackgroundLoadingStats * pStats, bool bReset = false);
+		void		TraceBackgroundLoadingStats(const char * c_szWhen);
 
 	protected:
+		typedef struct SEvictable
+		{
+			CResource *	pResource;
+			DWORD		dwReleaseTime;
+		} TEvictable;
+
+		typedef std::list<TEvictable>	TEvictableList;
+
+		typedef struct SResidencyType
+		{
+			TResidencyStats	kStats;
+			TEvictableList	kList_kEvictable;
+		} TResidencyType;
+
+	protected:
+		BYTE		__GetResidencyType(const char * c_szResidencyType);
+		int			__FindResidencyType(const char * c_szResidencyType);
+		void		__SetResidencyType(CResource * pResource);
+		void		__CountLookup(CResource * pResource);
+		bool		__EvictOldest(TResidencyType & rkType, DWORD dwCurrentTime);
+		void		__EvictOverBudget();
+
 		void		__DestroyDeletingResourceMap();
 		void		__DestroyResourceMap();
 		void		__DestroyCacheMap();
 
-		DWORD		__GetFileCRC(const char * c_szFileName, const char ** c_pszLowerFile = NULL);
+		uint64_t	__GetFileKey(const char * c_szFileName);
 	
 	protected:
-		typedef std::map<DWORD,	CResource *>									TResourcePointerMap;
+		typedef std::unordered_map<uint64_t, CResource *>						TResourcePointerMap;
 		typedef std::map<std::string, CResource* (*)(const char*)>				TResourceNewFunctionPointerMap;
 		typedef std::map<int, CResource* (*)(const char*)>						TResourceNewFunctionByTypePointerMap;
-		typedef std::map<CResource *, DWORD>									TResourceDeletingMap;
-		typedef std::map<DWORD, std::string>									TResourceRequestMap;
-		typedef std::map<long, CResource*>										TResourceRefDecreaseWaitingMap;
+		typedef std::unordered_map<CResource *, TEvictableList::iterator>		TResourceDeletingMap;
+		typedef std::map<uint64_t, const char *>								TResourceRequestMap;	// interned names
+		typedef std::map<std::string, BYTE>										TResidencyTypeByExtMap;
 
 	protected:
 		TResourcePointerMap						m_pCacheMap;
@@ -70,10 +135,23 @@ class CResourceManager : public CSingleton<CResourceManager>
 		TResourceDeletingMap					m_ResourceDeletingMap;
 		TResourceRequestMap						m_RequestMap;	// 쓰레드로 로딩 요청한 리스트
 		TResourceRequestMap						m_WaitingMap;
-		TResourceRefDecreaseWaitingMap			m_pResRefDecreaseWaitingMap;
+
+		CPathTable								m_kPathTable;	// resource file names, '\\' separated
+
+		// 0 is "other". A deque, so adding a type never moves the evictable lists that
+		// m_ResourceDeletingMap holds iterators into
+		std::deque<TResidencyType>				m_kDeq_kResidencyType;
+		TResidencyTypeByExtMap					m_kMap_stExt_byResidencyType;
+		size_t									m_uResidencyBudget;
+		size_t									m_uResidentBytes;
 
 		static CFileLoaderThread				ms_loadingThread;
-		CTextureCache*							m_pTextureCache;
+
+		DWORD									m_dwFinalizeBudgetMicroSec;
+		uint32_t								m_uFinalizedCount;
+		uint64_t								m_uLatencyMicroSec;
+		uint64_t								m_uMaxLatencyMicroSec;
+		uint64_t								m_uFinalizeMicroSec;
 
 		mutable std::mutex						m_ResourceMapMutex;  // Thread-safe resource map access
 };
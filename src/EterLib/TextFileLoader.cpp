@@ -1,42 +1,65 @@
 #include "StdAfx.h"
 #include "EterBase/CRC32.h"
 #include <string>
+#include <algorithm>
+#include <climits>
+#include <chrono>
 #include "PackLib/PackManager.h"
+#include "PackLib/ScriptBinary.h"
 
-#include "Pool.h"
 #include "TextFileLoader.h"
 
 std::map<DWORD, CTextFileLoader*> CTextFileLoader::ms_kMap_dwNameKey_pkTextFileLoader;
 bool CTextFileLoader::ms_isCacheMode=false;
+std::atomic<uint32_t> CTextFileLoader::ms_auLoadCount[2];
+std::atomic<uint64_t> CTextFileLoader::ms_auLoadMicroSec[2];
 
-CDynamicPool<CTextFileLoader::SGroupNode>	CTextFileLoader::SGroupNode::ms_kPool;
-
-CTokenVector* CTextFileLoader::SGroupNode::GetTokenVector(const std::string& c_rstGroupName)
+namespace
 {
-	DWORD dwGroupNameKey=GenNameKey(c_rstGroupName.c_str(), c_rstGroupName.length());
+	inline bool IsDelimeter(char c)
+	{
+		return ' ' == c || '\t' == c;
+	}
 
-	std::map<DWORD, CTokenVector>::iterator f=m_kMap_dwKey_kVct_stToken.find(dwGroupNameKey);
-	if (m_kMap_dwKey_kVct_stToken.end()==f)
-		return NULL;
+	inline bool IsEqualNoCase(const std::string_view& c_rstText, const char* c_szLower)
+	{
+		size_t i = 0;
+		for (; i < c_rstText.size(); ++i)
+		{
+			if (!c_szLower[i] || ascii_tolower(c_rstText[i]) != c_szLower[i])
+				return false;
+		}
 
-	return &f->second;
-}
+		return 0 == c_szLower[i];
+	}
 
-bool CTextFileLoader::SGroupNode::IsExistTokenVector(const std::string& c_rstGroupName)
-{
-	DWORD dwGroupNameKey=GenNameKey(c_rstGroupName.c_str(), c_rstGroupName.length());
+	// atoi/atof want a terminated string, tokens longer than any number are cut
+	class CTokenString
+	{
+		public:
+			explicit CTokenString(const std::string_view& c_rstToken)
+			{
+				const size_t uLen = std::min(c_rstToken.size(), sizeof(m_szBuf) - 1);
+				memcpy(m_szBuf, c_rstToken.data(), uLen);
+				m_szBuf[uLen] = '\0';
+			}
 
-	if (m_kMap_dwKey_kVct_stToken.end()==m_kMap_dwKey_kVct_stToken.find(dwGroupNameKey))
-		return false;
+			int ToInteger() const { return atoi(m_szBuf); }
+			float ToFloat() const { return float(atof(m_szBuf)); }
 
-	return true;
-}
+		private:
+			char m_szBuf[64];
+	};
 
-void CTextFileLoader::SGroupNode::InsertTokenVector(const std::string& c_rstGroupName, const CTokenVector& c_rkVct_stToken)
-{
-	DWORD dwGroupNameKey=GenNameKey(c_rstGroupName.c_str(), c_rstGroupName.length());
+	inline int TokenToInteger(const std::string_view& c_rstToken)
+	{
+		return CTokenString(c_rstToken).ToInteger();
+	}
 
-	m_kMap_dwKey_kVct_stToken.insert(std::map<DWORD, CTokenVector>::value_type(dwGroupNameKey, c_rkVct_stToken));
+	inline float TokenToFloat(const std::string_view& c_rstToken)
+	{
+		return CTokenString(c_rstToken).ToFloat();
+	}
 }
 
 DWORD CTextFileLoader::SGroupNode::GenNameKey(const char* c_szGroupName, UINT uGroupNameLen)
@@ -44,7 +67,7 @@ DWORD CTextFileLoader::SGroupNode::GenNameKey(const char* c_szGroupName, UINT uG
 	return GetCRC32(c_szGroupName, uGroupNameLen);
 }
 
-const std::string& CTextFileLoader::SGroupNode::GetGroupName()
+const std::string_view& CTextFileLoader::SGroupNode::GetGroupName()
 {
 	return m_strGroupName;
 }
@@ -57,37 +80,21 @@ bool CTextFileLoader::SGroupNode::IsGroupNameKey(DWORD dwGroupNameKey)
 	return false;
 }
 
-void CTextFileLoader::SGroupNode::SetGroupName(const std::string& c_rstGroupName)
-{
-	m_strGroupName=c_rstGroupName;
-	stl_lowers(m_strGroupName);
-
-	m_dwGroupNameKey=GenNameKey(m_strGroupName.c_str(), m_strGroupName.length());
-}
-
-
-CTextFileLoader::SGroupNode* CTextFileLoader::SGroupNode::New()
-{
-	return ms_kPool.Alloc();
-}
-
-void CTextFileLoader::SGroupNode::Delete(SGroupNode* pkNode)
+CTextFileLoader::TToken* CTextFileLoader::SGroupNode::FindToken(DWORD dwKey)
 {
-	pkNode->m_kMap_dwKey_kVct_stToken.clear();
-	pkNode->ChildNodeVector.clear();
-	pkNode->m_strGroupName="";
-	pkNode->m_dwGroupNameKey=0;
-	ms_kPool.Free(pkNode);
-}
-
+	if (0 == m_dwTokenCount)
+		return NULL;
 
+	for (DWORD dwSlot = dwKey & m_dwTokenSlotMask; m_pTokenSlots[dwSlot]; dwSlot = (dwSlot + 1) & m_dwTokenSlotMask)
+	{
+		TToken* pToken = &m_pTokens[m_pTokenSlots[dwSlot] - 1];
+		if (pToken->dwKey == dwKey)
+			return pToken;
+	}
 
-void CTextFileLoader::SGroupNode::DestroySystem()
-{
-	ms_kPool.Destroy();
+	return NULL;
 }
 
-
 CTextFileLoader* CTextFileLoader::Cache(const char* c_szFileName)
 {
 	DWORD dwNameKey=GetCRC32(c_szFileName, strlen(c_szFileName));
@@ -120,49 +127,67 @@ void CTextFileLoader::SetCacheMode()
 
 void CTextFileLoader::DestroySystem()
 {
-	{
-		std::map<DWORD, CTextFileLoader*>::iterator i;
-		for (i=ms_kMap_dwNameKey_pkTextFileLoader.begin(); i!=ms_kMap_dwNameKey_pkTextFileLoader.end(); ++i)
-			delete i->second;
-		ms_kMap_dwNameKey_pkTextFileLoader.clear();
-	}
+	std::map<DWORD, CTextFileLoader*>::iterator i;
+	for (i=ms_kMap_dwNameKey_pkTextFileLoader.begin(); i!=ms_kMap_dwNameKey_pkTextFileLoader.end(); ++i)
+		delete i->second;
+	ms_kMap_dwNameKey_pkTextFileLoader.clear();
+}
 
-	SGroupNode::DestroySystem();
+void CTextFileLoader::AddLoadStats(bool isCompiled, uint64_t uMicroSec)
+{
+	ms_auLoadCount[isCompiled].fetch_add(1, std::memory_order_relaxed);
+	ms_auLoadMicroSec[isCompiled].fetch_add(uMicroSec, std::memory_order_relaxed);
 }
 
-void CTextFileLoader::Destroy()
+void CTextFileLoader::TraceLoadStats(const char * c_szWhen)
 {
-	__DestroyGroupNodeVector();
+	uint32_t auCount[2];
+	uint64_t auMicroSec[2];
+
+	for (int i = 0; i < 2; ++i)
+	{
+		auCount[i] = ms_auLoadCount[i].exchange(0, std::memory_order_relaxed);
+		auMicroSec[i] = ms_auLoadMicroSec[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	if (!auCount[0] && !auCount[1])
+		return;
+
+	Tracef("%s - scripts: %u compiled in %llu us, %u text in %llu us\n", c_szWhen,
+		auCount[1], (unsigned long long)auMicroSec[1], auCount[0], (unsigned long long)auMicroSec[0]);
 }
 
-CTextFileLoader::CTextFileLoader()
+void CTextFileLoader::Destroy()
 {
-	SetTop();
+	m_kDeq_kTokenVector.clear();
+	m_kArena.Reset();
+	m_kVct_kLine.clear();
+	m_kFile.Clear();
 
-	m_acBufData=NULL;
-	m_dwBufSize=0;
-	m_dwBufCapacity=0;
+	m_pcData = NULL;
+	m_uDataSize = 0;
 
+	m_GlobalNode = TGroupNode();
 	m_GlobalNode.m_strGroupName = "global";
 	m_GlobalNode.pParentNode = NULL;
 
-	m_kVct_pkNode.reserve(128);	
+	SetTop();
 }
 
-CTextFileLoader::~CTextFileLoader()
+CTextFileLoader::CTextFileLoader()
 {
-	Destroy();
+	m_pcData = NULL;
+	m_uDataSize = 0;
+	m_dwcurLineIndex = 0;
+
+	m_kVct_kLine.reserve(128);
 
-	if (m_acBufData)
-		delete [] m_acBufData;
+	Destroy();
 }
 
-void CTextFileLoader::__DestroyGroupNodeVector()
+CTextFileLoader::~CTextFileLoader()
 {
-	std::vector<SGroupNode*>::iterator i;
-	for (i=m_kVct_pkNode.begin(); i!=m_kVct_pkNode.end(); ++i)
-		SGroupNode::Delete(*i);
-	m_kVct_pkNode.clear();
+	Destroy();
 }
 
 const char * CTextFileLoader::GetFileName()
@@ -178,138 +203,403 @@ bool CTextFileLoader::IsEmpty()
 bool CTextFileLoader::Load(const char * c_szFileName)
 {
 	m_strFileName = "";
+	Destroy();
+
+	const auto c_tStart = std::chrono::steady_clock::now();
+
+	const bool isCompiled = __LoadCompiled(c_szFileName);
+	bool bRet = true;
+
+	if (!isCompiled)
+	{
+		if (!CPackManager::Instance().GetFileView(c_szFileName, m_kFile))
+			return false;
 
-	TPackFile kFile;
-	if (!CPackManager::Instance().GetFile( c_szFileName, kFile))
+		bRet = LoadFromMemory(c_szFileName, m_kFile.data(), m_kFile.size());
+	}
+
+	AddLoadStats(isCompiled, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c_tStart).count());
+	return bRet;
+}
+
+// Rebuilds the node tree from "<file>.tsb". Only scripts that parsed without any
+// complaint get compiled, so this always stands for a successful text load.
+bool CTextFileLoader::__LoadCompiled(const char * c_szFileName)
+{
+	if (!CPackManager::Instance().GetCompiledFileView(c_szFileName, m_kFile))
+		return false;
+
+	CScriptBinaryView kView;
+	if (!kView.Open(m_kFile.data(), m_kFile.size(), SCRIPT_BINARY_GROUP))
+	{
+		TraceError("CTextFileLoader::Load - broken compiled script %s%s, using the text", c_szFileName, SCRIPT_BINARY_SUFFIX.data());
+		m_kFile.Clear();
 		return false;
+	}
+
+	const TScriptBinaryHeader & c_rkHeader = kView.GetHeader();
+
+	TGroupNode ** ppNodes = m_kArena.NewArray<TGroupNode*>(c_rkHeader.node_count);
+	ppNodes[0] = &m_GlobalNode;
+	for (DWORD i = 1; i < c_rkHeader.node_count; ++i)
+		ppNodes[i] = m_kArena.New<TGroupNode>();
+
+	TToken * pTokens = m_kArena.NewArray<TToken>(c_rkHeader.token_count);
+	std::string_view * pValues = m_kArena.NewArray<std::string_view>(c_rkHeader.value_count);
+	DWORD * pSlots = m_kArena.NewArray<DWORD>(c_rkHeader.slot_count);
+	TGroupNode ** ppChildNodes = m_kArena.NewArray<TGroupNode*>(c_rkHeader.child_count);
+
+	for (DWORD i = 0; i < c_rkHeader.value_count; ++i)
+		pValues[i] = kView.GetValue(i);
+
+	for (DWORD i = 0; i < c_rkHeader.slot_count; ++i)
+		pSlots[i] = kView.GetSlot(i);
+
+	for (DWORD i = 0; i < c_rkHeader.child_count; ++i)
+		ppChildNodes[i] = ppNodes[kView.GetChild(i)];
+
+	for (DWORD i = 0; i < c_rkHeader.token_count; ++i)
+	{
+		const TScriptBinaryToken & c_rkToken = kView.GetToken(i);
+		pTokens[i].dwKey = c_rkToken.key;
+		pTokens[i].dwValueCount = c_rkToken.value_count;
+		pTokens[i].pValues = pValues + c_rkToken.first_value;
+		pTokens[i].pkVector = NULL;
+	}
 
-	if (m_dwBufCapacity<kFile.size())
+	for (DWORD i = 0; i < c_rkHeader.node_count; ++i)
 	{
-		m_dwBufCapacity=kFile.size();
+		const TScriptBinaryNode & c_rkNode = kView.GetNode(i);
+		TGroupNode * pGroupNode = ppNodes[i];
 
-		if (m_acBufData)
-			delete [] m_acBufData;
+		if (i != 0)
+		{
+			pGroupNode->m_dwGroupNameKey = c_rkNode.name_key;
+			pGroupNode->m_strGroupName = kView.GetString(c_rkNode.name);
+			pGroupNode->pParentNode = ppNodes[c_rkNode.parent];
+		}
 
-		m_acBufData=new char[m_dwBufCapacity];
+		pGroupNode->m_pTokens = pTokens + c_rkNode.first_token;
+		pGroupNode->m_dwTokenCount = c_rkNode.token_count;
+		pGroupNode->m_pTokenSlots = c_rkNode.slot_count ? pSlots + c_rkNode.first_slot : NULL;
+		pGroupNode->m_dwTokenSlotMask = c_rkNode.slot_count ? c_rkNode.slot_count - 1 : 0;
+		pGroupNode->ppChildNodes = ppChildNodes + c_rkNode.first_child;
+		pGroupNode->dwChildNodeCount = c_rkNode.child_count;
 	}
 
-	m_dwBufSize=kFile.size();
-	memcpy(m_acBufData, kFile.data(), m_dwBufSize);
+	m_strFileName = c_szFileName;
+	return true;
+}
+
+bool CTextFileLoader::LoadFromMemory(const char * c_szFileName, const void * c_pvData, size_t uSize)
+{
+	if (c_pvData != m_kFile.data())
+		Destroy();
+
+	m_pcData = (const char *)c_pvData;
+	m_uDataSize = uSize;
 
 	m_strFileName = c_szFileName;
 	m_dwcurLineIndex = 0;
 
-	m_textFileLoader.Bind(m_dwBufSize, m_acBufData);
+	__SplitLines();
 	return LoadGroup(&m_GlobalNode);
 }
 
+// Same line rules as CMemoryTextFileLoader::Bind, a lead byte of a double byte character
+// takes the following byte with it even if that is a line break
+void CTextFileLoader::__SplitLines()
+{
+	m_kVct_kLine.clear();
+	m_kVct_kLine.reserve(m_uDataSize / 24 + 1);
+
+	const BYTE * c_pbBuf = (const BYTE *)m_pcData;
+	const size_t uSize = m_uDataSize;
+	size_t uLineBegin = 0;
+	size_t pos = 0;
+
+	while (pos < uSize)
+	{
+		// Skips 8 bytes at a time while none of them is a line break or a lead byte
+		while (pos + sizeof(uint64_t) <= uSize)
+		{
+			uint64_t u8Bytes;
+			memcpy(&u8Bytes, c_pbBuf + pos, sizeof(u8Bytes));
+
+			const uint64_t c_uLowBits = 0x0101010101010101ull;
+			const uint64_t c_uHighBits = 0x8080808080808080ull;
+			const uint64_t c_uLF = u8Bytes ^ (c_uLowBits * '\n');
+			const uint64_t c_uCR = u8Bytes ^ (c_uLowBits * '\r');
+			if ((u8Bytes | ((c_uLF - c_uLowBits) & ~c_uLF) | ((c_uCR - c_uLowBits) & ~c_uCR)) & c_uHighBits)
+				break;
+
+			pos += sizeof(uint64_t);
+		}
+
+		if (pos >= uSize)
+			break;
+
+		const BYTE c = c_pbBuf[pos++];
+
+		if (c > '\r' && c < 0x80)
+			continue;
+
+		if ('\n' == c || '\r' == c)
+		{
+			m_kVct_kLine.push_back({ m_pcData + uLineBegin, m_pcData + pos - 1 });
+
+			if (pos < uSize)
+				if ('\n' == c_pbBuf[pos] || '\r' == c_pbBuf[pos])
+					++pos;
+
+			uLineBegin = pos;
+		}
+		else if (c >= 0x80)
+		{
+			pos = std::min(pos + 1, uSize);
+		}
+	}
+
+	m_kVct_kLine.push_back({ m_pcData + uLineBegin, m_pcData + uSize });
+}
+
+// Tokenizes a line into m_kVct_kLineToken like CMemoryTextFileLoader::SplitLine2.
+// Returns -1 for an empty line and -2 for a quote that is not closed.
+int CTextFileLoader::__SplitLine(DWORD dwLine)
+{
+	m_kVct_kLineToken.clear();
+
+	const char * pcCur = m_kVct_kLine[dwLine].pBegin;
+	const char * pcEnd = m_kVct_kLine[dwLine].pEnd;
+
+	while (pcCur < pcEnd && IsDelimeter(*pcCur))
+		++pcCur;
+
+	if (pcCur == pcEnd)
+		return -1;
+
+	do
+	{
+		const char * pcTokenEnd;
+
+		if ('"' == *pcCur)
+		{
+			++pcCur;
+			pcTokenEnd = (const char *)memchr(pcCur, '"', pcEnd - pcCur);
+			if (!pcTokenEnd)
+				return -2;
+
+			m_kVct_kLineToken.emplace_back(pcCur, pcTokenEnd - pcCur);
+			pcCur = pcTokenEnd + 1;
+		}
+		else
+		{
+			pcTokenEnd = pcCur;
+			while (pcTokenEnd < pcEnd && !IsDelimeter(*pcTokenEnd))
+				++pcTokenEnd;
+
+			m_kVct_kLineToken.emplace_back(pcCur, pcTokenEnd - pcCur);
+			pcCur = pcTokenEnd;
+		}
+
+		while (pcCur < pcEnd && IsDelimeter(*pcCur))
+			++pcCur;
+	} while (pcCur < pcEnd);
+
+	return 0;
+}
+
+DWORD CTextFileLoader::__GenLowerKey(const std::string_view& c_rstKey)
+{
+	m_stLowerKey.resize(c_rstKey.size());
+	for (size_t i = 0; i < c_rstKey.size(); ++i)
+		m_stLowerKey[i] = ascii_tolower(c_rstKey[i]);
+
+	return SGroupNode::GenNameKey(m_stLowerKey.c_str(), m_stLowerKey.length());
+}
+
+std::string_view CTextFileLoader::__StoreLower(const std::string_view& c_rstText)
+{
+	char * pcText = (char *)m_kArena.Alloc(c_rstText.size() + 1, 1);
+	for (size_t i = 0; i < c_rstText.size(); ++i)
+		pcText[i] = ascii_tolower(c_rstText[i]);
+	pcText[c_rstText.size()] = '\0';
+
+	return std::string_view(pcText, c_rstText.size());
+}
+
+// Moves the tokens and children gathered since the given stack positions into the arena
+void CTextFileLoader::__FinishGroup(TGroupNode * pGroupNode, size_t uTokenBase, size_t uChildBase)
+{
+	const size_t uTokenCount = m_kVct_kPendingToken.size() - uTokenBase;
+	const size_t uChildCount = m_kVct_pkPendingChild.size() - uChildBase;
+
+	pGroupNode->dwChildNodeCount = DWORD(uChildCount);
+	pGroupNode->ppChildNodes = NULL;
+	if (uChildCount)
+	{
+		pGroupNode->ppChildNodes = m_kArena.NewArray<TGroupNode*>(uChildCount);
+		memcpy(pGroupNode->ppChildNodes, &m_kVct_pkPendingChild[uChildBase], uChildCount * sizeof(TGroupNode*));
+	}
+	m_kVct_pkPendingChild.resize(uChildBase);
+
+	pGroupNode->m_dwTokenCount = 0;
+	pGroupNode->m_pTokens = NULL;
+	pGroupNode->m_pTokenSlots = NULL;
+	pGroupNode->m_dwTokenSlotMask = 0;
+
+	if (uTokenCount)
+	{
+		DWORD dwSlotCount = 4;
+		while (dwSlotCount < uTokenCount * 2)
+			dwSlotCount <<= 1;
+
+		pGroupNode->m_pTokens = m_kArena.NewArray<TToken>(uTokenCount);
+		pGroupNode->m_pTokenSlots = m_kArena.NewArray<DWORD>(dwSlotCount);
+		pGroupNode->m_dwTokenSlotMask = dwSlotCount - 1;
+
+		for (size_t i = uTokenBase; i < m_kVct_kPendingToken.size(); ++i)
+		{
+			const TToken & c_rkToken = m_kVct_kPendingToken[i];
+
+			// The first definition of a key wins, as it did with std::map::insert
+			DWORD dwSlot = c_rkToken.dwKey & pGroupNode->m_dwTokenSlotMask;
+			bool isDuplicated = false;
+			for (; pGroupNode->m_pTokenSlots[dwSlot]; dwSlot = (dwSlot + 1) & pGroupNode->m_dwTokenSlotMask)
+			{
+				if (pGroupNode->m_pTokens[pGroupNode->m_pTokenSlots[dwSlot] - 1].dwKey == c_rkToken.dwKey)
+				{
+					isDuplicated = true;
+					break;
+				}
+			}
+
+			if (isDuplicated)
+				continue;
+
+			pGroupNode->m_pTokens[pGroupNode->m_dwTokenCount] = c_rkToken;
+			pGroupNode->m_pTokenSlots[dwSlot] = ++pGroupNode->m_dwTokenCount;
+		}
+	}
+	m_kVct_kPendingToken.resize(uTokenBase);
+}
+
 bool CTextFileLoader::LoadGroup(TGroupNode * pGroupNode)
 {
-	CTokenVector stTokenVector;
+	const size_t uTokenBase = m_kVct_kPendingToken.size();
+	const size_t uChildBase = m_kVct_pkPendingChild.size();
+	const DWORD dwLineCount = DWORD(m_kVct_kLine.size());
 	int nLocalGroupDepth = 0;
-	
-	for (; m_dwcurLineIndex < m_textFileLoader.GetLineCount(); ++m_dwcurLineIndex)
+	bool bRet = true;
+
+	for (; m_dwcurLineIndex < dwLineCount; ++m_dwcurLineIndex)
 	{
 		int iRet;
 
-		if ((iRet = m_textFileLoader.SplitLine2(m_dwcurLineIndex, &stTokenVector)) != 0)
+		if ((iRet = __SplitLine(m_dwcurLineIndex)) != 0)
 		{
 			if (iRet == -2)
 				TraceError("cannot find \" in %s:%lu", m_strFileName.c_str(), m_dwcurLineIndex);
 			continue;
 		}
 
-		stl_lowers(stTokenVector[0]);
+		const std::string_view stKey = m_kVct_kLineToken[0];
+		const char cFirst = stKey.empty() ? '\0' : stKey[0];
 
-		if ('{' == stTokenVector[0][0])
+		if ('{' == cFirst)
 		{
 			nLocalGroupDepth++;
 			continue;
 		}
 
-		if ('}' == stTokenVector[0][0]) {
+		if ('}' == cFirst) {
 			nLocalGroupDepth--;
 			break;
 		}
 
 		// Group
-		if (0 == stTokenVector[0].compare("group"))
+		if (IsEqualNoCase(stKey, "group"))
 		{
-			if (2 != stTokenVector.size())
+			if (2 != m_kVct_kLineToken.size())
 			{
 				assert(!"There is no group name!");
 				continue;
 			}
 
-			TGroupNode * pNewNode = TGroupNode::New();
-			m_kVct_pkNode.push_back(pNewNode);
-
+			TGroupNode * pNewNode = m_kArena.New<TGroupNode>();
 			pNewNode->pParentNode = pGroupNode;
-			pNewNode->SetGroupName(stTokenVector[1]);			
-			pGroupNode->ChildNodeVector.push_back(pNewNode);
+			pNewNode->m_strGroupName = __StoreLower(m_kVct_kLineToken[1]);
+			pNewNode->m_dwGroupNameKey = SGroupNode::GenNameKey(pNewNode->m_strGroupName.data(), pNewNode->m_strGroupName.length());
+			m_kVct_pkPendingChild.push_back(pNewNode);
 
 			++m_dwcurLineIndex;
 
 			if( false == LoadGroup(pNewNode) )
-				return false;
+			{
+				bRet = false;
+				break;
+			}
 		}
 		// List
-		else if (0 == stTokenVector[0].compare("list"))
+		else if (IsEqualNoCase(stKey, "list"))
 		{
-			if (2 != stTokenVector.size())
+			if (2 != m_kVct_kLineToken.size())
 			{
 				assert(!"There is no list name!");
 				continue;
 			}
 
-			CTokenVector stSubTokenVector;
+			TToken kToken = {};
+			kToken.dwKey = __GenLowerKey(m_kVct_kLineToken[1]);
 
-			stl_lowers(stTokenVector[1]);
-			std::string key = stTokenVector[1];
-
-			stTokenVector.clear();
+			m_kVct_kValue.clear();
 
 			++m_dwcurLineIndex;
-			for (; m_dwcurLineIndex < m_textFileLoader.GetLineCount(); ++m_dwcurLineIndex)
+			for (; m_dwcurLineIndex < dwLineCount; ++m_dwcurLineIndex)
 			{
-				if (!m_textFileLoader.SplitLine(m_dwcurLineIndex, &stSubTokenVector))
+				if (0 != __SplitLine(m_dwcurLineIndex))
 					continue;
 
-				if ('{' == stSubTokenVector[0][0])
+				const std::string_view & c_rstFirst = m_kVct_kLineToken[0];
+
+				if (!c_rstFirst.empty() && '{' == c_rstFirst[0])
 					continue;
-				
-				if ('}' == stSubTokenVector[0][0])
+
+				if (!c_rstFirst.empty() && '}' == c_rstFirst[0])
 					break;
 
-				for (DWORD j = 0; j < stSubTokenVector.size(); ++j)
-				{
-					stTokenVector.push_back(stSubTokenVector[j]);
-				}
+				m_kVct_kValue.insert(m_kVct_kValue.end(), m_kVct_kLineToken.begin(), m_kVct_kLineToken.end());
 			}
 
-			pGroupNode->InsertTokenVector(key, stTokenVector);
-			//pGroupNode->LocalTokenVectorMap.insert(std::make_pair(key, stTokenVector));
+			kToken.dwValueCount = DWORD(m_kVct_kValue.size());
+			kToken.pValues = m_kArena.NewArray<std::string_view>(m_kVct_kValue.size());
+			std::copy(m_kVct_kValue.begin(), m_kVct_kValue.end(), const_cast<std::string_view *>(kToken.pValues));
+			m_kVct_kPendingToken.push_back(kToken);
 		}
 		else
 		{
-			std::string key = stTokenVector[0];
-
-			if (1 == stTokenVector.size())
+			if (1 == m_kVct_kLineToken.size())
 			{
+				const std::string stKeyString(stKey);
 				TraceError("CTextFileLoader::LoadGroup : must have a value (filename: %s line: %d key: %s)",
 							m_strFileName.c_str(),
 							m_dwcurLineIndex,
-							key.c_str());
+							stKeyString.c_str());
 				break;
 			}
 
-			stTokenVector.erase(stTokenVector.begin());
-			pGroupNode->InsertTokenVector(key, stTokenVector);
-			//pGroupNode->LocalTokenVectorMap.insert(std::make_pair(key, stTokenVector));
+			TToken kToken = {};
+			kToken.dwKey = __GenLowerKey(stKey);
+			kToken.dwValueCount = DWORD(m_kVct_kLineToken.size() - 1);
+			kToken.pValues = m_kArena.NewArray<std::string_view>(kToken.dwValueCount);
+			std::copy(m_kVct_kLineToken.begin() + 1, m_kVct_kLineToken.end(), const_cast<std::string_view *>(kToken.pValues));
+			m_kVct_kPendingToken.push_back(kToken);
 		}
 	}
 
-	return (nLocalGroupDepth == 0);
+	__FinishGroup(pGroupNode, uTokenBase, uChildBase);
+
+	return bRet && (nLocalGroupDepth == 0);
 }
 
 void CTextFileLoader::SetTop()
@@ -325,7 +615,7 @@ DWORD CTextFileLoader::GetChildNodeCount()
 		return 0;
 	}
 
-	return m_pcurNode->ChildNodeVector.size();
+	return m_pcurNode->dwChildNodeCount;
 }
 
 BOOL CTextFileLoader::SetChildNode(const char * c_szKey)
@@ -338,9 +628,9 @@ BOOL CTextFileLoader::SetChildNode(const char * c_szKey)
 
 	DWORD dwKey=SGroupNode::GenNameKey(c_szKey, strlen(c_szKey));
 
-	for (DWORD i = 0; i < m_pcurNode->ChildNodeVector.size(); ++i)
+	for (DWORD i = 0; i < m_pcurNode->dwChildNodeCount; ++i)
 	{
-		TGroupNode * pGroupNode = m_pcurNode->ChildNodeVector[i];
+		TGroupNode * pGroupNode = m_pcurNode->ppChildNodes[i];
 		if (pGroupNode->IsGroupNameKey(dwKey))
 		{
 			m_pcurNode = pGroupNode;
@@ -365,13 +655,13 @@ BOOL CTextFileLoader::SetChildNode(DWORD dwIndex)
 		return FALSE;
 	}
 
-	if (dwIndex >= m_pcurNode->ChildNodeVector.size())
+	if (dwIndex >= m_pcurNode->dwChildNodeCount)
 	{
 		assert(!"Node index to set is too large to access!");
 		return FALSE;
 	}
 
-	m_pcurNode = m_pcurNode->ChildNodeVector[dwIndex];
+	m_pcurNode = m_pcurNode->ppChildNodes[dwIndex];
 
 	return TRUE;
 }
@@ -402,113 +692,100 @@ BOOL CTextFileLoader::GetCurrentNodeName(std::string * pstrName)
 	if (NULL == m_pcurNode->pParentNode)
 		return FALSE;
 
-	*pstrName = m_pcurNode->GetGroupName();
+	pstrName->assign(m_pcurNode->GetGroupName());
 
 	return TRUE;
 }
 
-BOOL CTextFileLoader::IsToken(const std::string & c_rstrKey)
+const CTextFileLoader::TToken* CTextFileLoader::__FindToken(const std::string & c_rstrKey)
 {
 	if (!m_pcurNode)
 	{
 		assert(!"Node to access has not set!");
-		return FALSE;
+		return NULL;
 	}
 
-	return m_pcurNode->IsExistTokenVector(c_rstrKey);
-	//return m_pcurNode->LocalTokenVectorMap.end() != m_pcurNode->LocalTokenVectorMap.find(c_rstrKey);
+	return m_pcurNode->FindToken(SGroupNode::GenNameKey(c_rstrKey.c_str(), c_rstrKey.length()));
 }
 
-BOOL CTextFileLoader::GetTokenVector(const std::string & c_rstrKey, CTokenVector ** ppTokenVector)
+const CTextFileLoader::TToken* CTextFileLoader::__FindValues(const std::string & c_rstrKey, DWORD dwMinCount, DWORD dwMaxCount)
 {
-	if (!m_pcurNode)
-	{
-		assert(!"Node to access has not set!");
-		return FALSE;
-	}
+	const TToken* c_pToken = __FindToken(c_rstrKey);
+	if (!c_pToken)
+		return NULL;
 
-	CTokenVector* pkRetTokenVector=m_pcurNode->GetTokenVector(c_rstrKey);
-	if (!pkRetTokenVector)
-		return FALSE;
+	if (c_pToken->dwValueCount < dwMinCount || c_pToken->dwValueCount > dwMaxCount)
+		return NULL;
+
+	return c_pToken;
+}
+
+BOOL CTextFileLoader::IsToken(const std::string & c_rstrKey)
+{
+	return NULL != __FindToken(c_rstrKey);
+}
 
-	*ppTokenVector = pkRetTokenVector;
+BOOL CTextFileLoader::GetTokenVector(const std::string & c_rstrKey, CTokenVector ** ppTokenVector)
+{
+	TToken* pToken = const_cast<TToken*>(__FindToken(c_rstrKey));
+	if (!pToken)
+		return FALSE;
 
-	//CTokenVectorMap::iterator itor = m_pcurNode->LocalTokenVectorMap.find(c_rstrKey);
-	//if (m_pcurNode->LocalTokenVectorMap.end() == itor)
-	//{
-		//Tracef(" CTextFileLoader::GetTokenVector - Failed to find the key %s [%s :: %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-	//	return FALSE;
-	//}
+	// Copied out of the file only for callers that want the whole list as strings
+	if (!pToken->pkVector)
+	{
+		CTokenVector & rkTokenVector = m_kDeq_kTokenVector.emplace_back();
+		rkTokenVector.reserve(pToken->dwValueCount);
+		for (DWORD i = 0; i < pToken->dwValueCount; ++i)
+			rkTokenVector.emplace_back(pToken->pValues[i]);
 
-	//*ppTokenVector = &itor->second;
+		pToken->pkVector = &rkTokenVector;
+	}
 
+	*ppTokenVector = pToken->pkVector;
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenBoolean(const std::string & c_rstrKey, BOOL * pData)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenBoolean - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pData = BOOL(atoi(pTokenVector->at(0).c_str()));
+	*pData = BOOL(TokenToInteger(c_pToken->pValues[0]));
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenByte(const std::string & c_rstrKey, BYTE * pData)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenByte - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pData = BYTE(atoi(pTokenVector->at(0).c_str()));
+	*pData = BYTE(TokenToInteger(c_pToken->pValues[0]));
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenWord(const std::string & c_rstrKey, WORD * pData)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenWord - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pData = WORD(atoi(pTokenVector->at(0).c_str()));
+	*pData = WORD(TokenToInteger(c_pToken->pValues[0]));
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenInteger(const std::string & c_rstrKey, int * pData)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenInteger - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pData = atoi(pTokenVector->at(0).c_str());
+	*pData = TokenToInteger(c_pToken->pValues[0]);
 
 	return TRUE;
 }
@@ -520,74 +797,50 @@ BOOL CTextFileLoader::GetTokenDoubleWord(const std::string & c_rstrKey, DWORD *
 
 BOOL CTextFileLoader::GetTokenFloat(const std::string & c_rstrKey, float * pData)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenFloat - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pData = atof(pTokenVector->at(0).c_str());
+	*pData = TokenToFloat(c_pToken->pValues[0]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenVector2(const std::string & c_rstrKey, D3DXVECTOR2 * pVector2)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 2, 2);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->size() != 2)
-	{
-		//Tracef(" CTextFileLoader::GetTokenVector2 - This key should have 2 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	pVector2->x = atof(pTokenVector->at(0).c_str());
-	pVector2->y = atof(pTokenVector->at(1).c_str());
+	pVector2->x = TokenToFloat(c_pToken->pValues[0]);
+	pVector2->y = TokenToFloat(c_pToken->pValues[1]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenVector3(const std::string & c_rstrKey, D3DXVECTOR3 * pVector3)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 3, 3);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->size() != 3)
-	{
-		//Tracef(" CTextFileLoader::GetTokenVector3 - This key should have 3 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	pVector3->x = atof(pTokenVector->at(0).c_str());
-	pVector3->y = atof(pTokenVector->at(1).c_str());
-	pVector3->z = atof(pTokenVector->at(2).c_str());
+	pVector3->x = TokenToFloat(c_pToken->pValues[0]);
+	pVector3->y = TokenToFloat(c_pToken->pValues[1]);
+	pVector3->z = TokenToFloat(c_pToken->pValues[2]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenVector4(const std::string & c_rstrKey, D3DXVECTOR4 * pVector4)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 4, 4);
+	if (!c_pToken)
 		return FALSE;
-	
-	if (pTokenVector->size() != 4)
-	{
-		//Tracef(" CTextFileLoader::GetTokenVector3 - This key should have 3 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-	
-	pVector4->x = atof(pTokenVector->at(0).c_str());
-	pVector4->y = atof(pTokenVector->at(1).c_str());
-	pVector4->z = atof(pTokenVector->at(2).c_str());
-	pVector4->w = atof(pTokenVector->at(3).c_str());
+
+	pVector4->x = TokenToFloat(c_pToken->pValues[0]);
+	pVector4->y = TokenToFloat(c_pToken->pValues[1]);
+	pVector4->z = TokenToFloat(c_pToken->pValues[2]);
+	pVector4->w = TokenToFloat(c_pToken->pValues[3]);
 	
 	return TRUE;
 }
@@ -600,96 +853,66 @@ BOOL CTextFileLoader::GetTokenPosition(const std::string & c_rstrKey, D3DXVECTOR
 
 BOOL CTextFileLoader::GetTokenQuaternion(const std::string & c_rstrKey, D3DXQUATERNION * pQ)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
-		return FALSE;
-	
-	if (pTokenVector->size() != 4)
-	{
-		//Tracef(" CTextFileLoader::GetTokenVector3 - This key should have 3 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
+	const TToken* c_pToken = __FindValues(c_rstrKey, 4, 4);
+	if (!c_pToken)
 		return FALSE;
-	}
-	
-	pQ->x = atof(pTokenVector->at(0).c_str());
-	pQ->y = atof(pTokenVector->at(1).c_str());
-	pQ->z = atof(pTokenVector->at(2).c_str());
-	pQ->w = atof(pTokenVector->at(3).c_str());
+
+	pQ->x = TokenToFloat(c_pToken->pValues[0]);
+	pQ->y = TokenToFloat(c_pToken->pValues[1]);
+	pQ->z = TokenToFloat(c_pToken->pValues[2]);
+	pQ->w = TokenToFloat(c_pToken->pValues[3]);
 	
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenDirection(const std::string & c_rstrKey, D3DVECTOR * pVector)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 3, 3);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->size() != 3)
-	{
-		//Tracef(" CTextFileLoader::GetTokenDirection - This key should have 3 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	pVector->x = atof(pTokenVector->at(0).c_str());
-	pVector->y = atof(pTokenVector->at(1).c_str());
-	pVector->z = atof(pTokenVector->at(2).c_str());
+	pVector->x = TokenToFloat(c_pToken->pValues[0]);
+	pVector->y = TokenToFloat(c_pToken->pValues[1]);
+	pVector->z = TokenToFloat(c_pToken->pValues[2]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenColor(const std::string & c_rstrKey, D3DXCOLOR * pColor)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 4, 4);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->size() != 4)
-	{
-		//Tracef(" CTextFileLoader::GetTokenColor - This key should have 4 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	pColor->r = atof(pTokenVector->at(0).c_str());
-	pColor->g = atof(pTokenVector->at(1).c_str());
-	pColor->b = atof(pTokenVector->at(2).c_str());
-	pColor->a = atof(pTokenVector->at(3).c_str());
+	pColor->r = TokenToFloat(c_pToken->pValues[0]);
+	pColor->g = TokenToFloat(c_pToken->pValues[1]);
+	pColor->b = TokenToFloat(c_pToken->pValues[2]);
+	pColor->a = TokenToFloat(c_pToken->pValues[3]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenColor(const std::string & c_rstrKey, D3DCOLORVALUE * pColor)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 4, 4);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->size() != 4)
-	{
-		//Tracef(" CTextFileLoader::GetTokenColor - This key should have 4 values %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	pColor->r = atof(pTokenVector->at(0).c_str());
-	pColor->g = atof(pTokenVector->at(1).c_str());
-	pColor->b = atof(pTokenVector->at(2).c_str());
-	pColor->a = atof(pTokenVector->at(3).c_str());
+	pColor->r = TokenToFloat(c_pToken->pValues[0]);
+	pColor->g = TokenToFloat(c_pToken->pValues[1]);
+	pColor->b = TokenToFloat(c_pToken->pValues[2]);
+	pColor->a = TokenToFloat(c_pToken->pValues[3]);
 
 	return TRUE;
 }
 
 BOOL CTextFileLoader::GetTokenString(const std::string & c_rstrKey, std::string * pString)
 {
-	CTokenVector * pTokenVector;
-	if (!GetTokenVector(c_rstrKey, &pTokenVector))
+	const TToken* c_pToken = __FindValues(c_rstrKey, 1, UINT_MAX);
+	if (!c_pToken)
 		return FALSE;
 
-	if (pTokenVector->empty())
-	{
-		//Tracef(" CTextFileLoader::GetTokenString - Failed to find the value %s [%s : %s]\n", m_File.GetFileName(), m_pcurNode->strGroupName.c_str(), c_rstrKey.c_str());
-		return FALSE;
-	}
-
-	*pString = pTokenVector->at(0);
+	pString->assign(c_pToken->pValues[0]);
 
 	return TRUE;
 }
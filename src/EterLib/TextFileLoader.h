@@ -4,40 +4,52 @@
 #include "EterBase/FileLoader.h"
 #include "EterLib/Util.h"
 #include "EterLib/Pool.h"
+#include "PackLib/Pack.h"
 
+#include <atomic>
+#include <deque>
+#include <string_view>
+
+// Parses group scripts (.msm/.msa/.mse/.prt/...) in place: tokens are string_views into the
+// file bytes, and nodes and token lists live in a per-file arena. Token lists are only copied
+// into a CTokenVector when GetTokenVector asks for one.
+// A compiled copy of the script (PackMaker --compile-scripts) is used instead of the text
+// when the packs have one, the nodes then point straight into it.
 class CTextFileLoader
 {
 	public:
+		typedef struct SToken
+		{
+			DWORD dwKey;					// GenNameKey of the lowercased key
+			DWORD dwValueCount;
+			const std::string_view* pValues;
+			CTokenVector* pkVector;			// materialized by GetTokenVector
+		} TToken;
+
 		typedef struct SGroupNode
 		{
 			static DWORD GenNameKey(const char* c_szGroupName, UINT uGroupNameLen);
 
-			void SetGroupName(const std::string& c_rstGroupName);
 			bool IsGroupNameKey(DWORD dwGroupNameKey);
 
-			const std::string& GetGroupName();
+			const std::string_view& GetGroupName();
 
-			CTokenVector* GetTokenVector(const std::string& c_rstGroupName);
-			bool IsExistTokenVector(const std::string& c_rstGroupName);
-			void InsertTokenVector(const std::string& c_rstGroupName, const CTokenVector& c_rkVct_stToken);
+			TToken* FindToken(DWORD dwKey);
 
 			DWORD m_dwGroupNameKey;
-			std::string m_strGroupName;
+			std::string_view m_strGroupName;
 
-			std::map<DWORD, CTokenVector> m_kMap_dwKey_kVct_stToken;
+			// Open addressing table over m_pTokens, slots hold index + 1
+			TToken* m_pTokens;
+			DWORD m_dwTokenCount;
+			DWORD* m_pTokenSlots;
+			DWORD m_dwTokenSlotMask;
 
 			SGroupNode * pParentNode;
-			std::vector<SGroupNode*> ChildNodeVector;
-
-			static SGroupNode* New();
-			static void Delete(SGroupNode* pkNode);
-
-			static void DestroySystem();
-			static CDynamicPool<SGroupNode>	ms_kPool;
+			SGroupNode ** ppChildNodes;
+			DWORD dwChildNodeCount;
 		} TGroupNode;
 
-		typedef std::vector<TGroupNode*> TGroupNodeVector;
-
 		class CGotoChild
 		{
 		public:
@@ -64,6 +76,10 @@ class CTextFileLoader
 
 		static CTextFileLoader* Cache(const char* c_szFileName);
 
+		// Script load times since the last report, compiled and text scripts counted apart
+		static void AddLoadStats(bool isCompiled, uint64_t uMicroSec);
+		static void TraceLoadStats(const char * c_szWhen);
+
 	public:
 		CTextFileLoader();
 		virtual ~CTextFileLoader();
@@ -71,6 +87,8 @@ class CTextFileLoader
 		void Destroy();
 
 		bool Load(const char * c_szFileName);
+		// Parses bytes that stay alive and unchanged as long as this loader uses them
+		bool LoadFromMemory(const char * c_szFileName, const void * c_pvData, size_t uSize);
 		const char * GetFileName();
 
 		bool IsEmpty();
@@ -103,29 +121,53 @@ class CTextFileLoader
 		BOOL GetTokenString(const std::string & c_rstrKey, std::string * pString);
 
 	protected:
-		void __DestroyGroupNodeVector();
+		struct SLine
+		{
+			const char* pBegin;
+			const char* pEnd;
+		};
+
+		bool __LoadCompiled(const char * c_szFileName);
+		void __SplitLines();
+		int __SplitLine(DWORD dwLine);
+		const TToken* __FindToken(const std::string & c_rstrKey);
+		const TToken* __FindValues(const std::string & c_rstrKey, DWORD dwMinCount, DWORD dwMaxCount);
+		DWORD __GenLowerKey(const std::string_view& c_rstKey);
+		std::string_view __StoreLower(const std::string_view& c_rstText);
+		void __FinishGroup(TGroupNode * pGroupNode, size_t uTokenBase, size_t uChildBase);
 
 		bool LoadGroup(TGroupNode * pGroupNode);
 
 	protected:
 		std::string					m_strFileName;
 
-		char*						m_acBufData;
-		DWORD						m_dwBufSize;
-		DWORD						m_dwBufCapacity;
+		CPackFileView				m_kFile;
+		const char*					m_pcData;
+		size_t						m_uDataSize;
 
+		std::vector<SLine>			m_kVct_kLine;
 		DWORD						m_dwcurLineIndex;
 
-		CMemoryTextFileLoader		m_textFileLoader;
+		CLinearArena				m_kArena;
+
+		// Parse scratch, reused between lines and files
+		std::vector<std::string_view>	m_kVct_kLineToken;
+		std::vector<std::string_view>	m_kVct_kValue;
+		std::vector<TToken>			m_kVct_kPendingToken;
+		std::vector<TGroupNode*>	m_kVct_pkPendingChild;
+		std::string					m_stLowerKey;
+
+		std::deque<CTokenVector>	m_kDeq_kTokenVector;
 
 		TGroupNode					m_GlobalNode;
 		TGroupNode *				m_pcurNode;
 
-		std::vector<SGroupNode*>	m_kVct_pkNode;
-
 	protected:
 		static std::map<DWORD, CTextFileLoader*> ms_kMap_dwNameKey_pkTextFileLoader;
 		static bool ms_isCacheMode;
+
+		static std::atomic<uint32_t> ms_auLoadCount[2];
+		static std::atomic<uint64_t> ms_auLoadMicroSec[2];
 };
 
 #endif
\ No newline at end of file
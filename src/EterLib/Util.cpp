@@ -1,6 +1,9 @@
 #include "StdAfx.h"
 #include "TextFileLoader.h"
 #include "PackLib/PackManager.h"
+#include "PackLib/ScriptBinary.h"
+
+#include <chrono>
 
 void PrintfTabs(FILE * File, int iTabCount, const char * c_szString, ...)
 {
@@ -46,8 +49,46 @@ bool LoadTextData(const char * c_szFileName, CTokenMap & rstTokenMap)
 	return true;
 }
 
+// Fills the map from "<file>.tsb" when the pack that provides the file has a compiled copy of it
+static bool LoadCompiledMultipleTextData(const char * c_szFileName, CTokenVectorMap & rstTokenVectorMap)
+{
+	CPackFileView kFile;
+	if (!CPackManager::Instance().GetCompiledFileView(c_szFileName, kFile))
+		return false;
+
+	CScriptBinaryView kView;
+	if (!kView.Open(kFile.data(), kFile.size(), SCRIPT_BINARY_TOKEN_MAP))
+	{
+		TraceError("LoadMultipleTextData - broken compiled script %s%s, using the text", c_szFileName, SCRIPT_BINARY_SUFFIX.data());
+		return false;
+	}
+
+	const TScriptBinaryNode & c_rkRoot = kView.GetNode(0);
+	for (DWORD i = 0; i < c_rkRoot.token_count; ++i)
+	{
+		const TScriptBinaryToken & c_rkToken = kView.GetToken(c_rkRoot.first_token + i);
+
+		CTokenVector stTokenVector;
+		stTokenVector.reserve(c_rkToken.value_count);
+		for (DWORD j = 0; j < c_rkToken.value_count; ++j)
+			stTokenVector.emplace_back(kView.GetValue(c_rkToken.first_value + j));
+
+		rstTokenVectorMap.insert(CTokenVectorMap::value_type(std::string(kView.GetString(c_rkToken.name)), std::move(stTokenVector)));
+	}
+
+	return true;
+}
+
 bool LoadMultipleTextData(const char * c_szFileName, CTokenVectorMap & rstTokenVectorMap)
 {
+	const auto c_tStart = std::chrono::steady_clock::now();
+
+	if (LoadCompiledMultipleTextData(c_szFileName, rstTokenVectorMap))
+	{
+		CTextFileLoader::AddLoadStats(true, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c_tStart).count());
+		return true;
+	}
+
 	TPackFile File;
 
 	if (!CPackManager::Instance().GetFile(c_szFileName, File))
@@ -104,6 +145,7 @@ bool LoadMultipleTextData(const char * c_szFileName, CTokenVectorMap & rstTokenV
 		}
 	}
 
+	CTextFileLoader::AddLoadStats(false, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c_tStart).count());
 	return true;
 }
 
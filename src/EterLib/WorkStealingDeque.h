@@ -0,0 +1,137 @@
+#ifndef __INC_ETERLIB_WORKSTEALINGDEQUE_H__
+#define __INC_ETERLIB_WORKSTEALINGDEQUE_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, any thread may steal from the top.
+// T must be trivially copyable (the pool stores task node pointers). The ring grows on demand,
+// replaced rings stay alive until the deque is destroyed because thieves may still read them.
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	explicit WorkStealingDeque(size_t capacity = 256)
+		: m_top(0)
+		, m_bottom(0)
+	{
+		assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+		m_rings.push_back(std::make_unique<TRing>(static_cast<int64_t>(capacity)));
+		m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+	}
+
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	// Owner only
+	void Push(T item)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_top.load(std::memory_order_acquire);
+		TRing* ring = m_ring.load(std::memory_order_relaxed);
+
+		if (bottom - top > ring->capacity - 1)
+			ring = Grow(ring, bottom, top);
+
+		ring->Put(bottom, item);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// Owner only, newest item first
+	bool Pop(T& item)
+	{
+		const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		TRing* ring = m_ring.load(std::memory_order_relaxed);
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		item = ring->Get(bottom);
+		if (top == bottom)
+		{
+			// Last item, race the thieves for it
+			const bool bWon = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return bWon;
+		}
+
+		return true;
+	}
+
+	// Any thread, oldest item first
+	bool Steal(T& item)
+	{
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom)
+			return false;
+
+		TRing* ring = m_ring.load(std::memory_order_acquire);
+		T stolen = ring->Get(top);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return false;
+
+		item = stolen;
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_bottom.load(std::memory_order_acquire) <= m_top.load(std::memory_order_acquire);
+	}
+
+	size_t Size() const
+	{
+		const int64_t size = m_bottom.load(std::memory_order_acquire) - m_top.load(std::memory_order_acquire);
+		return size > 0 ? static_cast<size_t>(size) : 0;
+	}
+
+private:
+	struct TRing
+	{
+		const int64_t capacity;
+		const int64_t mask;
+		std::unique_ptr<std::atomic<T>[]> items;
+
+		explicit TRing(int64_t c)
+			: capacity(c)
+			, mask(c - 1)
+			, items(new std::atomic<T>[static_cast<size_t>(c)])
+		{
+		}
+
+		T Get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+		void Put(int64_t i, T item) { items[i & mask].store(item, std::memory_order_relaxed); }
+	};
+
+	TRing* Grow(TRing* ring, int64_t bottom, int64_t top)
+	{
+		auto grown = std::make_unique<TRing>(ring->capacity * 2);
+		for (int64_t i = top; i < bottom; ++i)
+			grown->Put(i, ring->Get(i));
+
+		TRing* pGrown = grown.get();
+		m_rings.push_back(std::move(grown));
+		m_ring.store(pGrown, std::memory_order_release);
+		return pGrown;
+	}
+
+	alignas(64) std::atomic<int64_t> m_top;
+	alignas(64) std::atomic<int64_t> m_bottom;
+	alignas(64) std::atomic<TRing*> m_ring;
+	std::vector<std::unique_ptr<TRing>> m_rings; // owner only
+};
+
+#endif // __INC_ETERLIB_WORKSTEALINGDEQUE_H__
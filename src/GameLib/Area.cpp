@@ -427,6 +427,18 @@ void CArea::Refresh()
 
 void CArea::__Load_BuildObjectInstances()
 {
+	// If data is not inside property, then delete it. Checked here rather than while reading
+	// the object lists, those run on a loader thread and the property manager is not locked.
+	m_ObjectDataVector.erase(std::remove_if(m_ObjectDataVector.begin(), m_ObjectDataVector.end(), [](const TObjectData & c_rData)
+	{
+		CProperty * pProperty;
+		if (CPropertyManager::Instance().Get(c_rData.dwCRC, &pProperty))
+			return false;
+
+		TraceError(" CArea::BuildObjectInstances Property(%u) Load ERROR", c_rData.dwCRC);
+		return true;
+	}), m_ObjectDataVector.end());
+
 	m_ObjectInstanceVector.clear();
 	m_ObjectInstanceVector.resize(GetObjectDataCount());
 
@@ -742,16 +754,28 @@ bool CArea::Load(const char * c_szPathName)
 {
 	Clear();
 
+	LoadObjectData(c_szPathName);
+	BuildObjectInstances();
+	
+	return true;
+}
+
+bool CArea::LoadObjectData(const char * c_szPathName)
+{
 	std::string strObjectDataFileName = c_szPathName + std::string("AreaData.txt");
 	std::string strAmbienceDataFileName = c_szPathName + std::string("AreaAmbienceData.txt");
 
 	__Load_LoadObject(strObjectDataFileName.c_str());
 	__Load_LoadAmbience(strAmbienceDataFileName.c_str());
-	__Load_BuildObjectInstances();
-	
+
 	return true;
 }
 
+void CArea::BuildObjectInstances()
+{
+	__Load_BuildObjectInstances();
+}
+
 bool CArea::__Load_LoadObject(const char * c_szFileName)
 {
 	CTokenVectorMap stTokenVectorMap;
@@ -836,14 +860,7 @@ bool CArea::__Load_LoadObject(const char * c_szFileName)
 			}
 		}
 
-		// If data is not inside property, then delete it.
-		CProperty * pProperty;
-		if (!CPropertyManager::Instance().Get(ObjectData.dwCRC, &pProperty))
-		{
-			TraceError(" CArea::LoadObject Property(%u) Load ERROR", ObjectData.dwCRC);
-			continue;
-		}
-
+		// Objects without a property are dropped in __Load_BuildObjectInstances
 		m_ObjectDataVector.push_back(ObjectData);
 	}
 
@@ -912,14 +929,7 @@ bool CArea::__Load_LoadAmbience(const char * c_szFileName)
 			ObjectData.fMaxVolumeAreaPercentage = atof(c_rstrPercentage.c_str());
 		}
 
-		// If data is not inside property, then delete it.
-		CProperty * pProperty;
-		if (!CPropertyManager::Instance().Get(ObjectData.dwCRC, &pProperty))
-		{
-			TraceError(" CArea::LoadAmbience Property(%d) Load ERROR", ObjectData.dwCRC);
-			continue;
-		}
-
+		// Objects without a property are dropped in __Load_BuildObjectInstances
 		m_ObjectDataVector.push_back(ObjectData);
 	}
 
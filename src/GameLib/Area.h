@@ -204,6 +204,11 @@ class CArea
 
 		bool			Load(const char * c_szPathName);
 
+		// Load in two steps for streaming: the object lists are read on any thread into a
+		// cleared area, the instances are built on the render thread
+		bool			LoadObjectData(const char * c_szPathName);
+		void			BuildObjectInstances();
+
 		DWORD			GetObjectDataCount();
 		bool			GetObjectDataPointer(DWORD dwIndex, const TObjectData ** ppObjectData) const;
 
@@ -3,216 +3,254 @@
 //////////////////////////////////////////////////////////////////////
 
 #include "StdAfx.h"
-
-#include "EterLib/ResourceManager.h"
-#include "EterLib/GameThreadPool.h"
+#include "EterLib/Profiler.h"
 
 #include "AreaLoaderThread.h"
 #include "AreaTerrain.h"
+#include "Area.h"
 #include "MapOutdoor.h"
 
+bool CAreaLoaderThread::ms_isEnabled = true;
+UINT CAreaLoaderThread::ms_uSectorBudget = CAreaLoaderThread::DEFAULT_SECTOR_BUDGET;
+
+void CAreaLoaderThread::SetEnable(bool isEnable)
+{
+	ms_isEnabled = isEnable;
+}
+
+bool CAreaLoaderThread::IsEnabled()
+{
+	return ms_isEnabled;
+}
+
+void CAreaLoaderThread::SetSectorBudget(UINT uSectorCount)
+{
+	// Never less than the 3x3 the map keeps around the player
+	ms_uSectorBudget = std::max<UINT>(uSectorCount, (LOAD_SIZE_WIDTH * 2 + 1) * (LOAD_SIZE_WIDTH * 2 + 1));
+}
+
+UINT CAreaLoaderThread::GetSectorBudget()
+{
+	return ms_uSectorBudget;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
 
-TEMP_CAreaLoaderThread::TEMP_CAreaLoaderThread() : m_bShutdowned(false)
+CAreaLoaderThread::CAreaLoaderThread() : m_pOwner(NULL)
 {
-
 }
 
-TEMP_CAreaLoaderThread::~TEMP_CAreaLoaderThread()
+CAreaLoaderThread::~CAreaLoaderThread()
 {
 	Shutdown();
 }
 
-bool TEMP_CAreaLoaderThread::Create(void * arg)
+void CAreaLoaderThread::Initialize(CMapOutdoor * pOwner)
 {
-	// Modern implementation doesn't need explicit thread creation
-	// The global CGameThreadPool handles threading
-	m_bShutdowned = false;
-	return true;
+	m_pOwner = pOwner;
 }
 
-void TEMP_CAreaLoaderThread::Shutdown()
+void CAreaLoaderThread::Shutdown()
 {
-	m_bShutdowned = true;
-
-	// Clear any pending completed items
-	{
-		std::lock_guard<std::mutex> lock(m_TerrainCompleteMutex);
-		m_pTerrainCompleteDeque.clear();
-	}
+	for (auto & rkSector : m_kVct_pkSector)
+		__Free(*rkSector);
 
-	{
-		std::lock_guard<std::mutex> lock(m_AreaCompleteMutex);
-		m_pAreaCompleteDeque.clear();
-	}
+	m_kVct_pkSector.clear();
 }
 
-void TEMP_CAreaLoaderThread::Request(CTerrain * pTerrain)
+bool CAreaLoaderThread::Request(WORD wX, WORD wY)
 {
-	if (m_bShutdowned)
-		return;
+	if (!m_pOwner || __Find(wX, wY) != m_kVct_pkSector.end())
+		return false;
 
-	// Enqueue terrain loading to the global thread pool
-	CGameThreadPool* pThreadPool = CGameThreadPool::InstancePtr();
-	if (pThreadPool)
+	std::unique_ptr<SSector> pkSector(new SSector);
+	pkSector->wX = wX;
+	pkSector->wY = wY;
+	pkSector->isTerrainDecoded = false;
+	pkSector->isFinished = false;
+	pkSector->isTerrainTaken = false;
+	pkSector->isAreaTaken = false;
+
+	// Allocated here, the pools are not meant to be touched from the workers
+	pkSector->pTerrain = CTerrain::New();
+	pkSector->pTerrain->Clear();
+	pkSector->pTerrain->SetMapOutDoor(m_pOwner);
+	pkSector->pTerrain->SetCoordinate(wX, wY);
+
+	pkSector->pArea = CArea::New();
+	pkSector->pArea->SetMapOutDoor(m_pOwner);
+	pkSector->pArea->SetCoordinate(wX, wY);
+	pkSector->pArea->Clear();
+
+	SSector * pSector = pkSector.get();
+	CMapOutdoor * pOwner = m_pOwner;
+	m_kVct_pkSector.push_back(std::move(pkSector));
+
+	CGameThreadPool * pPool = CGameThreadPool::InstancePtr();
+	if (!pPool)
 	{
-		pThreadPool->Enqueue([this, pTerrain]()
-		{
-			ProcessTerrain(pTerrain);
-		});
+		pSector->isTerrainDecoded = pOwner->DecodeTerrain(pSector->pTerrain);
+		pOwner->DecodeArea(pSector->pArea);
+		return true;
 	}
-	else
+
+	pPool->Submit([pOwner, pSector]()
 	{
-		// Fallback to synchronous loading if thread pool not available
-		ProcessTerrain(pTerrain);
-	}
+		PROFILE_ZONE("Decode sector");
+		pSector->isTerrainDecoded = pOwner->DecodeTerrain(pSector->pTerrain);
+		pOwner->DecodeArea(pSector->pArea);
+	}, CGameThreadPool::PRIORITY_LOW, &pSector->kGroup);
+
+	return true;
 }
 
-bool TEMP_CAreaLoaderThread::Fetch(CTerrain ** ppTerrain)
+bool CAreaLoaderThread::IsRequested(WORD wX, WORD wY) const
 {
-	std::lock_guard<std::mutex> lock(m_TerrainCompleteMutex);
-
-	if (m_pTerrainCompleteDeque.empty())
-		return false;
-
-	*ppTerrain = m_pTerrainCompleteDeque.front();
-	m_pTerrainCompleteDeque.pop_front();
+	for (const auto & rkSector : m_kVct_pkSector)
+		if (rkSector->wX == wX && rkSector->wY == wY)
+			return true;
 
-	return true;
+	return false;
 }
 
-void TEMP_CAreaLoaderThread::Request(CArea * pArea)
+void CAreaLoaderThread::Publish()
 {
-	if (m_bShutdowned)
+	// One sector a frame, creating its textures and vertex buffers is what costs
+	for (auto & rkSector : m_kVct_pkSector)
+	{
+		if (rkSector->isFinished || !rkSector->kGroup.IsDone())
+			continue;
+
+		DWORD dwStartTime = ELTimer_GetMSec();
+		__Finish(*rkSector);
+		Tracef("CAreaLoaderThread::Publish (%d, %d) %d ms\n", rkSector->wX, rkSector->wY, ELTimer_GetMSec() - dwStartTime);
 		return;
+	}
+}
 
-	// Enqueue area loading to the global thread pool
-	CGameThreadPool* pThreadPool = CGameThreadPool::InstancePtr();
-	if (pThreadPool)
+void CAreaLoaderThread::Discard(short sCenterX, short sCenterY, short sRange)
+{
+	TSectorVector::iterator i = m_kVct_pkSector.begin();
+	while (i != m_kVct_pkSector.end())
 	{
-		pThreadPool->Enqueue([this, pArea]()
+		SSector & rSector = **i;
+		if (!rSector.isFinished
+			|| (abs(rSector.wX - sCenterX) <= sRange && abs(rSector.wY - sCenterY) <= sRange))
 		{
-			ProcessArea(pArea);
-		});
-	}
-	else
-	{
-		// Fallback to synchronous loading if thread pool not available
-		ProcessArea(pArea);
+			++i;
+			continue;
+		}
+
+		__Free(rSector);
+		i = m_kVct_pkSector.erase(i);
 	}
 }
 
-bool TEMP_CAreaLoaderThread::Fetch(CArea ** ppArea)
+bool CAreaLoaderThread::TakeTerrain(WORD wX, WORD wY, CTerrain ** ppTerrain)
 {
-	std::lock_guard<std::mutex> lock(m_AreaCompleteMutex);
-
-	if (m_pAreaCompleteDeque.empty())
+	TSectorVector::iterator i = __Find(wX, wY);
+	if (i == m_kVct_pkSector.end() || (*i)->isTerrainTaken)
 		return false;
 
-	*ppArea = m_pAreaCompleteDeque.front();
-	m_pAreaCompleteDeque.pop_front();
+	SSector & rSector = **i;
+	__Finish(rSector);
+
+	*ppTerrain = rSector.pTerrain;
+	rSector.pTerrain = NULL;
+	rSector.isTerrainTaken = true;
+
+	if (rSector.isAreaTaken)
+		m_kVct_pkSector.erase(i);
 
 	return true;
 }
 
-void TEMP_CAreaLoaderThread::ProcessArea(CArea * pArea)
+bool CAreaLoaderThread::TakeArea(WORD wX, WORD wY, CArea ** ppArea)
 {
-	if (m_bShutdowned)
-		return;
+	TSectorVector::iterator i = __Find(wX, wY);
+	if (i == m_kVct_pkSector.end() || (*i)->isAreaTaken)
+		return false;
 
-	DWORD dwStartTime = ELTimer_GetMSec();
+	SSector & rSector = **i;
+	__Finish(rSector);
 
-	// Area Load
-	WORD wAreaCoordX, wAreaCoordY;
-	pArea->GetCoordinate(&wAreaCoordX, &wAreaCoordY);
-	DWORD dwID = (DWORD) (wAreaCoordX) * 1000L + (DWORD) (wAreaCoordY);
+	*ppArea = rSector.pArea;
+	rSector.pArea = NULL;
+	rSector.isAreaTaken = true;
 
-	const std::string & c_rStrMapName = pArea->GetOwner()->GetName();
+	if (rSector.isTerrainTaken)
+		m_kVct_pkSector.erase(i);
 
-	char szAreaPathName[64+1];
-	_snprintf(szAreaPathName, sizeof(szAreaPathName), "%s\\%06u\\", c_rStrMapName.c_str(), dwID);
+	return true;
+}
 
-	pArea->Load(szAreaPathName);
+CAreaLoaderThread::TSectorVector::iterator CAreaLoaderThread::__Find(WORD wX, WORD wY)
+{
+	TSectorVector::iterator i;
+	for (i = m_kVct_pkSector.begin(); i != m_kVct_pkSector.end(); ++i)
+		if ((*i)->wX == wX && (*i)->wY == wY)
+			break;
 
-	Tracef("TEMP_CAreaLoaderThread::ProcessArea LoadArea : %d ms elapsed\n", ELTimer_GetMSec() - dwStartTime);
+	return i;
+}
+
+void CAreaLoaderThread::__Wait(SSector & rSector)
+{
+	CGameThreadPool * pPool = CGameThreadPool::InstancePtr();
+	if (!pPool)
+		return;
 
-	// Add to completed queue
+	// Returns at once for a decoded sector, but still reports what its task threw
+	try
 	{
-		std::lock_guard<std::mutex> lock(m_AreaCompleteMutex);
-		m_pAreaCompleteDeque.push_back(pArea);
+		pPool->WaitAll(rSector.kGroup);
+	}
+	catch (const std::exception & e)
+	{
+		TraceError("CAreaLoaderThread: sector (%d, %d) failed to decode: %s", rSector.wX, rSector.wY, e.what());
+		rSector.isTerrainDecoded = false;
 	}
 }
 
-void TEMP_CAreaLoaderThread::ProcessTerrain(CTerrain * pTerrain)
+void CAreaLoaderThread::__Finish(SSector & rSector)
 {
-	if (m_bShutdowned)
+	if (rSector.isFinished)
 		return;
 
-	DWORD dwStartTime = ELTimer_GetMSec();
-
-	// Terrain Load
-	WORD wCoordX, wCoordY;
-	pTerrain->GetCoordinate(&wCoordX, &wCoordY);
-	DWORD dwID = (DWORD) (wCoordX) * 1000L + (DWORD) (wCoordY);
+	__Wait(rSector);
 
-	const std::string & c_rStrMapName = pTerrain->GetOwner()->GetName();
-	char filename[256];
-	sprintf(filename, "%s\\%06u\\AreaProperty.txt", c_rStrMapName.c_str(), dwID);
+	// The part of a sector the render thread pays for, a hitch shows up as a long zone here
+	PROFILE_ZONE("Finish sector");
 
-	CTokenVectorMap stTokenVectorMap;
-
-	if (!LoadMultipleTextData(filename, stTokenVectorMap))
-		return;
-
-	if (stTokenVectorMap.end() == stTokenVectorMap.find("scripttype"))
-		return;
+	if (rSector.isTerrainDecoded)
+	{
+		m_pOwner->FinishTerrain(rSector.pTerrain);
+	}
+	else
+	{
+		CTerrain::Delete(rSector.pTerrain);
+		rSector.pTerrain = NULL;
+	}
 
-	if (stTokenVectorMap.end() == stTokenVectorMap.find("areaname"))
-		return;
+	m_pOwner->FinishArea(rSector.pArea);
+	rSector.isFinished = true;
+}
 
-	const std::string & c_rstrType = stTokenVectorMap["scripttype"][0];
-	const std::string & c_rstrAreaName = stTokenVectorMap["areaname"][0];
+void CAreaLoaderThread::__Free(SSector & rSector)
+{
+	__Wait(rSector);
 
-	if (c_rstrType != "AreaProperty")
-		return;
+	if (rSector.pTerrain)
+	{
+		CTerrain::Delete(rSector.pTerrain);
+		rSector.pTerrain = NULL;
+	}
 
-	char szRawHeightFieldname[64+1];
-	char szWaterMapName[64+1];
-	char szAttrMapName[64+1];
-	char szShadowTexName[64+1];
-	char szShadowMapName[64+1];
-	char szMiniMapTexName[64+1];
-	char szSplatName[64+1];
-
-	_snprintf(szRawHeightFieldname, sizeof(szRawHeightFieldname), "%s\\%06u\\height.raw", c_rStrMapName.c_str(), dwID);
-	_snprintf(szSplatName, sizeof(szSplatName), "%s\\%06u\\tile.raw", c_rStrMapName.c_str(), dwID);
-	_snprintf(szAttrMapName, sizeof(szAttrMapName), "%s\\%06u\\attr.atr", c_rStrMapName.c_str(), dwID);
-	_snprintf(szWaterMapName, sizeof(szWaterMapName), "%s\\%06u\\water.wtr", c_rStrMapName.c_str(), dwID);
-	_snprintf(szShadowTexName, sizeof(szShadowTexName), "%s\\%06u\\shadowmap.dds", c_rStrMapName.c_str(), dwID);
-	_snprintf(szShadowMapName, sizeof(szShadowMapName), "%s\\%06u\\shadowmap.raw", c_rStrMapName.c_str(), dwID);
-	_snprintf(szMiniMapTexName,	sizeof(szMiniMapTexName), "%s\\%06u\\minimap.dds", c_rStrMapName.c_str(), dwID);
-
-	pTerrain->CopySettingFromGlobalSetting();
-
-	pTerrain->LoadWaterMap(szWaterMapName);
-	pTerrain->LoadHeightMap(szRawHeightFieldname);
-	pTerrain->LoadAttrMap(szAttrMapName);
-	pTerrain->RAW_LoadTileMap(szSplatName, true);
-	pTerrain->LoadShadowTexture(szShadowTexName);
-	pTerrain->LoadShadowMap(szShadowMapName);
-	pTerrain->LoadMiniMapTexture(szMiniMapTexName);
-	pTerrain->SetName(c_rstrAreaName.c_str());
-	pTerrain->CalculateTerrainPatch();
-
-	pTerrain->SetReady();
-
-	Tracef("TEMP_CAreaLoaderThread::ProcessTerrain LoadTerrain : %d ms elapsed\n", ELTimer_GetMSec() - dwStartTime);
-
-	// Add to completed queue
+	if (rSector.pArea)
 	{
-		std::lock_guard<std::mutex> lock(m_TerrainCompleteMutex);
-		m_pTerrainCompleteDeque.push_back(pTerrain);
+		CArea::Delete(rSector.pArea);
+		rSector.pArea = NULL;
 	}
 }
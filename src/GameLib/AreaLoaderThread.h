@@ -4,37 +4,78 @@
 
 #pragma once
 
-#include <deque>
-#include <mutex>
+#include "EterLib/GameThreadPool.h"
+
+#include <memory>
+#include <vector>
 
 class CTerrain;
 class CArea;
+class CMapOutdoor;
 
-class TEMP_CAreaLoaderThread
+// Streams map sectors (a terrain and its area) in ahead of the player.
+// Request decodes the sector's files on CGameThreadPool, Publish creates the device
+// resources of one decoded sector per frame on the render thread, and
+// CMapOutdoor::LoadTerrain/LoadArea take the sector over once it comes into view.
+class CAreaLoaderThread
 {
 public:
-	TEMP_CAreaLoaderThread();
-	virtual ~TEMP_CAreaLoaderThread();
+	enum
+	{
+		DEFAULT_SECTOR_BUDGET = 25,	// sectors kept by the map plus the ones held here
+	};
+
+	static void					SetEnable(bool isEnable);
+	static bool					IsEnabled();
+	static void					SetSectorBudget(UINT uSectorCount);
+	static UINT					GetSectorBudget();
 
-	bool						Create(void * arg);
-	void						Shutdown();
+public:
+	CAreaLoaderThread();
+	~CAreaLoaderThread();
 
-	void						Request(CTerrain * pTerrain);
-	bool						Fetch(CTerrain ** ppTerrian);
+	void						Initialize(CMapOutdoor * pOwner);
+	void						Shutdown();	// waits for running decodes and frees every sector not taken
 
-	void						Request(CArea * pArea);
-	bool						Fetch(CArea ** ppArea);
+	bool						Request(WORD wX, WORD wY);
+	bool						IsRequested(WORD wX, WORD wY) const;
+	UINT						GetSectorCount() const { return m_kVct_pkSector.size(); }
 
-private:
-	void						ProcessTerrain(CTerrain * pTerrain);
-	void						ProcessArea(CArea * pArea);
+	// Render thread, once per frame
+	void						Publish();
+	// Frees the finished sectors farther than sRange from the center
+	void						Discard(short sCenterX, short sCenterY, short sRange);
+
+	// Waits for the sector if it is still decoding. False if it was never requested,
+	// a NULL terrain means its files could not be loaded.
+	bool						TakeTerrain(WORD wX, WORD wY, CTerrain ** ppTerrain);
+	bool						TakeArea(WORD wX, WORD wY, CArea ** ppArea);
 
 private:
-	std::deque<CTerrain *>		m_pTerrainCompleteDeque;
-	std::mutex					m_TerrainCompleteMutex;
+	struct SSector
+	{
+		WORD				wX;
+		WORD				wY;
+		CTerrain *			pTerrain;
+		CArea *				pArea;
+		bool				isTerrainDecoded;	// written by the worker
+		bool				isFinished;
+		bool				isTerrainTaken;
+		bool				isAreaTaken;
+		CGameTaskGroup		kGroup;
+	};
+
+	typedef std::vector<std::unique_ptr<SSector> > TSectorVector;
 
-	std::deque<CArea *>			m_pAreaCompleteDeque;
-	std::mutex					m_AreaCompleteMutex;
+	TSectorVector::iterator		__Find(WORD wX, WORD wY);
+	void						__Wait(SSector & rSector);
+	void						__Finish(SSector & rSector);
+	void						__Free(SSector & rSector);
+
+private:
+	CMapOutdoor *				m_pOwner;
+	TSectorVector				m_kVct_pkSector;
 
-	bool						m_bShutdowned;
+	static bool					ms_isEnabled;
+	static UINT					ms_uSectorBudget;
 };
@@ -8,6 +8,8 @@
 #include "AreaTerrain.h"
 #include "MapOutdoor.h"
 
+#include <array>
+
 CDynamicPool<CTerrain>		CTerrain::ms_kPool;
 
 void CTerrain::DestroySystem()
@@ -48,6 +50,7 @@ void CTerrain::SetMapOutDoor(CMapOutdoor * pOwnerOutdoorMap)
 void CTerrain::Clear()
 {
 	DeallocateMarkedSplats();
+	m_kVct_wHeightMax.clear();
 	CTerrainImpl::Clear();
   	Initialize();
 }
@@ -432,6 +435,225 @@ float CTerrain::GetHeight(int x, int y)
 	return (h1 + (xdist * xslope + ydist * yslope));
 }
 
+namespace
+{
+	constexpr UINT HEIGHT_MAX_TREE_LEVELS = 8;	// XSIZE = 128 cells down to 1
+
+	// Where each level of the max quadtree starts, the last entry is its size
+	constexpr std::array<UINT, HEIGHT_MAX_TREE_LEVELS + 1> MakeHeightMaxLevelOffsets()
+	{
+		std::array<UINT, HEIGHT_MAX_TREE_LEVELS + 1> auOffset{};
+		for (UINT k = 0; k < HEIGHT_MAX_TREE_LEVELS; ++k)
+			auOffset[k + 1] = auOffset[k] + (CTerrainImpl::XSIZE >> k) * (CTerrainImpl::YSIZE >> k);
+		return auOffset;
+	}
+
+	constexpr std::array<UINT, HEIGHT_MAX_TREE_LEVELS + 1> HEIGHT_MAX_LEVEL_OFFSET = MakeHeightMaxLevelOffsets();
+
+	static_assert((CTerrainImpl::XSIZE >> (HEIGHT_MAX_TREE_LEVELS - 1)) == 1 && CTerrainImpl::XSIZE == CTerrainImpl::YSIZE,
+		"the max quadtree needs a square power of two terrain");
+
+	// Clips [fTMin, fTMax] to where the ray is within [fMin, fMax] on one axis
+	bool ClipRayAxis(float fStart, float fDir, float fMin, float fMax, float & fTMin, float & fTMax)
+	{
+		if (0.0f == fDir)
+			return fStart >= fMin && fStart <= fMax;
+
+		float fT0 = (fMin - fStart) / fDir;
+		float fT1 = (fMax - fStart) / fDir;
+		if (fT0 > fT1)
+			std::swap(fT0, fT1);
+
+		fTMin = std::max(fTMin, fT0);
+		fTMax = std::min(fTMax, fT1);
+		return fTMin <= fTMax;
+	}
+
+	// Clips to the column of a square under fTop. It has no floor, the terrain is solid.
+	bool ClipRayColumn(const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fMinX, float fMinY, float fSize, float fTop, float & fTMin, float & fTMax)
+	{
+		if (!ClipRayAxis(c_rv3Start.x, c_rv3Dir.x, fMinX, fMinX + fSize, fTMin, fTMax))
+			return false;
+
+		if (!ClipRayAxis(c_rv3Start.y, c_rv3Dir.y, fMinY, fMinY + fSize, fTMin, fTMax))
+			return false;
+
+		if (0.0f == c_rv3Dir.z)
+			return c_rv3Start.z <= fTop;
+
+		const float fT = (fTop - c_rv3Start.z) / c_rv3Dir.z;
+		if (c_rv3Dir.z > 0.0f)
+			fTMax = std::min(fTMax, fT);
+		else
+			fTMin = std::max(fTMin, fT);
+
+		return fTMin <= fTMax;
+	}
+}
+
+void CTerrain::__BuildHeightMaxTree()
+{
+	m_kVct_wHeightMax.resize(HEIGHT_MAX_LEVEL_OFFSET[HEIGHT_MAX_TREE_LEVELS]);
+
+	WORD * pwCell = &m_kVct_wHeightMax[0];
+	for (short y = 0; y < YSIZE; ++y)
+	{
+		for (short x = 0; x < XSIZE; ++x)
+		{
+			*pwCell++ = std::max(std::max(GetHeightMapValue(x, y), GetHeightMapValue(x + 1, y)),
+								 std::max(GetHeightMapValue(x, y + 1), GetHeightMapValue(x + 1, y + 1)));
+		}
+	}
+
+	for (UINT uLevel = 1; uLevel < HEIGHT_MAX_TREE_LEVELS; ++uLevel)
+	{
+		const UINT uChildSize = XSIZE >> (uLevel - 1);
+		const WORD * c_pwChild = &m_kVct_wHeightMax[HEIGHT_MAX_LEVEL_OFFSET[uLevel - 1]];
+		WORD * pwNode = &m_kVct_wHeightMax[HEIGHT_MAX_LEVEL_OFFSET[uLevel]];
+
+		for (UINT y = 0; y < uChildSize; y += 2)
+		{
+			for (UINT x = 0; x < uChildSize; x += 2)
+			{
+				const WORD * c_pwQuad = &c_pwChild[y * uChildSize + x];
+				*pwNode++ = std::max(std::max(c_pwQuad[0], c_pwQuad[1]), std::max(c_pwQuad[uChildSize], c_pwQuad[uChildSize + 1]));
+			}
+		}
+	}
+}
+
+float CTerrain::__GetHeightMax(UINT uLevel, UINT uX, UINT uY) const
+{
+	const UINT uSize = XSIZE >> uLevel;
+	return (float) m_kVct_wHeightMax[HEIGHT_MAX_LEVEL_OFFSET[uLevel] + uY * uSize + uX] * m_fHeightScale;
+}
+
+bool CTerrain::IntersectRay(const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT)
+{
+	if (m_kVct_wHeightMax.empty())
+		return false;
+
+	// Into the terrain's own space, y flipped the way GetHeight takes it
+	const D3DXVECTOR3 v3Start(c_rv3Start.x - (float) m_wX * TERRAIN_XSIZE, -c_rv3Start.y - (float) m_wY * TERRAIN_YSIZE, c_rv3Start.z);
+	const D3DXVECTOR3 v3Dir(c_rv3Dir.x, -c_rv3Dir.y, c_rv3Dir.z);
+
+	const UINT uRootLevel = HEIGHT_MAX_TREE_LEVELS - 1;
+	if (!ClipRayColumn(v3Start, v3Dir, 0.0f, 0.0f, (float) TERRAIN_XSIZE, __GetHeightMax(uRootLevel, 0, 0), fTMin, fTMax))
+		return false;
+
+	return __IntersectHeightNode(uRootLevel, 0, 0, v3Start, v3Dir, fTMin, fTMax, pfT);
+}
+
+// [fTMin, fTMax] is already clipped to the node's column
+bool CTerrain::__IntersectHeightNode(UINT uLevel, UINT uX, UINT uY, const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT)
+{
+	if (0 == uLevel)
+		return __IntersectHeightCell(uX, uY, c_rv3Start, c_rv3Dir, fTMin, fTMax, pfT);
+
+	struct SChild
+	{
+		UINT	uX;
+		UINT	uY;
+		float	fTMin;
+		float	fTMax;
+	} akChild[4];
+
+	const UINT uChildLevel = uLevel - 1;
+	const float fChildSize = (float) (CELLSCALE << uChildLevel);
+	int iChildCount = 0;
+
+	for (UINT i = 0; i < 4; ++i)
+	{
+		SChild kChild;
+		kChild.uX = uX * 2 + (i & 1);
+		kChild.uY = uY * 2 + (i >> 1);
+		kChild.fTMin = fTMin;
+		kChild.fTMax = fTMax;
+
+		if (!ClipRayColumn(c_rv3Start, c_rv3Dir, kChild.uX * fChildSize, kChild.uY * fChildSize, fChildSize,
+						   __GetHeightMax(uChildLevel, kChild.uX, kChild.uY), kChild.fTMin, kChild.fTMax))
+			continue;
+
+		// The children do not overlap, so the nearest one along the ray goes first
+		int j = iChildCount++;
+		for (; j > 0 && akChild[j - 1].fTMin > kChild.fTMin; --j)
+			akChild[j] = akChild[j - 1];
+		akChild[j] = kChild;
+	}
+
+	for (int i = 0; i < iChildCount; ++i)
+	{
+		if (__IntersectHeightNode(uChildLevel, akChild[i].uX, akChild[i].uY, c_rv3Start, c_rv3Dir, akChild[i].fTMin, akChild[i].fTMax, pfT))
+			return true;
+	}
+
+	return false;
+}
+
+// The two triangles GetHeight interpolates in the cell, split along xdist == ydist
+bool CTerrain::__IntersectHeightCell(UINT uX, UINT uY, const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT)
+{
+	const float h1 = (float) GetHeightMapValue(uX, uY) * m_fHeightScale;				// top left
+	const float h2 = (float) GetHeightMapValue(uX + 1, uY + 1) * m_fHeightScale;		// bottom right
+	const float hLeft = (float) GetHeightMapValue(uX, uY + 1) * m_fHeightScale;		// bottom left
+	const float hRight = (float) GetHeightMapValue(uX + 1, uY) * m_fHeightScale;		// top right
+	const float ooscale = 1.0f / ((float) CELLSCALE);
+
+	// The ray from the cell's top left corner
+	const float fX0 = c_rv3Start.x - (float) (uX * CELLSCALE);
+	const float fY0 = c_rv3Start.y - (float) (uY * CELLSCALE);
+
+	float afT[3] = { fTMin, fTMax, fTMax };
+	int iPieceCount = 1;
+
+	const float fDiagonalDir = c_rv3Dir.x - c_rv3Dir.y;
+	if (0.0f != fDiagonalDir)
+	{
+		const float fT = (fY0 - fX0) / fDiagonalDir;
+		if (fT > fTMin && fT < fTMax)
+		{
+			afT[1] = fT;
+			iPieceCount = 2;
+		}
+	}
+
+	for (int i = 0; i < iPieceCount; ++i)
+	{
+		const float fT0 = afT[i];
+		const float fT1 = afT[i + 1];
+		const float fTMid = 0.5f * (fT0 + fT1);
+
+		float xslope, yslope;
+		if (fX0 + fTMid * c_rv3Dir.x <= fY0 + fTMid * c_rv3Dir.y)
+		{
+			xslope = (h2 - hLeft) * ooscale;
+			yslope = (hLeft - h1) * ooscale;
+		}
+		else
+		{
+			xslope = (hRight - h1) * ooscale;
+			yslope = (h2 - hRight) * ooscale;
+		}
+
+		// How far the ray is above the triangle, linear in t
+		const float fAbove0 = c_rv3Start.z + fT0 * c_rv3Dir.z - (h1 + (fX0 + fT0 * c_rv3Dir.x) * xslope + (fY0 + fT0 * c_rv3Dir.y) * yslope);
+		if (fAbove0 <= 0.0f)
+		{
+			*pfT = fT0;
+			return true;
+		}
+
+		const float fAbove1 = c_rv3Start.z + fT1 * c_rv3Dir.z - (h1 + (fX0 + fT1 * c_rv3Dir.x) * xslope + (fY0 + fT1 * c_rv3Dir.y) * yslope);
+		if (fAbove1 <= 0.0f)
+		{
+			*pfT = fT0 + (fT1 - fT0) * fAbove0 / (fAbove0 - fAbove1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // HeightMapCoord -> TileMapCoord
 
@@ -459,13 +681,67 @@ void CTerrain::CalculateNormal(long x, long y)
 
 bool CTerrain::RAW_LoadTileMap(const char * c_pszFileName, bool bBGLoading)
 {
-	CTerrainImpl::RAW_LoadTileMap(c_pszFileName);
+	RAW_DecodeTileMap(c_pszFileName);
 	DWORD dwStart = ELTimer_GetMSec();
-	RAW_AllocateSplats(bBGLoading);
-	Tracef("CTerrain::RAW_AllocateSplats %d\n", ELTimer_GetMSec() - dwStart);
+	RAW_CreateSplatTextures();
+	Tracef("CTerrain::RAW_CreateSplatTextures %d\n", ELTimer_GetMSec() - dwStart);
 	return true;
 }
 
+// Same result as RAW_AllocateSplats, without touching the device. The alpha textures of the
+// previous tile map must have been released already (Clear does it).
+bool CTerrain::RAW_DecodeTileMap(const char * c_pszFileName)
+{
+	const bool bRet = CTerrainImpl::RAW_LoadTileMap(c_pszFileName);
+
+	memset(&m_TerrainSplatPatch, 0, sizeof(m_TerrainSplatPatch));
+	m_TerrainSplatPatch.Splats[0].NeedsUpdate = 1;
+
+	RAW_CountTiles();
+
+	m_kVct_bySplatTile.clear();
+	m_kVct_bySplatAlpha.clear();
+
+	const DWORD dwTexCount = GetTextureSet()->GetTextureCount();
+	for (DWORD i = 1; i < dwTexCount; ++i)
+	{
+		if (0 == m_TerrainSplatPatch.TileCount[i])
+			continue;
+
+		m_kVct_bySplatTile.push_back((BYTE) i);
+		m_kVct_bySplatAlpha.resize(m_kVct_bySplatTile.size() * SPLATALPHA_RAW_XSIZE * SPLATALPHA_RAW_YSIZE);
+		RAW_BuildSplatAlpha((BYTE) i, &m_kVct_bySplatAlpha[(m_kVct_bySplatTile.size() - 1) * SPLATALPHA_RAW_XSIZE * SPLATALPHA_RAW_YSIZE]);
+	}
+
+	return bRet;
+}
+
+void CTerrain::RAW_CreateSplatTextures()
+{
+	// Left over when the terrain was loaded again without a Clear
+	for (DWORD i = 1; i < GetTextureSet()->GetTextureCount(); ++i)
+	{
+		if (m_lpAlphaTexture[i])
+		{
+			m_lpAlphaTexture[i]->Release();
+			m_lpAlphaTexture[i] = NULL;
+		}
+	}
+
+	for (DWORD i = 0; i < m_kVct_bySplatTile.size(); ++i)
+	{
+		const BYTE byTileNum = m_kVct_bySplatTile[i];
+		TTerainSplat & rSplat = m_TerrainSplatPatch.Splats[byTileNum];
+
+		rSplat.Active = 1;
+		rSplat.pd3dTexture = AddTexture32(byTileNum, &m_kVct_bySplatAlpha[i * SPLATALPHA_RAW_XSIZE * SPLATALPHA_RAW_YSIZE], SPLATALPHA_RAW_XSIZE, SPLATALPHA_RAW_YSIZE);
+	}
+
+	// Pooled terrains would otherwise keep up to a few MB each
+	std::vector<BYTE>().swap(m_kVct_bySplatTile);
+	std::vector<BYTE>().swap(m_kVct_bySplatAlpha);
+}
+
 bool CTerrain::LoadHeightMap(const char * c_pszFileName)
 {
 	CTerrainImpl::LoadHeightMap(c_pszFileName);
@@ -502,6 +778,8 @@ bool CTerrain::LoadHeightMap(const char * c_pszFileName)
 	}
 		
 	Tracef("LoadHeightMap::CalculateNormal %d ms\n", ELTimer_GetMSec() - dwStart);
+
+	__BuildHeightMaxTree();
 	return true;
 }
 
@@ -666,7 +944,6 @@ void CTerrain::RAW_GenerateSplat(bool bBGLoading)
 	m_TerrainSplatPatch.m_bNeedsUpdate = false;
 
 	BYTE abyAlphaMap[SPLATALPHA_RAW_XSIZE * SPLATALPHA_RAW_YSIZE];
-	BYTE * aptr;
 	
 	for (DWORD i = 1; i < GetTextureSet()->GetTextureCount(); ++i)
 	{
@@ -695,58 +972,7 @@ void CTerrain::RAW_GenerateSplat(bool bBGLoading)
 				rSplat.Active = 1;
 				rSplat.NeedsUpdate = 0;
 
-				aptr = abyAlphaMap;
-				const BYTE* pTileMap = m_abyTileMap;
-				const int iStride = TILEMAP_RAW_XSIZE;
-
-				for (long y = 0; y < SPLATALPHA_RAW_YSIZE; ++y)
-				{
-					const BYTE* pRow = pTileMap + (y * iStride);
-					const BYTE* pRowUp = (y > 0) ? (pRow - iStride) : NULL;
-					const BYTE* pRowDown = (y < SPLATALPHA_RAW_YSIZE - 1) ? (pRow + iStride) : NULL;
-
-					for (long x = 0; x < SPLATALPHA_RAW_XSIZE; ++x)
-					{
-						BYTE byTileNum = pRow[x];
-
-						if (byTileNum == i)
-						{
-							*aptr++ = 0xFF;
-						}
-						else if (byTileNum > i)
-						{
-							bool bFound = false;
-
-							// Check horizontal
-							if (x > 0 && pRow[x - 1] == i) bFound = true;
-							else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRow[x + 1] == i) bFound = true;
-							
-							// Check Up
-							else if (pRowUp)
-							{
-								if (pRowUp[x] == i) bFound = true;
-								else if (x > 0 && pRowUp[x - 1] == i) bFound = true;
-								else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRowUp[x + 1] == i) bFound = true;
-							}
-
-							// Check Down (only if not found yet)
-							if (!bFound && pRowDown)
-							{
-								if (pRowDown[x] == i) bFound = true;
-								else if (x > 0 && pRowDown[x - 1] == i) bFound = true;
-								else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRowDown[x + 1] == i) bFound = true;
-							}
-
-							*aptr++ = bFound ? 0xFF : 0x00;
-						}
-						else
-						{
-							*aptr++ = 0x00;
-						}
-					}
-				}
-
-
+				RAW_BuildSplatAlpha((BYTE) i, abyAlphaMap);
 				rSplat.pd3dTexture = AddTexture32(i, abyAlphaMap, SPLATALPHA_RAW_XSIZE, SPLATALPHA_RAW_YSIZE);
 			}
 			else
@@ -773,6 +999,61 @@ void CTerrain::RAW_GenerateSplat(bool bBGLoading)
 	}
 }
 
+// Alpha of one splat layer: opaque on its own tiles and on higher tiles next to them
+void CTerrain::RAW_BuildSplatAlpha(BYTE byTileNum, BYTE * pbyAlphaMap)
+{
+	BYTE * aptr = pbyAlphaMap;
+	const BYTE* pTileMap = m_abyTileMap;
+	const int iStride = TILEMAP_RAW_XSIZE;
+
+	for (long y = 0; y < SPLATALPHA_RAW_YSIZE; ++y)
+	{
+		const BYTE* pRow = pTileMap + (y * iStride);
+		const BYTE* pRowUp = (y > 0) ? (pRow - iStride) : NULL;
+		const BYTE* pRowDown = (y < SPLATALPHA_RAW_YSIZE - 1) ? (pRow + iStride) : NULL;
+
+		for (long x = 0; x < SPLATALPHA_RAW_XSIZE; ++x)
+		{
+			const BYTE byCurTileNum = pRow[x];
+
+			if (byCurTileNum == byTileNum)
+			{
+				*aptr++ = 0xFF;
+			}
+			else if (byCurTileNum > byTileNum)
+			{
+				bool bFound = false;
+
+				// Check horizontal
+				if (x > 0 && pRow[x - 1] == byTileNum) bFound = true;
+				else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRow[x + 1] == byTileNum) bFound = true;
+				
+				// Check Up
+				else if (pRowUp)
+				{
+					if (pRowUp[x] == byTileNum) bFound = true;
+					else if (x > 0 && pRowUp[x - 1] == byTileNum) bFound = true;
+					else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRowUp[x + 1] == byTileNum) bFound = true;
+				}
+
+				// Check Down (only if not found yet)
+				if (!bFound && pRowDown)
+				{
+					if (pRowDown[x] == byTileNum) bFound = true;
+					else if (x > 0 && pRowDown[x - 1] == byTileNum) bFound = true;
+					else if (x < SPLATALPHA_RAW_XSIZE - 1 && pRowDown[x + 1] == byTileNum) bFound = true;
+				}
+
+				*aptr++ = bFound ? 0xFF : 0x00;
+			}
+			else
+			{
+				*aptr++ = 0x00;
+			}
+		}
+	}
+}
+
 LPDIRECT3DTEXTURE9 CTerrain::AddTexture32(BYTE byImageNum, BYTE * pbyImage, long lTextureWidth, long lTextureHeight)
 {
 	assert(NULL==m_lpAlphaTexture[byImageNum]);
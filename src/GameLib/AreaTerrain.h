@@ -34,6 +34,11 @@ class CTerrain : public CTerrainImpl, public CGraphicBase
 		//////////////////////////////////////////////////////////////////////////
 		// Loading
 		bool			RAW_LoadTileMap(const char * c_pszFileName, bool bBGLoading = false);
+
+		// RAW_LoadTileMap in two steps: the decode builds the splat alpha maps and may run
+		// on a worker, the textures are created from them on the render thread
+		bool			RAW_DecodeTileMap(const char * c_pszFileName);
+		void			RAW_CreateSplatTextures();
 		
 		bool			LoadHeightMap(const char * c_pszFileName);
 
@@ -51,6 +56,10 @@ class CTerrain : public CTerrainImpl, public CGraphicBase
 		WORD *			GetHeightMap()			{ return m_awRawHeightMap; }
 		float			GetHeight(int x, int y);
 
+		// Picking: the first point of the world space ray v3Start + t * v3Dir, t in [fTMin, fTMax],
+		// that is on or under the surface GetHeight interpolates
+		bool			IntersectRay(const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT);
+
 		// Normal Map
 		bool			GetNormal(int ix, int iy, D3DXVECTOR3 * pv3Normal);
 
@@ -106,6 +115,7 @@ class CTerrain : public CTerrainImpl, public CGraphicBase
 		void	RAW_AllocateSplats(bool bBGLoading = false);
 		void	RAW_DeallocateSplats(bool bBGLoading = false);
 		virtual void RAW_CountTiles();
+		void	RAW_BuildSplatAlpha(BYTE byTileNum, BYTE * pbyAlphaMap);
 
 		LPDIRECT3DTEXTURE9 AddTexture32(BYTE byImageNum, BYTE * pbyImage, long lTextureWidth, long lTextureHeight);
 		void PutImage32(BYTE * pbySrc, BYTE * pbyDst, long src_pitch, long dst_pitch, long lTextureWidth, long lTextureHeight, bool bResize = false);
@@ -114,6 +124,12 @@ class CTerrain : public CTerrainImpl, public CGraphicBase
 	protected:
 		void CalculateNormal(long x, long y);
 
+		// Max quadtree over the height cells, the finest level (a cell's 4 corners) first
+		void __BuildHeightMaxTree();
+		bool __IntersectHeightNode(UINT uLevel, UINT uX, UINT uY, const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT);
+		bool __IntersectHeightCell(UINT uX, UINT uY, const D3DXVECTOR3 & c_rv3Start, const D3DXVECTOR3 & c_rv3Dir, float fTMin, float fTMax, float * pfT);
+		float __GetHeightMax(UINT uLevel, UINT uX, UINT uY) const;
+
 	protected:
 		std::string				m_strName;
 		WORD					m_wX;
@@ -134,6 +150,11 @@ class CTerrain : public CTerrainImpl, public CGraphicBase
 
 		// Picking
 		D3DXVECTOR3				m_v3Pick;
+		std::vector<WORD>		m_kVct_wHeightMax;
+
+		// Alpha maps decoded by RAW_DecodeTileMap, waiting for RAW_CreateSplatTextures
+		std::vector<BYTE>		m_kVct_bySplatTile;
+		std::vector<BYTE>		m_kVct_bySplatAlpha;
 
 		DWORD					m_dwNumTexturesShow;
 		std::vector<DWORD>		m_VectorNumShowTexture;
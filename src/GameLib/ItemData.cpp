@@ -41,11 +41,21 @@ CGraphicThing * CItemData::GetDropModelThing()
 
 CGraphicSubImage * CItemData::GetIconImage()
 {
-	if(m_pIconImage == NULL && m_strIconFileName.empty() == false)
-		__SetIconImage(m_strIconFileName.c_str());
+	const std::string & c_rstrIconFileName = GetIconImageFileName();
+
+	if(m_pIconImage == NULL && c_rstrIconFileName.empty() == false)
+		__SetIconImage(c_rstrIconFileName.c_str());
 	return m_pIconImage;
 }
 
+const std::string & CItemData::GetIconImageFileName()
+{
+	if (m_bResolveIconFileName)
+		__ResolveIconFileName();
+
+	return m_strIconFileName;
+}
+
 DWORD CItemData::GetLODModelThingCount()
 {
 	return m_pLODModelThingVector.size();
@@ -110,6 +120,7 @@ void CItemData::SetDefaultItemData(const char * c_szIconFileName, const char * c
 		m_strDropModelFileName = "d:/ymir work/item/etc/item_bag.gr2";
 	}
 	m_strIconFileName = c_szIconFileName;
+	m_bResolveIconFileName = false;
 
 	m_strSubModelFileName = "";
 	m_strDescription = "";
@@ -119,6 +130,43 @@ void CItemData::SetDefaultItemData(const char * c_szIconFileName, const char * c
 	__LoadFiles();
 }
 
+void CItemData::SetDefaultItemData(DWORD dwIconVnum, DWORD dwFallbackIconVnum)
+{
+	SetDefaultItemData("");
+
+	m_bResolveIconFileName = true;
+	m_dwIconVnum = dwIconVnum;
+	m_dwFallbackIconVnum = dwFallbackIconVnum;
+}
+
+void CItemData::__ResolveIconFileName()
+{
+	m_bResolveIconFileName = false;
+
+	char szName[64+1];
+
+	_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", m_dwIconVnum);
+	if (CResourceManager::Instance().IsFileExist(szName))
+	{
+		m_strIconFileName = szName;
+		return;
+	}
+
+	_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", m_dwFallbackIconVnum);
+	if (CResourceManager::Instance().IsFileExist(szName))
+	{
+		m_strIconFileName = szName;
+		return;
+	}
+
+	#ifdef _DEBUG
+	TraceError("%16s(#%-5d) cannot find icon file. setting to default.", m_ItemTable.szName, m_dwIconVnum);
+	#endif
+	const DWORD EmptyBowl = 27995;
+	_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", EmptyBowl);
+	m_strIconFileName = szName;
+}
+
 void CItemData::__LoadFiles()
 {
 	// Model File Name
@@ -389,6 +437,9 @@ void CItemData::Clear()
 	m_strSubModelFileName = "";
 	m_strDropModelFileName = "";
 	m_strIconFileName = "";
+	m_bResolveIconFileName = false;
+	m_dwIconVnum = 0;
+	m_dwFallbackIconVnum = 0;
 	m_strLODModelFileNameVector.clear();
 
 	m_pModelThing = NULL;
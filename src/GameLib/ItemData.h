@@ -455,8 +455,13 @@ class CItemData
 
 	public:
 		CItemData();
+		CItemData(const CItemData &) = default;
+		CItemData(CItemData &&) = default;
 		virtual ~CItemData();
 
+		CItemData & operator = (const CItemData &) = default;
+		CItemData & operator = (CItemData &&) = default;
+
 		void Clear();
 		void SetSummary(const std::string& c_rstSumm);
 		void SetDescription(const std::string& c_rstDesc);
@@ -465,6 +470,7 @@ class CItemData
 		CGraphicThing * GetSubModelThing();
 		CGraphicThing * GetDropModelThing();
 		CGraphicSubImage * GetIconImage();
+		const std::string & GetIconImageFileName();
 
 		DWORD GetLODModelThingCount();
 		BOOL GetLODModelThingPointer(DWORD dwIndex, CGraphicThing ** ppModelThing);
@@ -511,11 +517,15 @@ class CItemData
 
 		//BOOL LoadItemData(const char * c_szFileName);
 		void SetDefaultItemData(const char * c_szIconFileName, const char * c_szModelFileName  = NULL);
+		// The icon is the first of icon/item/<dwIconVnum>.tga, icon/item/<dwFallbackIconVnum>.tga
+		// and the empty bowl that exists, looked up when GetIconImage is first called
+		void SetDefaultItemData(DWORD dwIconVnum, DWORD dwFallbackIconVnum);
 		void SetItemTableData(TItemTable * pItemTable);
 
 	protected:
 		void __LoadFiles();
 		void __SetIconImage(const char * c_szFileName);
+		void __ResolveIconFileName();
 
 	protected:
 		std::string m_strModelFileName;
@@ -534,6 +544,9 @@ class CItemData
 
 		NRaceData::TAttachingDataVector m_AttachingDataVector;
 		DWORD		m_dwVnum;
+		bool		m_bResolveIconFileName;	// m_strIconFileName comes from the two vnums below
+		DWORD		m_dwIconVnum;
+		DWORD		m_dwFallbackIconVnum;
 		TItemTable m_ItemTable;
 		
 	public:
@@ -5,6 +5,9 @@
 
 #include "ItemManager.h"
 
+#include <functional>
+#include <unordered_map>
+
 static DWORD s_adwItemProtoKey[4] =
 {
 	173217,
@@ -15,27 +18,20 @@ static DWORD s_adwItemProtoKey[4] =
 
 BOOL CItemManager::SelectItemData(DWORD dwIndex)
 {
-	TItemMap::iterator f = m_ItemMap.find(dwIndex);
+	CItemData * pItemData = __FindItemData(dwIndex);
 
-	if (m_ItemMap.end() == f)
+	if (!pItemData)
 	{
-		int n = m_vec_ItemRange.size();
-		for (int i = 0; i < n; i++)
+		pItemData = __FindItemDataInRange(dwIndex);
+
+		if (!pItemData)
 		{
-			CItemData * p = m_vec_ItemRange[i];
-			const CItemData::TItemTable * pTable = p->GetTable(); 
-			if ((pTable->dwVnum < dwIndex) &&
-				dwIndex < (pTable->dwVnum + pTable->dwVnumRange))
-			{
-				m_pSelectedItemData = p;
-				return TRUE;
-			}
+			Tracef(" CItemManager::SelectItemData - FIND ERROR [%d]\n", dwIndex);
+			return FALSE;
 		}
-		Tracef(" CItemManager::SelectItemData - FIND ERROR [%d]\n", dwIndex);
-		return FALSE;
 	}
 
-	m_pSelectedItemData = f->second;
+	m_pSelectedItemData = pItemData;
 
 	return TRUE;
 }
@@ -50,50 +46,179 @@ BOOL CItemManager::GetItemDataPointer(DWORD dwItemID, CItemData ** ppItemData)
 	if (0 == dwItemID)
 		return FALSE;
 
-	TItemMap::iterator f = m_ItemMap.find(dwItemID);
+	CItemData * pItemData = __FindItemData(dwItemID);
 
-	if (m_ItemMap.end() == f)
+	if (!pItemData)
 	{
-		int n = m_vec_ItemRange.size();
-		for (int i = 0; i < n; i++)
+		pItemData = __FindItemDataInRange(dwItemID);
+
+		if (!pItemData)
 		{
-			CItemData * p = m_vec_ItemRange[i];
-			const CItemData::TItemTable * pTable = p->GetTable(); 
-			if ((pTable->dwVnum < dwItemID) &&
-				dwItemID < (pTable->dwVnum + pTable->dwVnumRange))
-			{
-				*ppItemData = p;
-				return TRUE;
-			}
+			Tracef(" CItemManager::GetItemDataPointer - FIND ERROR [%d]\n", dwItemID);
+			return FALSE;
 		}
-		Tracef(" CItemManager::GetItemDataPointer - FIND ERROR [%d]\n", dwItemID);
-		return FALSE;
 	}
 
-	*ppItemData = f->second;
+	*ppItemData = pItemData;
 
 	return TRUE;
 }
 
 CItemData * CItemManager::MakeItemData(DWORD dwIndex)
 {
-	TItemMap::iterator f = m_ItemMap.find(dwIndex);
+	std::vector<DWORD>::iterator f = std::lower_bound(m_kVct_dwItemVnum.begin(), m_kVct_dwItemVnum.end(), dwIndex);
+	const size_t uPos = f - m_kVct_dwItemVnum.begin();
+
+	if (m_kVct_dwItemVnum.end() == f || *f != dwIndex)
+	{
+		m_kVct_dwItemVnum.insert(f, dwIndex);
+		m_kVct_kItemData.insert(m_kVct_kItemData.begin() + uPos, CItemData());
+
+		for (DWORD & rdwRangeItemIndex : m_kVct_dwRangeItemIndex)
+			if (rdwRangeItemIndex >= uPos)
+				++rdwRangeItemIndex;
+
+		m_pSelectedItemData = NULL;
+	}
+
+	return &m_kVct_kItemData[uPos];
+}
+
+CItemData * CItemManager::__FindItemData(DWORD dwIndex)
+{
+	std::vector<DWORD>::iterator f = std::lower_bound(m_kVct_dwItemVnum.begin(), m_kVct_dwItemVnum.end(), dwIndex);
+
+	if (m_kVct_dwItemVnum.end() == f || *f != dwIndex)
+		return NULL;
+
+	return &m_kVct_kItemData[f - m_kVct_dwItemVnum.begin()];
+}
+
+CItemData * CItemManager::__FindItemDataInRange(DWORD dwIndex)
+{
+	for (DWORD dwItemIndex : m_kVct_dwRangeItemIndex)
+	{
+		CItemData & rkItemData = m_kVct_kItemData[dwItemIndex];
+		const CItemData::TItemTable * pTable = rkItemData.GetTable();
+		if ((pTable->dwVnum < dwIndex) &&
+			dwIndex < (pTable->dwVnum + pTable->dwVnumRange))
+			return &rkItemData;
+	}
+
+	return NULL;
+}
+
+// Adds an item for every vnum a loader did not find. The new items are merged into the
+// sorted ones in a single pass, c_rfnInitialize fills each one from its loader index.
+// When a loader adds one vnum twice, the later one stays as if loaded over the first.
+void CItemManager::__InsertItemData(std::vector<TNewItem> & rkVct_kNewItem, const std::function<void (CItemData &, const TNewItem &)> & c_rfnInitialize)
+{
+	if (rkVct_kNewItem.empty())
+		return;
 
-	if (m_ItemMap.end() == f)
+	std::stable_sort(rkVct_kNewItem.begin(), rkVct_kNewItem.end(), [](const TNewItem & a, const TNewItem & b) { return a.first < b.first; });
+
+	const size_t uItemCount = m_kVct_kItemData.size() + rkVct_kNewItem.size();
+
+	std::vector<CItemData> kVct_kItemData;
+	std::vector<DWORD> kVct_dwItemVnum;
+	kVct_kItemData.reserve(uItemCount);
+	kVct_dwItemVnum.reserve(uItemCount);
+
+	size_t uOld = 0;
+	for (size_t uNew = 0; uNew < rkVct_kNewItem.size(); ++uNew)
 	{
-		CItemData * pItemData = CItemData::New();
+		const TNewItem & c_rkNewItem = rkVct_kNewItem[uNew];
+		if (uNew + 1 < rkVct_kNewItem.size() && rkVct_kNewItem[uNew + 1].first == c_rkNewItem.first)
+			continue;
 
-		m_ItemMap.insert(TItemMap::value_type(dwIndex, pItemData));		
+		for (; uOld < m_kVct_dwItemVnum.size() && m_kVct_dwItemVnum[uOld] < c_rkNewItem.first; ++uOld)
+		{
+			kVct_kItemData.push_back(std::move(m_kVct_kItemData[uOld]));
+			kVct_dwItemVnum.push_back(m_kVct_dwItemVnum[uOld]);
+		}
 
-		return pItemData;
+		kVct_kItemData.emplace_back();
+		kVct_dwItemVnum.push_back(c_rkNewItem.first);
+		c_rfnInitialize(kVct_kItemData.back(), c_rkNewItem);
 	}
 
-	return f->second;
+	for (; uOld < m_kVct_dwItemVnum.size(); ++uOld)
+	{
+		kVct_kItemData.push_back(std::move(m_kVct_kItemData[uOld]));
+		kVct_dwItemVnum.push_back(m_kVct_dwItemVnum[uOld]);
+	}
+
+	m_kVct_kItemData.swap(kVct_kItemData);
+	m_kVct_dwItemVnum.swap(kVct_dwItemVnum);
+	m_pSelectedItemData = NULL;
+
+	__BuildRangeItemIndex();
+}
+
+void CItemManager::__BuildRangeItemIndex()
+{
+	m_kVct_dwRangeItemIndex.clear();
+	for (DWORD i = 0; i < m_kVct_kItemData.size(); ++i)
+		if (0 != m_kVct_kItemData[i].GetTable()->dwVnumRange)
+			m_kVct_dwRangeItemIndex.push_back(i);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
 // Load Item Table
 
+static void __SetItemListData(CItemData * pItemData, DWORD dwItemVNum, const CTokenVector & TokenVector)
+{
+	const std::string & c_rstrIcon = TokenVector[2];
+
+	extern BOOL USE_VIETNAM_CONVERT_WEAPON_VNUM;
+	if (USE_VIETNAM_CONVERT_WEAPON_VNUM)
+	{
+		extern DWORD Vietnam_ConvertWeaponVnum(DWORD vnum);
+		DWORD dwMildItemVnum = Vietnam_ConvertWeaponVnum(dwItemVNum);
+		if (dwMildItemVnum == dwItemVNum)
+		{
+			if (4 == TokenVector.size())
+			{
+				const std::string & c_rstrModelFileName = TokenVector[3];
+				pItemData->SetDefaultItemData(c_rstrIcon.c_str(), c_rstrModelFileName.c_str());
+			}
+			else
+			{
+				pItemData->SetDefaultItemData(c_rstrIcon.c_str());
+			}
+		}
+		else
+		{
+			DWORD dwMildBaseVnum = dwMildItemVnum / 10 * 10;
+			char szMildIconPath[MAX_PATH];				
+			sprintf(szMildIconPath, "icon/item/%.5d.tga", dwMildBaseVnum);
+			if (4 == TokenVector.size())
+			{
+				char szMildModelPath[MAX_PATH];
+				sprintf(szMildModelPath, "d:/ymir work/item/weapon/%.5d.gr2", dwMildBaseVnum);	
+				pItemData->SetDefaultItemData(szMildIconPath, szMildModelPath);
+			}
+			else
+			{
+				pItemData->SetDefaultItemData(szMildIconPath);
+			}
+		}
+	}
+	else
+	{
+		if (4 == TokenVector.size())
+		{
+			const std::string & c_rstrModelFileName = TokenVector[3];
+			pItemData->SetDefaultItemData(c_rstrIcon.c_str(), c_rstrModelFileName.c_str());
+		}
+		else
+		{
+			pItemData->SetDefaultItemData(c_rstrIcon.c_str());
+		}
+	}
+}
+
 bool CItemManager::LoadItemList(const char * c_szFileName)
 {
 	TPackFile File;
@@ -104,6 +229,9 @@ bool CItemManager::LoadItemList(const char * c_szFileName)
 	CMemoryTextFileLoader textFileLoader;
 	textFileLoader.Bind(File.size(), File.data());
 
+	// Items not loaded yet are added together at the end, by line
+	std::vector<TNewItem> kVct_kNewItem;
+
 	CTokenVector TokenVector;
     for (DWORD i = 0; i < textFileLoader.GetLineCount(); ++i)
 	{
@@ -118,60 +246,22 @@ bool CItemManager::LoadItemList(const char * c_szFileName)
 
 		const std::string & c_rstrID = TokenVector[0];
 		//const std::string & c_rstrType = TokenVector[1];
-		const std::string & c_rstrIcon = TokenVector[2];
 
 		DWORD dwItemVNum=atoi(c_rstrID.c_str());
 
-		CItemData * pItemData = MakeItemData(dwItemVNum);
-
-		extern BOOL USE_VIETNAM_CONVERT_WEAPON_VNUM;
-		if (USE_VIETNAM_CONVERT_WEAPON_VNUM)
-		{
-			extern DWORD Vietnam_ConvertWeaponVnum(DWORD vnum);
-			DWORD dwMildItemVnum = Vietnam_ConvertWeaponVnum(dwItemVNum);
-			if (dwMildItemVnum == dwItemVNum)
-			{
-				if (4 == TokenVector.size())
-				{
-					const std::string & c_rstrModelFileName = TokenVector[3];
-					pItemData->SetDefaultItemData(c_rstrIcon.c_str(), c_rstrModelFileName.c_str());
-				}
-				else
-				{
-					pItemData->SetDefaultItemData(c_rstrIcon.c_str());
-				}
-			}
-			else
-			{
-				DWORD dwMildBaseVnum = dwMildItemVnum / 10 * 10;
-				char szMildIconPath[MAX_PATH];				
-				sprintf(szMildIconPath, "icon/item/%.5d.tga", dwMildBaseVnum);
-				if (4 == TokenVector.size())
-				{
-					char szMildModelPath[MAX_PATH];
-					sprintf(szMildModelPath, "d:/ymir work/item/weapon/%.5d.gr2", dwMildBaseVnum);	
-					pItemData->SetDefaultItemData(szMildIconPath, szMildModelPath);
-				}
-				else
-				{
-					pItemData->SetDefaultItemData(szMildIconPath);
-				}
-			}
-		}
+		CItemData * pItemData = __FindItemData(dwItemVNum);
+		if (pItemData)
+			__SetItemListData(pItemData, dwItemVNum, TokenVector);
 		else
-		{
-			if (4 == TokenVector.size())
-			{
-				const std::string & c_rstrModelFileName = TokenVector[3];
-				pItemData->SetDefaultItemData(c_rstrIcon.c_str(), c_rstrModelFileName.c_str());
-			}
-			else
-			{
-				pItemData->SetDefaultItemData(c_rstrIcon.c_str());
-			}
-		}
+			kVct_kNewItem.push_back(TNewItem(dwItemVNum, i));
 	}
 
+	__InsertItemData(kVct_kNewItem, [&](CItemData & rkItemData, const TNewItem & c_rkNewItem)
+	{
+		textFileLoader.SplitLine(c_rkNewItem.second, &TokenVector, "\t");
+		__SetItemListData(&rkItemData, c_rkNewItem.first, TokenVector);
+	});
+
 	return true;
 }
 
@@ -222,12 +312,10 @@ bool CItemManager::LoadItemDesc(const char* c_szFileName)
 		DWORD dwVnum=atoi(kTokenVector[ITEMDESC_COL_VNUM].c_str());
 		const std::string& c_rstDesc=kTokenVector[ITEMDESC_COL_DESC];
 		const std::string& c_rstSumm=kTokenVector[ITEMDESC_COL_SUMM];
-		TItemMap::iterator f = m_ItemMap.find(dwVnum);
-		if (m_ItemMap.end() == f)
+		CItemData* pkItemDataFind = __FindItemData(dwVnum);
+		if (!pkItemDataFind)
 			continue;
 
-		CItemData* pkItemDataFind = f->second;
-
 		pkItemDataFind->SetDescription(__SnapString(c_rstDesc, stTemp));
 		pkItemDataFind->SetSummary(__SnapString(c_rstSumm, stTemp));
 	}
@@ -254,7 +342,6 @@ DWORD GetHashCode( const char* pString )
 bool CItemManager::LoadItemTable(const char* c_szFileName)
 {	
 	TPackFile file;
-	LPCVOID pvData;
 
 	if (!CPackManager::Instance().GetFile(c_szFileName, file))
 		return false;
@@ -299,84 +386,59 @@ bool CItemManager::LoadItemTable(const char* c_szFileName)
 	memcpy(&dwDataSize, p, sizeof(DWORD));
 	p += sizeof(DWORD);
 
-	BYTE * pbData = new BYTE[dwDataSize];
-	memcpy(pbData, p, dwDataSize);
-
 	/////
 
 	CLZObject zObj;
 
-	if (!CLZO::Instance().Decompress(zObj, pbData, s_adwItemProtoKey))
-	{
-		delete [] pbData;
+	if (!CLZO::Instance().Decompress(zObj, p, s_adwItemProtoKey))
 		return false;
-	}
 
 	/////
 
-	char szName[64+1];
-	
 	CItemData::TItemTable * table = (CItemData::TItemTable *) zObj.GetBuffer();
-	std::map<DWORD,DWORD> itemNameMap;
 
-	for (DWORD i = 0; i < dwElements; ++i, ++table)
-	{
-		CItemData * pItemData;
-		DWORD dwVnum = table->dwVnum;
+	// The first vnum of every item name, an item without its own icon borrows that one's
+	std::unordered_map<DWORD, DWORD> itemNameMap;
+	itemNameMap.reserve(dwElements);
 
-		TItemMap::iterator f = m_ItemMap.find(dwVnum);
-		if (m_ItemMap.end() == f)
-		{
-			_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", dwVnum);
+	// Items not loaded yet are added together at the end, by row
+	std::vector<TNewItem> kVct_kNewItem;
+	std::vector<DWORD> kVct_dwFallbackIconVnum(dwElements);
 
-			if (CResourceManager::Instance().IsFileExist(szName) == false)
-			{
-				std::map<DWORD, DWORD>::iterator itVnum = itemNameMap.find(GetHashCode(table->szName));
-				
-				if (itVnum != itemNameMap.end())
-					_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", itVnum->second);
-				else
-					_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", dwVnum-dwVnum % 10);
-
-				if (CResourceManager::Instance().IsFileExist(szName) == false)
-				{
-					#ifdef _DEBUG
-					TraceError("%16s(#%-5d) cannot find icon file. setting to default.", table->szName, dwVnum);
-					#endif
-					const DWORD EmptyBowl = 27995;
-					_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", EmptyBowl);
-				}
-			}
-				
-			pItemData = CItemData::New();
+	for (DWORD i = 0; i < dwElements; ++i)
+	{
+		DWORD dwVnum = table[i].dwVnum;
+		std::pair<std::unordered_map<DWORD, DWORD>::iterator, bool> kNameResult = itemNameMap.emplace(GetHashCode(table[i].szName), dwVnum);
 
-			pItemData->SetDefaultItemData(szName);
-			m_ItemMap.insert(TItemMap::value_type(dwVnum, pItemData));
-		}
-		else
-		{
-			pItemData = f->second;
-		}	
-		if (itemNameMap.find(GetHashCode(table->szName)) == itemNameMap.end())
-			itemNameMap.insert(std::map<DWORD,DWORD>::value_type(GetHashCode(table->szName),table->dwVnum));
-		pItemData->SetItemTableData(table);
-		if (0 != table->dwVnumRange)
+		CItemData * pItemData = __FindItemData(dwVnum);
+		if (pItemData)
 		{
-			m_vec_ItemRange.push_back(pItemData);
+			pItemData->SetItemTableData(&table[i]);
+			continue;
 		}
+
+		kVct_dwFallbackIconVnum[i] = kNameResult.second ? dwVnum - dwVnum % 10 : kNameResult.first->second;
+		kVct_kNewItem.push_back(TNewItem(dwVnum, i));
 	}
 
-	delete [] pbData;
+	__InsertItemData(kVct_kNewItem, [&](CItemData & rkItemData, const TNewItem & c_rkNewItem)
+	{
+		// Checking that the icon files exist is left to the first GetIconImage
+		rkItemData.SetDefaultItemData(c_rkNewItem.first, kVct_dwFallbackIconVnum[c_rkNewItem.second]);
+		rkItemData.SetItemTableData(&table[c_rkNewItem.second]);
+	});
+
+	// The range lookups read the tables of items that were already loaded too
+	__BuildRangeItemIndex();
 	return true;
 }
 
 void CItemManager::Destroy()
 {
-	TItemMap::iterator i;
-	for (i=m_ItemMap.begin(); i!=m_ItemMap.end(); ++i)
-		CItemData::Delete(i->second);
-
-	m_ItemMap.clear();
+	m_kVct_kItemData.clear();
+	m_kVct_dwItemVnum.clear();
+	m_kVct_dwRangeItemIndex.clear();
+	m_pSelectedItemData = NULL;
 }
 
 CItemManager::CItemManager() : m_pSelectedItemData(NULL)
@@ -2,6 +2,8 @@
 
 #include "ItemData.h"
 
+#include <functional>
+
 class CItemManager : public CSingleton<CItemManager>
 {
 	public:
@@ -15,8 +17,8 @@ class CItemManager : public CSingleton<CItemManager>
 		};
 
 	public:
-		typedef std::map<DWORD, CItemData*> TItemMap;
 		typedef std::map<std::string, CItemData*> TItemNameMap;
+		typedef std::pair<DWORD, DWORD> TNewItem;	// vnum, line or row it was loaded from
 
 	public:
 		CItemManager();
@@ -33,10 +35,19 @@ class CItemManager : public CSingleton<CItemManager>
 		bool			LoadItemDesc(const char* c_szFileName);
 		bool			LoadItemList(const char* c_szFileName);
 		bool			LoadItemTable(const char* c_szFileName);
+		// Adding an item moves the others, pointers taken before are no longer valid
 		CItemData *		MakeItemData(DWORD dwIndex);
 
 	protected:
-		TItemMap m_ItemMap;
-		std::vector<CItemData*>  m_vec_ItemRange;
+		CItemData *		__FindItemData(DWORD dwIndex);
+		CItemData *		__FindItemDataInRange(DWORD dwIndex);
+		void			__InsertItemData(std::vector<TNewItem> & rkVct_kNewItem, const std::function<void (CItemData &, const TNewItem &)> & c_rfnInitialize);
+		void			__BuildRangeItemIndex();
+
+	protected:
+		// Sorted by vnum, m_kVct_dwItemVnum[i] is the vnum of m_kVct_kItemData[i]
+		std::vector<CItemData> m_kVct_kItemData;
+		std::vector<DWORD> m_kVct_dwItemVnum;
+		std::vector<DWORD> m_kVct_dwRangeItemIndex;
 		CItemData * m_pSelectedItemData;		
 };
@@ -8,6 +8,8 @@
 #include "TerrainPatch.h"
 #include "AreaTerrain.h"
 
+#include <cfloat>
+
 //#define USE_LEVEL
 // unsigned int uiNumSplat;
 
@@ -66,6 +68,33 @@ struct FGetPickingPoint
 	}
 };
 
+// Collects the objects of a whole batch of height queries, with their culling circles
+struct FCollectHeightObject : public SpherePackCallback
+{
+	struct SItem
+	{
+		CGraphicObjectInstance *	pInstance;
+		float						fX;
+		float						fY;
+		float						fRadius2;
+	};
+
+	std::vector<SItem> m_kVct_kItem;
+
+	virtual void RangeTest2dCallback(const Vector3d & p, float distance, SpherePack * sphere, ViewState state)
+	{
+		if (state == VS_OUTSIDE)
+			return;
+
+		SItem kItem;
+		kItem.pInstance = (CGraphicObjectInstance *)sphere->GetUserData();
+		kItem.fX = sphere->GetCenter().x;
+		kItem.fY = sphere->GetCenter().y;
+		kItem.fRadius2 = sphere->GetRadius2();
+		m_kVct_kItem.push_back(kItem);
+	}
+};
+
 CMapOutdoor::CMapOutdoor()
 {
 	CGraphicImage * pAttrImage = (CGraphicImage *)CResourceManager::Instance().GetResourcePointer("d:/ymir work/special/white.dds");
@@ -73,6 +102,7 @@ CMapOutdoor::CMapOutdoor()
 	m_attrImageInstance.SetImagePointer(pAttrImage);
 	m_BuildingTransparentImageInstance.SetImagePointer(pBuildTransparentImage);
 
+	m_kAreaLoader.Initialize(this);
 	Initialize();
 
 	__SoftwareTransformPatch_Initialize();
@@ -83,8 +113,6 @@ CMapOutdoor::~CMapOutdoor()
 {
 	__SoftwareTransformPatch_Destroy();
 
-	// 2004.10.14.myevan.TEMP_CAreaLoaderThread
-	//ms_AreaLoaderThread.Shutdown();
 	Destroy();
 }
 
@@ -156,12 +184,14 @@ bool CMapOutdoor::Initialize()
 	m_AreaDeleteVector.clear();
 	m_AreaLoadRequestVector.clear();
 	m_AreaLoadWaitVector.clear();
+
+	m_v3StreamPrevPlayer = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	m_v3StreamVelocity = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	m_dwStreamPrevTime = 0;
 	//////////////////////////////////////////////////////////////////////////	
 	
 	m_PatchVector.clear();
 	
-	// 2004.10.14.myevan.TEMP_CAreaLoaderThread
-	//m_bBGLoadingEnable = false;
 	m_eTerrainRenderSort = DISTANCE_SORT;
 
 	D3DXMatrixIdentity(&m_matWorldForCommonUse);
@@ -195,6 +225,8 @@ bool CMapOutdoor::Destroy()
 
 	XMasTree_Destroy();
 
+	// Sectors still streaming belong to the loader until they are taken
+	m_kAreaLoader.Shutdown();
 	DestroyTerrain();
  	DestroyArea();
 	DestroyTerrainPatchProxyList();
@@ -432,42 +464,78 @@ bool CMapOutdoor::GetPickingPoint(D3DXVECTOR3 * v3IntersectPt)
 	return GetPickingPointWithRay(ms_Ray, v3IntersectPt);
 }
 
-bool CMapOutdoor::__PickTerrainHeight(float& fPos, const D3DXVECTOR3& v3Start, const D3DXVECTOR3& v3End, float fStep, float fRayRange, float fLimitRange, D3DXVECTOR3* pv3Pick)
+// First point of the ray on or under the loaded terrain. Walks the sectors the ray crosses
+// in order (a 2D DDA) and intersects each one's height field exactly.
+bool CMapOutdoor::__PickTerrain(const D3DXVECTOR3& v3Start, const D3DXVECTOR3& v3End, float fRayRange, D3DXVECTOR3* pv3Pick)
 {
-	CTerrain * pTerrain;
+	const float MAX_PICK_RANGE = 100000.0f;
+
+	if (fRayRange <= 0.0f || m_CurCoordinate.m_sTerrainCoordX < 0 || m_CurCoordinate.m_sTerrainCoordY < 0)
+		return false;
 
-	D3DXVECTOR3 v3CurPos;
+	const float fLimit = std::min(fRayRange, MAX_PICK_RANGE);
+	const D3DXVECTOR3 v3Dir = (v3End - v3Start) / fRayRange;
 
-	float fRayRangeInv=1.0f/fRayRange;
-	while (fPos < fRayRange && fPos<fLimitRange)
+	// Sector space, y flipped like the terrain coordinates
+	const float fU = v3Start.x;
+	const float fV = -v3Start.y;
+	const float fDirU = v3Dir.x;
+	const float fDirV = -v3Dir.y;
+	const float fSectorSize = (float) CTerrainImpl::TERRAIN_XSIZE;
+
+	int iSectorX = (int) floorf(fU / fSectorSize);
+	int iSectorY = (int) floorf(fV / fSectorSize);
+	const int iStepX = (fDirU > 0.0f) ? 1 : ((fDirU < 0.0f) ? -1 : 0);
+	const int iStepY = (fDirV > 0.0f) ? 1 : ((fDirV < 0.0f) ? -1 : 0);
+
+	float fTNextX = iStepX ? ((iSectorX + (iStepX > 0)) * fSectorSize - fU) / fDirU : FLT_MAX;
+	float fTNextY = iStepY ? ((iSectorY + (iStepY > 0)) * fSectorSize - fV) / fDirV : FLT_MAX;
+	const float fTDeltaX = iStepX ? fSectorSize / fabsf(fDirU) : FLT_MAX;
+	const float fTDeltaY = iStepY ? fSectorSize / fabsf(fDirV) : FLT_MAX;
+
+	float fT = 0.0f;
+	for (;;)
 	{
-		D3DXVec3Lerp(&v3CurPos, &v3Start, &v3End, fPos*fRayRangeInv);
-		BYTE byTerrainNum;
-		float fMultiplier = 1.0f;
-		if (GetTerrainNum(v3CurPos.x, v3CurPos.y, &byTerrainNum))
+		const int iOffsetX = iSectorX - m_CurCoordinate.m_sTerrainCoordX;
+		const int iOffsetY = iSectorY - m_CurCoordinate.m_sTerrainCoordY;
+
+		// Heading away from the loaded sectors, nothing left to hit
+		if ((iOffsetX > LOAD_SIZE_WIDTH && iStepX >= 0) || (iOffsetX < -LOAD_SIZE_WIDTH && iStepX <= 0) ||
+			(iOffsetY > LOAD_SIZE_WIDTH && iStepY >= 0) || (iOffsetY < -LOAD_SIZE_WIDTH && iStepY <= 0))
+			return false;
+
+		const float fTExit = std::min(std::min(fTNextX, fTNextY), fLimit);
+
+		CTerrain * pTerrain;
+		if (abs(iOffsetX) <= LOAD_SIZE_WIDTH && abs(iOffsetY) <= LOAD_SIZE_WIDTH &&
+			GetTerrainPointer((iOffsetY + LOAD_SIZE_WIDTH) * (LOAD_SIZE_WIDTH * 2 + 1) + iOffsetX + LOAD_SIZE_WIDTH, &pTerrain))
 		{
-			if (GetTerrainPointer(byTerrainNum, &pTerrain))
+			float fHitT;
+			if (pTerrain->IntersectRay(v3Start, v3Dir, fT, fTExit, &fHitT))
 			{
-				int ix, iy;
-				PR_FLOAT_TO_INT(v3CurPos.x, ix);
-				PR_FLOAT_TO_INT(fabs(v3CurPos.y), iy);
-				float fMapHeight = pTerrain->GetHeight(ix, iy);
-				if ( fMapHeight >= v3CurPos.z)
-				{
-					*pv3Pick = v3CurPos;
-					return true;
-				}
-				else
-				{
-					fMultiplier = fMAX(1.0f, 0.01f * ( v3CurPos.z - fMapHeight ) );
-				}
+				*pv3Pick = v3Start + v3Dir * fHitT;
+				return true;
 			}
 		}
-		fPos += fStep * fMultiplier;
-	}
 
-	return false;
+		if (fTExit >= fLimit)
+			return false;
+
+		if (fTNextX < fTNextY)
+		{
+			iSectorX += iStepX;
+			fT = fTNextX;
+			fTNextX += fTDeltaX;
+		}
+		else
+		{
+			iSectorY += iStepY;
+			fT = fTNextY;
+			fTNextY += fTDeltaY;
+		}
+	}
 }
+
 bool CMapOutdoor::GetPickingPointWithRay(const CRay & rRay, D3DXVECTOR3 * v3IntersectPt)
 {
 	bool bObjectPick = false;
@@ -498,15 +566,7 @@ bool CMapOutdoor::GetPickingPointWithRay(const CRay & rRay, D3DXVECTOR3 * v3Inte
 		}		
 	}	
 	
-	float fPos = 0.0f;
-	//float fStep = 1.0f;
-	//float fRayRangeInv=1.0f/fRayRange;
-
-	bTerrainPick=true;
-	if (!__PickTerrainHeight(fPos, v3Start, v3End, 5.0f, fRayRange, 5000.0f, &v3TerrainPick))
-		if (!__PickTerrainHeight(fPos, v3Start, v3End, 10.0f, fRayRange, 10000.0f, &v3TerrainPick))
-			if (!__PickTerrainHeight(fPos, v3Start, v3End, 100.0f, fRayRange, 100000.0f, &v3TerrainPick))
-					bTerrainPick=false;
+	bTerrainPick = __PickTerrain(v3Start, v3End, fRayRange, &v3TerrainPick);
 	
 	
 	if (bObjectPick && bTerrainPick)
@@ -550,12 +610,7 @@ bool CMapOutdoor::GetPickingPointWithRayOnlyTerrain(const CRay & rRay, D3DXVECTO
 	
 
 	
-	float fPos = 0.0f;	
-	bTerrainPick=true;
-	if (!__PickTerrainHeight(fPos, v3Start, v3End, 5.0f, fRayRange, 5000.0f, &v3TerrainPick))
-		if (!__PickTerrainHeight(fPos, v3Start, v3End, 10.0f, fRayRange, 10000.0f, &v3TerrainPick))
-			if (!__PickTerrainHeight(fPos, v3Start, v3End, 100.0f, fRayRange, 100000.0f, &v3TerrainPick))
-					bTerrainPick=false;
+	bTerrainPick = __PickTerrain(v3Start, v3End, fRayRange, &v3TerrainPick);
 	
 	if (bTerrainPick)
 	{
@@ -705,6 +760,67 @@ float CMapOutdoor::GetHeight(float fx, float fy)
 	return fTerrainHeight;
 }
 
+void CMapOutdoor::GetHeights(std::span<const D3DXVECTOR2> c_kPoints, std::span<float> kHeights)
+{
+	assert(c_kPoints.size() == kHeights.size());
+	const size_t uCount = std::min(c_kPoints.size(), kHeights.size());
+	if (0 == uCount)
+		return;
+
+	float fMinX = c_kPoints[0].x, fMaxX = c_kPoints[0].x;
+	float fMinY = c_kPoints[0].y, fMaxY = c_kPoints[0].y;
+	for (size_t i = 1; i < uCount; ++i)
+	{
+		fMinX = std::min(fMinX, c_kPoints[i].x);
+		fMaxX = std::max(fMaxX, c_kPoints[i].x);
+		fMinY = std::min(fMinY, c_kPoints[i].y);
+		fMaxY = std::max(fMaxY, c_kPoints[i].y);
+	}
+
+	// One lookup for points spread over the map would test each of them against too many objects
+	const float MAX_BATCH_RADIUS = 5000.0f;
+	const float fRadius = 0.5f * sqrtf((fMaxX - fMinX) * (fMaxX - fMinX) + (fMaxY - fMinY) * (fMaxY - fMinY));
+
+	if (m_bEnableTerrainOnlyForHeight || fRadius > MAX_BATCH_RADIUS)
+	{
+		for (size_t i = 0; i < uCount; ++i)
+			kHeights[i] = GetHeight(c_kPoints[i].x, c_kPoints[i].y);
+		return;
+	}
+
+	Vector3d aVector3d;
+	aVector3d.Set((fMinX + fMaxX) * 0.5f, -(fMinY + fMaxY) * 0.5f, 0.0f);
+
+	FCollectHeightObject kCollectHeightObject;
+	CCullingManager::Instance().RangeTest2d(aVector3d, fRadius, &kCollectHeightObject);
+
+	const float CHECK_HEIGHT = 25000.0f;
+
+	for (size_t i = 0; i < uCount; ++i)
+	{
+		const float fx = c_kPoints[i].x;
+		const float fy = c_kPoints[i].y;
+
+		// What GetHeight finds through PointTest2d: the objects whose circle holds the point
+		float fReturnHeight = 0.0f;
+		bool bHeightFound = false;
+
+		for (const FCollectHeightObject::SItem & c_rkItem : kCollectHeightObject.m_kVct_kItem)
+		{
+			const float dx = fx - c_rkItem.fX;
+			const float dy = -fy - c_rkItem.fY;
+			if (dx * dx + dy * dy > c_rkItem.fRadius2)
+				continue;
+
+			if (c_rkItem.pInstance->GetObjectHeight(fx, fy, &fReturnHeight))
+				bHeightFound = true;
+		}
+
+		const float fObjectHeight = bHeightFound ? fReturnHeight : -CHECK_HEIGHT;
+		kHeights[i] = fMAX(fObjectHeight, GetTerrainHeight(fx, fy));
+	}
+}
+
 float CMapOutdoor::GetCacheHeight(float fx, float fy)
 {
 	unsigned int nx=int(fx);
@@ -16,6 +16,7 @@
 
 #include "MonsterAreaInfo.h"
 
+#include <span>
 
 #define LOAD_SIZE_WIDTH				1
 
@@ -85,10 +86,19 @@ class CMapOutdoor : public CMapBase
 		virtual bool	Load(float x, float y, float z);
 		virtual float	GetHeight(float x, float y);
 		virtual float	GetCacheHeight(float x, float y);
+		// GetHeight for many points at once, kHeights[i] receives the height at c_kPoints[i]
+		void			GetHeights(std::span<const D3DXVECTOR2> c_kPoints, std::span<float> kHeights);
 
 		virtual bool	Update(float fX, float fY, float fZ);
 		virtual void	UpdateAroundAmbience(float fX, float fY, float fZ);
 
+		// Sector loading in two steps. Decode* read the files into a new, cleared object and
+		// may run on any thread, Finish* create the device resources on the render thread.
+		bool			DecodeTerrain(CTerrain * pTerrain);
+		void			FinishTerrain(CTerrain * pTerrain);
+		bool			DecodeArea(CArea * pArea);
+		void			FinishArea(CArea * pArea);
+
 	public:
 		void			Clear();
 
@@ -149,7 +159,7 @@ class CMapOutdoor : public CMapBase
 		DWORD			GetShadowMapColor(float fx, float fy);
 
 	protected:
-		bool			__PickTerrainHeight(float& fPos, const D3DXVECTOR3& v3Start, const D3DXVECTOR3& v3End, float fStep, float fRayRange, float fLimitRange, D3DXVECTOR3* pv3Pick);
+		bool			__PickTerrain(const D3DXVECTOR3& v3Start, const D3DXVECTOR3& v3End, float fRayRange, D3DXVECTOR3* pv3Pick);
 
 		virtual void	__ClearGarvage();
 		virtual void	__UpdateGarvage();
@@ -754,6 +764,18 @@ class CMapOutdoor : public CMapBase
 		std::string		m_settings_envDataName;
 		std::string		m_envDataName;
 
+	private:
+		void __PrefetchTerrainData(float fX, float fY);
+
+		// Streaming: requests the sectors around where the player is heading
+		void __UpdateStreaming(const D3DXVECTOR3 & c_rv3Player);
+		UINT __GetResidentSectorCount() const;
+
+		CAreaLoaderThread	m_kAreaLoader;
+		D3DXVECTOR3			m_v3StreamPrevPlayer;
+		D3DXVECTOR3			m_v3StreamVelocity;		// smoothed, units per ms
+		DWORD				m_dwStreamPrevTime;
+
 	private:
 		bool m_bSettingTerrainVisible;
 };
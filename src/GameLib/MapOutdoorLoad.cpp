@@ -3,10 +3,9 @@
 #include "AreaTerrain.h"
 #include "AreaLoaderThread.h"
 #include "EterLib/ResourceManager.h"
+#include "EterLib/GameThreadPool.h"
 #include "PackLib/PackManager.h"
 
-//CAreaLoaderThread CMapOutdoor::ms_AreaLoaderThread;
-
 bool CMapOutdoor::Load(float x, float y, float z)
 {
 	Destroy();
@@ -25,6 +24,8 @@ bool CMapOutdoor::Load(float x, float y, float z)
 	if (!LoadSetting(strFileName.c_str()))
 		TraceError("CMapOutdoor::Load : LoadSetting(%s) Failed", strFileName.c_str());
 
+	__PrefetchTerrainData(x, y);
+
 	CreateTerrainPatchProxyList();
 	BuildQuadTree();
 	LoadWaterTexture();
@@ -61,6 +62,57 @@ bool CMapOutdoor::Load(float x, float y, float z)
 	return true;
 }
 
+// Reads and decodes the terrain and area files around the start position on a worker
+// while the quad tree and textures are being built, so Update finds them in the pack cache.
+void CMapOutdoor::__PrefetchTerrainData(float fX, float fY)
+{
+	if (m_sTerrainCountX <= 0 || m_sTerrainCountY <= 0)
+		return;
+
+	static const char* c_aszTerrainFiles[] =
+	{
+		"AreaProperty.txt", "height.raw", "tile.raw", "attr.atr", "water.wtr",
+		"shadowmap.dds", "shadowmap.raw", "minimap.dds", "AreaData.txt", "AreaAmbienceData.txt",
+	};
+
+	int ix, iy;
+	PR_FLOAT_TO_INT(fX, ix);
+	PR_FLOAT_TO_INT(fabsf(fY), iy);
+
+	const short sCoordX = MINMAX(0, ix / CTerrainImpl::TERRAIN_XSIZE, m_sTerrainCountX - 1);
+	const short sCoordY = MINMAX(0, iy / CTerrainImpl::TERRAIN_YSIZE, m_sTerrainCountY - 1);
+
+	auto pPaths = std::make_shared<std::vector<std::string>>();
+	char szFileName[256];
+
+	for (short y = std::max(sCoordY - LOAD_SIZE_WIDTH, 0); y <= std::min(sCoordY + LOAD_SIZE_WIDTH, m_sTerrainCountY - 1); ++y)
+	{
+		for (short x = std::max(sCoordX - LOAD_SIZE_WIDTH, 0); x <= std::min(sCoordX + LOAD_SIZE_WIDTH, m_sTerrainCountX - 1); ++x)
+		{
+			const unsigned long ulID = (unsigned long) (x) * 1000L + (unsigned long) (y);
+			for (const char* c_szFile : c_aszTerrainFiles)
+			{
+				_snprintf(szFileName, sizeof(szFileName), "%s\\%06u\\%s", GetMapDataDirectory().c_str(), ulID, c_szFile);
+				pPaths->push_back(szFileName);
+			}
+		}
+	}
+
+	CGameThreadPool* pThreadPool = CGameThreadPool::InstancePtr();
+	if (!pThreadPool || !pThreadPool->IsInitialized())
+	{
+		std::vector<std::string_view> vec_svPath(pPaths->begin(), pPaths->end());
+		CPackManager::Instance().Prefetch(vec_svPath);
+		return;
+	}
+
+	pThreadPool->Submit([pPaths]()
+	{
+		std::vector<std::string_view> vec_svPath(pPaths->begin(), pPaths->end());
+		CPackManager::Instance().Prefetch(vec_svPath, true);
+	}, CGameThreadPool::PRIORITY_LOW);
+}
+
 std::string& CMapOutdoor::GetEnvironmentDataName()
 {
 	return m_envDataName;
@@ -155,46 +207,105 @@ bool CMapOutdoor::LoadArea(WORD wAreaCoordX, WORD wAreaCoordY, WORD wCellCoordX,
 {
 	if (isAreaLoaded(wAreaCoordX, wAreaCoordY))
 		return true;
+
+	CArea * pArea;
+	if (m_kAreaLoader.TakeArea(wAreaCoordX, wAreaCoordY, &pArea))
+	{
+		m_AreaVector.push_back(pArea);
+		return true;
+	}
+
 #ifdef _DEBUG
 	DWORD dwStartTime = ELTimer_GetMSec();
 #endif
-	unsigned long ulID = (unsigned long) (wAreaCoordX) * 1000L + (unsigned long) (wAreaCoordY);
-	char szAreaPathName[64+1];
-	_snprintf(szAreaPathName, sizeof(szAreaPathName), "%s\\%06u\\", GetMapDataDirectory().c_str(), ulID);
-
-	CArea * pArea = CArea::New();
+	pArea = CArea::New();
 	pArea->SetMapOutDoor(this);
-#ifdef _DEBUG
-	Tracef("CMapOutdoor::LoadArea1 %d\n", ELTimer_GetMSec() - dwStartTime);
-	dwStartTime = ELTimer_GetMSec();
-#endif
-
 	pArea->SetCoordinate(wAreaCoordX, wAreaCoordY);
-	if ( !pArea->Load(szAreaPathName) )
-		TraceError(" CMapOutdoor::LoadArea(%d, %d) LoadShadowMap ERROR", wAreaCoordX, wAreaCoordY);
+	pArea->Clear();
+
+	DecodeArea(pArea);
+	FinishArea(pArea);
 #ifdef _DEBUG
-	Tracef("CMapOutdoor::LoadArea2 %d\n", ELTimer_GetMSec() - dwStartTime);
-	dwStartTime = ELTimer_GetMSec();
+	Tracef("CMapOutdoor::LoadArea %d\n", ELTimer_GetMSec() - dwStartTime);
 #endif
 
 	m_AreaVector.push_back(pArea);
+	return true;
+}
 
-	pArea->EnablePortal(m_bEnablePortal);
-#ifdef _DEBUG
-	Tracef("CMapOutdoor::LoadArea3 %d\n", ELTimer_GetMSec() - dwStartTime);
-#endif
+// Reads the object lists into pArea on any thread. Whether their properties exist is
+// checked by FinishArea, CPropertyManager is only used from the render thread.
+bool CMapOutdoor::DecodeArea(CArea * pArea)
+{
+	WORD wAreaCoordX, wAreaCoordY;
+	pArea->GetCoordinate(&wAreaCoordX, &wAreaCoordY);
+
+	unsigned long ulID = (unsigned long) (wAreaCoordX) * 1000L + (unsigned long) (wAreaCoordY);
+	char szAreaPathName[64+1];
+	_snprintf(szAreaPathName, sizeof(szAreaPathName), "%s\\%06u\\", GetMapDataDirectory().c_str(), ulID);
+
+	if (!pArea->LoadObjectData(szAreaPathName))
+	{
+		TraceError(" CMapOutdoor::LoadArea(%d, %d) LoadShadowMap ERROR", wAreaCoordX, wAreaCoordY);
+		return false;
+	}
 
 	return true;
 }
 
+void CMapOutdoor::FinishArea(CArea * pArea)
+{
+	pArea->BuildObjectInstances();
+	pArea->EnablePortal(m_bEnablePortal);
+}
+
 bool CMapOutdoor::LoadTerrain(WORD wTerrainCoordX, WORD wTerrainCoordY, WORD wCellCoordX, WORD wCellCoordY)
 {
 	if (isTerrainLoaded(wTerrainCoordX, wTerrainCoordY))
 		return true;
 
+	CTerrain * pTerrain;
+	if (m_kAreaLoader.TakeTerrain(wTerrainCoordX, wTerrainCoordY, &pTerrain))
+	{
+		// Decoded ahead of time, NULL when it failed
+		if (!pTerrain)
+			return false;
+
+		m_TerrainVector.push_back(pTerrain);
+		return true;
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	DWORD dwStartTime = ELTimer_GetMSec();
+
+	pTerrain = CTerrain::New();
+	pTerrain->Clear();
+	pTerrain->SetMapOutDoor(this);
+	pTerrain->SetCoordinate(wTerrainCoordX, wTerrainCoordY);
+
+	if (!DecodeTerrain(pTerrain))
+	{
+		CTerrain::Delete(pTerrain);
+		return false;
+	}
+
+	FinishTerrain(pTerrain);
 	
+	Tracef("CMapOutdoor::LoadTerrain %d\n", ELTimer_GetMSec() - dwStartTime);
+
+	m_TerrainVector.push_back(pTerrain);
+
+	return true;
+}
+
+// Reads everything the terrain keeps in memory, so CAreaLoaderThread runs it on a worker.
+// It writes to pTerrain alone. Besides the packs, which lock, it reads the map directory and
+// the view settings of the map, and Destroy shuts the loader down before those change.
+bool CMapOutdoor::DecodeTerrain(CTerrain * pTerrain)
+{
+	WORD wTerrainCoordX, wTerrainCoordY;
+	pTerrain->GetCoordinate(&wTerrainCoordX, &wTerrainCoordY);
+
 	unsigned long ulID = (unsigned long) (wTerrainCoordX) * 1000L + (unsigned long) (wTerrainCoordY);
 	char filename[256];
 	sprintf(filename, "%s\\%06u\\AreaProperty.txt", GetMapDataDirectory().c_str(), ulID);
@@ -228,13 +339,6 @@ bool CMapOutdoor::LoadTerrain(WORD wTerrainCoordX, WORD wTerrainCoordY, WORD wCe
 		return false;
 	}
 
-	CTerrain * pTerrain = CTerrain::New();
-	
-	pTerrain->Clear();
-	pTerrain->SetMapOutDoor(this);
-	
-	pTerrain->SetCoordinate(wTerrainCoordX, wTerrainCoordY);
-	
 	pTerrain->CopySettingFromGlobalSetting();
 	
 	char szRawHeightFieldname[64+1];
@@ -252,6 +356,10 @@ bool CMapOutdoor::LoadTerrain(WORD wTerrainCoordX, WORD wTerrainCoordY, WORD wCe
 	_snprintf(szShadowTexName, sizeof(szShadowTexName), "%s\\%06u\\shadowmap.dds", GetMapDataDirectory().c_str(), ulID);
 	_snprintf(szShadowMapName, sizeof(szShadowMapName), "%s\\%06u\\shadowmap.raw", GetMapDataDirectory().c_str(), ulID);
 	_snprintf(szMiniMapTexName, sizeof(szMiniMapTexName), "%s\\%06u\\minimap.dds", GetMapDataDirectory().c_str(), ulID);
+
+	// The textures are created by FinishTerrain, have their files decompressed by then
+	std::string_view asvTexture[] = { szShadowTexName, szMiniMapTexName };
+	CPackManager::Instance().Prefetch(asvTexture, true);
 	
 	if(!pTerrain->LoadWaterMap(szWaterMapName))
 		TraceError(" CMapOutdoor::LoadTerrain(%d, %d) LoadWaterMap ERROR", wTerrainCoordX, wTerrainCoordY);
@@ -262,25 +370,35 @@ bool CMapOutdoor::LoadTerrain(WORD wTerrainCoordX, WORD wTerrainCoordY, WORD wCe
 	if (!pTerrain->LoadAttrMap(szAttrMapName))
 		TraceError(" CMapOutdoor::LoadTerrain(%d, %d) LoadAttrMap ERROR", wTerrainCoordX, wTerrainCoordY);
 
-	if (!pTerrain->RAW_LoadTileMap(szSplatName))
+	if (!pTerrain->RAW_DecodeTileMap(szSplatName))
 		TraceError(" CMapOutdoor::LoadTerrain(%d, %d) RAW_LoadTileMap ERROR", wTerrainCoordX, wTerrainCoordY);
 
-	pTerrain->LoadShadowTexture(szShadowTexName);
-
 	if (!pTerrain->LoadShadowMap(szShadowMapName))
 		TraceError(" CMapOutdoor::LoadTerrain(%d, %d) LoadShadowMap ERROR", wTerrainCoordX, wTerrainCoordY);
 
-	pTerrain->LoadMiniMapTexture(szMiniMapTexName);
 	pTerrain->SetName(c_rstrAreaName.c_str());
+	return true;
+}
+
+// The device side of the terrain, on the render thread
+void CMapOutdoor::FinishTerrain(CTerrain * pTerrain)
+{
+	WORD wTerrainCoordX, wTerrainCoordY;
+	pTerrain->GetCoordinate(&wTerrainCoordX, &wTerrainCoordY);
+
+	unsigned long ulID = (unsigned long) (wTerrainCoordX) * 1000L + (unsigned long) (wTerrainCoordY);
+	char szShadowTexName[64+1];
+	char szMiniMapTexName[64+1];
+
+	_snprintf(szShadowTexName, sizeof(szShadowTexName), "%s\\%06u\\shadowmap.dds", GetMapDataDirectory().c_str(), ulID);
+	_snprintf(szMiniMapTexName, sizeof(szMiniMapTexName), "%s\\%06u\\minimap.dds", GetMapDataDirectory().c_str(), ulID);
+
+	pTerrain->RAW_CreateSplatTextures();
+	pTerrain->LoadShadowTexture(szShadowTexName);
+	pTerrain->LoadMiniMapTexture(szMiniMapTexName);
 	pTerrain->CalculateTerrainPatch();
 	
 	pTerrain->SetReady();
-	
-	Tracef("CMapOutdoor::LoadTerrain %d\n", ELTimer_GetMSec() - dwStartTime);
-
-	m_TerrainVector.push_back(pTerrain);
-
-	return true;
 }
 
 bool CMapOutdoor::LoadSetting(const char * c_szFileName)
@@ -117,6 +117,7 @@ bool CMapOutdoor::Update(float fX, float fY, float fZ)
 	DWORD t4=ELTimer_GetMSec();
 #endif
 	__UpdateGarvage();
+	__UpdateStreaming(v3Player);
 #ifdef __PERFORMANCE_CHECKER__
 	DWORD t5=ELTimer_GetMSec();
 #endif
@@ -868,6 +869,87 @@ void CMapOutdoor::__UpdateGarvage()
 	}
 }
 
+namespace
+{
+	// How far ahead the player's movement is extrapolated
+	const float STREAM_LOOKAHEAD_MS = 5000.0f;
+	// Weight of the newest sample in the smoothed velocity
+	const float STREAM_VELOCITY_BLEND = 0.1f;
+}
+
+// Requests the sectors around where the player is heading while the map stays under the
+// sector budget, and hands one decoded sector a frame to the render thread.
+void CMapOutdoor::__UpdateStreaming(const D3DXVECTOR3 & c_rv3Player)
+{
+	const DWORD dwCurTime = ELTimer_GetMSec();
+	const DWORD dwElapsed = dwCurTime - m_dwStreamPrevTime;
+	const D3DXVECTOR3 v3Delta = c_rv3Player - m_v3StreamPrevPlayer;
+
+	// The first frame, a hitch or a warp is no movement
+	if (0 == m_dwStreamPrevTime || dwElapsed > 1000 ||
+		fabsf(v3Delta.x) > CTerrainImpl::TERRAIN_XSIZE || fabsf(v3Delta.y) > CTerrainImpl::TERRAIN_YSIZE)
+		m_v3StreamVelocity = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+	else if (dwElapsed > 0)
+		m_v3StreamVelocity += (v3Delta / (float) dwElapsed - m_v3StreamVelocity) * STREAM_VELOCITY_BLEND;
+
+	m_v3StreamPrevPlayer = c_rv3Player;
+	m_dwStreamPrevTime = dwCurTime;
+
+	m_kAreaLoader.Publish();
+
+	if (!CAreaLoaderThread::IsEnabled() || m_CurCoordinate.m_sTerrainCoordX < 0 || m_CurCoordinate.m_sTerrainCoordY < 0)
+		return;
+
+	// Nothing requested stays in view farther than the predicted sector's neighbours
+	m_kAreaLoader.Discard(m_CurCoordinate.m_sTerrainCoordX, m_CurCoordinate.m_sTerrainCoordY, LOAD_SIZE_WIDTH * 2);
+
+	const D3DXVECTOR3 v3Predicted = c_rv3Player + m_v3StreamVelocity * STREAM_LOOKAHEAD_MS;
+
+	int ix, iy;
+	PR_FLOAT_TO_INT(v3Predicted.x, ix);
+	PR_FLOAT_TO_INT(fabsf(v3Predicted.y), iy);
+
+	const short sCoordX = MINMAX(0, ix / CTerrainImpl::TERRAIN_XSIZE, m_sTerrainCountX - 1);
+	const short sCoordY = MINMAX(0, iy / CTerrainImpl::TERRAIN_YSIZE, m_sTerrainCountY - 1);
+
+	// Standing still, Update already loaded everything around the player
+	if (sCoordX == m_CurCoordinate.m_sTerrainCoordX && sCoordY == m_CurCoordinate.m_sTerrainCoordY)
+		return;
+
+	const short sMinX = std::max(sCoordX - LOAD_SIZE_WIDTH, 0);
+	const short sMaxX = std::min(sCoordX + LOAD_SIZE_WIDTH, m_sTerrainCountX - 1);
+	const short sMinY = std::max(sCoordY - LOAD_SIZE_WIDTH, 0);
+	const short sMaxY = std::min(sCoordY + LOAD_SIZE_WIDTH, m_sTerrainCountY - 1);
+
+	for (WORD wY = sMinY; wY <= sMaxY; ++wY)
+	{
+		for (WORD wX = sMinX; wX <= sMaxX; ++wX)
+		{
+			// A sector without terrain still loads its area, so that one counts too
+			if (isTerrainLoaded(wX, wY) || isAreaLoaded(wX, wY) || m_kAreaLoader.IsRequested(wX, wY))
+				continue;
+
+			if (__GetResidentSectorCount() >= CAreaLoaderThread::GetSectorBudget())
+			{
+				// Sectors left behind go first
+				if (m_TerrainDeleteVector.empty() && m_AreaDeleteVector.empty())
+					return;
+
+				__ClearGarvage();
+				if (__GetResidentSectorCount() >= CAreaLoaderThread::GetSectorBudget())
+					return;
+			}
+
+			m_kAreaLoader.Request(wX, wY);
+		}
+	}
+}
+
+UINT CMapOutdoor::__GetResidentSectorCount() const
+{
+	return m_TerrainVector.size() + m_TerrainDeleteVector.size() + m_kAreaLoader.GetSectorCount();
+}
+
 void CMapOutdoor::UpdateAreaList(long lCenterX, long lCenterY)
 {
 	if (m_TerrainVector.size() <= AROUND_AREA_NUM && m_AreaVector.size() <= AROUND_AREA_NUM)
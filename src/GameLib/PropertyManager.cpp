@@ -1,9 +1,29 @@
 #include "StdAfx.h"
 #include "PackLib/PackManager.h"
+#include "EterLib/GameThreadPool.h"
+#include "EterLib/Profiler.h"
 
 #include "PropertyManager.h"
 #include "Property.h"
 
+static CProperty * __LoadProperty(const char * c_pszFileName)
+{
+	TPackFile file;
+
+	if (!CPackManager::Instance().GetFile(c_pszFileName, file))
+		return NULL;
+
+	CProperty * pProperty = new CProperty(c_pszFileName);
+
+	if (!pProperty->ReadFromMemory(file.data(), file.size(), c_pszFileName))
+	{
+		delete pProperty;
+		return NULL;
+	}
+
+	return pProperty;
+}
+
 CPropertyManager::CPropertyManager() : m_isFileMode(true)
 {
 }
@@ -15,6 +35,8 @@ CPropertyManager::~CPropertyManager()
 
 bool CPropertyManager::Initialize(const char * c_pszPackFileName)
 {
+	PROFILE_FUNCTION();
+
 	if (c_pszPackFileName)
 	{
 		m_pack = std::make_shared<CPack>();
@@ -25,21 +47,20 @@ bool CPropertyManager::Initialize(const char * c_pszPackFileName)
 
 		m_isFileMode = false;
 
-		const auto& index = m_pack->GetIndex();
-		for (const auto& entry : index)
-		{
-			m_fileDict.emplace(entry.file_name, std::make_pair(m_pack, entry));
-		}
+		std::vector<std::string> kVct_stFileName;
+		kVct_stFileName.reserve(m_pack->GetEntryCount());
 
-		for (auto it = m_fileDict.begin(); it != m_fileDict.end(); ++it) {
-			std::string stFileName = it->second.second.file_name;
+		for (size_t i = 0; i < m_pack->GetEntryCount(); ++i) {
+			std::string stFileName(m_pack->GetEntryName(m_pack->GetEntry(i)));
 			if (!stricmp("property/reserve", stFileName.c_str())) {
 				LoadReservedCRC(stFileName.c_str());
 			}
 			else {
-				Register(stFileName.c_str());
+				kVct_stFileName.push_back(std::move(stFileName));
 			}
 		}
+
+		__RegisterParallel(kVct_stFileName);
 	}
 	else
 	{
@@ -88,7 +109,7 @@ DWORD CPropertyManager::GetUniqueCRC(const char * c_szSeed)
 		DWORD dwCRC = GetCRC32(stTmp.c_str(), stTmp.length());
 
 		if (m_ReservedCRCSet.find(dwCRC) == m_ReservedCRCSet.end() &&
-			m_PropertyByCRCMap.find(dwCRC) == m_PropertyByCRCMap.end())
+			__FindProperty(dwCRC) == m_PropertyByCRCMap.end())
 			return dwCRC;
 
 		char szAdd[2];
@@ -97,36 +118,132 @@ DWORD CPropertyManager::GetUniqueCRC(const char * c_szSeed)
 	}
 }
 
-bool CPropertyManager::Register(const char * c_pszFileName, CProperty ** ppProperty)
+CPropertyManager::TPropertyCRCMap::iterator CPropertyManager::__FindProperty(DWORD dwCRC)
 {
-	TPackFile file;
+	TPropertyCRCMap::iterator itor = std::lower_bound(m_PropertyByCRCMap.begin(), m_PropertyByCRCMap.end(), dwCRC,
+		[](const TPropertyCRCMap::value_type & c_rkPair, DWORD dwKey) { return c_rkPair.first < dwKey; });
 
-	if (!CPackManager::Instance().GetFile(c_pszFileName, file))
-		return false;
-
-	CProperty * pProperty = new CProperty(c_pszFileName);
+	if (itor != m_PropertyByCRCMap.end() && itor->first == dwCRC)
+		return itor;
 
-	if (!pProperty->ReadFromMemory(file.data(), file.size(), c_pszFileName))
-	{
-		delete pProperty;
-		return false;
-	}
+	return m_PropertyByCRCMap.end();
+}
 
+void CPropertyManager::__InsertProperty(CProperty * pProperty)
+{
 	DWORD dwCRC = pProperty->GetCRC();
 
-	TPropertyCRCMap::iterator itor = m_PropertyByCRCMap.find(dwCRC);
+	TPropertyCRCMap::iterator itor = std::lower_bound(m_PropertyByCRCMap.begin(), m_PropertyByCRCMap.end(), dwCRC,
+		[](const TPropertyCRCMap::value_type & c_rkPair, DWORD dwKey) { return c_rkPair.first < dwKey; });
 
-	if (m_PropertyByCRCMap.end() != itor)
+	if (itor != m_PropertyByCRCMap.end() && itor->first == dwCRC)
 	{
 		Tracef("Property already registered, replace %s to %s\n",
 				itor->second->GetFileName(),
-				c_pszFileName);
+				pProperty->GetFileName());
 
 		delete itor->second;
 		itor->second = pProperty;
 	}
 	else
-		m_PropertyByCRCMap.insert(TPropertyCRCMap::value_type(dwCRC, pProperty));
+		m_PropertyByCRCMap.insert(itor, TPropertyCRCMap::value_type(dwCRC, pProperty));
+}
+
+// Reads and parses the files on the thread pool, then merges them in the given order,
+// so a CRC found twice still resolves to the later file like with Register.
+void CPropertyManager::__RegisterParallel(const std::vector<std::string> & c_rkVct_stFileName)
+{
+	CGameThreadPool * pPool = CGameThreadPool::InstancePtr();
+	if (!pPool || !pPool->IsInitialized())
+	{
+		PROFILE_ZONE("Register properties");
+
+		for (const std::string & c_rstFileName : c_rkVct_stFileName)
+			Register(c_rstFileName.c_str());
+		return;
+	}
+
+	const size_t c_uFileCount = c_rkVct_stFileName.size();
+	std::vector<CProperty *> kVct_pProperty(c_uFileCount, NULL);
+
+	// A few chunks per worker keep them busy without a task per file
+	const size_t c_uChunkSize = std::max<size_t>(32, c_uFileCount / (pPool->GetWorkerCount() * 4 + 1) + 1);
+
+	{
+		PROFILE_ZONE("Load properties");
+
+		CGameTaskGroup kGroup;
+		for (size_t uBegin = 0; uBegin < c_uFileCount; uBegin += c_uChunkSize)
+		{
+			const size_t c_uEnd = std::min(uBegin + c_uChunkSize, c_uFileCount);
+
+			pPool->Submit([&c_rkVct_stFileName, &kVct_pProperty, uBegin, c_uEnd]()
+			{
+				for (size_t i = uBegin; i < c_uEnd; ++i)
+					kVct_pProperty[i] = __LoadProperty(c_rkVct_stFileName[i].c_str());
+			}, CGameThreadPool::PRIORITY_NORMAL, &kGroup);
+		}
+
+		try
+		{
+			pPool->WaitAll(kGroup);
+		}
+		catch (const std::exception & e)
+		{
+			TraceError("CPropertyManager: failed to load properties: %s", e.what());
+		}
+	}
+
+	PROFILE_ZONE("Merge properties");
+
+	std::vector<std::pair<DWORD, size_t> > kVct_kLoaded;
+	kVct_kLoaded.reserve(c_uFileCount);
+
+	for (size_t i = 0; i < c_uFileCount; ++i)
+		if (kVct_pProperty[i])
+			kVct_kLoaded.push_back(std::make_pair(kVct_pProperty[i]->GetCRC(), i));
+
+	std::stable_sort(kVct_kLoaded.begin(), kVct_kLoaded.end(),
+		[](const std::pair<DWORD, size_t> & c_rkLeft, const std::pair<DWORD, size_t> & c_rkRight) { return c_rkLeft.first < c_rkRight.first; });
+
+	TPropertyCRCMap kVct_kProperty;
+	kVct_kProperty.reserve(kVct_kLoaded.size());
+
+	for (const std::pair<DWORD, size_t> & c_rkLoaded : kVct_kLoaded)
+	{
+		CProperty * pProperty = kVct_pProperty[c_rkLoaded.second];
+
+		if (!kVct_kProperty.empty() && kVct_kProperty.back().first == c_rkLoaded.first)
+		{
+			Tracef("Property already registered, replace %s to %s\n",
+					kVct_kProperty.back().second->GetFileName(),
+					pProperty->GetFileName());
+
+			delete kVct_kProperty.back().second;
+			kVct_kProperty.back().second = pProperty;
+		}
+		else
+			kVct_kProperty.push_back(TPropertyCRCMap::value_type(c_rkLoaded.first, pProperty));
+	}
+
+	if (m_PropertyByCRCMap.empty())
+	{
+		m_PropertyByCRCMap.swap(kVct_kProperty);
+		return;
+	}
+
+	for (const TPropertyCRCMap::value_type & c_rkProperty : kVct_kProperty)
+		__InsertProperty(c_rkProperty.second);
+}
+
+bool CPropertyManager::Register(const char * c_pszFileName, CProperty ** ppProperty)
+{
+	CProperty * pProperty = __LoadProperty(c_pszFileName);
+
+	if (!pProperty)
+		return false;
+
+	__InsertProperty(pProperty);
 
 	if (ppProperty)
 		*ppProperty = pProperty;
@@ -141,7 +258,7 @@ bool CPropertyManager::Get(const char * c_pszFileName, CProperty ** ppProperty)
 
 bool CPropertyManager::Get(DWORD dwCRC, CProperty ** ppProperty)
 {
-	TPropertyCRCMap::iterator itor = m_PropertyByCRCMap.find(dwCRC);
+	TPropertyCRCMap::iterator itor = __FindProperty(dwCRC);
 
 	if (m_PropertyByCRCMap.end() == itor)
 		return false;
@@ -21,12 +21,16 @@ class CPropertyManager : public CSingleton<CPropertyManager>
 		bool			Get(const char * c_pszFileName, CProperty ** ppProperty);
 
 	protected:
-		typedef std::map<DWORD, CProperty *>		TPropertyCRCMap;
+		// Sorted by CRC, looked up with a binary search
+		typedef std::vector<std::pair<DWORD, CProperty *> >	TPropertyCRCMap;
 		typedef std::set<DWORD>						TCRCSet;
 
+		TPropertyCRCMap::iterator					__FindProperty(DWORD dwCRC);
+		void										__InsertProperty(CProperty * pProperty);
+		void										__RegisterParallel(const std::vector<std::string> & c_rkVct_stFileName);
+
 		bool										m_isFileMode;
 		TPropertyCRCMap								m_PropertyByCRCMap;
 		TCRCSet										m_ReservedCRCSet;
 		std::shared_ptr<CPack>						m_pack;
-		TPackFileMap								m_fileDict;
 };
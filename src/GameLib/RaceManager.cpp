@@ -266,6 +266,21 @@ bool CRaceManager::__LoadRaceMotionList(CRaceData& rkRaceData, const char* pathN
 	stMotionFileName = "";
 
 	UINT uLineCount=kTextFileLoader.GetLineCount();
+
+	// Let the OS start reading every motion of the list while they are registered one by one
+	{
+		std::vector<std::string> vec_stPrefetchName;
+		vec_stPrefetchName.reserve(uLineCount);
+		for (UINT uLineIndex=0; uLineIndex<uLineCount; ++uLineIndex)
+		{
+			if (3 == sscanf(kTextFileLoader.GetLineString(uLineIndex).c_str(), "%s %s %s", szMode, szType, szFile))
+				vec_stPrefetchName.push_back(std::string(pathName) + szFile);
+		}
+
+		std::vector<std::string_view> vec_svPrefetchName(vec_stPrefetchName.begin(), vec_stPrefetchName.end());
+		CPackManager::Instance().Prefetch(vec_svPrefetchName);
+	}
+
 	for (UINT uLineIndex=0; uLineIndex<uLineCount; ++uLineIndex)
 	{
 		DWORD motionType = CRaceMotionData::NAME_NONE;
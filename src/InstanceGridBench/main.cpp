@@ -0,0 +1,346 @@
+#include "EterLib/StdAfx.h"
+#include "EterLib/PositionGrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Moves synthetic actors around a square map and runs the neighbour search of
+// CInstanceBase::CheckAdvancing for every one of them each frame, once as the scan over the
+// alive map it used before CInstanceGrid and once as a grid refresh followed by a radius
+// query per actor, candidates sorted by VID. Reports ms per frame for both.
+// Exits with EXIT_FAILURE if the two find different collisions, or a radius, rect or
+// nearest query disagrees with a brute force scan.
+
+using TClock = std::chrono::steady_clock;
+
+static const int TYPE_COUNT = 8;				// CActorInstance::EType values in use
+static const float COLLISION_RADIUS = 150.0f;
+static const float QUERY_RADIUS = 800.0f + 200.0f;	// CELL_SIZE + CInstanceGrid::POSITION_SLACK
+
+struct TActor
+{
+	DWORD vid;
+	float x;
+	float y;
+	UINT type;
+};
+
+using TGrid = CPositionGrid<TActor>;
+using TActorMap = std::map<DWORD, TActor*>;
+
+struct TBenchOptions
+{
+	int frames;
+	int queries;
+	float step;
+};
+
+// Kept out of line like CActorInstance::TestActorCollision, so the scan cannot be folded away
+#ifdef _MSC_VER
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+static bool TestCollision(const TActor* source, const TActor* target)
+{
+	const float dx = source->x - target->x;
+	const float dy = source->y - target->y;
+	return dx * dx + dy * dy < 4.0f * COLLISION_RADIUS * COLLISION_RADIUS;
+}
+
+static std::vector<TActor> MakeActors(int count, float size, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(0.0f, size);
+	std::uniform_int_distribution<UINT> type(0, TYPE_COUNT - 1);
+
+	std::vector<TActor> actors(count);
+	for (int i = 0; i < count; ++i) {
+		actors[i].vid = static_cast<DWORD>(i + 1);
+		actors[i].x = position(random);
+		actors[i].y = position(random);
+		actors[i].type = type(random);
+	}
+
+	return actors;
+}
+
+static void MoveActors(std::vector<TActor>& actors, float size, float step, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> move(-step, step);
+
+	for (TActor& actor : actors) {
+		actor.x = std::clamp(actor.x + move(random), 0.0f, size);
+		actor.y = std::clamp(actor.y + move(random), 0.0f, size);
+	}
+}
+
+// CheckAdvancing before the grid: every actor tests every alive instance
+static size_t FindByMapScan(const TActorMap& alive, std::vector<std::pair<DWORD, DWORD>>& collisions)
+{
+	size_t tests = 0;
+	for (auto source = alive.begin(); source != alive.end(); ++source) {
+		for (auto target = alive.begin(); target != alive.end(); ++target) {
+			if (source == target)
+				continue;
+
+			++tests;
+			if (TestCollision(source->second, target->second))
+				collisions.emplace_back(source->first, target->first);
+		}
+	}
+
+	return tests;
+}
+
+static size_t FindByGrid(TGrid& grid, std::vector<TActor>& actors, std::vector<std::pair<DWORD, DWORD>>& collisions)
+{
+	for (TActor& actor : actors)
+		grid.Refresh(&actor, actor.x, actor.y, TGrid::TypeMask(actor.type));
+
+	TGrid::TObjectVector near;
+	size_t tests = 0;
+
+	for (TActor& source : actors) {
+		near.clear();
+		grid.FindInRadius(source.x, source.y, QUERY_RADIUS, TGrid::TYPE_MASK_ALL, &near);
+		std::sort(near.begin(), near.end(), [](const TActor* left, const TActor* right) { return left->vid < right->vid; });
+
+		for (const TActor* target : near) {
+			if (target == &source)
+				continue;
+
+			++tests;
+			if (TestCollision(&source, target))
+				collisions.emplace_back(source.vid, target->vid);
+		}
+	}
+
+	return tests;
+}
+
+static std::vector<DWORD> SortedVIDs(const TGrid::TObjectVector& found)
+{
+	std::vector<DWORD> vids;
+	for (const TActor* actor : found)
+		vids.push_back(actor->vid);
+
+	std::sort(vids.begin(), vids.end());
+	return vids;
+}
+
+static float DistanceSq(const TActor& actor, float x, float y)
+{
+	const float dx = actor.x - x;
+	const float dy = actor.y - y;
+	return dx * dx + dy * dy;
+}
+
+static bool IsOddVID(TActor* actor)
+{
+	return actor->vid & 1;
+}
+
+static bool CheckQueries(const TGrid& grid, const std::vector<TActor>& actors, float size, int queries, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(-0.1f * size, 1.1f * size);
+	std::uniform_real_distribution<float> extent(0.0f, 0.25f * size);
+	std::uniform_int_distribution<DWORD> mask(1, (1u << TYPE_COUNT) - 1);
+	std::uniform_int_distribution<UINT> count(1, 16);
+
+	for (int query = 0; query < queries; ++query) {
+		const float x = position(random);
+		const float y = position(random);
+		const float radius = extent(random);
+		const DWORD type_mask = query % 4 == 0 ? static_cast<DWORD>(TGrid::TYPE_MASK_ALL) : mask(random);
+
+		TGrid::TObjectVector found;
+		std::vector<DWORD> expected;
+
+		grid.FindInRadius(x, y, radius, type_mask, &found);
+		for (const TActor& actor : actors)
+			if ((TGrid::TypeMask(actor.type) & type_mask) && DistanceSq(actor, x, y) <= radius * radius)
+				expected.push_back(actor.vid);
+
+		if (SortedVIDs(found) != expected) {
+			std::cerr << "Radius query " << query << " found " << found.size() << " actors, expected " << expected.size() << std::endl;
+			return false;
+		}
+
+		const float right = x + extent(random);
+		const float bottom = y + extent(random);
+		found.clear();
+		expected.clear();
+
+		grid.FindInRect(x, y, right, bottom, type_mask, &found);
+		for (const TActor& actor : actors)
+			if ((TGrid::TypeMask(actor.type) & type_mask) && actor.x >= x && actor.x <= right && actor.y >= y && actor.y <= bottom)
+				expected.push_back(actor.vid);
+
+		if (SortedVIDs(found) != expected) {
+			std::cerr << "Rect query " << query << " found " << found.size() << " actors, expected " << expected.size() << std::endl;
+			return false;
+		}
+
+		// Nearest results are compared by distance, equally distant actors may come in any order
+		const UINT nearest = count(random);
+		const bool filtered = query % 2 == 1;
+		found.clear();
+
+		grid.FindNearest(x, y, nearest, radius, type_mask, &found, filtered ? IsOddVID : NULL);
+
+		std::vector<float> expected_distances;
+		for (const TActor& actor : actors) {
+			if (!(TGrid::TypeMask(actor.type) & type_mask) || (filtered && !(actor.vid & 1)))
+				continue;
+
+			const float distance_sq = DistanceSq(actor, x, y);
+			if (distance_sq <= radius * radius)
+				expected_distances.push_back(distance_sq);
+		}
+
+		std::sort(expected_distances.begin(), expected_distances.end());
+		expected_distances.resize(std::min<size_t>(nearest, expected_distances.size()));
+
+		std::vector<float> distances;
+		for (const TActor* actor : found)
+			distances.push_back(DistanceSq(*actor, x, y));
+
+		if (distances != expected_distances) {
+			std::cerr << "Nearest query " << query << " found " << found.size() << " actors, expected " << expected_distances.size() << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool Run(int count, float size, const TBenchOptions& options)
+{
+	std::mt19937 random(static_cast<unsigned>(count) * 31u + static_cast<unsigned>(size));
+	std::vector<TActor> actors = MakeActors(count, size, random);
+
+	TActorMap alive;
+	for (TActor& actor : actors)
+		alive[actor.vid] = &actor;
+
+	TGrid grid;
+	std::vector<std::pair<DWORD, DWORD>> scan_collisions, grid_collisions;
+	double scan_ms = 0.0, grid_ms = 0.0;
+	size_t scan_tests = 0, grid_tests = 0;
+
+	for (int frame = 0; frame < options.frames; ++frame) {
+		MoveActors(actors, size, options.step, random);
+
+		scan_collisions.clear();
+		grid_collisions.clear();
+
+		auto begin = TClock::now();
+		scan_tests += FindByMapScan(alive, scan_collisions);
+		scan_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+		begin = TClock::now();
+		grid_tests += FindByGrid(grid, actors, grid_collisions);
+		grid_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+		if (scan_collisions != grid_collisions) {
+			std::cerr << count << " actors, frame " << frame << ": the grid found " << grid_collisions.size()
+				<< " collisions, the scan " << scan_collisions.size() << std::endl;
+			return false;
+		}
+	}
+
+	if (grid.GetCount() != actors.size()) {
+		std::cerr << "Grid holds " << grid.GetCount() << " of " << actors.size() << " actors" << std::endl;
+		return false;
+	}
+
+	if (!CheckQueries(grid, actors, size, options.queries, random))
+		return false;
+
+	// Half of them leave, the rest must still be found
+	for (size_t i = 0; i < actors.size(); i += 2)
+		grid.Remove(&actors[i]);
+
+	std::vector<TActor> staying;
+	for (size_t i = 1; i < actors.size(); i += 2)
+		staying.push_back(actors[i]);
+
+	if (!CheckQueries(grid, staying, size, options.queries, random))
+		return false;
+
+	TGrid::TObjectVector left;
+	grid.FindInRect(-size, -size, 2.0f * size, 2.0f * size, TGrid::TYPE_MASK_ALL, &left);
+	if (left.size() != staying.size() || grid.GetCount() != staying.size()) {
+		std::cerr << "Grid holds " << left.size() << " actors after removal, expected " << staying.size() << std::endl;
+		return false;
+	}
+
+	printf("%7d %8.0f px %9.2f ms %9.2f ms %12.0f %12.0f\n", count, size, scan_ms / options.frames, grid_ms / options.frames,
+		double(scan_tests) / options.frames, double(grid_tests) / options.frames);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("InstanceGridBench");
+
+	program.add_argument("--actors")
+		.nargs(argparse::nargs_pattern::at_least_one)
+		.default_value(std::vector<int>{ 1000, 2000, 5000 })
+		.scan<'i', int>()
+		.help("Alive instances, one run per count and map size");
+
+	program.add_argument("--sizes")
+		.nargs(argparse::nargs_pattern::at_least_one)
+		.default_value(std::vector<int>{ 8000, 40000 })
+		.scan<'i', int>()
+		.help("Side of the square map in pixels");
+
+	program.add_argument("--frames")
+		.default_value(10)
+		.scan<'i', int>()
+		.help("Frames per run");
+
+	program.add_argument("--queries")
+		.default_value(200)
+		.scan<'i', int>()
+		.help("Random radius, rect and nearest queries checked per run");
+
+	program.add_argument("--step")
+		.default_value(20.0f)
+		.scan<'g', float>()
+		.help("Largest move per axis and frame in pixels");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.frames = std::max(1, program.get<int>("--frames"));
+	options.queries = std::max(0, program.get<int>("--queries"));
+	options.step = std::max(0.0f, program.get<float>("--step"));
+
+	printf("%d frames, %d checked queries per run\n", options.frames, options.queries);
+	printf("%7s %11s %12s %12s %12s %12s\n", "actors", "map", "map scan", "grid", "scan tests", "grid tests");
+
+	for (int size : program.get<std::vector<int>>("--sizes")) {
+		for (int count : program.get<std::vector<int>>("--actors")) {
+			if (!Run(std::max(1, count), static_cast<float>(std::max(1, size)), options))
+				return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,471 @@
+#include "GameLib/StdAfx.h"
+#include "GameLib/ItemManager.h"
+#include "EterBase/lzo.h"
+#include "EterGrnLib/Thing.h"
+#include "EterLib/ResourceManager.h"
+#include "PackLib/PackManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Writes a synthetic item_proto and the icons of a share of its items to a scratch folder,
+// then loads it with CItemManager::LoadItemTable and with the loader it replaced, a
+// std::map of pooled CItemData that checked up to three icon files per item while loading.
+// Files are read in file load mode, so a missing icon costs a filesystem lookup as it does
+// for files outside the packs. Reports load time, vnum lookup time and the cost of the
+// icon lookups CItemData now does on the first GetIconImage of an item.
+// Exits with EXIT_FAILURE if an item, its table or its icon file differs between the two.
+
+using TClock = std::chrono::steady_clock;
+using TItemTable = CItemData::TItemTable;
+
+DWORD GetHashCode(const char* pString);
+
+static DWORD s_adwItemProtoKey[4] =
+{
+	173217,
+	72619434,
+	408587239,
+	27973291
+};
+
+static const DWORD EMPTY_BOWL_VNUM = 27995;
+static const DWORD RANGE_VNUM_BASE = 1000000;
+
+struct TBenchOptions
+{
+	int items;
+	double icon_share;
+	int runs;
+	int lookups;
+	int inventory;
+};
+
+static TItemTable MakeRow(DWORD vnum, DWORD name_vnum)
+{
+	TItemTable row = {};
+	row.dwVnum = vnum;
+	snprintf(row.szName, sizeof(row.szName), "item_%u", static_cast<unsigned>(name_vnum));
+	snprintf(row.szLocaleName, sizeof(row.szLocaleName), "Item %u", static_cast<unsigned>(vnum));
+	row.bType = static_cast<BYTE>(name_vnum % 30);
+	row.dwIBuyItemPrice = vnum * 7;
+	return row;
+}
+
+// Items come in groups of ten refine levels, the way item_proto numbers them. Most groups
+// share one name, and only some levels have their own icon, the rest borrow one. One item
+// in 500 is a range item, numbered apart from the others so its range holds no item.
+static std::vector<TItemTable> MakeTable(const TBenchOptions& options, std::mt19937& random, std::vector<DWORD>& icon_vnums)
+{
+	std::uniform_real_distribution<double> pick(0.0, 1.0);
+	std::uniform_int_distribution<int> gap(1, 4);
+
+	const int range_count = std::max(1, options.items / 500);
+	const int level_count = std::max(1, options.items - range_count);
+
+	std::vector<TItemTable> table;
+	table.reserve(level_count + range_count);
+
+	for (DWORD base = 10; static_cast<int>(table.size()) < level_count; base += 10 * gap(random)) {
+		const bool shared_name = pick(random) < 0.66;
+
+		for (DWORD level = 0; level < 10 && static_cast<int>(table.size()) < level_count; ++level) {
+			table.push_back(MakeRow(base + level, shared_name ? base : base + level));
+
+			if (0 == level || pick(random) < options.icon_share)
+				icon_vnums.push_back(base + level);
+		}
+	}
+
+	for (int i = 0; i < range_count; ++i) {
+		TItemTable row = MakeRow(RANGE_VNUM_BASE + i * 100, RANGE_VNUM_BASE + i * 100);
+		row.dwVnumRange = 50;
+		table.push_back(row);
+	}
+
+	icon_vnums.push_back(EMPTY_BOWL_VNUM);
+
+	// item_proto is not sorted by vnum
+	std::shuffle(table.begin(), table.end(), random);
+	return table;
+}
+
+static bool WriteItemProto(const std::filesystem::path& path, std::vector<TItemTable>& table)
+{
+	CLZObject zObj;
+	if (!CLZO::Instance().CompressEncryptedMemory(zObj, table.data(), UINT(table.size() * sizeof(TItemTable)), s_adwItemProtoKey)) {
+		std::cerr << "Cannot compress the item table" << std::endl;
+		return false;
+	}
+
+	const DWORD header[] = {
+		MAKEFOURCC('M', 'I', 'P', 'X'),
+		1,
+		sizeof(TItemTable),
+		static_cast<DWORD>(table.size()),
+		zObj.GetSize(),
+	};
+
+	std::ofstream ofs(path, std::ios::binary);
+	ofs.write(reinterpret_cast<const char*>(header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(zObj.GetBuffer()), zObj.GetSize());
+	return ofs.good();
+}
+
+static bool WriteIcons(const std::filesystem::path& folder, const std::vector<DWORD>& icon_vnums)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(folder / "icon" / "item", ec);
+
+	char name[64 + 1];
+	for (DWORD vnum : icon_vnums) {
+		snprintf(name, sizeof(name), "icon/item/%05u.tga", static_cast<unsigned>(vnum));
+
+		std::ofstream ofs(folder / name, std::ios::binary);
+		if (!ofs.is_open()) {
+			std::cerr << "Cannot write " << (folder / name).string() << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// CItemManager::LoadItemTable before the sorted vector: a std::map of pooled CItemData, the
+// icon file picked while loading
+class COldItemLoader
+{
+	public:
+		~COldItemLoader() { Destroy(); }
+
+		void Destroy()
+		{
+			for (auto& item : m_items)
+				CItemData::Delete(item.second);
+
+			m_items.clear();
+			m_range_items.clear();
+		}
+
+		size_t GetStatCount() const { return m_stats; }
+
+		CItemData* Find(DWORD vnum)
+		{
+			auto f = m_items.find(vnum);
+			return m_items.end() == f ? NULL : f->second;
+		}
+
+		size_t GetCount() const { return m_items.size(); }
+
+		bool LoadItemTable(const char* c_szFileName)
+		{
+			TPackFile file;
+			if (!CPackManager::Instance().GetFile(c_szFileName, file))
+				return false;
+
+			// The MIPX header of WriteItemProto: fourcc, version, stride, elements, data size
+			DWORD adwHeader[5];
+			memcpy(adwHeader, file.data(), sizeof(adwHeader));
+
+			const DWORD dwElements = adwHeader[3];
+			const DWORD dwDataSize = adwHeader[4];
+
+			BYTE* pbData = new BYTE[dwDataSize];
+			memcpy(pbData, file.data() + sizeof(adwHeader), dwDataSize);
+
+			CLZObject zObj;
+			if (!CLZO::Instance().Decompress(zObj, pbData, s_adwItemProtoKey)) {
+				delete[] pbData;
+				return false;
+			}
+
+			char szName[64 + 1];
+			TItemTable* table = (TItemTable*)zObj.GetBuffer();
+			std::map<DWORD, DWORD> itemNameMap;
+
+			for (DWORD i = 0; i < dwElements; ++i, ++table) {
+				CItemData* pItemData;
+				DWORD dwVnum = table->dwVnum;
+
+				auto f = m_items.find(dwVnum);
+				if (m_items.end() == f) {
+					_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", dwVnum);
+
+					if (!__IsFileExist(szName)) {
+						auto itVnum = itemNameMap.find(GetHashCode(table->szName));
+
+						if (itVnum != itemNameMap.end())
+							_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", itVnum->second);
+						else
+							_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", dwVnum - dwVnum % 10);
+
+						if (!__IsFileExist(szName))
+							_snprintf(szName, sizeof(szName), "icon/item/%05d.tga", EMPTY_BOWL_VNUM);
+					}
+
+					pItemData = CItemData::New();
+					pItemData->SetDefaultItemData(szName);
+					m_items.insert(std::make_pair(dwVnum, pItemData));
+				}
+				else {
+					pItemData = f->second;
+				}
+
+				if (itemNameMap.find(GetHashCode(table->szName)) == itemNameMap.end())
+					itemNameMap.insert(std::make_pair(GetHashCode(table->szName), table->dwVnum));
+
+				pItemData->SetItemTableData(table);
+				if (0 != table->dwVnumRange)
+					m_range_items.push_back(pItemData);
+			}
+
+			delete[] pbData;
+			return true;
+		}
+
+	protected:
+		bool __IsFileExist(const char* c_szFileName)
+		{
+			++m_stats;
+			return CResourceManager::Instance().IsFileExist(c_szFileName);
+		}
+
+	protected:
+		std::map<DWORD, CItemData*> m_items;
+		std::vector<CItemData*> m_range_items;
+		size_t m_stats = 0;
+};
+
+static CResource* NewThing(const char* c_szFileName)
+{
+	return new CGraphicThing(c_szFileName);
+}
+
+static double Median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+static bool Compare(COldItemLoader& old_loader, const std::vector<TItemTable>& table)
+{
+	CItemManager& rkItemMgr = CItemManager::Instance();
+
+	if (old_loader.GetCount() != table.size()) {
+		std::cerr << "The old loader holds " << old_loader.GetCount() << " of " << table.size() << " items" << std::endl;
+		return false;
+	}
+
+	for (const TItemTable& row : table) {
+		CItemData* old_item = old_loader.Find(row.dwVnum);
+		CItemData* new_item = NULL;
+
+		if (!old_item || !rkItemMgr.GetItemDataPointer(row.dwVnum, &new_item)) {
+			std::cerr << "Item " << row.dwVnum << " is missing" << std::endl;
+			return false;
+		}
+
+		if (memcmp(old_item->GetTable(), new_item->GetTable(), sizeof(TItemTable)) != 0) {
+			std::cerr << "Item " << row.dwVnum << " has a different table" << std::endl;
+			return false;
+		}
+
+		if (old_item->GetIconImageFileName() != new_item->GetIconImageFileName()) {
+			std::cerr << "Item " << row.dwVnum << " uses " << new_item->GetIconImageFileName() << ", the old loader "
+				<< old_item->GetIconImageFileName() << std::endl;
+			return false;
+		}
+	}
+
+	// Vnums inside a range resolve to the range item
+	for (const TItemTable& row : table) {
+		if (0 == row.dwVnumRange)
+			continue;
+
+		CItemData* item = NULL;
+		if (!rkItemMgr.GetItemDataPointer(row.dwVnum + row.dwVnumRange - 1, &item) || item->GetTable()->dwVnum != row.dwVnum) {
+			std::cerr << "Range item " << row.dwVnum << " is not found by a vnum inside its range" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool Run(const TBenchOptions& options)
+{
+	CItemManager& rkItemMgr = CItemManager::Instance();
+	std::mt19937 random(1);
+
+	std::vector<DWORD> icon_vnums;
+	std::vector<TItemTable> table = MakeTable(options, random, icon_vnums);
+
+	if (!WriteItemProto("item_proto", table) || !WriteIcons(".", icon_vnums))
+		return false;
+
+	COldItemLoader old_loader;
+	std::vector<double> old_ms, new_ms;
+	double resolve_us = 0.0;
+
+	std::vector<DWORD> inventory;
+	std::uniform_int_distribution<size_t> row(0, table.size() - 1);
+	for (int i = 0; i < options.inventory; ++i)
+		inventory.push_back(table[row(random)].dwVnum);
+
+	for (int run = 0; run < options.runs; ++run) {
+		old_loader.Destroy();
+		rkItemMgr.Destroy();
+
+		auto begin = TClock::now();
+		if (!old_loader.LoadItemTable("item_proto")) {
+			std::cerr << "The old loader cannot load item_proto" << std::endl;
+			return false;
+		}
+		old_ms.push_back(std::chrono::duration<double, std::milli>(TClock::now() - begin).count());
+
+		begin = TClock::now();
+		if (!rkItemMgr.LoadItemTable("item_proto")) {
+			std::cerr << "CItemManager cannot load item_proto" << std::endl;
+			return false;
+		}
+		new_ms.push_back(std::chrono::duration<double, std::milli>(TClock::now() - begin).count());
+
+		// What opening an inventory costs now, the first time its icons are shown
+		begin = TClock::now();
+		for (DWORD vnum : inventory) {
+			CItemData* item;
+			if (rkItemMgr.GetItemDataPointer(vnum, &item))
+				item->GetIconImageFileName();
+		}
+		resolve_us += std::chrono::duration<double, std::micro>(TClock::now() - begin).count();
+	}
+
+	const size_t stats_per_load = old_loader.GetStatCount() / options.runs;
+
+	if (!Compare(old_loader, table))
+		return false;
+
+	std::vector<DWORD> queries(options.lookups);
+	for (DWORD& vnum : queries)
+		vnum = table[row(random)].dwVnum;
+
+	size_t checksum = 0;
+	auto begin = TClock::now();
+	for (DWORD vnum : queries)
+		checksum += old_loader.Find(vnum)->GetTable()->dwIBuyItemPrice;
+	const double old_lookup_ns = std::chrono::duration<double, std::nano>(TClock::now() - begin).count() / queries.size();
+
+	begin = TClock::now();
+	for (DWORD vnum : queries) {
+		CItemData* item;
+		if (rkItemMgr.GetItemDataPointer(vnum, &item))
+			checksum -= item->GetTable()->dwIBuyItemPrice;
+	}
+	const double new_lookup_ns = std::chrono::duration<double, std::nano>(TClock::now() - begin).count() / queries.size();
+
+	if (checksum != 0) {
+		std::cerr << "Lookups returned different items" << std::endl;
+		return false;
+	}
+
+	printf("%zu items, %zu icon files, %d runs\n", table.size(), icon_vnums.size(), options.runs);
+	printf("load     std::map %8.2f ms (%zu icon lookups)   sorted vector %8.2f ms\n", Median(old_ms), stats_per_load, Median(new_ms));
+	printf("lookup   std::map %8.1f ns                      sorted vector %8.1f ns\n", old_lookup_ns, new_lookup_ns);
+	printf("icons    first %d GetIconImage of a load resolve in %.1f us\n", options.inventory, resolve_us / options.runs);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("ItemBench");
+
+	program.add_argument("--items")
+		.default_value(20000)
+		.scan<'i', int>()
+		.help("Rows in the item table, one in 500 a range item");
+
+	program.add_argument("--icon-share")
+		.default_value(0.3)
+		.scan<'g', double>()
+		.help("Share of the items past the first refine level with an icon of their own");
+
+	program.add_argument("--runs")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Loads per loader, the median is reported");
+
+	program.add_argument("--lookups")
+		.default_value(2000000)
+		.scan<'i', int>()
+		.help("Random vnum lookups per loader");
+
+	program.add_argument("--inventory")
+		.default_value(180)
+		.scan<'i', int>()
+		.help("Items whose icons are looked up after each load");
+
+	program.add_argument("--work-dir")
+		.default_value(std::string("item_bench"))
+		.help("Scratch folder for item_proto and the icons, removed afterwards");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.items = std::max(1, program.get<int>("--items"));
+	options.icon_share = std::clamp(program.get<double>("--icon-share"), 0.0, 1.0);
+	options.runs = std::max(1, program.get<int>("--runs"));
+	options.lookups = std::max(1, program.get<int>("--lookups"));
+	options.inventory = std::max(0, program.get<int>("--inventory"));
+
+	const std::filesystem::path work_dir = std::filesystem::absolute(program.get<std::string>("--work-dir"));
+	const std::filesystem::path start_dir = std::filesystem::current_path();
+
+	std::error_code ec;
+	std::filesystem::remove_all(work_dir, ec);
+	if (!std::filesystem::create_directories(work_dir, ec)) {
+		std::cerr << "Cannot create " << work_dir.string() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success;
+	{
+		CLZO lzo;
+		CPackManager pack_manager;
+		CResourceManager resource_manager;
+		CItemManager item_manager;
+
+		// Items ask for their drop model while loading
+		resource_manager.RegisterResourceNewFunctionPointer("gr2", NewThing, "model");
+
+		// Everything comes from the scratch folder, missing files are looked up on disk
+		pack_manager.SetFileLoadMode();
+		std::filesystem::current_path(work_dir);
+
+		success = Run(options);
+
+		item_manager.Destroy();
+		CItemData::DestroySystem();
+		resource_manager.Destroy();
+	}
+
+	std::filesystem::current_path(start_dir);
+	std::filesystem::remove_all(work_dir, ec);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,435 @@
+#ifdef _WIN32
+#include "EterLib/StdAfx.h"
+
+typedef int socklen_t;
+#define MSG_NOSIGNAL 0
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#endif
+
+#include "EterLib/ControlPackets.h"
+#include "EterLib/NetworkThread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Loopback stand-in for the game server. A local socket pair carries plaintext frames,
+// KEY_COMPLETE and then frames encrypted with SecureCipher, sent in bursts every ms.
+// The client side runs a game loop that sleeps for a render frame between two network
+// updates, once with select + one recv per frame like CNetworkStream::Process and once
+// with CNetworkThread. Every frame is checked for its sequence number across the key
+// switch, a mismatch exits with EXIT_FAILURE.
+
+using TClock = std::chrono::steady_clock;
+
+#pragma pack(push, 1)
+struct TBenchFrame
+{
+	uint16_t header;
+	uint16_t length;
+	uint32_t sequence;
+	int64_t sent_ns;
+	uint8_t padding[24];
+};
+#pragma pack(pop)
+
+static const uint16_t BENCH_FRAME_HEADER = 0x0205;
+
+struct TBenchOptions
+{
+	int plain_frames;
+	int frames;
+	int burst;
+	int render_ms;
+};
+
+struct TBenchResult
+{
+	bool ok = true;
+	size_t game_frames = 0;
+	uint64_t bytes = 0;
+	double total_ms = 0.0;
+	double io_ms = 0.0;
+	double io_max_ms = 0.0;
+	std::vector<double> latencies_us;
+};
+
+static int64_t NowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now().time_since_epoch()).count();
+}
+
+static void CloseSocket(SOCKET sock)
+{
+#ifdef _WIN32
+	closesocket(sock);
+#else
+	close(sock);
+#endif
+}
+
+static bool SetNonBlocking(SOCKET sock)
+{
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	return ioctlsocket(sock, FIONBIO, &non_blocking) == 0;
+#else
+	return fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+// A connected pair over 127.0.0.1 on a free port, the client end does not block
+static bool MakeSocketPair(SOCKET& client, SOCKET& server)
+{
+	SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET)
+		return false;
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	socklen_t addr_len = sizeof(addr);
+	if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+		|| listen(listener, 1) != 0
+		|| getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+		CloseSocket(listener);
+		return false;
+	}
+
+	client = socket(AF_INET, SOCK_STREAM, 0);
+	if (client == INVALID_SOCKET || connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+		if (client != INVALID_SOCKET)
+			CloseSocket(client);
+		CloseSocket(listener);
+		return false;
+	}
+
+	server = accept(listener, nullptr, nullptr);
+	CloseSocket(listener);
+
+	if (server == INVALID_SOCKET) {
+		CloseSocket(client);
+		return false;
+	}
+
+	const int no_delay = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+	setsockopt(server, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+
+	if (!SetNonBlocking(client)) {
+		CloseSocket(client);
+		CloseSocket(server);
+		return false;
+	}
+
+	return true;
+}
+
+static bool SendAll(SOCKET sock, const uint8_t* data, size_t size)
+{
+	while (size > 0) {
+		const int sent = send(sock, reinterpret_cast<const char*>(data), static_cast<int>(size), MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+
+		data += sent;
+		size -= static_cast<size_t>(sent);
+	}
+
+	return true;
+}
+
+// Plaintext frames, KEY_COMPLETE, then the rest encrypted, burst frames every ms
+static void RunServer(SOCKET sock, SecureCipher& cipher, const TBenchOptions& options)
+{
+	std::vector<uint8_t> out;
+	out.reserve(static_cast<size_t>(options.burst) * sizeof(TBenchFrame));
+
+	int sequence = 0;
+	while (sequence < options.frames) {
+		out.clear();
+
+		for (int i = 0; i < options.burst && sequence < options.frames; ++i, ++sequence) {
+			if (sequence == options.plain_frames && !cipher.IsActivated()) {
+				TPacketGCKeyComplete key_complete = {};
+				key_complete.header = GC::KEY_COMPLETE;
+				key_complete.length = sizeof(key_complete);
+
+				const size_t offset = out.size();
+				out.resize(offset + sizeof(key_complete));
+				memcpy(&out[offset], &key_complete, sizeof(key_complete));
+
+				// Everything after KEY_COMPLETE goes out encrypted
+				cipher.SetActivated(true);
+			}
+
+			TBenchFrame frame = {};
+			frame.header = BENCH_FRAME_HEADER;
+			frame.length = sizeof(frame);
+			frame.sequence = static_cast<uint32_t>(sequence);
+			frame.sent_ns = NowNs();
+
+			const size_t offset = out.size();
+			out.resize(offset + sizeof(frame));
+			memcpy(&out[offset], &frame, sizeof(frame));
+			cipher.EncryptInPlace(&out[offset], sizeof(frame));
+		}
+
+		if (!SendAll(sock, out.data(), out.size()))
+			return;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+// Select + one recv of what fits, as CNetworkStream::__RecvInternalBuffer does per frame
+static bool RecvOnce(SOCKET sock, SecureCipher& cipher, RingBuffer& buffer)
+{
+	fd_set read_set;
+	FD_ZERO(&read_set);
+	FD_SET(sock, &read_set);
+
+	timeval timeout = {};
+	if (select(static_cast<int>(sock) + 1, &read_set, nullptr, nullptr, &timeout) <= 0 || !FD_ISSET(sock, &read_set))
+		return true;
+
+	buffer.EnsureWritable(4096);
+
+	const int received = recv(sock, reinterpret_cast<char*>(buffer.WritePtr()), static_cast<int>(buffer.WritableBytes()), 0);
+	if (received <= 0)
+		return false;
+
+	if (cipher.IsActivated())
+		cipher.DecryptInPlace(buffer.WritePtr(), static_cast<size_t>(received));
+
+	buffer.CommitWrite(static_cast<size_t>(received));
+	return true;
+}
+
+static TBenchResult RunClient(bool use_thread, const TBenchOptions& options)
+{
+	TBenchResult result;
+
+	SecureCipher server_cipher, client_cipher;
+	uint8_t server_pk[SecureCipher::PK_SIZE], client_pk[SecureCipher::PK_SIZE];
+
+	if (!server_cipher.Initialize() || !client_cipher.Initialize()) {
+		std::cerr << "Failed to initialize the ciphers" << std::endl;
+		result.ok = false;
+		return result;
+	}
+
+	server_cipher.GetPublicKey(server_pk);
+	client_cipher.GetPublicKey(client_pk);
+
+	if (!server_cipher.ComputeServerKeys(client_pk) || !client_cipher.ComputeClientKeys(server_pk)) {
+		std::cerr << "Failed to compute the session keys" << std::endl;
+		result.ok = false;
+		return result;
+	}
+
+	SOCKET client = INVALID_SOCKET, server = INVALID_SOCKET;
+	if (!MakeSocketPair(client, server)) {
+		std::cerr << "Failed to open a loopback connection" << std::endl;
+		result.ok = false;
+		return result;
+	}
+
+	RingBuffer buffer;
+	buffer.Reserve(64 * 1024);
+
+	std::unique_ptr<CNetworkThread> network_thread;
+	if (use_thread) {
+		network_thread = std::make_unique<CNetworkThread>(client, client_cipher);
+		network_thread->Start();
+	}
+
+	std::thread server_thread(RunServer, server, std::ref(server_cipher), std::cref(options));
+
+	result.latencies_us.reserve(static_cast<size_t>(options.frames));
+
+	uint32_t expected = 0;
+	bool connected = true;
+	const int64_t start_ns = NowNs();
+
+	while (expected < static_cast<uint32_t>(options.frames) && result.ok && connected) {
+		const int64_t io_start_ns = NowNs();
+
+		if (network_thread) {
+			result.bytes += network_thread->Drain(buffer);
+			connected = !network_thread->IsDisconnected();
+		}
+		else {
+			const size_t before = buffer.ReadableBytes();
+			connected = RecvOnce(client, client_cipher, buffer);
+			result.bytes += buffer.ReadableBytes() - before;
+		}
+
+		const double io_ms = double(NowNs() - io_start_ns) / 1e6;
+		result.io_ms += io_ms;
+		result.io_max_ms = std::max(result.io_max_ms, io_ms);
+		++result.game_frames;
+
+		// Dispatch whatever arrived whole, like the packet handlers would
+		while (buffer.ReadableBytes() >= sizeof(uint16_t) * 2) {
+			uint16_t header, length;
+			memcpy(&header, buffer.ReadPtr(), sizeof(header));
+			memcpy(&length, buffer.ReadPtr() + sizeof(header), sizeof(length));
+
+			if (buffer.ReadableBytes() < length)
+				break;
+
+			if (header == GC::KEY_COMPLETE) {
+				buffer.Discard(length);
+				client_cipher.SetActivated(true);
+
+				// Same as CNetworkStream::DecryptPendingRecvData
+				if (network_thread)
+					network_thread->OnCipherActivated();
+				else if (buffer.ReadableBytes())
+					client_cipher.DecryptInPlace(buffer.DataAt(buffer.ReadPos()), buffer.ReadableBytes());
+				continue;
+			}
+
+			TBenchFrame frame;
+			if (header != BENCH_FRAME_HEADER || length != sizeof(frame)) {
+				std::cerr << "Garbled frame after " << expected << " frames" << std::endl;
+				result.ok = false;
+				break;
+			}
+
+			memcpy(&frame, buffer.ReadPtr(), sizeof(frame));
+			buffer.Discard(length);
+
+			if (frame.sequence != expected) {
+				std::cerr << "Frame " << frame.sequence << " arrived where " << expected << " was expected" << std::endl;
+				result.ok = false;
+				break;
+			}
+
+			result.latencies_us.push_back(double(NowNs() - frame.sent_ns) / 1e3);
+			++expected;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.render_ms));
+	}
+
+	result.total_ms = double(NowNs() - start_ns) / 1e6;
+
+	if (!connected && expected < static_cast<uint32_t>(options.frames)) {
+		std::cerr << "Connection lost after " << expected << " frames" << std::endl;
+		result.ok = false;
+	}
+
+	// Closing the client end unblocks the server if the client gave up early
+	network_thread.reset();
+	CloseSocket(client);
+	server_thread.join();
+	CloseSocket(server);
+
+	return result;
+}
+
+static void PrintResult(const char* label, TBenchResult& result)
+{
+	std::vector<double>& latencies = result.latencies_us;
+	std::sort(latencies.begin(), latencies.end());
+
+	double sum = 0.0;
+	for (double latency : latencies)
+		sum += latency;
+
+	const double frames = double(std::max<size_t>(result.game_frames, 1));
+	const size_t count = latencies.size();
+
+	printf("%-7s %zu frames in %.0f ms (%.1f MB/s), game thread io %.3f ms/frame (max %.3f), latency avg %.0f us p50 %.0f us p99 %.0f us\n",
+		label, count, result.total_ms, double(result.bytes) / (1024.0 * 1024.0) / result.total_ms * 1e3,
+		result.io_ms / frames, result.io_max_ms,
+		count ? sum / double(count) : 0.0, count ? latencies[count / 2] : 0.0, count ? latencies[count * 99 / 100] : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("NetBench");
+
+	program.add_argument("--frames")
+		.default_value(200000)
+		.scan<'i', int>()
+		.help("Number of frames the server sends");
+
+	program.add_argument("--plain")
+		.default_value(100)
+		.scan<'i', int>()
+		.help("Frames sent before KEY_COMPLETE, unencrypted");
+
+	program.add_argument("--burst")
+		.default_value(1000)
+		.scan<'i', int>()
+		.help("Frames the server sends every ms");
+
+	program.add_argument("--render-ms")
+		.default_value(16)
+		.scan<'i', int>()
+		.help("Time the game loop spends between two network updates");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.frames = std::max(1, program.get<int>("--frames"));
+	options.plain_frames = std::clamp(program.get<int>("--plain"), 0, options.frames);
+	options.burst = std::max(1, program.get<int>("--burst"));
+	options.render_ms = std::max(0, program.get<int>("--render-ms"));
+
+#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(1, 1), &wsa_data) != 0) {
+		std::cerr << "WSAStartup failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+#endif
+
+	if (sodium_init() < 0) {
+		std::cerr << "sodium_init failed" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success = true;
+	for (int use_thread = 0; use_thread < 2; ++use_thread) {
+		TBenchResult result = RunClient(use_thread != 0, options);
+		PrintResult(use_thread ? "thread" : "select", result);
+		success &= result.ok;
+	}
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
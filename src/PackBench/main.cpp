@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <argparse.hpp>
+
+#include "EterBase/PathHash.h"
+#include "PackLib/PackManager.h"
+
+// Lookup and path hashing numbers over the file names of real packs, or of generated
+// paths without any pack:
+//  - the string keyed map CPackManager used to have, against the manager before and
+//    after Freeze, for the whole file list and for random lookups from 1 and N threads
+//  - HashPath throughput against normalizing first
+//  - every spelling of a path must get the key of its normalized form, and no two
+//    names may share a key
+// Exits with EXIT_FAILURE if a check fails.
+
+using TClock = std::chrono::steady_clock;
+
+// Keeps the hashing loops from being optimized away
+static volatile uint64_t g_sink;
+
+static double ElapsedNs(TClock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(TClock::now() - start).count();
+}
+
+// Upper case letters and backslashes at random, the way paths come from scripts. All of
+// them live in one pool, so the timings measure hashing rather than cache misses.
+static void MakeSpellings(const std::vector<std::string>& names, std::mt19937& rng, std::string& pool, std::vector<std::string_view>& spellings)
+{
+	size_t size = 0;
+	for (const std::string& name : names)
+		size += name.size();
+
+	pool.clear();
+	pool.reserve(size);
+
+	for (const std::string& name : names) {
+		for (char c : name) {
+			if (c == '/' && (rng() & 1))
+				c = '\\';
+			else if (c >= 'a' && c <= 'z' && (rng() & 1))
+				c = c - 'a' + 'A';
+			pool += c;
+		}
+	}
+
+	spellings.clear();
+	spellings.reserve(names.size());
+
+	size_t offset = 0;
+	for (const std::string& name : names) {
+		spellings.emplace_back(pool.data() + offset, name.size());
+		offset += name.size();
+	}
+}
+
+static std::vector<std::string> MakeSyntheticNames(size_t count, std::mt19937& rng)
+{
+	static const char* dirs[] = { "d:/ymir work/", "d:/ymir work/effect/", "d:/ymir work/pc/warrior/", "icon/item/", "locale/en/", "property/" };
+	static const char* extensions[] = { ".gr2", ".dds", ".msa", ".mse", ".txt", ".tga" };
+
+	std::unordered_set<std::string> seen;
+	std::vector<std::string> names;
+	names.reserve(count);
+
+	while (names.size() < count) {
+		std::string name = dirs[rng() % std::size(dirs)];
+		const int parts = 1 + rng() % 3;
+		for (int i = 0; i < parts; ++i) {
+			const int length = 3 + rng() % 12;
+			for (int j = 0; j < length; ++j) {
+				const int r = rng() % 37;
+				name += r < 26 ? char('a' + r) : r < 36 ? char('0' + r - 26) : '_';
+			}
+			name += i + 1 < parts ? '/' : '\0';
+		}
+		name.pop_back();
+		name += extensions[rng() % std::size(extensions)];
+
+		if (seen.insert(name).second)
+			names.push_back(std::move(name));
+	}
+
+	return names;
+}
+
+// Names of every pack, later packs override earlier ones like in the manager
+static bool LoadNames(const std::vector<std::string>& packs, std::vector<std::string>& names, uint64_t& total_size)
+{
+	std::unordered_set<std::string> seen;
+	total_size = 0;
+
+	for (const std::string& path : packs) {
+		auto pack = std::make_shared<CPack>();
+		if (!pack->Load(path)) {
+			std::cerr << "Failed to load " << path << std::endl;
+			return false;
+		}
+
+		for (size_t i = 0; i < pack->GetEntryCount(); ++i) {
+			const TPackIndexEntry& entry = pack->GetEntry(i);
+			total_size += entry.file_size;
+
+			std::string name(pack->GetEntryName(entry));
+			if (seen.insert(name).second)
+				names.push_back(std::move(name));
+		}
+	}
+
+	return true;
+}
+
+static bool CheckPathHashes(const std::vector<std::string>& names, const std::vector<std::string_view>& spellings, std::mt19937& rng)
+{
+	std::string normalized;
+
+	size_t spelling_mismatches = 0;
+	for (size_t i = 0; i < names.size(); ++i) {
+		NormalizePath(spellings[i], normalized);
+		if (normalized != names[i] || HashPath(spellings[i]) != HashPath(names[i]))
+			++spelling_mismatches;
+	}
+
+	// Any byte may come in, the folding must still match NormalizePath for both separators
+	size_t byte_mismatches = 0;
+	std::string raw, backslashed;
+	for (int i = 0; i < 1000000; ++i) {
+		raw.resize(rng() % 70);
+		for (char& c : raw)
+			c = static_cast<char>(rng() & 0xff);
+
+		NormalizePath(raw, normalized);
+		NormalizePath(raw, backslashed, '\\');
+
+		const uint64_t key = HashPath(raw);
+		if (key != HashPath(normalized) || key != HashPath(backslashed))
+			++byte_mismatches;
+	}
+
+	// Bytes that only differ in the high bit are different characters
+	if (HashPath("\xdc\xc1") == HashPath("\xdc\xe1"))
+		++byte_mismatches;
+
+	std::unordered_map<uint64_t, const std::string*> keys, pack_keys;
+	keys.reserve(names.size());
+	pack_keys.reserve(names.size());
+
+	size_t collisions = 0, pack_collisions = 0;
+	for (const std::string& name : names) {
+		auto [it, inserted] = keys.emplace(HashPath(name), &name);
+		if (!inserted) {
+			std::cerr << "HashPath collision: " << *it->second << " and " << name << std::endl;
+			++collisions;
+		}
+
+		auto [pack_it, pack_inserted] = pack_keys.emplace(PackHashPath(name), &name);
+		if (!pack_inserted) {
+			std::cerr << "PackHashPath collision: " << *pack_it->second << " and " << name << std::endl;
+			++pack_collisions;
+		}
+	}
+
+	printf("path keys: %zu names, %zu spellings off, %zu random byte strings off, %zu HashPath and %zu PackHashPath collisions\n",
+		names.size(), spelling_mismatches, byte_mismatches, collisions, pack_collisions);
+
+	return spelling_mismatches == 0 && byte_mismatches == 0 && collisions == 0 && pack_collisions == 0;
+}
+
+static void BenchPathHashes(const std::vector<std::string_view>& spellings)
+{
+	size_t total_chars = 0;
+	for (std::string_view spelling : spellings)
+		total_chars += spelling.size();
+
+	std::string buf;
+	uint64_t sink = 0;
+
+	// Best of three, the first pass also warms the caches
+	double normalize_pack = 1e300, normalize_hash = 1e300, hash_only = 1e300;
+	for (int pass = 0; pass < 3; ++pass) {
+		auto start = TClock::now();
+		for (std::string_view spelling : spellings) {
+			NormalizePath(spelling, buf);
+			sink += PackHashPath(buf);
+		}
+		normalize_pack = std::min(normalize_pack, ElapsedNs(start));
+
+		start = TClock::now();
+		for (std::string_view spelling : spellings) {
+			NormalizePath(spelling, buf);
+			sink += HashPath(buf);
+		}
+		normalize_hash = std::min(normalize_hash, ElapsedNs(start));
+
+		start = TClock::now();
+		for (std::string_view spelling : spellings)
+			sink += HashPath(spelling);
+		hash_only = std::min(hash_only, ElapsedNs(start));
+	}
+
+	g_sink = sink;
+
+	const double count = double(spellings.size());
+	printf("path hash (%.1f chars avg): NormalizePath+PackHashPath %.1f ns, NormalizePath+HashPath %.1f ns, HashPath %.1f ns (%.2f GB/s)\n",
+		double(total_chars) / count, normalize_pack / count, normalize_hash / count, hash_only / count, double(total_chars) / hash_only);
+}
+
+// Runs fn(begin, end) over [0, count) split across thread_count threads, returns ns
+template <typename TFunc>
+static double RunThreads(size_t thread_count, size_t count, TFunc fn)
+{
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count);
+
+	const auto start = TClock::now();
+	for (size_t t = 0; t < thread_count; ++t)
+		threads.emplace_back(fn, count * t / thread_count, count * (t + 1) / thread_count);
+
+	for (auto& thread : threads)
+		thread.join();
+
+	return ElapsedNs(start);
+}
+
+static bool BenchLookups(const std::vector<std::string>& packs, const std::vector<std::string_view>& spellings,
+	size_t lookup_count, size_t thread_count, size_t read_count, std::mt19937& rng)
+{
+	std::vector<uint32_t> order(lookup_count);
+	for (uint32_t& index : order)
+		index = static_cast<uint32_t>(rng() % spellings.size());
+
+	const double count = double(spellings.size());
+	const double lookups = double(lookup_count);
+	std::atomic<size_t> misses = 0;
+
+	// The map the manager kept before the freeze existed, keyed by the normalized name
+	{
+		std::vector<std::shared_ptr<CPack>> loaded;
+		std::unordered_map<std::string, TPackLookupEntry> entries;
+
+		auto start = TClock::now();
+		for (const std::string& path : packs) {
+			auto pack = std::make_shared<CPack>();
+			pack->Load(path);
+			for (size_t i = 0; i < pack->GetEntryCount(); ++i) {
+				const TPackIndexEntry& entry = pack->GetEntry(i);
+				entries[std::string(pack->GetEntryName(entry))] = { pack.get(), &entry };
+			}
+			loaded.push_back(std::move(pack));
+		}
+		const double build = ElapsedNs(start);
+
+		auto lookup = [&](size_t begin, size_t end, bool random) {
+			thread_local std::string buf;
+			size_t missed = 0;
+			for (size_t i = begin; i < end; ++i) {
+				NormalizePath(spellings[random ? order[i] : i], buf);
+				missed += entries.find(buf) == entries.end();
+			}
+			misses += missed;
+		};
+
+		start = TClock::now();
+		lookup(0, spellings.size(), false);
+		const double full = ElapsedNs(start);
+
+		start = TClock::now();
+		lookup(0, lookup_count, true);
+		const double random = ElapsedNs(start);
+
+		const double threaded = RunThreads(thread_count, lookup_count, [&](size_t begin, size_t end) { lookup(begin, end, true); });
+
+		printf("string map: load %.1f ms, file list %.1f ms (%.1f ns/file), random %.1f ns, %zu threads %.1f M lookups/s\n",
+			build / 1e6, full / 1e6, full / count, random / lookups, thread_count, lookups / threaded * 1e3);
+	}
+
+	CPackManager manager;
+	manager.SetPackLoadMode();
+
+	auto start = TClock::now();
+	for (size_t i = 0; i < packs.size(); ++i) {
+		if (!manager.AddPack(packs[i], static_cast<int>(i))) {
+			std::cerr << "Failed to mount " << packs[i] << std::endl;
+			return false;
+		}
+	}
+	const double mount = ElapsedNs(start);
+
+	auto lookup = [&](size_t begin, size_t end, bool random) {
+		size_t missed = 0;
+		for (size_t i = begin; i < end; ++i)
+			missed += !manager.IsExist(spellings[random ? order[i] : i]);
+		misses += missed;
+	};
+
+	for (int frozen = 0; frozen < 2; ++frozen) {
+		double freeze = 0.0;
+		if (frozen) {
+			start = TClock::now();
+			manager.Freeze();
+			freeze = ElapsedNs(start);
+		}
+
+		start = TClock::now();
+		lookup(0, spellings.size(), false);
+		const double full = ElapsedNs(start);
+
+		start = TClock::now();
+		lookup(0, lookup_count, true);
+		const double random = ElapsedNs(start);
+
+		const double threaded = RunThreads(thread_count, lookup_count, [&](size_t begin, size_t end) { lookup(begin, end, true); });
+
+		if (frozen)
+			printf("frozen:     freeze %.1f ms, file list %.1f ms (%.1f ns/file), random %.1f ns, %zu threads %.1f M lookups/s\n",
+				freeze / 1e6, full / 1e6, full / count, random / lookups, thread_count, lookups / threaded * 1e3);
+		else
+			printf("mounting:   mount %.1f ms, file list %.1f ms (%.1f ns/file), random %.1f ns, %zu threads %.1f M lookups/s\n",
+				mount / 1e6, full / 1e6, full / count, random / lookups, thread_count, lookups / threaded * 1e3);
+	}
+
+	// Whole reads for scale, these include decompression
+	uint64_t read_bytes = 0;
+	size_t read_failures = 0;
+	TPackFile data;
+
+	start = TClock::now();
+	for (size_t i = 0; i < read_count; ++i) {
+		if (manager.GetFile(spellings[order[i % order.size()]], data))
+			read_bytes += data.size();
+		else
+			++read_failures;
+	}
+	const double read = ElapsedNs(start);
+
+	printf("GetFile:    %zu random files, %.1f us each, %.1f MB/s\n",
+		read_count, read / 1e3 / double(std::max<size_t>(read_count, 1)), double(read_bytes) / read * 1e3);
+
+	if (misses || read_failures) {
+		std::cerr << misses << " lookups and " << read_failures << " reads did not find a packed file" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("PackBench");
+
+	program.add_argument("--pack")
+		.append()
+		.default_value(std::vector<std::string>())
+		.help("Pack to mount, in ascending priority. Without any, only path hashing is measured on generated paths");
+
+	program.add_argument("--paths")
+		.default_value(300000)
+		.scan<'i', int>()
+		.help("Number of generated paths when no pack is given");
+
+	program.add_argument("--lookups")
+		.default_value(2000000)
+		.scan<'i', int>()
+		.help("Number of random lookups");
+
+	program.add_argument("--reads")
+		.default_value(2000)
+		.scan<'i', int>()
+		.help("Number of random GetFile calls");
+
+	program.add_argument("--threads")
+		.default_value(0)
+		.scan<'i', int>()
+		.help("Threads for the concurrent lookups, 0 uses every core");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<std::string> packs = program.get<std::vector<std::string>>("--pack");
+
+	size_t thread_count = static_cast<size_t>(std::max(0, program.get<int>("--threads")));
+	if (thread_count == 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::mt19937 rng(1);
+
+	std::vector<std::string> names;
+	uint64_t total_size = 0;
+	if (packs.empty()) {
+		names = MakeSyntheticNames(static_cast<size_t>(std::max(1, program.get<int>("--paths"))), rng);
+	}
+	else if (!LoadNames(packs, names, total_size)) {
+		return EXIT_FAILURE;
+	}
+
+	if (names.empty()) {
+		std::cerr << "No files to look up" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::string spelling_pool;
+	std::vector<std::string_view> spellings;
+	MakeSpellings(names, rng, spelling_pool, spellings);
+
+	if (!packs.empty()) {
+		printf("%zu packs, %zu files, %.1f MB\n", packs.size(), names.size(), double(total_size) / (1024.0 * 1024.0));
+	}
+
+	bool success = CheckPathHashes(names, spellings, rng);
+	BenchPathHashes(spellings);
+
+	if (!packs.empty()) {
+		success &= BenchLookups(packs, spellings, static_cast<size_t>(std::max(1, program.get<int>("--lookups"))), thread_count,
+			static_cast<size_t>(std::max(0, program.get<int>("--reads"))), rng);
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,6 +1,18 @@
 #include "Pack.h"
 #include "EterLib/BufferPool.h"
 #include <zstd.h>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Ranges closer than this are read as one
+static constexpr uint64_t PREFETCH_MERGE_GAP = 64 * 1024;
 
 static thread_local ZSTD_DCtx* g_zstdDCtx = nullptr;
 
@@ -13,6 +25,14 @@ static ZSTD_DCtx* GetThreadLocalZSTDContext()
 	return g_zstdDCtx;
 }
 
+CPack::~CPack()
+{
+	if (m_ddict) {
+		ZSTD_freeDDict(m_ddict);
+		m_ddict = nullptr;
+	}
+}
+
 void CPack::DecryptData(uint8_t* data, size_t len, const uint8_t* nonce)
 {
 	crypto_stream_xchacha20_xor(data, data, len, nonce, PACK_KEY.data());
@@ -27,48 +47,204 @@ bool CPack::Load(const std::string& path)
 		return false;
 	}
 
+	if (m_file.size() >= sizeof(uint32_t) && *reinterpret_cast<const uint32_t*>(m_file.data()) == PACK_MAGIC_V2) {
+		return LoadV2();
+	}
+
+	return LoadV1();
+}
+
+bool CPack::LoadV1()
+{
 	size_t file_size = m_file.size();
 	if (file_size < sizeof(TPackFileHeader)) {
 		return false;
 	}
 
-	memcpy(&m_header, m_file.data(), sizeof(TPackFileHeader));
+	TPackFileHeader header;
+	memcpy(&header, m_file.data(), sizeof(TPackFileHeader));
 
-	if (file_size < sizeof(TPackFileHeader) + m_header.entry_num * sizeof(TPackFileEntry)) {
+	if (header.entry_num > (file_size - sizeof(TPackFileHeader)) / sizeof(TPackFileEntry) || header.data_begin > file_size) {
 		return false;
 	}
 
-	m_index.resize(m_header.entry_num);
+	m_version = 1;
+	m_data_begin = header.data_begin;
+	m_legacy_entries.resize(header.entry_num);
 
-	for (size_t i = 0; i < m_header.entry_num; i++) {
-		TPackFileEntry& entry = m_index[i];
+	// Only the compact entry is kept, the fat v1 record lives on the stack
+	for (size_t i = 0; i < header.entry_num; i++) {
+		TPackFileEntry entry;
 		memcpy(&entry, m_file.data() + sizeof(TPackFileHeader) + i * sizeof(TPackFileEntry), sizeof(TPackFileEntry));
-		DecryptData((uint8_t*)&entry, sizeof(TPackFileEntry), m_header.nonce);
+		DecryptData((uint8_t*)&entry, sizeof(TPackFileEntry), header.nonce);
 
-		if (file_size < m_header.data_begin + entry.offset + entry.compressed_size) {
+		if (entry.offset > file_size - m_data_begin || entry.compressed_size > file_size - m_data_begin - entry.offset) {
 			return false;
 		}
+
+		std::string_view name(entry.file_name, strnlen(entry.file_name, sizeof(entry.file_name)));
+
+		TPackIndexEntry& compact = m_legacy_entries[i];
+		memset(&compact, 0, sizeof(compact));
+		compact.hash = PackHashPath(name);
+		compact.name_offset = static_cast<uint32_t>(m_names.size());
+		compact.name_length = static_cast<uint16_t>(name.size());
+		compact.encryption = entry.encryption;
+		compact.offset = entry.offset;
+		compact.file_size = entry.file_size;
+		compact.compressed_size = entry.compressed_size;
+		memcpy(compact.nonce, entry.nonce, sizeof(compact.nonce));
+
+		m_names.append(name);
 	}
 
+	std::stable_sort(m_legacy_entries.begin(), m_legacy_entries.end(), [](const TPackIndexEntry& a, const TPackIndexEntry& b) {
+		return a.hash < b.hash;
+	});
+
+	m_entries = m_legacy_entries.data();
+	m_entry_count = m_legacy_entries.size();
 	return true;
 }
 
-bool CPack::GetFile(const TPackFileEntry& entry, TPackFile& result)
+bool CPack::LoadV2()
+{
+	size_t file_size = m_file.size();
+	if (file_size < sizeof(TPackFileHeaderV2)) {
+		return false;
+	}
+
+	TPackFileHeaderV2 header;
+	memcpy(&header, m_file.data(), sizeof(TPackFileHeaderV2));
+
+	if (header.version != PACK_VERSION_2 && header.version != PACK_VERSION_3) {
+		return false;
+	}
+
+	size_t index_begin = sizeof(TPackFileHeaderV2);
+	TPackDictionaryInfo dict = {};
+
+	if (header.version == PACK_VERSION_3) {
+		if (file_size < index_begin + sizeof(TPackDictionaryInfo)) {
+			return false;
+		}
+
+		memcpy(&dict, m_file.data() + index_begin, sizeof(TPackDictionaryInfo));
+		index_begin += sizeof(TPackDictionaryInfo);
+
+		if (dict.offset > file_size || dict.size > file_size - dict.offset) {
+			return false;
+		}
+	}
+
+	// Header fields are untrusted, every check is written so that it cannot wrap around
+	if (header.entry_num > (file_size - index_begin) / sizeof(TPackIndexEntry)) {
+		return false;
+	}
+
+	const uint64_t index_size = header.entry_num * sizeof(TPackIndexEntry);
+	if (header.name_pool_size > file_size - index_begin - index_size
+		|| header.data_begin < index_begin + index_size + header.name_pool_size
+		|| header.data_begin > file_size) {
+		return false;
+	}
+
+	m_version = header.version;
+	m_data_begin = header.data_begin;
+	m_entries = reinterpret_cast<const TPackIndexEntry*>(m_file.data() + index_begin);
+	m_entry_count = header.entry_num;
+
+	if (dict.size) {
+		m_ddict = ZSTD_createDDict(m_file.data() + dict.offset, dict.size);
+		if (!m_ddict) {
+			return false;
+		}
+	}
+
+	m_names.assign(m_file.data() + index_begin + index_size, header.name_pool_size);
+	DecryptData((uint8_t*)m_names.data(), m_names.size(), header.nonce);
+
+	for (size_t i = 0; i < m_entry_count; i++) {
+		const TPackIndexEntry& entry = m_entries[i];
+
+		if (entry.offset > file_size - m_data_begin || entry.compressed_size > file_size - m_data_begin - entry.offset) {
+			return false;
+		}
+
+		if (entry.name_offset > m_names.size() || entry.name_length > m_names.size() - entry.name_offset) {
+			return false;
+		}
+
+		if ((entry.flags & PACK_ENTRY_FLAG_DICT) && !m_ddict) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::string_view CPack::GetEntryName(const TPackIndexEntry& entry) const
+{
+	return std::string_view(m_names.data() + entry.name_offset, entry.name_length);
+}
+
+const TPackIndexEntry* CPack::FindEntry(uint64_t hash) const
+{
+	const TPackIndexEntry* end = m_entries + m_entry_count;
+	const TPackIndexEntry* it = std::lower_bound(m_entries, end, hash, [](const TPackIndexEntry& entry, uint64_t value) {
+		return entry.hash < value;
+	});
+
+	if (it == end || it->hash != hash) {
+		return nullptr;
+	}
+
+	return it;
+}
+
+size_t CPack::Decompress(const TPackIndexEntry& entry, uint8_t* dst, size_t dst_size, const void* src, size_t src_size) const
+{
+	ZSTD_DCtx* dctx = GetThreadLocalZSTDContext();
+
+	if (entry.flags & PACK_ENTRY_FLAG_DICT) {
+		return ZSTD_decompress_usingDDict(dctx, dst, dst_size, src, src_size, m_ddict);
+	}
+
+	return ZSTD_decompressDCtx(dctx, dst, dst_size, src, src_size);
+}
+
+bool CPack::GetFile(const TPackIndexEntry& entry, TPackFile& result)
 {
 	return GetFileWithPool(entry, result, nullptr);
 }
 
-bool CPack::GetFileWithPool(const TPackFileEntry& entry, TPackFile& result, CBufferPool* pPool)
+bool CPack::GetFileWithPool(const TPackIndexEntry& entry, TPackFile& result, CBufferPool* pPool)
 {
 	result.resize(entry.file_size);
 
-	size_t offset = m_header.data_begin + entry.offset;
-	ZSTD_DCtx* dctx = GetThreadLocalZSTDContext();
+	size_t offset = m_data_begin + entry.offset;
+
+	if (entry.flags & PACK_ENTRY_FLAG_STORED) {
+		if (entry.compressed_size != entry.file_size) {
+			return false;
+		}
+
+		memcpy(result.data(), m_file.data() + offset, entry.file_size);
+
+		switch (entry.encryption)
+		{
+			case 0: break;
+			case 1: DecryptData(result.data(), result.size(), entry.nonce); break;
+			default: return false;
+		}
+
+		return true;
+	}
 
 	switch (entry.encryption)
 	{
 		case 0: {
-			size_t decompressed_size = ZSTD_decompressDCtx(dctx, result.data(), result.size(), m_file.data() + offset, entry.compressed_size);
+			size_t decompressed_size = Decompress(entry, result.data(), result.size(), m_file.data() + offset, entry.compressed_size);
 			if (decompressed_size != entry.file_size) {
 				return false;
 			}
@@ -85,7 +261,7 @@ bool CPack::GetFileWithPool(const TPackFileEntry& entry, TPackFile& result, CBuf
 
 			DecryptData(compressed_data.data(), entry.compressed_size, entry.nonce);
 
-			size_t decompressed_size = ZSTD_decompressDCtx(dctx, result.data(), result.size(), compressed_data.data(), compressed_data.size());
+			size_t decompressed_size = Decompress(entry, result.data(), result.size(), compressed_data.data(), compressed_data.size());
 
 			if (pPool) {
 				pPool->Release(std::move(compressed_data));
@@ -101,3 +277,107 @@ bool CPack::GetFileWithPool(const TPackFileEntry& entry, TPackFile& result, CBuf
 
 	return true;
 }
+
+bool CPack::GetFileView(const TPackIndexEntry& entry, CPackFileView& view, CBufferPool* pPool)
+{
+	view.Clear();
+
+	// Stored, unencrypted entries are handed out straight from the mapping
+	if ((entry.flags & PACK_ENTRY_FLAG_STORED) && entry.encryption == 0 && entry.compressed_size == entry.file_size) {
+		view.m_owner = shared_from_this();
+		view.m_data = reinterpret_cast<const uint8_t*>(m_file.data() + m_data_begin + entry.offset);
+		view.m_size = entry.file_size;
+		return true;
+	}
+
+	if (!GetFileWithPool(entry, view.m_buffer, pPool)) {
+		view.Clear();
+		return false;
+	}
+
+	view.m_data = view.m_buffer.data();
+	view.m_size = view.m_buffer.size();
+	return true;
+}
+
+#ifdef _WIN32
+typedef struct _TPrefetchRange
+{
+	PVOID VirtualAddress;
+	SIZE_T NumberOfBytes;
+} TPrefetchRange;
+
+typedef BOOL (WINAPI *TPrefetchVirtualMemory)(HANDLE, ULONG_PTR, TPrefetchRange*, ULONG);
+
+// PrefetchVirtualMemory only exists on Windows 8 and later
+static TPrefetchVirtualMemory GetPrefetchVirtualMemory()
+{
+	static const TPrefetchVirtualMemory s_pfn = reinterpret_cast<TPrefetchVirtualMemory>(
+		GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory"));
+	return s_pfn;
+}
+#endif
+
+void CPack::Prefetch(std::vector<const TPackIndexEntry*>& entries) const
+{
+	if (entries.empty() || !m_file.is_mapped()) {
+		return;
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const TPackIndexEntry* a, const TPackIndexEntry* b) {
+		return a->offset < b->offset;
+	});
+
+	struct TRange
+	{
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	std::vector<TRange> ranges;
+	for (const TPackIndexEntry* entry : entries) {
+		const uint64_t begin = m_data_begin + entry->offset;
+		const uint64_t end = std::min<uint64_t>(begin + entry->compressed_size, m_file.size());
+		if (begin >= end) {
+			continue;
+		}
+
+		if (!ranges.empty() && begin <= ranges.back().end + PREFETCH_MERGE_GAP) {
+			ranges.back().end = std::max(ranges.back().end, end);
+		} else {
+			ranges.push_back({ begin, end });
+		}
+	}
+
+	const uint8_t* base = reinterpret_cast<const uint8_t*>(m_file.data());
+
+#ifdef _WIN32
+	TPrefetchVirtualMemory pfnPrefetch = GetPrefetchVirtualMemory();
+	if (!pfnPrefetch) {
+		return;
+	}
+
+	std::vector<TPrefetchRange> request;
+	request.reserve(ranges.size());
+	for (const TRange& range : ranges) {
+		request.push_back({ const_cast<uint8_t*>(base + range.begin), static_cast<SIZE_T>(range.end - range.begin) });
+	}
+
+	pfnPrefetch(GetCurrentProcess(), request.size(), request.data(), 0);
+#else
+	const uintptr_t page_mask = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE)) - 1;
+	for (const TRange& range : ranges) {
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(base + range.begin) & ~page_mask;
+		const uintptr_t end = reinterpret_cast<uintptr_t>(base + range.end);
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+	}
+#endif
+}
+
+void CPackFileView::Clear()
+{
+	m_owner.reset();
+	m_data = nullptr;
+	m_size = 0;
+	m_buffer.clear();
+}
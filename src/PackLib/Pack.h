@@ -1,27 +1,79 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <mio/mmap.hpp>
 
 #include "config.h"
 
 class CBufferPool;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+
+// Read-only bytes of a pack file. Stored entries point straight into the pack mapping and
+// keep the pack alive, everything else is decompressed into an owned buffer.
+class CPackFileView
+{
+public:
+	CPackFileView() = default;
+	CPackFileView(CPackFileView&&) = default;
+	CPackFileView& operator=(CPackFileView&&) = default;
+	CPackFileView(const CPackFileView&) = delete;
+	CPackFileView& operator=(const CPackFileView&) = delete;
+
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	// True if the bytes live in the pack mapping rather than in a heap buffer
+	bool IsMapped() const { return m_owner != nullptr; }
+
+	void Clear();
+
+private:
+	friend class CPack;
+	friend class CPackManager;
+
+	std::shared_ptr<const CPack> m_owner;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+	TPackFile m_buffer;
+};
 
 class CPack : public std::enable_shared_from_this<CPack>
 {
 public:
 	CPack() = default;
-	~CPack() = default;
+	~CPack();
 
 	bool Load(const std::string& path);
-	const std::vector<TPackFileEntry>& GetIndex() const { return m_index; }
+	uint32_t GetVersion() const { return m_version; }
 
-	bool GetFile(const TPackFileEntry& entry, TPackFile& result);
-	bool GetFileWithPool(const TPackFileEntry& entry, TPackFile& result, CBufferPool* pPool);
+	// Index entries are sorted by hash. For v2 packs they point straight into the mapping.
+	size_t GetEntryCount() const { return m_entry_count; }
+	const TPackIndexEntry& GetEntry(size_t i) const { return m_entries[i]; }
+	std::string_view GetEntryName(const TPackIndexEntry& entry) const;
+	const TPackIndexEntry* FindEntry(uint64_t hash) const;
+
+	bool GetFile(const TPackIndexEntry& entry, TPackFile& result);
+	bool GetFileWithPool(const TPackIndexEntry& entry, TPackFile& result, CBufferPool* pPool);
+	bool GetFileView(const TPackIndexEntry& entry, CPackFileView& view, CBufferPool* pPool);
+
+	// Asks the OS to page in the compressed bytes of the given entries. Nearby ranges are
+	// merged into one request. Returns immediately, the reads happen in the background.
+	void Prefetch(std::vector<const TPackIndexEntry*>& entries) const;
 
 private:
+	bool LoadV1();
+	bool LoadV2();
 	void DecryptData(uint8_t* data, size_t len, const uint8_t* nonce);
+	size_t Decompress(const TPackIndexEntry& entry, uint8_t* dst, size_t dst_size, const void* src, size_t src_size) const;
+
+	uint32_t m_version = 0;
+	uint64_t m_data_begin = 0;
+	size_t m_entry_count = 0;
+	const TPackIndexEntry* m_entries = nullptr;
+	std::string m_names;
+	ZSTD_DDict* m_ddict = nullptr;
 
-	TPackFileHeader m_header;
-	std::vector<TPackFileEntry> m_index;
+	std::vector<TPackIndexEntry> m_legacy_entries; // v1 index converted to the compact form
 	mio::mmap_source m_file;
 };
@@ -1,18 +1,28 @@
 #include "PackManager.h"
+#include "ScriptBinary.h"
 #include "EterLib/BufferPool.h"
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
 #include "EterBase/Debug.h"
 
 CPackManager::CPackManager()
 	: m_load_from_pack(true)
 	, m_pBufferPool(nullptr)
+	, m_frozen(false)
+	, m_tracing(false)
+	, m_cache_used(false)
+	, m_cache_bytes(0)
+	, m_cache_budget(32 * 1024 * 1024)
 {
 	m_pBufferPool = new CBufferPool();
 }
 
 CPackManager::~CPackManager()
 {
+	StopTrace();
+
 	if (m_pBufferPool)
 	{
 		delete m_pBufferPool;
@@ -20,7 +30,7 @@ CPackManager::~CPackManager()
 	}
 }
 
-bool CPackManager::AddPack(const std::string& path)
+bool CPackManager::AddPack(const std::string& path, int iPriority)
 {
 	std::shared_ptr<CPack> pack = std::make_shared<CPack>();
 
@@ -30,12 +40,156 @@ bool CPackManager::AddPack(const std::string& path)
 	}
 
 	std::lock_guard<std::mutex> lock(m_mutex);
-	const auto& index = pack->GetIndex();
-	for (const auto& entry : index)
+	if (IsFrozen())
+	{
+		TraceError("CPackManager::AddPack - %s added after the lookup table was frozen", path.c_str());
+		return false;
+	}
+
+	if (iPriority < 0)
+	{
+		iPriority = 0;
+		for (const auto& slot : m_packs)
+			iPriority = std::max(iPriority, slot.priority + 1);
+	}
+
+	m_packs.push_back({ std::move(pack), iPriority });
+	return true;
+}
+
+void CPackManager::Freeze()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (IsFrozen())
+		return;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// Lowest priority first, so a stable sort keeps overriding entries last within a hash run
+	std::stable_sort(m_packs.begin(), m_packs.end(), [](const TPackSlot& a, const TPackSlot& b) {
+		return a.priority < b.priority;
+	});
+
+	struct TCandidate
+	{
+		uint64_t hash;
+		uint32_t order;
+		TPackLookupEntry value;
+	};
+
+	size_t total = 0;
+	for (const auto& slot : m_packs)
+		total += slot.pack->GetEntryCount();
+
+	std::vector<TCandidate> candidates;
+	candidates.reserve(total);
+
+	for (uint32_t order = 0; order < m_packs.size(); ++order)
+	{
+		CPack* pack = m_packs[order].pack.get();
+		for (size_t i = 0; i < pack->GetEntryCount(); ++i)
+		{
+			const TPackIndexEntry& entry = pack->GetEntry(i);
+			candidates.push_back({ entry.hash, order, { pack, &entry } });
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const TCandidate& a, const TCandidate& b) {
+		return a.hash != b.hash ? a.hash < b.hash : a.order < b.order;
+	});
+
+	m_lookup_hashes.clear();
+	m_lookup_entries.clear();
+	m_lookup_hashes.reserve(candidates.size());
+	m_lookup_entries.reserve(candidates.size());
+
+	size_t collisions = 0;
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		const TCandidate& candidate = candidates[i];
+		const std::string_view name = candidate.value.pack->GetEntryName(*candidate.value.entry);
+
+		// Within a run of one hash, a later candidate of the same name comes from a higher
+		// priority pack and overrides this one. A different name is another file that only
+		// shares the hash, both stay and FindEntry tells them apart by name.
+		bool overridden = false;
+		for (size_t j = i + 1; j < candidates.size() && candidates[j].hash == candidate.hash; ++j)
+		{
+			if (candidates[j].value.pack->GetEntryName(*candidates[j].value.entry) == name)
+			{
+				overridden = true;
+				break;
+			}
+		}
+
+		if (overridden)
+			continue;
+
+		if (!m_lookup_hashes.empty() && m_lookup_hashes.back() == candidate.hash)
+		{
+			const TPackLookupEntry& other = m_lookup_entries.back();
+			const std::string_view otherName = other.pack->GetEntryName(*other.entry);
+			TraceError("CPackManager::Freeze - %.*s and %.*s share a path hash",
+				static_cast<int>(otherName.size()), otherName.data(), static_cast<int>(name.size()), name.data());
+			++collisions;
+		}
+
+		m_lookup_hashes.push_back(candidate.hash);
+		m_lookup_entries.push_back(candidate.value);
+	}
+
+	m_lookup_hashes.shrink_to_fit();
+	m_lookup_entries.shrink_to_fit();
+	m_frozen.store(true, std::memory_order_release);
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	Tracef("CPackManager::Freeze - %u packs, %u files (%u overridden, %u hash collisions) in %lld us\n",
+		static_cast<unsigned>(m_packs.size()), static_cast<unsigned>(m_lookup_hashes.size()),
+		static_cast<unsigned>(candidates.size() - m_lookup_hashes.size()), static_cast<unsigned>(collisions),
+		static_cast<long long>(elapsed));
+}
+
+bool CPackManager::FindEntry(uint64_t hash, std::string_view path, TPackLookupEntry& result) const
+{
+	if (IsFrozen())
+	{
+		// Almost always a run of one, the name check is what keeps a colliding path out
+		for (auto it = std::lower_bound(m_lookup_hashes.begin(), m_lookup_hashes.end(), hash);
+			it != m_lookup_hashes.end() && *it == hash; ++it)
+		{
+			const TPackLookupEntry& lookup = m_lookup_entries[it - m_lookup_hashes.begin()];
+			if (lookup.pack->GetEntryName(*lookup.entry) == path)
+			{
+				result = lookup;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Still mounting: search every pack, highest priority wins
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const TPackSlot* best = nullptr;
+	const TPackIndexEntry* bestEntry = nullptr;
+	for (const auto& slot : m_packs)
 	{
-		m_entries[entry.file_name] = std::make_pair(pack, entry);
+		if (best && slot.priority < best->priority)
+			continue;
+
+		const TPackIndexEntry* entry = slot.pack->FindEntry(hash);
+		if (entry && slot.pack->GetEntryName(*entry) == path)
+		{
+			best = &slot;
+			bestEntry = entry;
+		}
 	}
 
+	if (!best)
+		return false;
+
+	result = { best->pack.get(), bestEntry };
 	return true;
 }
 
@@ -51,9 +205,14 @@ bool CPackManager::GetFileWithPool(std::string_view path, TPackFile& result, CBu
 
 	// First try to load from pack
 	if (m_load_from_pack) {
-		auto it = m_entries.find(buf);
-		if (it != m_entries.end()) {
-			return it->second.first->GetFileWithPool(it->second.second, result, pPool);
+		const uint64_t hash = PackHashPath(buf);
+		TPackLookupEntry lookup;
+		if (FindEntry(hash, buf, lookup)) {
+			TraceAccess(buf, hash);
+			if (TakeCachedFile(lookup.entry, result))
+				return true;
+
+			return lookup.pack->GetFileWithPool(*lookup.entry, result, pPool);
 		}
 	}
 
@@ -79,6 +238,98 @@ bool CPackManager::GetFileWithPool(std::string_view path, TPackFile& result, CBu
 	return false;
 }
 
+bool CPackManager::GetFileView(std::string_view path, CPackFileView& view)
+{
+	thread_local std::string buf;
+	NormalizePath(path, buf);
+
+	if (m_load_from_pack) {
+		const uint64_t hash = PackHashPath(buf);
+		TPackLookupEntry lookup;
+		if (FindEntry(hash, buf, lookup)) {
+			TraceAccess(buf, hash);
+			view.Clear();
+			if (TakeCachedFile(lookup.entry, view.m_buffer)) {
+				view.m_data = view.m_buffer.data();
+				view.m_size = view.m_buffer.size();
+				return true;
+			}
+
+			return lookup.pack->GetFileView(*lookup.entry, view, m_pBufferPool);
+		}
+	}
+
+	// Disk files are read into the view's own buffer
+	view.Clear();
+	if (!GetFileWithPool(path, view.m_buffer, nullptr)) {
+		return false;
+	}
+
+	view.m_data = view.m_buffer.data();
+	view.m_size = view.m_buffer.size();
+	return true;
+}
+
+bool CPackManager::GetCompiledFileView(std::string_view source_path, CPackFileView& view)
+{
+	if (!m_load_from_pack) {
+		return false;
+	}
+
+	thread_local std::string buf;
+	NormalizePath(source_path, buf);
+
+	TPackLookupEntry source;
+	if (!FindEntry(PackHashPath(buf), buf, source)) {
+		return false;
+	}
+
+	buf += SCRIPT_BINARY_SUFFIX;
+
+	const uint64_t hash = PackHashPath(buf);
+	TPackLookupEntry lookup;
+	if (!FindEntry(hash, buf, lookup) || lookup.pack != source.pack) {
+		return false;
+	}
+
+	TraceAccess(buf, hash);
+	view.Clear();
+	if (TakeCachedFile(lookup.entry, view.m_buffer)) {
+		view.m_data = view.m_buffer.data();
+		view.m_size = view.m_buffer.size();
+	}
+	else if (!lookup.pack->GetFileView(*lookup.entry, view, m_pBufferPool)) {
+		return false;
+	}
+
+	// A broken header is left to the loader, it reports it and reads the text
+	if (view.size() < sizeof(TScriptBinaryHeader)) {
+		return true;
+	}
+
+	TScriptBinaryHeader header;
+	memcpy(&header, view.data(), sizeof(header));
+
+	// Packs made by an older PackMaker are read as text until they are rebuilt
+	if (header.version != SCRIPT_BINARY_VERSION || header.source_size != source.entry->file_size) {
+		view.Clear();
+		return false;
+	}
+
+#ifdef _DEBUG
+	// Same size is all a release build checks, here the text is read to be sure
+	TPackFile text;
+	if (source.pack->GetFile(*source.entry, text)
+		&& ScriptBinaryKey(std::string_view(reinterpret_cast<const char*>(text.data()), text.size())) != header.source_crc) {
+		TraceError("CPackManager::GetCompiledFileView - %s does not match its text", buf.c_str());
+		view.Clear();
+		return false;
+	}
+#endif
+
+	return true;
+}
+
 bool CPackManager::IsExist(std::string_view path) const
 {
 	thread_local std::string buf;
@@ -86,8 +337,8 @@ bool CPackManager::IsExist(std::string_view path) const
 
 	// First check in pack entries
 	if (m_load_from_pack) {
-		auto it = m_entries.find(buf);
-		if (it != m_entries.end()) {
+		TPackLookupEntry lookup;
+		if (FindEntry(PackHashPath(buf), buf, lookup)) {
 			return true;
 		}
 	}
@@ -104,13 +355,149 @@ bool CPackManager::IsExist(std::string_view path) const
 	return result;
 }
 
-void CPackManager::NormalizePath(std::string_view in, std::string& out) const
+size_t CPackManager::Prefetch(std::span<const std::string_view> paths, bool bDecompress)
+{
+	if (!m_load_from_pack || paths.empty())
+		return 0;
+
+	std::string buf;
+	std::vector<TPackLookupEntry> lookups;
+	lookups.reserve(paths.size());
+
+	for (std::string_view path : paths)
+	{
+		NormalizePath(path, buf);
+
+		TPackLookupEntry lookup;
+		if (FindEntry(PackHashPath(buf), buf, lookup))
+			lookups.push_back(lookup);
+	}
+
+	// One merged request per pack
+	std::unordered_map<CPack*, std::vector<const TPackIndexEntry*>> perPack;
+	for (const TPackLookupEntry& lookup : lookups)
+		perPack[lookup.pack].push_back(lookup.entry);
+
+	for (auto& [pack, entries] : perPack)
+		pack->Prefetch(entries);
+
+	if (bDecompress)
+	{
+		for (size_t i = 0; i < lookups.size(); ++i)
+		{
+			const TPackIndexEntry& entry = *lookups[i].entry;
+
+			// Plain stored files are already served straight from the mapping
+			if ((entry.flags & PACK_ENTRY_FLAG_STORED) && entry.encryption == 0)
+				continue;
+
+			if (entry.file_size > m_cache_budget)
+				continue;
+
+			TPackFile data;
+			if (lookups[i].pack->GetFile(entry, data))
+				StoreCachedFile(lookups[i].entry, std::move(data));
+		}
+	}
+
+	return lookups.size();
+}
+
+void CPackManager::SetPrefetchCacheSize(size_t bytes)
 {
-	out.resize(in.size());
-	for (std::size_t i = 0; i < out.size(); ++i) {
-		if (in[i] == '\\')
-			out[i] = '/';
-		else
-			out[i] = static_cast<char>(std::tolower(in[i]));
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+	m_cache_budget = bytes;
+
+	while (m_cache_bytes > m_cache_budget && !m_cache_lru.empty())
+	{
+		auto it = m_cache.find(m_cache_lru.back());
+		m_cache_bytes -= it->second.data.size();
+		m_cache.erase(it);
+		m_cache_lru.pop_back();
+	}
+
+	m_cache_used.store(!m_cache.empty(), std::memory_order_release);
+}
+
+bool CPackManager::TakeCachedFile(const TPackIndexEntry* entry, TPackFile& result)
+{
+	if (!m_cache_used.load(std::memory_order_acquire))
+		return false;
+
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+	auto it = m_cache.find(entry);
+	if (it == m_cache.end())
+		return false;
+
+	// A prefetched file is read once, so hand the buffer over instead of copying it
+	result = std::move(it->second.data);
+	m_cache_bytes -= result.size();
+	m_cache_lru.erase(it->second.lru);
+	m_cache.erase(it);
+
+	m_cache_used.store(!m_cache.empty(), std::memory_order_release);
+	return true;
+}
+
+void CPackManager::StoreCachedFile(const TPackIndexEntry* entry, TPackFile&& data)
+{
+	std::lock_guard<std::mutex> lock(m_cache_mutex);
+	if (data.size() > m_cache_budget || m_cache.find(entry) != m_cache.end())
+		return;
+
+	while (m_cache_bytes + data.size() > m_cache_budget && !m_cache_lru.empty())
+	{
+		auto it = m_cache.find(m_cache_lru.back());
+		m_cache_bytes -= it->second.data.size();
+		m_cache.erase(it);
+		m_cache_lru.pop_back();
+	}
+
+	m_cache_lru.push_front(entry);
+	m_cache_bytes += data.size();
+	m_cache.emplace(entry, TCachedFile{ std::move(data), m_cache_lru.begin() });
+	m_cache_used.store(true, std::memory_order_release);
+}
+
+bool CPackManager::StartTrace(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_trace_mutex);
+	if (m_trace_file.is_open())
+		return true;
+
+	m_trace_file.open(path, std::ios::out | std::ios::trunc);
+	if (!m_trace_file.is_open())
+	{
+		TraceError("CPackManager::StartTrace - cannot open %s", path.c_str());
+		return false;
 	}
+
+	m_traced.clear();
+	m_tracing.store(true, std::memory_order_release);
+	Tracef("CPackManager::StartTrace - recording pack accesses to %s\n", path.c_str());
+	return true;
+}
+
+void CPackManager::StopTrace()
+{
+	std::lock_guard<std::mutex> lock(m_trace_mutex);
+	m_tracing.store(false, std::memory_order_release);
+
+	if (m_trace_file.is_open())
+		m_trace_file.close();
+
+	m_traced.clear();
+}
+
+void CPackManager::TraceAccess(const std::string& path, uint64_t hash)
+{
+	if (!m_tracing.load(std::memory_order_acquire))
+		return;
+
+	std::lock_guard<std::mutex> lock(m_trace_mutex);
+	if (!m_trace_file.is_open())
+		return;
+
+	if (m_traced.insert(hash).second)
+		m_trace_file << path << '\n';
 }
@@ -1,8 +1,14 @@
 #pragma once
+#include <unordered_set>
 #include <unordered_map>
+#include <list>
+#include <span>
+#include <fstream>
 #include <mutex>
+#include <atomic>
 
 #include "EterBase/Singleton.h"
+#include "EterBase/PathHash.h"
 #include "Pack.h"
 
 class CBufferPool;
@@ -13,22 +19,89 @@ public:
 	CPackManager();
 	virtual ~CPackManager();
 
-	bool AddPack(const std::string& path);
+	// Packs with a higher priority override files of packs with a lower one.
+	// A negative priority places the pack after every pack added so far.
+	bool AddPack(const std::string& path, int iPriority = -1);
+
+	// Builds the immutable lookup table once every pack is mounted.
+	// After this call lookups take no lock and allocate nothing.
+	void Freeze();
+	bool IsFrozen() const { return m_frozen.load(std::memory_order_acquire); }
+
 	bool GetFile(std::string_view path, TPackFile& result);
 	bool GetFileWithPool(std::string_view path, TPackFile& result, CBufferPool* pPool);
 	bool IsExist(std::string_view path) const;
 
+	// Like GetFile, but stored entries are returned without any copy.
+	// The view keeps its pack alive, so it may outlive later lookups.
+	bool GetFileView(std::string_view path, CPackFileView& view);
+
+	// The compiled "<source_path>.tsb" PackMaker stored next to a script, if it still matches
+	// the text. It has to come from the pack that provides the text and be compiled from a text
+	// of the same size, so a patch pack that overrides the text alone falls back to it.
+	// Never looks on disk, a miss is the common case.
+	bool GetCompiledFileView(std::string_view source_path, CPackFileView& view);
+
+	// Hints that the given files will be read soon. Their compressed bytes are paged in by
+	// the OS in the background, with nearby reads merged per pack. With bDecompress the files
+	// are also decoded into a bounded cache that the next GetFile of each path takes over.
+	// Decoding runs on the calling thread, so only ask for it from a worker.
+	// Returns the number of paths found in packs.
+	size_t Prefetch(std::span<const std::string_view> paths, bool bDecompress = false);
+	void SetPrefetchCacheSize(size_t bytes);
+
+	// Records the first access of every pack file, in order, one path per line.
+	// PackMaker --trace lays packs out in this order.
+	bool StartTrace(const std::string& path);
+	void StopTrace();
+
 	void SetPackLoadMode() { m_load_from_pack = true; }
 	void SetFileLoadMode() { m_load_from_pack = false; }
 
 	CBufferPool* GetBufferPool() { return m_pBufferPool; }
 
 private:
-	void NormalizePath(std::string_view in, std::string& out) const;
+	struct TPackSlot
+	{
+		std::shared_ptr<CPack> pack;
+		int priority;
+	};
+
+	// The hash finds the candidates, the name decides, so two paths sharing a hash in
+	// different packs do not override each other
+	bool FindEntry(uint64_t hash, std::string_view path, TPackLookupEntry& result) const;
+	void TraceAccess(const std::string& path, uint64_t hash);
+	bool TakeCachedFile(const TPackIndexEntry* entry, TPackFile& result);
+	void StoreCachedFile(const TPackIndexEntry* entry, TPackFile&& data);
 
 private:
 	bool m_load_from_pack = true;
-	TPackFileMap m_entries;
+	std::vector<TPackSlot> m_packs;
 	CBufferPool* m_pBufferPool;
-	mutable std::mutex m_mutex;  // Thread safety for parallel pack loading
+	mutable std::mutex m_mutex;  // Guards m_packs until the table is frozen
+
+	// Frozen lookup table: sorted hashes with a parallel array of entries, one per distinct path
+	std::atomic<bool> m_frozen;
+	std::vector<uint64_t> m_lookup_hashes;
+	std::vector<TPackLookupEntry> m_lookup_entries;
+
+	// Access trace, see StartTrace
+	std::atomic<bool> m_tracing;
+	std::mutex m_trace_mutex;
+	std::ofstream m_trace_file;
+	std::unordered_set<uint64_t> m_traced;
+
+	// Files decoded ahead of time by Prefetch by their entry, least recently stored at the back
+	struct TCachedFile
+	{
+		TPackFile data;
+		std::list<const TPackIndexEntry*>::iterator lru;
+	};
+
+	std::atomic<bool> m_cache_used;
+	std::mutex m_cache_mutex;
+	std::unordered_map<const TPackIndexEntry*, TCachedFile> m_cache;
+	std::list<const TPackIndexEntry*> m_cache_lru;
+	size_t m_cache_bytes;
+	size_t m_cache_budget;
 };
@@ -0,0 +1,209 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <string_view>
+
+// Compiled form of the text scripts the client parses on every start and warp.
+// PackMaker --compile-scripts stores "<path>.tsb" next to each script it understands,
+// the loaders use it instead of the text when the pack that provides the text has one.
+//
+// layout: header | nodes | tokens | children | slots | values | string pool
+// Node 0 is the root, every other node comes after its parent (pre-order).
+constexpr uint32_t SCRIPT_BINARY_MAGIC = 0x31425354; // "TSB1"
+constexpr uint16_t SCRIPT_BINARY_VERSION = 2;
+constexpr std::string_view SCRIPT_BINARY_SUFFIX = ".tsb";
+
+enum EScriptBinaryKind : uint8_t
+{
+	SCRIPT_BINARY_NONE,
+	SCRIPT_BINARY_GROUP,		// CTextFileLoader group scripts (.mse, .msa, .msm, .mss)
+	SCRIPT_BINARY_TOKEN_MAP,	// LoadMultipleTextData files (AreaData.txt, Setting.txt, ...), a single node
+};
+
+#pragma pack(push, 1)
+struct TScriptBinaryHeader
+{
+	uint32_t	magic;
+	uint16_t	version;
+	uint8_t		kind;
+	uint8_t		reserved;
+	uint32_t	source_size;
+	uint32_t	source_crc;		// ScriptBinaryKey of the whole source text
+	uint32_t	node_count;
+	uint32_t	token_count;
+	uint32_t	child_count;
+	uint32_t	slot_count;
+	uint32_t	value_count;
+	uint32_t	string_pool_size;
+};
+struct TScriptBinaryString
+{
+	uint32_t	offset; // into the string pool
+	uint32_t	length;
+};
+struct TScriptBinaryNode
+{
+	uint32_t	name_key;		// ScriptBinaryKey of the lower case name
+	TScriptBinaryString name;
+	uint32_t	parent;			// UINT32_MAX for the root
+	uint32_t	first_child;	// into the child table, which holds node indices
+	uint32_t	child_count;
+	uint32_t	first_token;
+	uint32_t	token_count;
+	uint32_t	first_slot;		// open addressing table over the node's tokens, slots hold index + 1
+	uint32_t	slot_count;		// a power of two, or 0 without tokens
+};
+struct TScriptBinaryToken
+{
+	uint32_t	key;			// ScriptBinaryKey of the lower case key
+	TScriptBinaryString name;
+	uint32_t	first_value;
+	uint32_t	value_count;
+};
+#pragma pack(pop)
+
+// CRC-32 (IEEE), the same keys as GetCRC32 in EterBase.
+// This is part of the format, do not change it without bumping the version.
+namespace ScriptBinaryDetail
+{
+	constexpr std::array<uint32_t, 256> MakeCrcTable()
+	{
+		std::array<uint32_t, 256> table{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; ++bit)
+				crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+			table[i] = crc;
+		}
+		return table;
+	}
+
+	inline constexpr std::array<uint32_t, 256> CRC_TABLE = MakeCrcTable();
+}
+
+constexpr uint32_t ScriptBinaryKey(std::string_view text)
+{
+	uint32_t crc = 0xFFFFFFFFu;
+	for (char c : text)
+		crc = ScriptBinaryDetail::CRC_TABLE[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+// Bounds checked view over a compiled script. Nothing is copied, the records are
+// packed so they can be read in place at any alignment.
+class CScriptBinaryView
+{
+public:
+	bool Open(const void* data, size_t size, EScriptBinaryKind kind)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		if (!bytes || size < sizeof(TScriptBinaryHeader))
+			return false;
+
+		m_header = reinterpret_cast<const TScriptBinaryHeader*>(bytes);
+		if (m_header->magic != SCRIPT_BINARY_MAGIC || m_header->version != SCRIPT_BINARY_VERSION || m_header->kind != kind)
+			return false;
+
+		const uint64_t node_bytes = uint64_t(m_header->node_count) * sizeof(TScriptBinaryNode);
+		const uint64_t token_bytes = uint64_t(m_header->token_count) * sizeof(TScriptBinaryToken);
+		const uint64_t child_bytes = uint64_t(m_header->child_count) * sizeof(uint32_t);
+		const uint64_t slot_bytes = uint64_t(m_header->slot_count) * sizeof(uint32_t);
+		const uint64_t value_bytes = uint64_t(m_header->value_count) * sizeof(TScriptBinaryString);
+
+		if (m_header->node_count == 0
+			|| sizeof(TScriptBinaryHeader) + node_bytes + token_bytes + child_bytes + slot_bytes + value_bytes + m_header->string_pool_size != size)
+			return false;
+
+		const uint8_t* cur = bytes + sizeof(TScriptBinaryHeader);
+		m_nodes = reinterpret_cast<const TScriptBinaryNode*>(cur);
+		cur += node_bytes;
+		m_tokens = reinterpret_cast<const TScriptBinaryToken*>(cur);
+		cur += token_bytes;
+		m_children = cur;
+		cur += child_bytes;
+		m_slots = cur;
+		cur += slot_bytes;
+		m_values = reinterpret_cast<const TScriptBinaryString*>(cur);
+		cur += value_bytes;
+		m_strings = reinterpret_cast<const char*>(cur);
+
+		return Validate();
+	}
+
+	const TScriptBinaryHeader& GetHeader() const { return *m_header; }
+	const TScriptBinaryNode& GetNode(uint32_t index) const { return m_nodes[index]; }
+	const TScriptBinaryToken& GetToken(uint32_t index) const { return m_tokens[index]; }
+	uint32_t GetChild(uint32_t index) const { return Read32(m_children, index); }
+	uint32_t GetSlot(uint32_t index) const { return Read32(m_slots, index); }
+	std::string_view GetValue(uint32_t index) const { return GetString(m_values[index]); }
+	std::string_view GetString(const TScriptBinaryString& str) const { return std::string_view(m_strings + str.offset, str.length); }
+
+private:
+	static uint32_t Read32(const uint8_t* table, uint32_t index)
+	{
+		uint32_t value;
+		memcpy(&value, table + index * sizeof(uint32_t), sizeof(value));
+		return value;
+	}
+
+	bool IsString(const TScriptBinaryString& str) const
+	{
+		return uint64_t(str.offset) + str.length <= m_header->string_pool_size;
+	}
+
+	static bool IsRange(uint32_t first, uint32_t count, uint32_t total)
+	{
+		return uint64_t(first) + count <= total;
+	}
+
+	bool Validate() const
+	{
+		const TScriptBinaryHeader& h = *m_header;
+
+		for (uint32_t i = 0; i < h.node_count; ++i) {
+			const TScriptBinaryNode& node = m_nodes[i];
+			if (!IsString(node.name)
+				|| (i == 0 ? node.parent != UINT32_MAX : node.parent >= i)
+				|| !IsRange(node.first_child, node.child_count, h.child_count)
+				|| !IsRange(node.first_token, node.token_count, h.token_count)
+				|| !IsRange(node.first_slot, node.slot_count, h.slot_count)
+				|| (node.slot_count & (node.slot_count - 1)) != 0
+				|| (node.slot_count != 0 && node.slot_count <= node.token_count)
+				|| (node.token_count != 0 && node.slot_count == 0 && h.kind == SCRIPT_BINARY_GROUP))
+				return false;
+
+			// Children come after their parent, so walking down always ends
+			for (uint32_t c = 0; c < node.child_count; ++c) {
+				const uint32_t child = GetChild(node.first_child + c);
+				if (child <= i || child >= h.node_count)
+					return false;
+			}
+
+			for (uint32_t s = 0; s < node.slot_count; ++s) {
+				if (GetSlot(node.first_slot + s) > node.token_count)
+					return false;
+			}
+		}
+
+		for (uint32_t i = 0; i < h.token_count; ++i) {
+			if (!IsString(m_tokens[i].name) || !IsRange(m_tokens[i].first_value, m_tokens[i].value_count, h.value_count))
+				return false;
+		}
+
+		for (uint32_t i = 0; i < h.value_count; ++i) {
+			if (!IsString(m_values[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	const TScriptBinaryHeader* m_header = nullptr;
+	const TScriptBinaryNode* m_nodes = nullptr;
+	const TScriptBinaryToken* m_tokens = nullptr;
+	const uint8_t* m_children = nullptr;
+	const uint8_t* m_slots = nullptr;
+	const TScriptBinaryString* m_values = nullptr;
+	const char* m_strings = nullptr;
+};
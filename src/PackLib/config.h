@@ -3,8 +3,8 @@
 #include <array>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
-#include <unordered_map>
 
 #include <sodium.h>
 
@@ -18,7 +18,17 @@ constexpr std::array<uint8_t, PACK_KEY_SIZE> PACK_KEY = {
 	0xFE,0xDC,0xBA,0x98, 0x76,0x54,0x32,0x10
 };
 
+// v2 packs start with this magic; v1 packs start with a plain entry count
+constexpr uint32_t PACK_MAGIC_V2 = 0x324B4350; // "PCK2"
+constexpr uint32_t PACK_VERSION_2 = 2;
+constexpr uint32_t PACK_VERSION_3 = 3; // v2 plus a zstd dictionary
+
+// TPackIndexEntry::flags
+constexpr uint8_t PACK_ENTRY_FLAG_STORED = 0x01; // data is kept as is, without zstd
+constexpr uint8_t PACK_ENTRY_FLAG_DICT = 0x02;   // compressed with the pack dictionary
+
 #pragma pack(push, 1)
+// v1 layout: header | encrypted TPackFileEntry[entry_num] | data
 struct TPackFileHeader
 {
 	uint64_t	entry_num;
@@ -34,9 +44,56 @@ struct TPackFileEntry
 	uint8_t		encryption;
 	uint8_t     nonce[PACK_NONCE_SIZE];
 };
+
+// v2 layout: header | TPackIndexEntry[entry_num] sorted by hash | encrypted name pool | data
+// v3 layout: header | TPackDictionaryInfo | entries | name pool | dictionary | data
+// The entry table is stored in plain form so it can be searched straight from the mapping.
+struct TPackFileHeaderV2
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint64_t	entry_num;
+	uint64_t	name_pool_size;
+	uint64_t	data_begin;
+	uint8_t     nonce[PACK_NONCE_SIZE];
+};
+struct TPackDictionaryInfo
+{
+	uint64_t	offset; // absolute file offset
+	uint64_t	size;
+};
+struct TPackIndexEntry
+{
+	uint64_t	hash;
+	uint32_t	name_offset;
+	uint16_t	name_length;
+	uint8_t		encryption;
+	uint8_t		flags;
+	uint64_t	offset;
+	uint64_t	file_size;
+	uint64_t	compressed_size;
+	uint8_t     nonce[PACK_NONCE_SIZE];
+};
 #pragma pack(pop)
 
+static_assert(sizeof(TPackIndexEntry) == 64, "TPackIndexEntry must stay 64 bytes");
+
+// FNV-1a over an already normalized path (lower case, '/' separators).
+// This is part of the v2 on-disk format, do not change it without bumping the version.
+constexpr uint64_t PackHashPath(std::string_view path)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : path) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
 class CPack;
 using TPackFile = std::vector<uint8_t>;
-using TPackFileMapEntry = std::pair<std::shared_ptr<CPack>, TPackFileEntry>;
-using TPackFileMap = std::unordered_map<std::string, TPackFileMapEntry>;
+struct TPackLookupEntry
+{
+	CPack* pack;
+	const TPackIndexEntry* entry;
+};
@@ -0,0 +1,452 @@
+#include "ScriptCompiler.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	struct TBuildToken
+	{
+		std::string name;
+		std::vector<std::string> values;
+	};
+
+	struct TBuildNode
+	{
+		std::string name;
+		uint32_t parent;
+		std::vector<uint32_t> children;
+		std::vector<TBuildToken> tokens;
+	};
+
+	char ToLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+
+	std::string ToLower(std::string_view text)
+	{
+		std::string result(text);
+		std::transform(result.begin(), result.end(), result.begin(), [](char c) { return ToLower(c); });
+		return result;
+	}
+
+	bool IsDelimiter(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	// Lines and tokens follow CMemoryTextFileLoader::Bind and SplitLine2
+	class CScriptLexer
+	{
+	public:
+		CScriptLexer(const char* data, size_t size)
+		{
+			size_t line_begin = 0;
+			size_t pos = 0;
+
+			while (pos < size) {
+				const char c = data[pos++];
+
+				if (c == '\n' || c == '\r') {
+					m_lines.emplace_back(data + line_begin, pos - 1 - line_begin);
+
+					if (pos < size && (data[pos] == '\n' || data[pos] == '\r'))
+						++pos;
+
+					line_begin = pos;
+				}
+				else if (static_cast<uint8_t>(c) >= 0x80) {
+					// lead byte, its trail byte belongs to the line even if it is a line break
+					pos = std::min(pos + 1, size);
+				}
+			}
+
+			m_lines.emplace_back(data + line_begin, size - line_begin);
+		}
+
+		size_t GetLineCount() const { return m_lines.size(); }
+
+		// 0 on success, -1 for an empty line, -2 for a quote that is not closed
+		int Split(size_t line, std::vector<std::string_view>& tokens) const
+		{
+			tokens.clear();
+
+			const char* cur = m_lines[line].data();
+			const char* end = cur + m_lines[line].size();
+
+			while (cur < end && IsDelimiter(*cur))
+				++cur;
+
+			if (cur == end)
+				return -1;
+
+			do {
+				if (*cur == '"') {
+					++cur;
+					const char* quote = static_cast<const char*>(memchr(cur, '"', end - cur));
+					if (!quote)
+						return -2;
+
+					tokens.emplace_back(cur, quote - cur);
+					cur = quote + 1;
+				}
+				else {
+					const char* token_end = cur;
+					while (token_end < end && !IsDelimiter(*token_end))
+						++token_end;
+
+					tokens.emplace_back(cur, token_end - cur);
+					cur = token_end;
+				}
+
+				while (cur < end && IsDelimiter(*cur))
+					++cur;
+			} while (cur < end);
+
+			return 0;
+		}
+
+	private:
+		std::vector<std::string_view> m_lines;
+	};
+
+	// Mirrors CTextFileLoader::LoadGroup, any case the client would log or assert on is an error
+	class CGroupScriptParser
+	{
+	public:
+		CGroupScriptParser(const CScriptLexer& lexer, std::vector<TBuildNode>& nodes, std::string& error)
+			: m_lexer(lexer), m_nodes(nodes), m_error(error), m_line(0)
+		{
+		}
+
+		bool Parse()
+		{
+			m_nodes.clear();
+			m_nodes.push_back({ "global", UINT32_MAX, {}, {} });
+			return LoadGroup(0);
+		}
+
+	private:
+		bool Fail(const char* reason)
+		{
+			m_error = std::string(reason) + " at line " + std::to_string(m_line + 1);
+			return false;
+		}
+
+		static bool IsKeyword(std::string_view token, std::string_view keyword)
+		{
+			return token.size() == keyword.size() && std::equal(token.begin(), token.end(), keyword.begin(), [](char a, char b) {
+				return ToLower(a) == b;
+			});
+		}
+
+		bool LoadGroup(uint32_t node)
+		{
+			int depth = 0;
+
+			for (; m_line < m_lexer.GetLineCount(); ++m_line) {
+				const int ret = m_lexer.Split(m_line, m_tokens);
+				if (ret == -2)
+					return Fail("unterminated quote");
+				if (ret != 0)
+					continue;
+
+				const std::string_view key = m_tokens[0];
+				const char first = key.empty() ? '\0' : key[0];
+
+				if (first == '{') {
+					++depth;
+					continue;
+				}
+
+				if (first == '}') {
+					--depth;
+					break;
+				}
+
+				if (IsKeyword(key, "group")) {
+					if (m_tokens.size() != 2)
+						return Fail("group without a name");
+
+					const uint32_t child = static_cast<uint32_t>(m_nodes.size());
+					m_nodes.push_back({ ToLower(m_tokens[1]), node, {}, {} });
+					m_nodes[node].children.push_back(child);
+
+					++m_line;
+					if (!LoadGroup(child))
+						return false;
+				}
+				else if (IsKeyword(key, "list")) {
+					if (m_tokens.size() != 2)
+						return Fail("list without a name");
+
+					TBuildToken token;
+					token.name = ToLower(m_tokens[1]);
+
+					for (++m_line; m_line < m_lexer.GetLineCount(); ++m_line) {
+						if (m_lexer.Split(m_line, m_tokens) != 0)
+							continue;
+
+						if (!m_tokens[0].empty() && m_tokens[0][0] == '{')
+							continue;
+
+						if (!m_tokens[0].empty() && m_tokens[0][0] == '}')
+							break;
+
+						for (std::string_view value : m_tokens)
+							token.values.emplace_back(value);
+					}
+
+					m_nodes[node].tokens.push_back(std::move(token));
+				}
+				else {
+					if (m_tokens.size() == 1)
+						return Fail("key without a value");
+
+					TBuildToken token;
+					token.name = ToLower(key);
+					for (size_t i = 1; i < m_tokens.size(); ++i)
+						token.values.emplace_back(m_tokens[i]);
+
+					m_nodes[node].tokens.push_back(std::move(token));
+				}
+			}
+
+			if (depth != 0)
+				return Fail("unbalanced braces");
+
+			return true;
+		}
+
+		const CScriptLexer& m_lexer;
+		std::vector<TBuildNode>& m_nodes;
+		std::string& m_error;
+		size_t m_line;
+		std::vector<std::string_view> m_tokens;
+	};
+
+	// Mirrors LoadMultipleTextData: "key values..." lines and "start key" ... "end" blocks
+	bool ParseTokenMap(const CScriptLexer& lexer, std::vector<TBuildNode>& nodes, std::string& error)
+	{
+		nodes.clear();
+		nodes.push_back({ "global", UINT32_MAX, {}, {} });
+
+		std::vector<std::string_view> tokens;
+
+		for (size_t line = 0; line < lexer.GetLineCount(); ++line) {
+			if (lexer.Split(line, tokens) != 0)
+				continue;
+
+			TBuildToken token;
+
+			if (ToLower(tokens[0]) == "start") {
+				if (tokens.size() < 2) {
+					error = "start without a name at line " + std::to_string(line + 1);
+					return false;
+				}
+
+				token.name = ToLower(tokens[1]);
+
+				for (++line; line < lexer.GetLineCount(); ++line) {
+					if (lexer.Split(line, tokens) != 0)
+						continue;
+
+					std::string first = ToLower(tokens[0]);
+					if (first == "end")
+						break;
+
+					token.values.push_back(std::move(first));
+					for (size_t i = 1; i < tokens.size(); ++i)
+						token.values.emplace_back(tokens[i]);
+				}
+			}
+			else {
+				token.name = ToLower(tokens[0]);
+				for (size_t i = 1; i < tokens.size(); ++i)
+					token.values.emplace_back(tokens[i]);
+			}
+
+			nodes[0].tokens.push_back(std::move(token));
+		}
+
+		return true;
+	}
+
+	class CScriptWriter
+	{
+	public:
+		void Write(EScriptBinaryKind kind, std::string_view source, std::vector<TBuildNode>& nodes, std::vector<char>& output)
+		{
+			TScriptBinaryHeader header = {};
+			header.magic = SCRIPT_BINARY_MAGIC;
+			header.version = SCRIPT_BINARY_VERSION;
+			header.kind = kind;
+			header.source_size = static_cast<uint32_t>(source.size());
+			header.source_crc = ScriptBinaryKey(source);
+
+			std::vector<TScriptBinaryNode> out_nodes;
+			std::vector<TScriptBinaryToken> out_tokens;
+			std::vector<uint32_t> children;
+			std::vector<uint32_t> slots;
+			std::vector<TScriptBinaryString> values;
+
+			for (TBuildNode& node : nodes) {
+				// The first definition of a key wins, like std::map::insert in the client.
+				// Group scripts are keyed by hash there, token maps by the name itself.
+				std::vector<TBuildToken*> tokens;
+				std::unordered_set<uint32_t> seen_keys;
+				std::unordered_set<std::string_view> seen_names;
+				for (TBuildToken& token : node.tokens) {
+					const bool first = kind == SCRIPT_BINARY_GROUP
+						? seen_keys.insert(ScriptBinaryKey(token.name)).second
+						: seen_names.insert(token.name).second;
+
+					if (first)
+						tokens.push_back(&token);
+				}
+
+				TScriptBinaryNode out = {};
+				out.name_key = ScriptBinaryKey(node.name);
+				out.name = AddString(node.name);
+				out.parent = node.parent;
+				out.first_child = static_cast<uint32_t>(children.size());
+				out.child_count = static_cast<uint32_t>(node.children.size());
+				out.first_token = static_cast<uint32_t>(out_tokens.size());
+				out.token_count = static_cast<uint32_t>(tokens.size());
+				out.first_slot = static_cast<uint32_t>(slots.size());
+
+				children.insert(children.end(), node.children.begin(), node.children.end());
+
+				for (TBuildToken* token : tokens) {
+					TScriptBinaryToken out_token = {};
+					out_token.key = ScriptBinaryKey(token->name);
+					out_token.name = AddString(token->name);
+					out_token.first_value = static_cast<uint32_t>(values.size());
+					out_token.value_count = static_cast<uint32_t>(token->values.size());
+					out_tokens.push_back(out_token);
+
+					for (const std::string& value : token->values)
+						values.push_back(AddString(value));
+				}
+
+				// Same table the client builds for text scripts, so lookups cost the same
+				if (kind == SCRIPT_BINARY_GROUP && !tokens.empty()) {
+					uint32_t slot_count = 4;
+					while (slot_count < tokens.size() * 2)
+						slot_count <<= 1;
+
+					out.slot_count = slot_count;
+					slots.resize(slots.size() + slot_count, 0);
+
+					uint32_t* table = slots.data() + out.first_slot;
+					for (uint32_t i = 0; i < out.token_count; ++i) {
+						uint32_t slot = out_tokens[out.first_token + i].key & (slot_count - 1);
+						while (table[slot])
+							slot = (slot + 1) & (slot_count - 1);
+						table[slot] = i + 1;
+					}
+				}
+
+				out_nodes.push_back(out);
+			}
+
+			header.node_count = static_cast<uint32_t>(out_nodes.size());
+			header.token_count = static_cast<uint32_t>(out_tokens.size());
+			header.child_count = static_cast<uint32_t>(children.size());
+			header.slot_count = static_cast<uint32_t>(slots.size());
+			header.value_count = static_cast<uint32_t>(values.size());
+			header.string_pool_size = static_cast<uint32_t>(m_pool.size());
+
+			output.clear();
+			Append(output, &header, sizeof(header));
+			Append(output, out_nodes.data(), out_nodes.size() * sizeof(TScriptBinaryNode));
+			Append(output, out_tokens.data(), out_tokens.size() * sizeof(TScriptBinaryToken));
+			Append(output, children.data(), children.size() * sizeof(uint32_t));
+			Append(output, slots.data(), slots.size() * sizeof(uint32_t));
+			Append(output, values.data(), values.size() * sizeof(TScriptBinaryString));
+			Append(output, m_pool.data(), m_pool.size());
+		}
+
+	private:
+		TScriptBinaryString AddString(const std::string& text)
+		{
+			auto it = m_offsets.find(text);
+			if (it == m_offsets.end()) {
+				it = m_offsets.emplace(text, static_cast<uint32_t>(m_pool.size())).first;
+				m_pool += text;
+			}
+
+			return { it->second, static_cast<uint32_t>(text.size()) };
+		}
+
+		static void Append(std::vector<char>& output, const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			output.insert(output.end(), bytes, bytes + size);
+		}
+
+		std::string m_pool;
+		std::unordered_map<std::string, uint32_t> m_offsets;
+	};
+}
+
+EScriptBinaryKind GetScriptBinaryKind(std::string_view name)
+{
+	static const std::array<std::string_view, 5> group_extensions = {
+		".msa", ".msm", ".mse", ".mss", ".msenv"
+	};
+
+	static const std::array<std::string_view, 5> token_map_files = {
+		"areadata.txt", "areaambiencedata.txt", "areaproperty.txt", "setting.txt", "mapproperty.txt"
+	};
+
+	const size_t slash = name.find_last_of('/');
+	const std::string_view file_name = slash == std::string_view::npos ? name : name.substr(slash + 1);
+	const size_t dot = file_name.find_last_of('.');
+	const std::string_view extension = dot == std::string_view::npos ? std::string_view() : file_name.substr(dot);
+
+	if (std::find(group_extensions.begin(), group_extensions.end(), extension) != group_extensions.end())
+		return SCRIPT_BINARY_GROUP;
+
+	if (std::find(token_map_files.begin(), token_map_files.end(), file_name) != token_map_files.end())
+		return SCRIPT_BINARY_TOKEN_MAP;
+
+	// Terrain texture sets are referenced from Setting.txt
+	if (extension == ".txt" && name.find("textureset/") != std::string_view::npos)
+		return SCRIPT_BINARY_TOKEN_MAP;
+
+	return SCRIPT_BINARY_NONE;
+}
+
+bool CompileScript(EScriptBinaryKind kind, const char* data, size_t size, std::vector<char>& output, std::string& error)
+{
+	if (size > UINT32_MAX) {
+		error = "too large";
+		return false;
+	}
+
+	CScriptLexer lexer(data, size);
+	std::vector<TBuildNode> nodes;
+
+	switch (kind) {
+		case SCRIPT_BINARY_GROUP:
+			if (!CGroupScriptParser(lexer, nodes, error).Parse())
+				return false;
+			break;
+
+		case SCRIPT_BINARY_TOKEN_MAP:
+			if (!ParseTokenMap(lexer, nodes, error))
+				return false;
+			break;
+
+		default:
+			error = "not a script";
+			return false;
+	}
+
+	CScriptWriter().Write(kind, std::string_view(data, size), nodes, output);
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "PackLib/ScriptBinary.h"
+
+// Which compiled form a file gets, from its normalized pack name
+EScriptBinaryKind GetScriptBinaryKind(std::string_view name);
+
+// Parses a text script the way the client does and writes its compiled form.
+// Scripts the client would complain about are rejected, so they keep loading from text.
+bool CompileScript(EScriptBinaryKind kind, const char* data, size_t size, std::vector<char>& output, std::string& error);
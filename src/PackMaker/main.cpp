@@ -2,18 +2,726 @@
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
 
 #include <zstd.h>
+#include <zdict.h>
+#define XXH_INLINE_ALL
+#include <common/xxhash.h>
 #include <argparse.hpp>
 #include <sodium.h>
+#include <mio/mmap.hpp>
 
 #include "PackLib/config.h"
+#include "ScriptCompiler.h"
+
+struct TMakerEntry
+{
+	std::filesystem::path path;
+	std::string name;
+	uint64_t offset;
+	uint64_t file_size;
+	uint64_t compressed_size;
+	uint8_t encryption;
+	uint8_t flags;
+	uint8_t nonce[PACK_NONCE_SIZE];
+
+	// compiled scripts are generated from the file at path, content replaces its bytes
+	bool compiled;
+	std::vector<char> content;
+
+	// filled by the workers, consumed by the writer
+	std::vector<char> blob;
+	std::string error;
+	uint64_t content_hash;
+	bool reused;
+	bool ready;
+};
+
+// "<pack>.hashes" next to a v2 pack: XXH64 of the contents of every file, keyed by path hash.
+// Only PackMaker reads it, --incremental compares these instead of decoding the old blobs.
+constexpr uint32_t CONTENT_HASHES_MAGIC = 0x48584350; // "PCXH"
+
+#pragma pack(push, 1)
+struct TContentHashesHeader
+{
+	uint32_t	magic;
+	uint64_t	entry_num;
+	uint8_t		pack_nonce[PACK_NONCE_SIZE]; // header nonce of the pack they describe
+};
+struct TContentHash
+{
+	uint64_t	path_hash;
+	uint64_t	content_hash;
+};
+#pragma pack(pop)
+
+// Deletes the partially written pack on every failure, dismissed once it replaced the output
+struct TTempOutputGuard
+{
+	std::filesystem::path path;
+	std::ofstream& stream;
+	bool dismissed = false;
+
+	~TTempOutputGuard()
+	{
+		if (dismissed)
+			return;
+
+		stream.close();
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+	}
+};
+
+// Index of a previously built pack, used by --incremental
+struct TPreviousPack
+{
+	mio::mmap_source file;
+	uint64_t data_begin = 0;
+	std::string dictionary;
+	uint8_t nonce[PACK_NONCE_SIZE];
+	std::unordered_map<std::string, TPackIndexEntry> entries;
+	std::unordered_map<uint64_t, uint64_t> content_hashes; // path hash -> content hash
+};
+
+struct TCompressContext
+{
+	bool legacy;
+	bool verify_reuse;
+	const ZSTD_CDict* cdict;
+	const TPreviousPack* previous;
+};
+
+// Already compressed formats, zstd barely shrinks them so they are kept as is
+static bool IsStoredExtension(const std::filesystem::path& path)
+{
+	static const std::array<std::string_view, 6> stored_extensions = {
+		".jpg", ".jpeg", ".png", ".ogg", ".mp3", ".wma"
+	};
+
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+
+	return std::find(stored_extensions.begin(), stored_extensions.end(), ext) != stored_extensions.end();
+}
+
+static bool IsScript(const std::filesystem::path& path)
+{
+	return path.has_extension() && path.extension() == ".py";
+}
+
+// A file is stored uncompressed unless zstd saves at least 1/STORE_MIN_SAVING of it
+constexpr uint64_t STORE_MIN_SAVING = 20;
+
+constexpr int COMPRESSION_LEVEL = 17;
+
+// Files up to this size are dictionary candidates (.msa/.mse/.mss, small texts)
+constexpr uint64_t DICT_MAX_SAMPLE_SIZE = 64 * 1024;
+constexpr size_t DICT_MIN_SAMPLES = 64;
+constexpr size_t DICT_MAX_SAMPLE_BYTES = 32 * 1024 * 1024;
+constexpr size_t DICT_SIZE = 112 * 1024;
+
+// How far the workers may run ahead of the writer, bounds the memory held in blobs
+constexpr size_t PIPELINE_WINDOW = 512;
 
 static void EncryptData(uint8_t* data, size_t len, const uint8_t* nonce)
 {
 	crypto_stream_xchacha20_xor(data, data, len, nonce, PACK_KEY.data());
 }
 
+static bool ReadInputFile(const std::filesystem::path& path, uint64_t size, std::vector<char>& buffer)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs.is_open()) {
+		return false;
+	}
+
+	buffer.resize(size);
+	return size == 0 || static_cast<bool>(ifs.read(buffer.data(), size));
+}
+
+static bool ReadEntryContent(const TMakerEntry& entry, std::vector<char>& buffer)
+{
+	if (entry.compiled) {
+		buffer = entry.content;
+		return true;
+	}
+
+	return ReadInputFile(entry.path, entry.file_size, buffer);
+}
+
+// Moves files listed in a client access trace (--pack-trace) to the front, in first access order.
+// Files missing from the trace keep their alphabetical order behind them.
+static bool ApplyAccessTrace(const std::filesystem::path& path, std::vector<TMakerEntry>& entries)
+{
+	std::ifstream ifs(path);
+	if (!ifs.is_open()) {
+		return false;
+	}
+
+	std::unordered_map<std::string, size_t> ranks;
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.empty())
+			ranks.emplace(line, ranks.size());
+	}
+
+	size_t traced = 0;
+	std::vector<size_t> entry_ranks(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		auto it = ranks.find(entries[i].name);
+		entry_ranks[i] = it != ranks.end() ? it->second : SIZE_MAX;
+		traced += it != ranks.end();
+	}
+
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return entry_ranks[a] < entry_ranks[b];
+	});
+
+	std::vector<TMakerEntry> sorted;
+	sorted.reserve(entries.size());
+	for (size_t i : order)
+		sorted.push_back(std::move(entries[i]));
+	entries = std::move(sorted);
+
+	std::cout << "Access trace covers " << traced << " of " << entries.size() << " files" << std::endl;
+	return true;
+}
+
+static bool LoadPreviousPack(const std::filesystem::path& path, TPreviousPack& pack)
+{
+	std::error_code ec;
+	pack.file.map(path.string(), ec);
+	if (ec || pack.file.size() < sizeof(TPackFileHeaderV2)) {
+		return false;
+	}
+
+	TPackFileHeaderV2 header;
+	memcpy(&header, pack.file.data(), sizeof(header));
+	if (header.magic != PACK_MAGIC_V2 || (header.version != PACK_VERSION_2 && header.version != PACK_VERSION_3)) {
+		return false;
+	}
+
+	// The previous pack is as untrusted as any other, checks are written so they cannot wrap around
+	const size_t file_size = pack.file.size();
+	size_t index_begin = sizeof(TPackFileHeaderV2);
+	if (header.version == PACK_VERSION_3) {
+		if (file_size - index_begin < sizeof(TPackDictionaryInfo)) {
+			return false;
+		}
+
+		TPackDictionaryInfo dict;
+		memcpy(&dict, pack.file.data() + index_begin, sizeof(dict));
+		index_begin += sizeof(TPackDictionaryInfo);
+
+		if (dict.offset > file_size || dict.size > file_size - dict.offset) {
+			return false;
+		}
+
+		pack.dictionary.assign(pack.file.data() + dict.offset, dict.size);
+	}
+
+	if (header.entry_num > (file_size - index_begin) / sizeof(TPackIndexEntry)) {
+		return false;
+	}
+
+	const uint64_t index_size = header.entry_num * sizeof(TPackIndexEntry);
+	if (header.name_pool_size > file_size - index_begin - index_size || header.data_begin > file_size) {
+		return false;
+	}
+
+	std::string names(pack.file.data() + index_begin + index_size, header.name_pool_size);
+	EncryptData((uint8_t*)names.data(), names.size(), header.nonce);
+
+	pack.data_begin = header.data_begin;
+	memcpy(pack.nonce, header.nonce, sizeof(pack.nonce));
+
+	for (uint64_t i = 0; i < header.entry_num; ++i) {
+		TPackIndexEntry entry;
+		memcpy(&entry, pack.file.data() + index_begin + i * sizeof(TPackIndexEntry), sizeof(entry));
+
+		if (entry.name_offset > names.size() || entry.name_length > names.size() - entry.name_offset
+			|| entry.offset > file_size - pack.data_begin || entry.compressed_size > file_size - pack.data_begin - entry.offset) {
+			return false;
+		}
+
+		pack.entries.emplace(names.substr(entry.name_offset, entry.name_length), entry);
+	}
+
+	return true;
+}
+
+// Missing or written for another build of the pack leaves the hashes empty
+static void LoadContentHashes(const std::filesystem::path& path, TPreviousPack& pack)
+{
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs.is_open()) {
+		return;
+	}
+
+	TContentHashesHeader header;
+	if (!ifs.read((char*)&header, sizeof(header)) || header.magic != CONTENT_HASHES_MAGIC
+		|| memcmp(header.pack_nonce, pack.nonce, sizeof(pack.nonce)) != 0
+		|| header.entry_num != pack.entries.size()) {
+		return;
+	}
+
+	std::vector<TContentHash> hashes(header.entry_num);
+	if (!ifs.read((char*)hashes.data(), hashes.size() * sizeof(TContentHash))) {
+		return;
+	}
+
+	pack.content_hashes.reserve(hashes.size());
+	for (const auto& hash : hashes)
+		pack.content_hashes.emplace(hash.path_hash, hash.content_hash);
+}
+
+static bool WriteContentHashes(const std::filesystem::path& path, const std::vector<TMakerEntry>& entries, const TPackFileHeaderV2& header)
+{
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+
+	bool written = false;
+	{
+		std::ofstream ofs(temp_path, std::ios::binary);
+		if (!ofs.is_open()) {
+			return false;
+		}
+
+		TContentHashesHeader hashes_header;
+		hashes_header.magic = CONTENT_HASHES_MAGIC;
+		hashes_header.entry_num = entries.size();
+		memcpy(hashes_header.pack_nonce, header.nonce, sizeof(hashes_header.pack_nonce));
+		ofs.write((const char*)&hashes_header, sizeof(hashes_header));
+
+		for (const auto& entry : entries) {
+			TContentHash hash;
+			hash.path_hash = PackHashPath(entry.name);
+			hash.content_hash = entry.content_hash;
+			ofs.write((const char*)&hash, sizeof(hash));
+		}
+
+		ofs.close();
+		written = !ofs.fail();
+	}
+
+	std::error_code ec;
+	if (!written) {
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	std::filesystem::rename(temp_path, path, ec);
+	return !ec;
+}
+
+// Decodes a blob of the previous pack and compares it with the new file contents
+static bool PreviousBlobEquals(const TPreviousPack& pack, const TPackIndexEntry& old, const std::vector<char>& content, ZSTD_DCtx* dctx, std::vector<char>& scratch)
+{
+	const char* blob = pack.file.data() + pack.data_begin + old.offset;
+	std::vector<char> decrypted;
+
+	if (old.encryption == 1) {
+		decrypted.assign(blob, blob + old.compressed_size);
+		EncryptData((uint8_t*)decrypted.data(), decrypted.size(), old.nonce);
+	}
+
+	const char* src = old.encryption ? decrypted.data() : blob;
+
+	if (old.flags & PACK_ENTRY_FLAG_STORED) {
+		return old.compressed_size == old.file_size && memcmp(src, content.data(), content.size()) == 0;
+	}
+
+	scratch.resize(old.file_size);
+
+	size_t size = (old.flags & PACK_ENTRY_FLAG_DICT)
+		? ZSTD_decompress_usingDict(dctx, scratch.data(), scratch.size(), src, old.compressed_size, pack.dictionary.data(), pack.dictionary.size())
+		: ZSTD_decompressDCtx(dctx, scratch.data(), scratch.size(), src, old.compressed_size);
+
+	return !ZSTD_isError(size) && size == content.size() && memcmp(scratch.data(), content.data(), size) == 0;
+}
+
+// Reuses the blob of the previous pack if it holds the same contents. Files with a recorded
+// content hash are compared by hash, the rest (every file with --verify-reuse) are decoded.
+static bool ReusePreviousBlob(const TPreviousPack& pack, TMakerEntry& entry, const std::vector<char>& content, bool verify, ZSTD_DCtx* dctx, std::vector<char>& scratch)
+{
+	auto it = pack.entries.find(entry.name);
+	if (it == pack.entries.end()) {
+		return false;
+	}
+
+	const TPackIndexEntry& old = it->second;
+	if (old.file_size != entry.file_size || old.encryption > 1) {
+		return false;
+	}
+
+	auto hash = pack.content_hashes.find(old.hash);
+	const bool hashed = hash != pack.content_hashes.end();
+
+	if (hashed && hash->second != entry.content_hash) {
+		return false;
+	}
+
+	if ((!hashed || verify) && !PreviousBlobEquals(pack, old, content, dctx, scratch)) {
+		return false;
+	}
+
+	const char* blob = pack.file.data() + pack.data_begin + old.offset;
+	entry.blob.assign(blob, blob + old.compressed_size);
+	entry.compressed_size = old.compressed_size;
+	entry.encryption = old.encryption;
+	entry.flags = old.flags;
+	entry.reused = true;
+	memcpy(entry.nonce, old.nonce, sizeof(entry.nonce));
+	return true;
+}
+
+static bool TrainDictionary(const std::vector<TMakerEntry>& entries, std::string& dictionary)
+{
+	std::vector<char> samples;
+	std::vector<size_t> sample_sizes;
+	std::vector<char> buffer;
+
+	for (const auto& entry : entries) {
+		if (entry.file_size == 0 || entry.file_size > DICT_MAX_SAMPLE_SIZE || IsStoredExtension(entry.path) || IsScript(entry.path))
+			continue;
+
+		if (samples.size() + entry.file_size > DICT_MAX_SAMPLE_BYTES)
+			break;
+
+		if (!ReadEntryContent(entry, buffer))
+			continue;
+
+		samples.insert(samples.end(), buffer.begin(), buffer.end());
+		sample_sizes.push_back(buffer.size());
+	}
+
+	if (sample_sizes.size() < DICT_MIN_SAMPLES) {
+		std::cout << "Not enough small files to train a dictionary (" << sample_sizes.size() << ")" << std::endl;
+		return false;
+	}
+
+	dictionary.resize(DICT_SIZE);
+	size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sample_sizes.data(), static_cast<unsigned>(sample_sizes.size()));
+	if (ZDICT_isError(size)) {
+		std::cerr << "Failed to train dictionary: " << ZDICT_getErrorName(size) << std::endl;
+		dictionary.clear();
+		return false;
+	}
+
+	dictionary.resize(size);
+	std::cout << "Trained a " << size << " byte dictionary from " << sample_sizes.size() << " files" << std::endl;
+	return true;
+}
+
+static void ProcessEntry(TMakerEntry& entry, const TCompressContext& context, ZSTD_CCtx* cctx, ZSTD_DCtx* dctx, std::vector<char>& scratch)
+{
+	std::vector<char> buffer;
+	if (entry.compiled) {
+		buffer = std::move(entry.content);
+	}
+	else if (!ReadInputFile(entry.path, entry.file_size, buffer)) {
+		entry.error = "Failed to read input file: " + entry.path.string();
+		return;
+	}
+
+	entry.content_hash = XXH64(buffer.data(), buffer.size(), 0);
+
+	if (context.previous && ReusePreviousBlob(*context.previous, entry, buffer, context.verify_reuse, dctx, scratch)) {
+		return;
+	}
+
+	const bool is_script = IsScript(entry.path);
+
+	// v1 packs have no flags, so every entry there has to be compressed
+	if (!context.legacy && !is_script && IsStoredExtension(entry.path)) {
+		entry.compressed_size = entry.file_size;
+		entry.flags |= PACK_ENTRY_FLAG_STORED;
+		entry.blob = std::move(buffer);
+		return;
+	}
+
+	const bool use_dict = context.cdict && entry.file_size <= DICT_MAX_SAMPLE_SIZE;
+
+	entry.blob.resize(ZSTD_compressBound(entry.file_size));
+	entry.compressed_size = use_dict
+		? ZSTD_compress_usingCDict(cctx, entry.blob.data(), entry.blob.size(), buffer.data(), buffer.size(), context.cdict)
+		: ZSTD_compressCCtx(cctx, entry.blob.data(), entry.blob.size(), buffer.data(), buffer.size(), COMPRESSION_LEVEL);
+
+	if (ZSTD_isError(entry.compressed_size)) {
+		entry.error = "Failed to compress input file: " + entry.path.string() + " error: " + ZSTD_getErrorName(entry.compressed_size);
+		return;
+	}
+
+	// Keep the raw bytes if compression saves less than 1/STORE_MIN_SAVING (5%)
+	if (!context.legacy && !is_script && entry.compressed_size + entry.file_size / STORE_MIN_SAVING >= entry.file_size) {
+		entry.compressed_size = entry.file_size;
+		entry.flags |= PACK_ENTRY_FLAG_STORED;
+		entry.blob = std::move(buffer);
+		return;
+	}
+
+	entry.blob.resize(entry.compressed_size);
+	if (use_dict) {
+		entry.flags |= PACK_ENTRY_FLAG_DICT;
+	}
+
+	if (is_script) {
+		entry.encryption = 1;
+
+		randombytes_buf(entry.nonce, sizeof(entry.nonce));
+		EncryptData((uint8_t*)entry.blob.data(), entry.compressed_size, entry.nonce);
+	}
+}
+
+// Workers compress entries out of order, the calling thread writes them in index order
+static bool WriteEntries(std::ofstream& ofs, std::vector<TMakerEntry>& entries, const TCompressContext& context, size_t jobs)
+{
+	std::mutex mutex;
+	std::condition_variable cv_ready;
+	std::condition_variable cv_space;
+	size_t next_job = 0;
+	size_t written = 0;
+	bool abort = false;
+
+	auto worker = [&]() {
+		ZSTD_CCtx* cctx = ZSTD_createCCtx();
+		ZSTD_DCtx* dctx = ZSTD_createDCtx();
+		std::vector<char> scratch;
+
+		while (true) {
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv_space.wait(lock, [&]() { return abort || next_job >= entries.size() || next_job < written + PIPELINE_WINDOW; });
+
+				if (abort || next_job >= entries.size())
+					break;
+
+				index = next_job++;
+			}
+
+			ProcessEntry(entries[index], context, cctx, dctx, scratch);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				entries[index].ready = true;
+			}
+			cv_ready.notify_all();
+		}
+
+		ZSTD_freeCCtx(cctx);
+		ZSTD_freeDCtx(dctx);
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(jobs);
+	for (size_t i = 0; i < jobs; ++i)
+		workers.emplace_back(worker);
+
+	bool success = true;
+	uint64_t offset = 0;
+
+	for (auto& entry : entries) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv_ready.wait(lock, [&]() { return entry.ready; });
+		}
+
+		if (!entry.error.empty()) {
+			std::cerr << entry.error << std::endl;
+			success = false;
+			break;
+		}
+
+		entry.offset = offset;
+		ofs.write(entry.blob.data(), entry.compressed_size);
+		offset += entry.compressed_size;
+
+		entry.blob.clear();
+		entry.blob.shrink_to_fit();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++written;
+		}
+		cv_space.notify_all();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		abort = true;
+	}
+	cv_space.notify_all();
+
+	for (auto& thread : workers)
+		thread.join();
+
+	return success;
+}
+
+// The client resolves files by hash only, so a collision inside one pack is fatal.
+// Checked before anything is compressed.
+static bool CheckPathHashes(const std::vector<TMakerEntry>& entries)
+{
+	std::unordered_map<uint64_t, const std::string*> names;
+	names.reserve(entries.size());
+
+	for (auto& entry : entries) {
+		auto [it, inserted] = names.emplace(PackHashPath(entry.name), &entry.name);
+		if (!inserted) {
+			std::cerr << "Path hash collision: " << *it->second << " and " << entry.name << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void WriteIndexV1(std::ofstream& ofs, const std::vector<TMakerEntry>& entries, const TPackFileHeader& header)
+{
+	ofs.seekp(sizeof(TPackFileHeader), std::ios::beg);
+
+	for (auto& entry : entries) {
+		TPackFileEntry tmp;
+		memset(&tmp, 0, sizeof(tmp));
+		entry.name.copy(tmp.file_name, sizeof(tmp.file_name) - 1);
+		tmp.offset = entry.offset;
+		tmp.file_size = entry.file_size;
+		tmp.compressed_size = entry.compressed_size;
+		tmp.encryption = entry.encryption;
+		memcpy(tmp.nonce, entry.nonce, sizeof(tmp.nonce));
+
+		EncryptData((uint8_t*)&tmp, sizeof(TPackFileEntry), header.nonce);
+		ofs.write((const char*)&tmp, sizeof(TPackFileEntry));
+	}
+}
+
+static void WriteIndexV2(std::ofstream& ofs, const std::vector<TMakerEntry>& entries, const TPackFileHeaderV2& header, uint64_t index_begin)
+{
+	std::vector<TPackIndexEntry> index;
+	index.reserve(entries.size());
+
+	std::string name_pool;
+	for (auto& entry : entries) {
+		TPackIndexEntry tmp;
+		memset(&tmp, 0, sizeof(tmp));
+		tmp.hash = PackHashPath(entry.name);
+		tmp.name_offset = static_cast<uint32_t>(name_pool.size());
+		tmp.name_length = static_cast<uint16_t>(entry.name.size());
+		tmp.offset = entry.offset;
+		tmp.file_size = entry.file_size;
+		tmp.compressed_size = entry.compressed_size;
+		tmp.encryption = entry.encryption;
+		tmp.flags = entry.flags;
+		memcpy(tmp.nonce, entry.nonce, sizeof(tmp.nonce));
+		index.push_back(tmp);
+
+		name_pool += entry.name;
+	}
+
+	std::sort(index.begin(), index.end(), [](const TPackIndexEntry& a, const TPackIndexEntry& b) {
+		return a.hash < b.hash;
+	});
+
+	EncryptData((uint8_t*)name_pool.data(), name_pool.size(), header.nonce);
+
+	ofs.seekp(index_begin, std::ios::beg);
+	ofs.write((const char*)index.data(), index.size() * sizeof(TPackIndexEntry));
+	ofs.write(name_pool.data(), name_pool.size());
+}
+
+// Adds a compiled "<name>.tsb" entry behind every script the client can then load without parsing text
+static void CompileScripts(std::vector<TMakerEntry>& entries, size_t jobs, uint64_t& name_pool_size)
+{
+	std::vector<EScriptBinaryKind> kinds(entries.size());
+	std::vector<std::vector<char>> outputs(entries.size());
+	std::vector<std::string> errors(entries.size());
+
+	for (size_t i = 0; i < entries.size(); ++i)
+		kinds[i] = GetScriptBinaryKind(entries[i].name);
+
+	std::atomic<size_t> next_job = 0;
+	auto worker = [&]() {
+		std::vector<char> buffer;
+
+		for (size_t i = next_job++; i < entries.size(); i = next_job++) {
+			if (kinds[i] == SCRIPT_BINARY_NONE)
+				continue;
+
+			if (!ReadInputFile(entries[i].path, entries[i].file_size, buffer)) {
+				errors[i] = "cannot read the file";
+				continue;
+			}
+
+			if (!CompileScript(kinds[i], buffer.data(), buffer.size(), outputs[i], errors[i]))
+				outputs[i].clear();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < jobs; ++i)
+		workers.emplace_back(worker);
+	for (auto& thread : workers)
+		thread.join();
+
+	std::vector<TMakerEntry> result;
+	result.reserve(entries.size() * 2);
+
+	size_t compiled = 0, kept = 0;
+	uint64_t source_bytes = 0, compiled_bytes = 0;
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		result.push_back(std::move(entries[i]));
+
+		if (kinds[i] == SCRIPT_BINARY_NONE)
+			continue;
+
+		const TMakerEntry& source = result.back();
+		if (outputs[i].empty() || source.name.size() + SCRIPT_BINARY_SUFFIX.size() > FILENAME_MAX) {
+			std::cout << "Keeping " << source.name << " as text: " << errors[i] << std::endl;
+			++kept;
+			continue;
+		}
+
+		TMakerEntry entry = source;
+		entry.name += SCRIPT_BINARY_SUFFIX;
+		entry.file_size = outputs[i].size();
+		entry.compiled = true;
+		entry.content = std::move(outputs[i]);
+
+		name_pool_size += entry.name.size();
+		source_bytes += source.file_size;
+		compiled_bytes += entry.file_size;
+		++compiled;
+
+		result.push_back(std::move(entry));
+	}
+
+	entries = std::move(result);
+
+	std::cout << "Compiled " << compiled << " scripts (" << source_bytes << " -> " << compiled_bytes << " bytes), "
+		<< kept << " kept as text" << std::endl;
+}
+
 int main(int argc, char* argv[])
 {
 	std::setlocale(LC_ALL, "en_US.UTF-8");
@@ -33,6 +741,35 @@ int main(int argc, char* argv[])
 		.default_value("")
 		.help("Output path to place newly created pack file");
 
+	program.add_argument("--legacy")
+		.flag()
+		.help("Write the old v1 pack format");
+
+	program.add_argument("--jobs")
+		.default_value(0)
+		.scan<'i', int>()
+		.help("Number of compression threads, 0 uses every core");
+
+	program.add_argument("--dict")
+		.flag()
+		.help("Train a zstd dictionary for the small files of this pack");
+
+	program.add_argument("--incremental")
+		.flag()
+		.help("Reuse compressed data of the existing output pack for unchanged files");
+
+	program.add_argument("--verify-reuse")
+		.flag()
+		.help("With --incremental, decode reused files and compare them instead of trusting their content hash");
+
+	program.add_argument("--compile-scripts")
+		.flag()
+		.help("Store a compiled copy of effect, motion, race and map scripts next to the text");
+
+	program.add_argument("--trace")
+		.default_value("")
+		.help("Client access trace (pack_trace.txt), files are laid out in first access order");
+
 	try {
 		program.parse_args(argc, argv);
 	}
@@ -43,6 +780,14 @@ int main(int argc, char* argv[])
 	}
 
 	std::filesystem::path input = program.get<std::string>("--input"), output = program.get<std::string>("--output");
+	const bool legacy = program.get<bool>("--legacy");
+	const bool use_dict = program.get<bool>("--dict") && !legacy;
+	const bool incremental = program.get<bool>("--incremental") && !legacy;
+
+	size_t jobs = static_cast<size_t>(std::max(0, program.get<int>("--jobs")));
+	if (jobs == 0) {
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
 
 	// we just normalize it here, because if it has a trailing slash, filename() will be empty
 	// otherwise it returns the last part of the path
@@ -52,13 +797,38 @@ int main(int argc, char* argv[])
 
 	output /= input.filename().replace_extension(".pck");
 
-	std::ofstream ofs(output, std::ios::binary);
+	std::filesystem::path hashes_output = output;
+	hashes_output += ".hashes";
+
+	// The previous pack stays mapped while the new one is written next to it
+	std::unique_ptr<TPreviousPack> previous;
+	if (incremental && std::filesystem::exists(output)) {
+		previous = std::make_unique<TPreviousPack>();
+		if (!LoadPreviousPack(output, *previous)) {
+			std::cout << "Cannot reuse " << output << ", rebuilding every file" << std::endl;
+			previous.reset();
+		}
+		else {
+			LoadContentHashes(hashes_output, *previous);
+			if (previous->content_hashes.empty()) {
+				std::cout << "No content hashes for " << output << ", decoding its files to compare them" << std::endl;
+			}
+		}
+	}
+
+	std::filesystem::path temp_output = output;
+	temp_output += ".tmp";
+
+	std::ofstream ofs(temp_output, std::ios::binary);
 	if (!ofs.is_open()) {
-		std::cerr << "Failed to open output file: " << output << std::endl;
+		std::cerr << "Failed to open output file: " << temp_output << std::endl;
 		return EXIT_FAILURE;
 	}
 
-	std::map<std::filesystem::path, TPackFileEntry> entries;
+	TTempOutputGuard temp_guard{ temp_output, ofs };
+
+	std::map<std::filesystem::path, TMakerEntry> sorted_entries;
+	uint64_t name_pool_size = 0;
 
 	for (auto entry : std::filesystem::recursive_directory_iterator(input)) {
 		if (!entry.is_regular_file())
@@ -66,9 +836,18 @@ int main(int argc, char* argv[])
 
 		std::filesystem::path relative_path = std::filesystem::relative(entry.path(), input);
 
-		TPackFileEntry& file_entry = entries[relative_path];
-		memset(&file_entry, 0, sizeof(file_entry));
+		TMakerEntry& file_entry = sorted_entries[relative_path];
+		file_entry.path = entry.path();
+		file_entry.offset = 0;
 		file_entry.file_size = entry.file_size();
+		file_entry.compressed_size = 0;
+		file_entry.encryption = 0;
+		file_entry.flags = 0;
+		file_entry.compiled = false;
+		file_entry.content_hash = 0;
+		file_entry.reused = false;
+		file_entry.ready = false;
+		memset(file_entry.nonce, 0, sizeof(file_entry.nonce));
 
 		constexpr std::string_view ymir_work_prefix = "ymir work/";
 		std::string rp_str = relative_path.generic_string();
@@ -80,65 +859,153 @@ int main(int argc, char* argv[])
 			return static_cast<char>(std::tolower(c));
 		});
 
-		rp_str.copy(file_entry.file_name, sizeof(file_entry.file_name) - 1);
+		if (rp_str.size() > FILENAME_MAX) {
+			rp_str.resize(FILENAME_MAX);
+		}
+
+		file_entry.name = std::move(rp_str);
+		name_pool_size += file_entry.name.size();
 	}
 
-	TPackFileHeader header;
-	memset(&header, 0, sizeof(header));
-	header.entry_num = entries.size();
-	header.data_begin = sizeof(TPackFileHeader) + sizeof(TPackFileEntry) * entries.size();
+	std::vector<TMakerEntry> entries;
+	entries.reserve(sorted_entries.size());
+	for (auto& [path, entry] : sorted_entries)
+		entries.push_back(std::move(entry));
+	sorted_entries.clear();
 
-	randombytes_buf(header.nonce, sizeof(header.nonce));
+	if (!CheckPathHashes(entries)) {
+		return EXIT_FAILURE;
+	}
 
-	ofs.write((const char*) &header, sizeof(header));
-	ofs.seekp(header.data_begin, std::ios::beg);
+	// The compiled copies bring names of their own
+	if (program.get<bool>("--compile-scripts")) {
+		CompileScripts(entries, jobs, name_pool_size);
 
-	uint64_t offset = 0;
-	for (auto& [path, entry] : entries) {
-		std::ifstream ifs(input / path, std::ios::binary);
-		if (!ifs.is_open()) {
-			std::cerr << "Failed to open input file: " << (input / path) << std::endl;
+		if (!CheckPathHashes(entries)) {
 			return EXIT_FAILURE;
 		}
+	}
 
-		static std::vector<char> buffer;
-		buffer.resize(entry.file_size);
+	const std::string trace = program.get<std::string>("--trace");
+	if (!trace.empty() && !ApplyAccessTrace(trace, entries)) {
+		std::cerr << "Failed to read access trace: " << trace << std::endl;
+		return EXIT_FAILURE;
+	}
 
-		if (!ifs.read(buffer.data(), entry.file_size)) {
-			std::cerr << "Failed to read input file: " << (input / path) << std::endl;
-			return EXIT_FAILURE;
+	// An incremental build keeps the old dictionary, otherwise its dictionary blobs could not be reused
+	std::string dictionary;
+	if (previous && !previous->dictionary.empty()) {
+		dictionary = previous->dictionary;
+	}
+	else if (use_dict) {
+		TrainDictionary(entries, dictionary);
+	}
+
+	ZSTD_CDict* cdict = nullptr;
+	if (!dictionary.empty()) {
+		cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), COMPRESSION_LEVEL);
+	}
+
+	TPackFileHeader header;
+	TPackFileHeaderV2 header_v2;
+	TPackDictionaryInfo dict_info;
+	memset(&header, 0, sizeof(header));
+	memset(&header_v2, 0, sizeof(header_v2));
+	memset(&dict_info, 0, sizeof(dict_info));
+
+	uint64_t index_begin = 0;
+
+	if (legacy) {
+		header.entry_num = entries.size();
+		header.data_begin = sizeof(TPackFileHeader) + sizeof(TPackFileEntry) * entries.size();
+		randombytes_buf(header.nonce, sizeof(header.nonce));
+
+		ofs.write((const char*) &header, sizeof(header));
+		ofs.seekp(header.data_begin, std::ios::beg);
+	}
+	else {
+		index_begin = sizeof(TPackFileHeaderV2) + (cdict ? sizeof(TPackDictionaryInfo) : 0);
+
+		header_v2.magic = PACK_MAGIC_V2;
+		header_v2.version = cdict ? PACK_VERSION_3 : PACK_VERSION_2;
+		header_v2.entry_num = entries.size();
+		header_v2.name_pool_size = name_pool_size;
+		header_v2.data_begin = index_begin + sizeof(TPackIndexEntry) * entries.size() + name_pool_size;
+		randombytes_buf(header_v2.nonce, sizeof(header_v2.nonce));
+
+		if (cdict) {
+			dict_info.offset = header_v2.data_begin;
+			dict_info.size = dictionary.size();
+			header_v2.data_begin += dictionary.size();
 		}
 
-		size_t compress_bound = ZSTD_compressBound(entry.file_size);
-		static std::vector<char> compressed_buffer;
-		compressed_buffer.resize(compress_bound);
+		ofs.write((const char*) &header_v2, sizeof(header_v2));
 
-		entry.compressed_size = ZSTD_compress(compressed_buffer.data(), compress_bound, buffer.data(), entry.file_size, 17);
-		if(ZSTD_isError(entry.compressed_size)) {
-			std::cerr << "Failed to compress input file: " << (input / path) << " error: " << ZSTD_getErrorName(entry.compressed_size) << std::endl;
-			return EXIT_FAILURE;
+		if (cdict) {
+			ofs.write((const char*) &dict_info, sizeof(dict_info));
+			ofs.seekp(dict_info.offset, std::ios::beg);
+			ofs.write(dictionary.data(), dictionary.size());
 		}
 
-		entry.offset = offset;
+		ofs.seekp(header_v2.data_begin, std::ios::beg);
+	}
 
-		entry.encryption = 0;
-		if (path.has_extension() && path.extension() == ".py") {
-			entry.encryption = 1;
+	TCompressContext context;
+	context.legacy = legacy;
+	context.verify_reuse = program.get<bool>("--verify-reuse");
+	context.cdict = cdict;
+	context.previous = previous.get();
 
-			randombytes_buf(entry.nonce, sizeof(entry.nonce));
-			EncryptData((uint8_t*)compressed_buffer.data(), entry.compressed_size, entry.nonce);
-		}
+	const bool written = WriteEntries(ofs, entries, context, jobs);
 
-		ofs.write(compressed_buffer.data(), entry.compressed_size);
-		offset += entry.compressed_size;
+	if (cdict) {
+		ZSTD_freeCDict(cdict);
 	}
 
-	ofs.seekp(sizeof(TPackFileHeader), std::ios::beg);
+	if (!written) {
+		return EXIT_FAILURE;
+	}
 
-	for (auto& [path, entry] : entries) {
-		TPackFileEntry tmp = entry;
-		EncryptData((uint8_t*)&tmp, sizeof(TPackFileEntry), header.nonce);
-		ofs.write((const char*)&tmp, sizeof(TPackFileEntry));
+	if (legacy) {
+		WriteIndexV1(ofs, entries, header);
+	}
+	else {
+		WriteIndexV2(ofs, entries, header_v2, index_begin);
+	}
+
+	// A short write, a full disk for one, must not replace the good pack; the guard removes the temp file
+	ofs.flush();
+	if (!ofs.good()) {
+		std::cerr << "Failed to write " << temp_output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ofs.close();
+	if (ofs.fail()) {
+		std::cerr << "Failed to close " << temp_output << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const bool previous_loaded = previous != nullptr;
+	previous.reset();
+
+	std::error_code ec;
+	std::filesystem::rename(temp_output, output, ec);
+	if (ec) {
+		std::cerr << "Failed to replace " << output << ": " << ec.message() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	temp_guard.dismissed = true;
+
+	if (previous_loaded) {
+		size_t reused = std::count_if(entries.begin(), entries.end(), [](const TMakerEntry& entry) { return entry.reused; });
+		std::cout << "Reused " << reused << " of " << entries.size() << " files" << std::endl;
+	}
+
+	// v1 packs cannot be rebuilt incrementally, a stale file would only be ignored
+	if (!legacy && !WriteContentHashes(hashes_output, entries, header_v2)) {
+		std::cerr << "Failed to write " << hashes_output << ", the next incremental build will decode its files" << std::endl;
 	}
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "EffectLib/ParticleProperty.h"
+#include "EterBase/Random.h"
+#include "EterLib/GrpBase.h"
+
+// The update of CParticleInstance as it was before CParticleArray, kept as the baseline:
+// one object per particle, held in a list per texture frame, and every time event searched
+// for every particle each frame.
+class COldParticleInstance
+{
+	public:
+		BOOL Update(float fElapsedTime, float fAngle)
+		{
+			m_fLastLifeTime -= fElapsedTime;
+			if (m_fLastLifeTime < 0.0f)
+				return FALSE;
+
+			float fLifePercentage = (m_fLifeTime - m_fLastLifeTime) / m_fLifeTime;
+
+			UpdateRotation(fLifePercentage, fElapsedTime);
+			UpdateTextureAnimation(fLifePercentage, fElapsedTime);
+			UpdateScale(fLifePercentage, fElapsedTime);
+			UpdateColor(fLifePercentage, fElapsedTime);
+			UpdateGravity(fLifePercentage, fElapsedTime);
+			UpdateAirResistance(fLifePercentage, fElapsedTime);
+
+			m_v3LastPosition = m_v3Position;
+			m_v3Position += m_v3Velocity * fElapsedTime;
+
+			if (fAngle)
+			{
+				if (m_pParticleProperty->m_bAttachFlag)
+				{
+					float fCos, fSin;
+					fAngle = D3DXToRadian(fAngle);
+					fCos = cos(fAngle);
+					fSin = sin(fAngle);
+
+					float rx = m_v3Position.x - m_v3StartPosition.x;
+					float ry = m_v3Position.y - m_v3StartPosition.y;
+
+					m_v3Position.x =   fCos * rx + fSin * ry + m_v3StartPosition.x;
+					m_v3Position.y = - fSin * rx + fCos * ry + m_v3StartPosition.y;
+				}
+				else
+				{
+					D3DXQUATERNION q,qc;
+					D3DXQuaternionRotationAxis(&q,&m_pParticleProperty->m_v3ZAxis,D3DXToRadian(fAngle));
+					D3DXQuaternionConjugate(&qc,&q);
+
+					D3DXQUATERNION qr(
+						m_v3Position.x-m_v3StartPosition.x,
+						m_v3Position.y-m_v3StartPosition.y,
+						m_v3Position.z-m_v3StartPosition.z,
+						0.0f);
+					D3DXQuaternionMultiply(&qr,&q,&qr);
+					D3DXQuaternionMultiply(&qr,&qr,&qc);
+
+					m_v3Position.x = qr.x;
+					m_v3Position.y = qr.y;
+					m_v3Position.z = qr.z;
+
+					m_v3Position += m_v3StartPosition;
+				}
+			}
+
+			return TRUE;
+		}
+
+	protected:
+		void UpdateRotation(float time, float elapsedTime)
+		{
+			if (m_rotationType == CParticleProperty::ROTATION_TYPE_NONE)
+				return;
+
+			if (m_rotationType == CParticleProperty::ROTATION_TYPE_TIME_EVENT)
+				m_fRotationSpeed = GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventRotation);
+
+			m_fRotation += m_fRotationSpeed * elapsedTime;
+		}
+
+		void UpdateTextureAnimation(float time, float elapsedTime)
+		{
+			if (m_byTextureAnimationType == CParticleProperty::TEXTURE_ANIMATION_TYPE_NONE)
+				return;
+
+			const float frameDelay = m_pParticleProperty->GetTextureAnimationFrameDelay();
+			const DWORD frameCount = m_pParticleProperty->GetTextureAnimationFrameCount();
+
+			m_fFrameTime += elapsedTime;
+
+			const uint64_t elapsedFrames = static_cast<uint64_t>(m_fFrameTime / frameDelay);
+
+			if (0 == elapsedFrames)
+				return;
+
+			m_fFrameTime -= elapsedFrames * frameDelay;
+
+			switch (m_byTextureAnimationType)
+			{
+			case CParticleProperty::TEXTURE_ANIMATION_TYPE_CW:
+				m_byFrameIndex += elapsedFrames;
+				if (m_byFrameIndex >= frameCount)
+					m_byFrameIndex = 0;
+				break;
+
+			case CParticleProperty::TEXTURE_ANIMATION_TYPE_CCW:
+				m_byFrameIndex = std::min<uint8_t>(m_byFrameIndex - elapsedFrames, frameCount - 1);
+				break;
+
+			case CParticleProperty::TEXTURE_ANIMATION_TYPE_RANDOM_FRAME:
+				if (frameCount != 0)
+					m_byFrameIndex = random_range(0, frameCount - 1);
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		void UpdateScale(float time, float elapsedTime)
+		{
+			if (!m_pParticleProperty->m_TimeEventScaleX.empty())
+				m_v2Scale.x = GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventScaleX);
+
+			if (!m_pParticleProperty->m_TimeEventScaleY.empty())
+				m_v2Scale.y = GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventScaleY);
+		}
+
+		void UpdateColor(float time, float elapsedTime)
+		{
+			if (m_pParticleProperty->m_TimeEventColor.empty())
+				return;
+
+			m_Color = GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventColor);
+		}
+
+		void UpdateGravity(float time, float elapsedTime)
+		{
+			if (m_pParticleProperty->m_TimeEventGravity.empty())
+				return;
+
+			float fGravity;
+			fGravity = GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventGravity);
+
+			m_v3Velocity.z -= fGravity * elapsedTime;
+		}
+
+		void UpdateAirResistance(float time, float elapsedTime)
+		{
+			if (m_pParticleProperty->m_TimeEventAirResistance.empty())
+				return;
+
+			m_v3Velocity *= 1.0f - GetTimeEventBlendValue(time, m_pParticleProperty->m_TimeEventAirResistance);
+		}
+
+	public:
+		D3DXVECTOR3			m_v3StartPosition;
+
+		D3DXVECTOR3			m_v3Position;
+		D3DXVECTOR3			m_v3LastPosition;
+		D3DXVECTOR3			m_v3Velocity;
+
+		D3DXVECTOR2			m_v2HalfSize;
+		D3DXVECTOR2			m_v2Scale;
+
+		float				m_fRotation;
+		D3DXCOLOR			m_Color;
+
+		BYTE				m_byTextureAnimationType;
+		float				m_fLastFrameTime;
+		BYTE				m_byFrameIndex;
+		float				m_fFrameTime;
+
+		float				m_fLifeTime;
+		float				m_fLastLifeTime;
+
+		CParticleProperty *	m_pParticleProperty;
+		void *				m_pEmitterProperty;
+
+		BYTE				m_rotationType;
+
+		float				m_fAirResistance;
+		float				m_fRotationSpeed;
+		float				m_fGravity;
+
+		// Not updated here, but every particle carried it
+		TPTVertex			m_ParticleMesh[4];
+};
@@ -0,0 +1,381 @@
+#include "EffectLib/StdAfx.h"
+#include "EffectLib/ParticleArray.h"
+#include "EffectLib/ParticleProperty.h"
+
+#include "OldParticleInstance.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Runs particle systems built from six synthetic particle properties (gravity, air
+// resistance, scale and colour curves, texture animation, attached and free emitter
+// rotation) through CParticleArray and through the per particle update it replaced, with
+// the same particles emitted into both. Reports ms per frame and ns per particle.
+// Exits with EXIT_FAILURE if a system ends up with a different particle count or texture
+// frames, or if positions, colours or scales differ by more than the sampled time event
+// curves allow.
+
+using TClock = std::chrono::steady_clock;
+using TParticleList = std::list<COldParticleInstance*>;
+
+static const int CONFIG_COUNT = 6;
+static const int TEXTURE_FRAME_COUNT = 8;
+
+// The curves are sampled 64 times over a particle's life, so a steep key shows up as a
+// small lag, and the velocity error it leaves adds up in the position
+static const float POSITION_TOLERANCE = 0.1f;
+static const float CURVE_TOLERANCE = 0.05f;
+
+struct TConfig
+{
+	CParticleProperty property;
+	float emission;			// particles per second
+	UINT max_count;
+	float life;
+	float angle;			// emitter angular velocity
+};
+
+struct TOldSystem
+{
+	// One list per texture frame and one for particles moving to a frame this update, as
+	// CParticleSystemInstance kept them
+	std::vector<TParticleList> lists;
+	UINT count;
+	float residue;
+};
+
+struct TNewSystem
+{
+	CParticleArray particles;
+	float residue;
+};
+
+// Stands in for the CDynamicPool the old particles came from
+struct TOldParticlePool
+{
+	std::deque<COldParticleInstance> storage;
+	std::vector<COldParticleInstance*> free;
+
+	COldParticleInstance* Alloc()
+	{
+		if (free.empty()) {
+			storage.emplace_back();
+			return &storage.back();
+		}
+
+		COldParticleInstance* particle = free.back();
+		free.pop_back();
+		return particle;
+	}
+};
+
+struct TComparison
+{
+	size_t count_mismatches = 0;
+	size_t frame_mismatches = 0;
+	float max_position = 0.0f;
+	float max_color = 0.0f;
+	float max_scale = 0.0f;
+};
+
+template<typename T>
+static void AddKey(std::vector<CTimeEvent<T>>& events, float time, const T& value)
+{
+	CTimeEvent<T> event;
+	event.m_fTime = time;
+	event.m_Value = value;
+	events.push_back(event);
+}
+
+static void MakeConfigs(std::vector<TConfig>& configs)
+{
+	configs.resize(CONFIG_COUNT);
+
+	for (int i = 0; i < CONFIG_COUNT; ++i) {
+		TConfig& config = configs[i];
+		CParticleProperty& property = config.property;
+
+		property.Clear();
+		property.m_bAttachFlag = i == 4;
+		property.m_v3ZAxis = D3DXVECTOR3(0.2f, 0.1f, 1.0f);
+
+		if (i % 2 == 0)
+			AddKey(property.m_TimeEventGravity, 0.0f, 300.0f + i * 50.0f);
+
+		if (i % 3 != 2) {
+			AddKey(property.m_TimeEventAirResistance, 0.0f, 0.02f);
+			AddKey(property.m_TimeEventAirResistance, 0.6f, 0.08f);
+		}
+
+		AddKey(property.m_TimeEventScaleX, 0.0f, 0.5f);
+		AddKey(property.m_TimeEventScaleX, 0.3f, 1.4f);
+		AddKey(property.m_TimeEventScaleX, 1.0f, 2.0f);
+		AddKey(property.m_TimeEventScaleY, 0.0f, 0.5f);
+		AddKey(property.m_TimeEventScaleY, 0.5f, 1.0f);
+
+		// Fades in over the first 10% of the life, the steepest key of the set
+		AddKey(property.m_TimeEventColor, 0.0f, D3DXCOLOR(1.0f, 0.8f, 0.4f, 0.0f));
+		AddKey(property.m_TimeEventColor, 0.1f, D3DXCOLOR(1.0f, 0.7f, 0.3f, 1.0f));
+		AddKey(property.m_TimeEventColor, 0.7f, D3DXCOLOR(0.8f, 0.3f, 0.1f, 0.8f));
+		AddKey(property.m_TimeEventColor, 1.0f, D3DXCOLOR(0.2f, 0.1f, 0.0f, 0.0f));
+
+		property.m_byTexAniType = i < 3 ? CParticleProperty::TEXTURE_ANIMATION_TYPE_CW : CParticleProperty::TEXTURE_ANIMATION_TYPE_NONE;
+		property.m_ImageVector.resize(TEXTURE_FRAME_COUNT);
+		property.BuildTimeEventSample();
+
+		config.emission = 150.0f + 40.0f * i;
+		config.max_count = 150 + 30 * i;
+		config.life = 0.8f + 0.3f * i;
+		config.angle = (i == 3 || i == 4) ? 90.0f : 0.0f;
+	}
+}
+
+// CParticleSystemInstance::OnUpdate before CParticleArray
+static void UpdateOld(TOldSystem& system, TOldParticlePool& pool, float elapsed_time, float angle)
+{
+	for (int frame = 0; frame < TEXTURE_FRAME_COUNT; ++frame) {
+		TParticleList& list = system.lists[frame];
+
+		for (auto it = list.begin(); it != list.end();) {
+			COldParticleInstance* particle = *it;
+
+			if (!particle->Update(elapsed_time, angle)) {
+				pool.free.push_back(particle);
+				it = list.erase(it);
+				--system.count;
+			}
+			else if (particle->m_byFrameIndex != frame) {
+				system.lists[TEXTURE_FRAME_COUNT + particle->m_byFrameIndex].push_back(particle);
+				it = list.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	for (int frame = 0; frame < TEXTURE_FRAME_COUNT; ++frame)
+		system.lists[frame].splice(system.lists[frame].end(), system.lists[TEXTURE_FRAME_COUNT + frame]);
+}
+
+static void Emit(const TConfig& config, TOldSystem& old_system, TOldParticlePool& pool, TNewSystem& new_system, float elapsed_time, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> spread(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> height(0.0f, 20.0f);
+	std::uniform_real_distribution<float> side_speed(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> up_speed(100.0f, 400.0f);
+
+	const float emission = config.emission * elapsed_time + new_system.residue;
+	int create = static_cast<int>(emission);
+	new_system.residue = emission - create;
+	create = std::min<int>(create, static_cast<int>(config.max_count) - static_cast<int>(new_system.particles.GetCount()));
+
+	const CParticleProperty& property = config.property;
+	const D3DXCOLOR color = property.m_TimeEventColor.front().m_Value;
+
+	for (int i = 0; i < create; ++i) {
+		const D3DXVECTOR3 position(spread(random), spread(random), height(random));
+		const D3DXVECTOR3 velocity(side_speed(random), side_speed(random), up_speed(random));
+
+		COldParticleInstance* particle = pool.Alloc();
+		particle->m_pParticleProperty = const_cast<CParticleProperty*>(&property);
+		particle->m_pEmitterProperty = NULL;
+		particle->m_fLifeTime = config.life;
+		particle->m_fLastLifeTime = config.life;
+		particle->m_v3StartPosition = D3DXVECTOR3(0.0f, 0.0f, 0.0f);
+		particle->m_v3Position = position;
+		particle->m_v3LastPosition = position;
+		particle->m_v3Velocity = velocity;
+		particle->m_v2HalfSize = D3DXVECTOR2(10.0f, 10.0f);
+		particle->m_v2Scale = D3DXVECTOR2(0.5f, 0.5f);
+		particle->m_fRotation = 0.0f;
+		particle->m_Color = color;
+		particle->m_byTextureAnimationType = property.m_byTexAniType;
+		particle->m_byFrameIndex = 0;
+		particle->m_fFrameTime = 0.0f;
+		particle->m_rotationType = CParticleProperty::ROTATION_TYPE_NONE;
+		old_system.lists[0].push_back(particle);
+		++old_system.count;
+
+		// The fields CParticleSystemInstance::CreateParticles sets
+		CParticleArray& particles = new_system.particles;
+		const UINT index = particles.Add();
+		const float values[][2] = {
+			{ CParticleArray::FIELD_POSITION_X, position.x },
+			{ CParticleArray::FIELD_POSITION_Y, position.y },
+			{ CParticleArray::FIELD_POSITION_Z, position.z },
+			{ CParticleArray::FIELD_LAST_POSITION_X, position.x },
+			{ CParticleArray::FIELD_LAST_POSITION_Y, position.y },
+			{ CParticleArray::FIELD_LAST_POSITION_Z, position.z },
+			{ CParticleArray::FIELD_START_POSITION_X, 0.0f },
+			{ CParticleArray::FIELD_START_POSITION_Y, 0.0f },
+			{ CParticleArray::FIELD_START_POSITION_Z, 0.0f },
+			{ CParticleArray::FIELD_VELOCITY_X, velocity.x },
+			{ CParticleArray::FIELD_VELOCITY_Y, velocity.y },
+			{ CParticleArray::FIELD_VELOCITY_Z, velocity.z },
+			{ CParticleArray::FIELD_HALF_SIZE_X, 10.0f },
+			{ CParticleArray::FIELD_HALF_SIZE_Y, 10.0f },
+			{ CParticleArray::FIELD_SCALE_X, 0.5f },
+			{ CParticleArray::FIELD_SCALE_Y, 0.5f },
+			{ CParticleArray::FIELD_ROTATION, 0.0f },
+			{ CParticleArray::FIELD_COLOR_R, color.r },
+			{ CParticleArray::FIELD_COLOR_G, color.g },
+			{ CParticleArray::FIELD_COLOR_B, color.b },
+			{ CParticleArray::FIELD_COLOR_A, color.a },
+			{ CParticleArray::FIELD_LIFE_TIME, config.life },
+			{ CParticleArray::FIELD_LAST_LIFE_TIME, config.life },
+			{ CParticleArray::FIELD_FRAME_TIME, 0.0f },
+			{ CParticleArray::FIELD_LIFE_PERCENTAGE, 0.0f },
+			{ CParticleArray::FIELD_TEMP, 0.0f },
+		};
+
+		for (const auto& value : values)
+			particles.GetField(CParticleArray::EField(static_cast<int>(value[0])))[index] = value[1];
+
+		particles.GetFrameIndex()[index] = 0;
+		particles.GetTextureAnimationType()[index] = property.m_byTexAniType;
+	}
+}
+
+// Both hold the same particles in a different order, so each side is sorted by life left
+// and then by position before the particles are paired up
+static void Compare(const TOldSystem& old_system, const TNewSystem& new_system, TComparison& comparison)
+{
+	typedef std::array<float, 5> TKey;	// life left, z, alpha, x scale, texture frame
+	std::vector<TKey> old_keys, new_keys;
+
+	for (int frame = 0; frame < TEXTURE_FRAME_COUNT; ++frame) {
+		for (const COldParticleInstance* particle : old_system.lists[frame]) {
+			old_keys.push_back({ particle->m_fLastLifeTime, particle->m_v3Position.z, particle->m_Color.a, particle->m_v2Scale.x,
+				static_cast<float>(particle->m_byFrameIndex) });
+		}
+	}
+
+	const CParticleArray& particles = new_system.particles;
+	for (UINT i = 0; i < particles.GetCount(); ++i) {
+		new_keys.push_back({ particles.GetField(CParticleArray::FIELD_LAST_LIFE_TIME)[i], particles.GetField(CParticleArray::FIELD_POSITION_Z)[i],
+			particles.GetField(CParticleArray::FIELD_COLOR_A)[i], particles.GetField(CParticleArray::FIELD_SCALE_X)[i],
+			static_cast<float>(particles.GetFrameIndex()[i]) });
+	}
+
+	if (old_keys.size() != new_keys.size()) {
+		++comparison.count_mismatches;
+		return;
+	}
+
+	std::sort(old_keys.begin(), old_keys.end());
+	std::sort(new_keys.begin(), new_keys.end());
+
+	for (size_t i = 0; i < old_keys.size(); ++i) {
+		comparison.max_position = std::max(comparison.max_position, fabsf(old_keys[i][1] - new_keys[i][1]));
+		comparison.max_color = std::max(comparison.max_color, fabsf(old_keys[i][2] - new_keys[i][2]));
+		comparison.max_scale = std::max(comparison.max_scale, fabsf(old_keys[i][3] - new_keys[i][3]));
+		comparison.frame_mismatches += old_keys[i][4] != new_keys[i][4];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("ParticleBench");
+
+	program.add_argument("--systems")
+		.default_value(240)
+		.scan<'i', int>()
+		.help("Particle systems, the six configs in turn");
+
+	program.add_argument("--frames")
+		.default_value(600)
+		.scan<'i', int>()
+		.help("Frames to run");
+
+	program.add_argument("--fps")
+		.default_value(60)
+		.scan<'i', int>()
+		.help("Frames per second of the simulation");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	const int system_count = std::max(1, program.get<int>("--systems"));
+	const int frame_count = std::max(1, program.get<int>("--frames"));
+	const float elapsed_time = 1.0f / std::max(1, program.get<int>("--fps"));
+
+	std::vector<TConfig> configs;
+	MakeConfigs(configs);
+
+	TOldParticlePool pool;
+	std::vector<TOldSystem> old_systems(system_count);
+	std::vector<TNewSystem> new_systems(system_count);
+
+	for (TOldSystem& system : old_systems) {
+		system.lists.resize(TEXTURE_FRAME_COUNT * 2);
+		system.count = 0;
+		system.residue = 0.0f;
+	}
+
+	for (TNewSystem& system : new_systems)
+		system.residue = 0.0f;
+
+	std::mt19937 random(7);
+	double old_ms = 0.0, new_ms = 0.0;
+	size_t particle_frames = 0;
+
+	for (int frame = 0; frame < frame_count; ++frame) {
+		for (int i = 0; i < system_count; ++i) {
+			TConfig& config = configs[i % CONFIG_COUNT];
+
+			auto begin = TClock::now();
+			UpdateOld(old_systems[i], pool, elapsed_time, config.angle);
+			old_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+			CParticleArray& particles = new_systems[i].particles;
+			begin = TClock::now();
+			particles.UpdateLife(elapsed_time);
+			particles.Update(config.property, elapsed_time, config.angle, config.property.m_v3ZAxis);
+			new_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+			particle_frames += particles.GetCount();
+
+			Emit(config, old_systems[i], pool, new_systems[i], elapsed_time, random);
+		}
+	}
+
+	TComparison comparison;
+	for (int i = 0; i < system_count; ++i)
+		Compare(old_systems[i], new_systems[i], comparison);
+
+	const double particles_per_frame = double(particle_frames) / frame_count;
+	printf("%d systems, %d frames, %.0f live particles per frame\n", system_count, frame_count, particles_per_frame);
+	printf("old update %8.2f ms/frame %8.1f ns/particle\n", old_ms / frame_count, old_ms * 1e6 / std::max<size_t>(1, particle_frames));
+	printf("new update %8.2f ms/frame %8.1f ns/particle\n", new_ms / frame_count, new_ms * 1e6 / std::max<size_t>(1, particle_frames));
+	printf("max |dz| %.4f, max |d alpha| %.4f, max |d scale| %.4f\n", comparison.max_position, comparison.max_color, comparison.max_scale);
+
+	if (comparison.count_mismatches || comparison.frame_mismatches) {
+		std::cerr << comparison.count_mismatches << " systems with a different particle count, "
+			<< comparison.frame_mismatches << " particles on a different texture frame" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (comparison.max_position > POSITION_TOLERANCE || comparison.max_color > CURVE_TOLERANCE || comparison.max_scale > CURVE_TOLERANCE) {
+		std::cerr << "The update differs from the old one by more than the tolerance" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
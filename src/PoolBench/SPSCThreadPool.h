@@ -0,0 +1,186 @@
+#pragma once
+
+#include "EterLib/SPSCQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// CGameThreadPool as it was before the work-stealing scheduler, kept as the baseline:
+// one SPSCQueue per worker behind a mutex, the least busy worker takes the task, idle
+// workers yield, then sleep 10 us, then 1 ms. Every task carries its own promise, and a
+// full queue runs the task on the caller.
+class CSPSCThreadPool
+{
+public:
+	using TTask = std::function<void()>;
+
+	CSPSCThreadPool() : m_bShutdown(false) {}
+	~CSPSCThreadPool() { Destroy(); }
+
+	void Initialize(int iWorkerCount)
+	{
+		iWorkerCount = std::max(2, std::min(16, iWorkerCount));
+
+		m_bShutdown.store(false, std::memory_order_release);
+		for (int i = 0; i < iWorkerCount; ++i)
+		{
+			auto pWorker = std::make_unique<TWorkerThread>();
+			pWorker->pTaskQueue = std::make_unique<SPSCQueue<TTask>>(QUEUE_SIZE);
+			m_workers.push_back(std::move(pWorker));
+		}
+
+		for (auto& pWorker : m_workers)
+			pWorker->thread = std::thread(&CSPSCThreadPool::WorkerThreadProc, this, pWorker.get());
+	}
+
+	void Destroy()
+	{
+		m_bShutdown.store(true, std::memory_order_release);
+
+		for (auto& pWorker : m_workers)
+		{
+			if (pWorker->thread.joinable())
+				pWorker->thread.join();
+		}
+
+		m_workers.clear();
+	}
+
+	int GetWorkerCount() const { return static_cast<int>(m_workers.size()); }
+
+	template<typename TFunc>
+	std::future<void> Enqueue(TFunc&& func)
+	{
+		std::unique_lock<std::mutex> lock(m_lifecycleMutex);
+
+		auto promise = std::make_shared<std::promise<void>>();
+		auto future = promise->get_future();
+		auto pFunc = std::make_shared<typename std::decay<TFunc>::type>(std::forward<TFunc>(func));
+
+		TTask task = [promise, pFunc]()
+		{
+			try
+			{
+				(*pFunc)();
+				promise->set_value();
+			}
+			catch (...)
+			{
+				promise->set_exception(std::current_exception());
+			}
+		};
+
+		TWorkerThread* pWorker = m_workers[SelectLeastBusyWorker()].get();
+		pWorker->uTaskCount.fetch_add(1, std::memory_order_relaxed);
+
+		bool bPushed = false;
+		{
+			std::lock_guard<std::mutex> queueLock(pWorker->queueMutex);
+			bPushed = pWorker->pTaskQueue->Push(std::move(task));
+		}
+
+		if (!bPushed)
+		{
+			pWorker->uTaskCount.fetch_sub(1, std::memory_order_relaxed);
+			lock.unlock();
+
+			try
+			{
+				(*pFunc)();
+				promise->set_value();
+			}
+			catch (...)
+			{
+				promise->set_exception(std::current_exception());
+			}
+		}
+
+		return future;
+	}
+
+private:
+	struct TWorkerThread
+	{
+		std::thread thread;
+		std::unique_ptr<SPSCQueue<TTask>> pTaskQueue;
+		std::mutex queueMutex;
+		std::atomic<uint32_t> uTaskCount;
+
+		TWorkerThread() : uTaskCount(0) {}
+	};
+
+	void WorkerThreadProc(TWorkerThread* pWorker)
+	{
+		int iIdleCount = 0;
+
+		for (;;)
+		{
+			TTask task;
+			bool bHasTask = false;
+			{
+				std::lock_guard<std::mutex> lock(pWorker->queueMutex);
+				bHasTask = pWorker->pTaskQueue->Pop(task);
+			}
+
+			if (bHasTask)
+			{
+				iIdleCount = 0;
+				task();
+				pWorker->uTaskCount.fetch_sub(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			// Queued tasks still run on shutdown
+			if (m_bShutdown.load(std::memory_order_acquire))
+				return;
+
+			++iIdleCount;
+
+			if (iIdleCount < 100)
+			{
+				std::this_thread::yield();
+			}
+			else if (iIdleCount < 1000)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(10));
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				if (iIdleCount > 10000)
+					iIdleCount = 1000;
+			}
+		}
+	}
+
+	int SelectLeastBusyWorker() const
+	{
+		int iBestWorker = 0;
+		uint32_t uMinTasks = m_workers[0]->uTaskCount.load(std::memory_order_relaxed);
+
+		for (size_t i = 1; i < m_workers.size(); ++i)
+		{
+			const uint32_t uTasks = m_workers[i]->uTaskCount.load(std::memory_order_relaxed);
+			if (uTasks < uMinTasks)
+			{
+				uMinTasks = uTasks;
+				iBestWorker = static_cast<int>(i);
+			}
+		}
+
+		return iBestWorker;
+	}
+
+	std::vector<std::unique_ptr<TWorkerThread>> m_workers;
+	std::atomic<bool> m_bShutdown;
+	std::mutex m_lifecycleMutex;
+
+	static const size_t QUEUE_SIZE = 8192;
+};
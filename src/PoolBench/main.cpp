@@ -0,0 +1,357 @@
+#include "EterLib/StdAfx.h"
+#include "EterLib/GameThreadPool.h"
+
+#include "SPSCThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Runs the same task mix through the SPSC pool CGameThreadPool replaced and through
+// CGameThreadPool, with the same worker count:
+//  - tasks: many small tasks submitted from the main thread, then waited for
+//  - fan-out: tasks that submit more tasks from the workers
+//  - wakeup: time from submitting one task to it starting, after the pool sat idle
+//  - priority: how long a HIGH task waits while LOW tasks are queued on every worker
+// Exits with EXIT_FAILURE if a task does not run exactly once or a HIGH task waits for LOW work.
+
+using TClock = std::chrono::steady_clock;
+
+struct TBenchOptions
+{
+	int workers;
+	int tasks;
+	int work;
+	int parents;
+	int children;
+	int wakeups;
+	int idle_ms;
+	int repeat;
+};
+
+static std::atomic<double> s_sink;
+
+// About work * 2 ns of arithmetic the compiler cannot drop
+static void DoWork(int work)
+{
+	double x = 0.0;
+	for (int i = 0; i < work; ++i)
+		x += std::sqrt(static_cast<double>(i));
+
+	s_sink.store(x, std::memory_order_relaxed);
+}
+
+static double ElapsedMs(TClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(TClock::now() - start).count();
+}
+
+static double Percentile(std::vector<double> samples, double p)
+{
+	std::sort(samples.begin(), samples.end());
+	const size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+	return samples[index];
+}
+
+static bool CheckCount(const char* label, const std::atomic<int>& done, int expected)
+{
+	if (done.load() == expected)
+		return true;
+
+	std::cerr << label << ": " << done.load() << " of " << expected << " tasks ran" << std::endl;
+	return false;
+}
+
+static bool RunTasks(CSPSCThreadPool& pool, const TBenchOptions& options, double& best_ms)
+{
+	std::vector<std::future<void>> futures;
+	futures.reserve(options.tasks);
+
+	for (int pass = 0; pass < options.repeat; ++pass) {
+		std::atomic<int> done(0);
+		futures.clear();
+
+		const auto start = TClock::now();
+		for (int i = 0; i < options.tasks; ++i)
+			futures.push_back(pool.Enqueue([&done, work = options.work]() { DoWork(work); done.fetch_add(1, std::memory_order_relaxed); }));
+
+		for (auto& future : futures)
+			future.wait();
+
+		best_ms = std::min(best_ms, ElapsedMs(start));
+
+		if (!CheckCount("SPSC tasks", done, options.tasks))
+			return false;
+	}
+
+	return true;
+}
+
+static bool RunTasks(CGameThreadPool& pool, const TBenchOptions& options, bool use_futures, double& best_ms)
+{
+	std::vector<std::future<void>> futures;
+	if (use_futures)
+		futures.reserve(options.tasks);
+
+	for (int pass = 0; pass < options.repeat; ++pass) {
+		std::atomic<int> done(0);
+		futures.clear();
+
+		const auto start = TClock::now();
+		if (use_futures) {
+			for (int i = 0; i < options.tasks; ++i)
+				futures.push_back(pool.Enqueue([&done, work = options.work]() { DoWork(work); done.fetch_add(1, std::memory_order_relaxed); }));
+
+			for (auto& future : futures)
+				future.wait();
+		}
+		else {
+			CGameTaskGroup group;
+			for (int i = 0; i < options.tasks; ++i)
+				pool.Submit([&done, work = options.work]() { DoWork(work); done.fetch_add(1, std::memory_order_relaxed); }, CGameThreadPool::PRIORITY_NORMAL, &group);
+
+			pool.WaitAll(group);
+		}
+
+		best_ms = std::min(best_ms, ElapsedMs(start));
+
+		if (!CheckCount(use_futures ? "Work-stealing tasks (futures)" : "Work-stealing tasks", done, options.tasks))
+			return false;
+	}
+
+	return true;
+}
+
+// The SPSC pool has no way to wait for tasks without their futures, so the main thread
+// yields until the children are counted
+static bool RunFanOut(CSPSCThreadPool& pool, const TBenchOptions& options, double& best_ms)
+{
+	const int expected = options.parents * options.children;
+
+	for (int pass = 0; pass < options.repeat; ++pass) {
+		std::atomic<int> done(0);
+
+		const auto start = TClock::now();
+		for (int i = 0; i < options.parents; ++i) {
+			pool.Enqueue([&pool, &done, &options]() {
+				for (int j = 0; j < options.children; ++j)
+					pool.Enqueue([&done, work = options.work]() { DoWork(work); done.fetch_add(1, std::memory_order_relaxed); });
+			});
+		}
+
+		while (done.load(std::memory_order_acquire) < expected)
+			std::this_thread::yield();
+
+		best_ms = std::min(best_ms, ElapsedMs(start));
+
+		if (!CheckCount("SPSC fan-out", done, expected))
+			return false;
+	}
+
+	return true;
+}
+
+static bool RunFanOut(CGameThreadPool& pool, const TBenchOptions& options, double& best_ms)
+{
+	const int expected = options.parents * options.children;
+
+	for (int pass = 0; pass < options.repeat; ++pass) {
+		std::atomic<int> done(0);
+		CGameTaskGroup group;
+
+		const auto start = TClock::now();
+		for (int i = 0; i < options.parents; ++i) {
+			pool.Submit([&pool, &done, &group, &options]() {
+				for (int j = 0; j < options.children; ++j)
+					pool.Submit([&done, work = options.work]() { DoWork(work); done.fetch_add(1, std::memory_order_relaxed); }, CGameThreadPool::PRIORITY_NORMAL, &group);
+			}, CGameThreadPool::PRIORITY_NORMAL, &group);
+		}
+
+		pool.WaitAll(group);
+		best_ms = std::min(best_ms, ElapsedMs(start));
+
+		if (!CheckCount("Work-stealing fan-out", done, expected))
+			return false;
+	}
+
+	return true;
+}
+
+// Microseconds from Enqueue to the task starting, one task after every idle period. A random
+// spin after the sleep keeps the submits from lining up with the timer ticks of sleeping workers.
+template<typename TPool>
+static std::vector<double> MeasureWakeups(TPool& pool, const TBenchOptions& options)
+{
+	std::vector<double> samples;
+	samples.reserve(options.wakeups);
+
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int> phase_us(0, 2000);
+
+	for (int i = 0; i < options.wakeups; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.idle_ms));
+
+		const auto phase_end = TClock::now() + std::chrono::microseconds(phase_us(random));
+		while (TClock::now() < phase_end)
+			;
+
+		TClock::time_point started;
+		const auto submitted = TClock::now();
+		pool.Enqueue([&started]() { started = TClock::now(); }).wait();
+
+		samples.push_back(std::chrono::duration<double, std::micro>(started - submitted).count());
+	}
+
+	return samples;
+}
+
+static void PrintRate(const char* label, int tasks, double ms)
+{
+	printf("%-34s %9.2f ms %9.0f ns/task\n", label, ms, ms * 1e6 / tasks);
+}
+
+static void PrintWakeups(const char* label, const std::vector<double>& samples)
+{
+	printf("%-34s median %8.1f us   p99 %8.1f us   max %8.1f us\n", label,
+		Percentile(samples, 0.5), Percentile(samples, 0.99), Percentile(samples, 1.0));
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("PoolBench");
+
+	program.add_argument("--workers")
+		.default_value(0)
+		.scan<'i', int>()
+		.help("Worker threads of both pools, 0 for one per hardware thread");
+
+	program.add_argument("--tasks")
+		.default_value(200000)
+		.scan<'i', int>()
+		.help("Tasks per pass");
+
+	program.add_argument("--work")
+		.default_value(50)
+		.scan<'i', int>()
+		.help("Loop iterations per task");
+
+	program.add_argument("--parents")
+		.default_value(1000)
+		.scan<'i', int>()
+		.help("Fan-out tasks submitted from the main thread");
+
+	program.add_argument("--children")
+		.default_value(100)
+		.scan<'i', int>()
+		.help("Tasks each fan-out task submits");
+
+	program.add_argument("--wakeups")
+		.default_value(200)
+		.scan<'i', int>()
+		.help("Wakeup samples per pool");
+
+	program.add_argument("--idle-ms")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Idle time before every wakeup sample");
+
+	program.add_argument("--repeat")
+		.default_value(3)
+		.scan<'i', int>()
+		.help("Passes per scenario, the best one is reported");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.workers = program.get<int>("--workers");
+	options.tasks = std::max(1, program.get<int>("--tasks"));
+	options.work = std::max(0, program.get<int>("--work"));
+	options.parents = std::max(1, program.get<int>("--parents"));
+	options.children = std::max(1, program.get<int>("--children"));
+	options.wakeups = std::max(1, program.get<int>("--wakeups"));
+	options.idle_ms = std::max(0, program.get<int>("--idle-ms"));
+	options.repeat = std::max(1, program.get<int>("--repeat"));
+
+	if (options.workers <= 0)
+		options.workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	const int fan_out_tasks = options.parents * options.children;
+	bool success = true;
+
+	double spsc_tasks_ms = 1e30, spsc_fan_out_ms = 1e30;
+	std::vector<double> spsc_wakeups;
+	int workers;
+	{
+		CSPSCThreadPool pool;
+		pool.Initialize(options.workers);
+		workers = pool.GetWorkerCount();
+
+		success = success && RunTasks(pool, options, spsc_tasks_ms);
+		success = success && RunFanOut(pool, options, spsc_fan_out_ms);
+		spsc_wakeups = MeasureWakeups(pool, options);
+	}
+
+	double steal_tasks_ms = 1e30, steal_futures_ms = 1e30, steal_fan_out_ms = 1e30, high_ms = 0.0;
+	std::vector<double> steal_wakeups;
+	{
+		CGameThreadPool pool;
+		pool.Initialize(options.workers);
+
+		success = success && RunTasks(pool, options, false, steal_tasks_ms);
+		success = success && RunTasks(pool, options, true, steal_futures_ms);
+		success = success && RunFanOut(pool, options, steal_fan_out_ms);
+		steal_wakeups = MeasureWakeups(pool, options);
+
+		// LOW tasks for every worker and more, a HIGH task still finds the one LOW never takes
+		const int low_ms = 20;
+		std::atomic<int> low_done(0);
+		CGameTaskGroup low_group;
+		for (int i = 0; i < workers * 4; ++i)
+			pool.Submit([&low_done, low_ms]() { std::this_thread::sleep_for(std::chrono::milliseconds(low_ms)); low_done.fetch_add(1); }, CGameThreadPool::PRIORITY_LOW, &low_group);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+		CGameTaskGroup high_group;
+		const auto start = TClock::now();
+		pool.Submit([]() {}, CGameThreadPool::PRIORITY_HIGH, &high_group);
+		pool.WaitAll(high_group);
+		high_ms = ElapsedMs(start);
+
+		pool.WaitAll(low_group);
+		success = success && CheckCount("LOW tasks", low_done, workers * 4);
+
+		if (high_ms >= low_ms) {
+			std::cerr << "A HIGH task waited " << high_ms << " ms behind LOW tasks" << std::endl;
+			success = false;
+		}
+	}
+
+	printf("%d workers, %d tasks of %d iterations, fan-out %d x %d, best of %d\n", workers, options.tasks, options.work,
+		options.parents, options.children, options.repeat);
+	PrintRate("tasks     SPSC (futures)", options.tasks, spsc_tasks_ms);
+	PrintRate("tasks     work-stealing (futures)", options.tasks, steal_futures_ms);
+	PrintRate("tasks     work-stealing (group)", options.tasks, steal_tasks_ms);
+	PrintRate("fan-out   SPSC", fan_out_tasks, spsc_fan_out_ms);
+	PrintRate("fan-out   work-stealing", fan_out_tasks, steal_fan_out_ms);
+	PrintWakeups("wakeup    SPSC", spsc_wakeups);
+	PrintWakeups("wakeup    work-stealing", steal_wakeups);
+	printf("%-34s %9.3f ms\n", "HIGH behind LOW work-stealing", high_ms);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
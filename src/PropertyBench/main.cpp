@@ -0,0 +1,214 @@
+#include "GameLib/StdAfx.h"
+#include "GameLib/Property.h"
+#include "GameLib/PropertyManager.h"
+#include "EterLib/GameThreadPool.h"
+#include "PackLib/PackManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Writes synthetic building properties to a scratch folder and registers them the way
+// CPropertyManager::Initialize does for the entries of property.pck: once serially, as
+// without a thread pool, and once per worker count on CGameThreadPool. Files are read
+// in file load mode. Reports the median time per registration.
+// Exits with EXIT_FAILURE if a CRC resolves to a different file than with the serial
+// registration.
+
+using TClock = std::chrono::steady_clock;
+using TRegistered = std::vector<std::pair<DWORD, std::string>>;
+
+struct TBenchOptions
+{
+	int files;
+	int duplicate_every;
+	int runs;
+};
+
+// Gives the bench the entry names Initialize would collect from the pack
+class CBenchPropertyManager : public CPropertyManager
+{
+	public:
+		void RegisterAll(const std::vector<std::string>& c_rkVct_stFileName) { __RegisterParallel(c_rkVct_stFileName); }
+
+		TRegistered GetRegistered() const
+		{
+			TRegistered registered;
+			for (const TPropertyCRCMap::value_type& c_rkProperty : m_PropertyByCRCMap)
+				registered.emplace_back(c_rkProperty.first, c_rkProperty.second->GetFileName());
+
+			return registered;
+		}
+};
+
+static double Median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+// Some files share the CRC of the one before them, the later file has to win
+static bool WriteProperties(const std::filesystem::path& folder, const TBenchOptions& options, std::vector<std::string>& file_names)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(folder / "property" / "bench", ec);
+
+	std::mt19937 random(17);
+	DWORD crc = 0;
+
+	for (int i = 0; i < options.files; ++i) {
+		if (options.duplicate_every <= 0 || i % options.duplicate_every != 1)
+			crc = random() & 0x7fffffff;
+
+		char file_name[64];
+		snprintf(file_name, sizeof(file_name), "property/bench/bench_%05d.prb", i);
+
+		std::ofstream file(folder / file_name, std::ios::binary);
+		file << "YPRT\r\n"
+			<< crc << "\r\n"
+			<< "propertytype\t\"Building\"\r\n"
+			<< "propertyname\t\"bench_" << i << "\"\r\n"
+			<< "buildingfile\t\"d:/ymir work/bench/bench_" << i << ".gr2\"\r\n"
+			<< "shadowflag\t\"" << (i % 2) << "\"\r\n";
+
+		if (!file) {
+			std::cerr << "Cannot write " << file_name << std::endl;
+			return false;
+		}
+
+		file_names.push_back(file_name);
+	}
+
+	return true;
+}
+
+static double Register(const std::vector<std::string>& file_names, TRegistered& registered)
+{
+	CBenchPropertyManager property_manager;
+
+	const auto begin = TClock::now();
+	property_manager.RegisterAll(file_names);
+	const double ms = std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+	registered = property_manager.GetRegistered();
+	return ms;
+}
+
+static bool Run(const std::vector<std::string>& file_names, const std::vector<int>& worker_counts, const TBenchOptions& options)
+{
+	// Once to fill the file cache
+	TRegistered serial;
+	Register(file_names, serial);
+
+	std::vector<double> serial_ms;
+	for (int run = 0; run < options.runs; ++run)
+		serial_ms.push_back(Register(file_names, serial));
+
+	printf("%d files, %zu CRCs, %u hardware threads, median of %d runs\n", options.files, serial.size(), std::thread::hardware_concurrency(), options.runs);
+	printf("serial          %8.2f ms\n", Median(serial_ms));
+
+	for (int worker_count : worker_counts) {
+		CGameThreadPool pool;
+		pool.Initialize(worker_count);
+
+		std::vector<double> parallel_ms;
+		for (int run = 0; run < options.runs; ++run) {
+			TRegistered parallel;
+			parallel_ms.push_back(Register(file_names, parallel));
+
+			if (parallel != serial) {
+				std::cerr << worker_count << " workers registered " << parallel.size() << " CRCs differently from the serial "
+					<< serial.size() << std::endl;
+				return false;
+			}
+		}
+
+		printf("%2d workers      %8.2f ms\n", pool.GetWorkerCount(), Median(parallel_ms));
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("PropertyBench");
+
+	program.add_argument("--files")
+		.default_value(8000)
+		.scan<'i', int>()
+		.help("Property files to register");
+
+	program.add_argument("--duplicate-every")
+		.default_value(100)
+		.scan<'i', int>()
+		.help("One file in this many repeats the CRC of the file before it, 0 for none");
+
+	program.add_argument("--workers")
+		.nargs(argparse::nargs_pattern::at_least_one)
+		.default_value(std::vector<int>{ 2, 4, 8 })
+		.scan<'i', int>()
+		.help("Thread pool worker counts, one run each, CGameThreadPool starts at least 2");
+
+	program.add_argument("--runs")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Registrations per pool size, the median is reported");
+
+	program.add_argument("--work-dir")
+		.default_value(std::string("property_bench"))
+		.help("Scratch folder for the property files, removed afterwards");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.files = std::max(1, program.get<int>("--files"));
+	options.duplicate_every = std::max(0, program.get<int>("--duplicate-every"));
+	options.runs = std::max(1, program.get<int>("--runs"));
+
+	std::vector<int> worker_counts;
+	for (int worker_count : program.get<std::vector<int>>("--workers"))
+		worker_counts.push_back(std::max(1, worker_count));
+
+	const std::filesystem::path work_dir = std::filesystem::absolute(program.get<std::string>("--work-dir"));
+	const std::filesystem::path start_dir = std::filesystem::current_path();
+
+	std::error_code ec;
+	std::filesystem::remove_all(work_dir, ec);
+	if (!std::filesystem::create_directories(work_dir, ec)) {
+		std::cerr << "Cannot create " << work_dir.string() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success;
+	{
+		CPackManager pack_manager;
+
+		// Everything comes from the scratch folder
+		pack_manager.SetFileLoadMode();
+		std::filesystem::current_path(work_dir);
+
+		std::vector<std::string> file_names;
+		success = WriteProperties(work_dir, options, file_names) && Run(file_names, worker_counts, options);
+	}
+
+	std::filesystem::current_path(start_dir);
+	std::filesystem::remove_all(work_dir, ec);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
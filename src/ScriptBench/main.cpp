@@ -0,0 +1,219 @@
+#include "EterLib/StdAfx.h"
+#include "EterLib/TextFileLoader.h"
+#include "PackLib/PackManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Parses every .msm/.msa/.mse/.prt/.txt of the given packs through CTextFileLoader and
+// reports MB/s of script text per extension:
+//  - text: LoadFromMemory over bytes read beforehand, the parser alone
+//  - load: Load from the packs, compiled copies included where the packs have them
+// Exits with EXIT_FAILURE if a script loads one way and not the other.
+
+using TClock = std::chrono::steady_clock;
+
+static const char* s_extensions[] = { ".msm", ".msa", ".mse", ".prt", ".txt" };
+static const size_t EXTENSION_COUNT = std::size(s_extensions);
+
+struct TScript
+{
+	std::string name;
+	size_t extension;
+	CPackFileView text;
+	bool parsed;
+};
+
+struct TScriptStats
+{
+	size_t files = 0;
+	size_t failed = 0;
+	size_t compiled = 0;
+	uint64_t bytes = 0;
+	double text_ns = 0.0;
+	double load_ns = 0.0;
+};
+
+static double ElapsedNs(TClock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(TClock::now() - start).count();
+}
+
+static bool FindExtension(std::string_view name, size_t& extension)
+{
+	for (size_t i = 0; i < EXTENSION_COUNT; ++i) {
+		const std::string_view suffix = s_extensions[i];
+		if (name.size() < suffix.size())
+			continue;
+
+		const std::string_view tail = name.substr(name.size() - suffix.size());
+		if (std::equal(tail.begin(), tail.end(), suffix.begin(), [](char a, char b) { return ascii_tolower(a) == b; })) {
+			extension = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Script names of every pack, later packs override earlier ones like in the manager
+static bool LoadScriptNames(const std::vector<std::string>& packs, std::vector<TScript>& scripts)
+{
+	std::unordered_set<std::string> seen;
+
+	for (const std::string& path : packs) {
+		auto pack = std::make_shared<CPack>();
+		if (!pack->Load(path)) {
+			std::cerr << "Failed to load " << path << std::endl;
+			return false;
+		}
+
+		for (size_t i = 0; i < pack->GetEntryCount(); ++i) {
+			std::string name(pack->GetEntryName(pack->GetEntry(i)));
+
+			TScript script;
+			if (!FindExtension(name, script.extension) || !seen.insert(name).second)
+				continue;
+
+			script.name = std::move(name);
+			script.parsed = false;
+			scripts.push_back(std::move(script));
+		}
+	}
+
+	return true;
+}
+
+static void PrintStats(const char* label, const TScriptStats& stats, int repeat)
+{
+	const double mb = double(stats.bytes) / (1024.0 * 1024.0);
+	printf("%-6s %7zu files %8.2f MB %6zu failed %6zu compiled   text %8.1f MB/s   load %8.1f MB/s\n",
+		label, stats.files, mb, stats.failed, stats.compiled,
+		stats.text_ns > 0.0 ? mb * repeat / stats.text_ns * 1e9 : 0.0,
+		stats.load_ns > 0.0 ? mb * repeat / stats.load_ns * 1e9 : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("ScriptBench");
+
+	program.add_argument("--pack")
+		.append()
+		.required()
+		.help("Pack to mount, in ascending priority");
+
+	program.add_argument("--repeat")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Number of passes over every script");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<std::string> packs = program.get<std::vector<std::string>>("--pack");
+	const int repeat = std::max(1, program.get<int>("--repeat"));
+
+	CPackManager manager;
+	manager.SetPackLoadMode();
+
+	for (size_t i = 0; i < packs.size(); ++i) {
+		if (!manager.AddPack(packs[i], static_cast<int>(i))) {
+			std::cerr << "Failed to mount " << packs[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	manager.Freeze();
+
+	std::vector<TScript> scripts;
+	if (!LoadScriptNames(packs, scripts))
+		return EXIT_FAILURE;
+
+	if (scripts.empty()) {
+		std::cerr << "No scripts in the given packs" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TScriptStats stats[EXTENSION_COUNT];
+	for (TScript& script : scripts) {
+		TScriptStats& ext = stats[script.extension];
+		if (!manager.GetFileView(script.name, script.text)) {
+			std::cerr << "Failed to read " << script.name << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		CPackFileView compiled;
+		if (manager.GetCompiledFileView(script.name, compiled))
+			++ext.compiled;
+
+		++ext.files;
+		ext.bytes += script.text.size();
+	}
+
+	// The first pass also tells which scripts parse at all, the loaders of a pass are
+	// destroyed as they go like the ones the game keeps on the stack
+	size_t mismatches = 0;
+	for (int pass = 0; pass < repeat; ++pass) {
+		for (TScript& script : scripts) {
+			TScriptStats& ext = stats[script.extension];
+
+			auto start = TClock::now();
+			{
+				CTextFileLoader loader;
+				const bool parsed = loader.LoadFromMemory(script.name.c_str(), script.text.data(), script.text.size());
+				if (pass == 0) {
+					script.parsed = parsed;
+					ext.failed += !parsed;
+				}
+			}
+			ext.text_ns += ElapsedNs(start);
+
+			start = TClock::now();
+			{
+				CTextFileLoader loader;
+				const bool loaded = loader.Load(script.name.c_str());
+				if (pass == 0 && loaded != script.parsed) {
+					std::cerr << script.name << (loaded ? " loads but does not parse as text" : " parses as text but does not load") << std::endl;
+					++mismatches;
+				}
+			}
+			ext.load_ns += ElapsedNs(start);
+		}
+	}
+
+	printf("%zu packs, %zu scripts, %d passes\n", packs.size(), scripts.size(), repeat);
+
+	TScriptStats total;
+	for (size_t i = 0; i < EXTENSION_COUNT; ++i) {
+		const TScriptStats& ext = stats[i];
+		if (!ext.files)
+			continue;
+
+		PrintStats(s_extensions[i], ext, repeat);
+
+		total.files += ext.files;
+		total.failed += ext.failed;
+		total.compiled += ext.compiled;
+		total.bytes += ext.bytes;
+		total.text_ns += ext.text_ns;
+		total.load_ns += ext.load_ns;
+	}
+
+	PrintStats("total", total, repeat);
+
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
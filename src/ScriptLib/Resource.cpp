@@ -89,15 +89,15 @@ void CPythonResource::Destroy()
 
 CPythonResource::CPythonResource()
 {
-	m_resManager.RegisterResourceNewFunctionPointer("sub", NewSubImage);
-	m_resManager.RegisterResourceNewFunctionPointer("dds", NewImage);
-	m_resManager.RegisterResourceNewFunctionPointer("jpg", NewImage);
-	m_resManager.RegisterResourceNewFunctionPointer("tga", NewImage);
-	m_resManager.RegisterResourceNewFunctionPointer("bmp", NewImage);
-	m_resManager.RegisterResourceNewFunctionPointer("fnt", NewText);
-	m_resManager.RegisterResourceNewFunctionPointer("gr2", NewThing);
-	m_resManager.RegisterResourceNewFunctionPointer("mde", NewEffectMesh);
-	m_resManager.RegisterResourceNewFunctionPointer("mdatr", NewAttributeData);
+	m_resManager.RegisterResourceNewFunctionPointer("sub", NewSubImage, "image");
+	m_resManager.RegisterResourceNewFunctionPointer("dds", NewImage, "image");
+	m_resManager.RegisterResourceNewFunctionPointer("jpg", NewImage, "image");
+	m_resManager.RegisterResourceNewFunctionPointer("tga", NewImage, "image");
+	m_resManager.RegisterResourceNewFunctionPointer("bmp", NewImage, "image");
+	m_resManager.RegisterResourceNewFunctionPointer("fnt", NewText, "font");
+	m_resManager.RegisterResourceNewFunctionPointer("gr2", NewThing, "model");
+	m_resManager.RegisterResourceNewFunctionPointer("mde", NewEffectMesh, "effect");
+	m_resManager.RegisterResourceNewFunctionPointer("mdatr", NewAttributeData, "attribute");
 }
 
 CPythonResource::~CPythonResource()
@@ -692,6 +692,21 @@ void SpherePackFactory::PointTest2d(const Vector3d &center, SpherePackCallback *
 	
 }
 
+void SpherePackFactory::RangeTest2d(const Vector3d &center,float radius,SpherePackCallback *callback)
+{
+#ifdef __STATIC_RANGE__
+	if (!center.IsInStaticRange())
+	{
+		TraceError("SpherePackFactory::RangeTest2d - RANGE ERROR %f, %f, %f",
+			center.x, center.y, center.z);
+		assert("SpherePackFactory::RangeTest2d - RANGE ERROR");
+		return;
+	}
+#endif
+	mCallback = callback;
+	mRoot->RangeTest2d(center,radius,this,VS_PARTIAL);
+}
+
 void SpherePack::RangeTest(const Vector3d &p,
                            float distance,
                            SpherePackCallback *callback,
@@ -773,6 +788,36 @@ void SpherePack::PointTest2d(const Vector3d &p,
 	}
 }
 
+void SpherePack::RangeTest2d(const Vector3d &p,
+                             float distance,
+                             SpherePackCallback *callback,
+                             ViewState state)
+{
+	if (state == VS_PARTIAL)
+	{
+		float dx=p.x-mCenter.x;
+		float dy=p.y-mCenter.y;
+		float d = sqrtf((dx*dx)+(dy*dy));
+
+		if ((d-distance) > GetRadius()) return;
+		if ((GetRadius()+d) < distance) state = VS_INSIDE;
+	}
+
+	if (HasSpherePackFlag(SPF_SUPERSPHERE))
+	{
+		SpherePack *pack = mChildren;
+		while (pack)
+		{
+			pack->RangeTest2d(p,distance,callback,state);
+			pack = pack->_GetNextSibling();
+		}
+	}
+	else
+	{
+		callback->RangeTest2dCallback(p,distance,this,state);
+	}
+}
+
 void SpherePackFactory::RangeTestCallback(const Vector3d &p,float distance,SpherePack *sphere,ViewState state)
 {
 #ifdef SPHERELIB_STRICT
@@ -793,6 +838,12 @@ void SpherePackFactory::PointTest2dCallback(const Vector3d &p, SpherePack *spher
 	if (link) link->PointTest2d(p, mCallback,state);
 };
 
+void SpherePackFactory::RangeTest2dCallback(const Vector3d &p,float distance,SpherePack *sphere,ViewState state)
+{
+	SpherePack *link = (SpherePack *) sphere->GetUserData();
+	if (link) link->RangeTest2d(p,distance,mCallback,state);
+};
+
 void SpherePack::RayTrace(const Vector3d &p1,
                           const Vector3d &dir,
                           float distance,
@@ -77,6 +77,12 @@ public:
 		SpherePack *sphere,
 		ViewState state) // sphere within range, VS_PARTIAL if sphere straddles range test
 	{};
+
+	virtual void RangeTest2dCallback(const Vector3d &searchpos, // position we are performing range test against, z is ignored.
+		float distance,                     // radius of the circle we are range searching against.
+		SpherePack *sphere,
+		ViewState state) // sphere within range, VS_PARTIAL if sphere straddles range test
+	{};
 	
 private:
 };
@@ -264,6 +270,11 @@ public:
 		SpherePackCallback *callback,
 		ViewState state);
 
+	void RangeTest2d(const Vector3d &p,
+		float distance,
+		SpherePackCallback *callback,
+		ViewState state);
+
 	void Reset(void);
 	
 private:
@@ -405,6 +416,7 @@ public:
 	
 	void RangeTest(const Vector3d &center,float radius,SpherePackCallback *callback);
 	void PointTest2d(const Vector3d &center, SpherePackCallback *callback);
+	void RangeTest2d(const Vector3d &center,float radius,SpherePackCallback *callback);
 	
 	virtual void RayTraceCallback(const Vector3d &p1,          // source pos of ray
 		const Vector3d &dir,          // direction of ray
@@ -414,6 +426,7 @@ public:
 	
 	virtual void RangeTestCallback(const Vector3d &p,float distance,SpherePack *sphere,ViewState state);
 	virtual void PointTest2dCallback(const Vector3d &p, SpherePack *sphere,ViewState state);
+	virtual void RangeTest2dCallback(const Vector3d &p,float distance,SpherePack *sphere,ViewState state);
 	
 	virtual void VisibilityCallback(const Frustum &f,SpherePack *sphere,ViewState state);
 	
@@ -0,0 +1,450 @@
+#include "GameLib/StdAfx.h"
+#include "GameLib/AreaTerrain.h"
+#include "GameLib/MapOutdoor.h"
+#include "PackLib/PackManager.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Writes the height maps of a synthetic 3x3 of sectors, rolling hills crossed by ridges one
+// cell wide, loads them into CTerrain with LoadHeightMap and casts camera rays at them.
+// Each ray is picked with the step marcher CMapOutdoor used before CTerrain::IntersectRay
+// and with the sector walk of CMapOutdoor::__PickTerrain over IntersectRay. Reports us per
+// ray, and how often the marcher stepped through a ridge in front of its hit.
+// Exits with EXIT_FAILURE if an IntersectRay hit is off the surface, a ray passes under the
+// surface before its hit, or the marcher finds a point under the surface nearer than the
+// sector walk's hit.
+
+using TClock = std::chrono::steady_clock;
+
+static const short CENTER_COORD = 5;
+static const float HEIGHT_SCALE = 0.5f;
+static const float MAX_PICK_RANGE = 100000.0f;	// as in CMapOutdoor::__PickTerrain
+
+static const float SURFACE_TOLERANCE = 0.5f;
+static const float TUNNEL_DISTANCE = 300.0f;	// a hit this much further than a real one went through something
+static const int PATH_SAMPLES = 64;				// points checked between the camera and the hit
+
+// Stands in for CMapOutdoor::CopySettingFromGlobalSetting, which needs the owner map
+class CBenchTerrain : public CTerrain
+{
+	public:
+		void SetHeightScale(float fHeightScale) { m_fHeightScale = fHeightScale; }
+};
+
+struct TRay
+{
+	D3DXVECTOR3 start;
+	D3DXVECTOR3 end;
+	float range;
+};
+
+struct TPick
+{
+	bool hit;
+	D3DXVECTOR3 point;
+};
+
+struct TBenchOptions
+{
+	int rays;
+	int runs;
+};
+
+// Raw height of the map wide grid vertex, shared by the edges of neighbouring sectors
+static WORD GetGridHeight(int x, int y)
+{
+	float height = 4000.0f + 1500.0f * sinf(x * 0.03f) * cosf(y * 0.025f) + 600.0f * sinf(x * 0.11f + y * 0.07f);
+	if (x % 37 == 0)
+		height += 2500.0f;
+	if (y % 53 == 0)
+		height += 1800.0f;
+
+	return static_cast<WORD>(std::max(0.0f, height));
+}
+
+// The surface CTerrain::GetHeight interpolates, without its rounding to whole units
+static float GetSurfaceHeight(float x, float y)
+{
+	const float u = x / float(CTerrainImpl::CELLSCALE);
+	const float v = -y / float(CTerrainImpl::CELLSCALE);
+	const int cell_x = static_cast<int>(floorf(u));
+	const int cell_y = static_cast<int>(floorf(v));
+	const float dx = u - cell_x;
+	const float dy = v - cell_y;
+
+	const float h1 = GetGridHeight(cell_x, cell_y) * HEIGHT_SCALE;
+	const float h2 = GetGridHeight(cell_x + 1, cell_y + 1) * HEIGHT_SCALE;
+
+	if (dx <= dy) {
+		const float h3 = GetGridHeight(cell_x, cell_y + 1) * HEIGHT_SCALE;
+		return h1 + dx * (h2 - h3) + dy * (h3 - h1);
+	}
+
+	const float h3 = GetGridHeight(cell_x + 1, cell_y) * HEIGHT_SCALE;
+	return h1 + dx * (h3 - h1) + dy * (h2 - h3);
+}
+
+class CTerrainSet
+{
+	public:
+		bool Load(const std::filesystem::path& folder)
+		{
+			for (int i = 0; i < AROUND_AREA_NUM; ++i) {
+				const int coord_x = CENTER_COORD + i % 3 - LOAD_SIZE_WIDTH;
+				const int coord_y = CENTER_COORD + i / 3 - LOAD_SIZE_WIDTH;
+
+				std::vector<WORD> heights(CTerrainImpl::HEIGHTMAP_RAW_XSIZE * CTerrainImpl::HEIGHTMAP_RAW_YSIZE);
+				for (int y = 0; y < CTerrainImpl::HEIGHTMAP_RAW_YSIZE; ++y)
+					for (int x = 0; x < CTerrainImpl::HEIGHTMAP_RAW_XSIZE; ++x)
+						heights[y * CTerrainImpl::HEIGHTMAP_RAW_XSIZE + x] = GetGridHeight(coord_x * CTerrainImpl::XSIZE + x - 1, coord_y * CTerrainImpl::YSIZE + y - 1);
+
+				char file_name[64];
+				snprintf(file_name, sizeof(file_name), "height_%03d_%03d.raw", coord_x, coord_y);
+
+				std::ofstream file(folder / file_name, std::ios::binary);
+				file.write(reinterpret_cast<const char*>(heights.data()), heights.size() * sizeof(WORD));
+				file.close();
+
+				m_terrains[i] = std::make_unique<CBenchTerrain>();
+				m_terrains[i]->SetCoordinate(static_cast<WORD>(coord_x), static_cast<WORD>(coord_y));
+				m_terrains[i]->SetHeightScale(HEIGHT_SCALE);
+
+				if (!file || !m_terrains[i]->LoadHeightMap(file_name)) {
+					std::cerr << "Cannot load " << file_name << std::endl;
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// CMapOutdoor::GetTerrainNum and GetTerrainPointer
+		CTerrain* GetTerrain(float x, float y) const
+		{
+			if (y < 0)
+				y = -y;
+
+			int ix, iy;
+			PR_FLOAT_TO_INT(x, ix);
+			PR_FLOAT_TO_INT(y, iy);
+
+			const WORD coord_x = ix / CTerrainImpl::TERRAIN_XSIZE;
+			const WORD coord_y = iy / CTerrainImpl::TERRAIN_YSIZE;
+			const BYTE index = (coord_y - CENTER_COORD + LOAD_SIZE_WIDTH) * 3 + (coord_x - CENTER_COORD + LOAD_SIZE_WIDTH);
+
+			if (index >= AROUND_AREA_NUM)
+				return NULL;
+
+			return m_terrains[index].get();
+		}
+
+		CTerrain* GetTerrain(int offset_x, int offset_y) const
+		{
+			if (abs(offset_x) > LOAD_SIZE_WIDTH || abs(offset_y) > LOAD_SIZE_WIDTH)
+				return NULL;
+
+			return m_terrains[(offset_y + LOAD_SIZE_WIDTH) * (LOAD_SIZE_WIDTH * 2 + 1) + offset_x + LOAD_SIZE_WIDTH].get();
+		}
+
+	protected:
+		std::array<std::unique_ptr<CBenchTerrain>, AROUND_AREA_NUM> m_terrains;
+};
+
+// CMapOutdoor::__PickTerrainHeight before IntersectRay
+static bool PickTerrainHeight(const CTerrainSet& terrains, float& fPos, const D3DXVECTOR3& v3Start, const D3DXVECTOR3& v3End, float fStep, float fRayRange, float fLimitRange, D3DXVECTOR3* pv3Pick)
+{
+	D3DXVECTOR3 v3CurPos;
+
+	float fRayRangeInv = 1.0f / fRayRange;
+	while (fPos < fRayRange && fPos < fLimitRange) {
+		D3DXVec3Lerp(&v3CurPos, &v3Start, &v3End, fPos * fRayRangeInv);
+		float fMultiplier = 1.0f;
+
+		CTerrain* pTerrain = terrains.GetTerrain(v3CurPos.x, v3CurPos.y);
+		if (pTerrain) {
+			int ix, iy;
+			PR_FLOAT_TO_INT(v3CurPos.x, ix);
+			PR_FLOAT_TO_INT(fabs(v3CurPos.y), iy);
+			float fMapHeight = pTerrain->GetHeight(ix, iy);
+			if (fMapHeight >= v3CurPos.z) {
+				*pv3Pick = v3CurPos;
+				return true;
+			}
+			else {
+				fMultiplier = std::max(1.0f, 0.01f * (v3CurPos.z - fMapHeight));
+			}
+		}
+		fPos += fStep * fMultiplier;
+	}
+
+	return false;
+}
+
+static bool PickByMarching(const CTerrainSet& terrains, const TRay& ray, D3DXVECTOR3* pick)
+{
+	float pos = 0.0f;
+	return PickTerrainHeight(terrains, pos, ray.start, ray.end, 5.0f, ray.range, 5000.0f, pick)
+		|| PickTerrainHeight(terrains, pos, ray.start, ray.end, 10.0f, ray.range, 10000.0f, pick)
+		|| PickTerrainHeight(terrains, pos, ray.start, ray.end, 100.0f, ray.range, 100000.0f, pick);
+}
+
+// CMapOutdoor::__PickTerrain, the sectors the ray crosses in order
+static bool PickBySectors(const CTerrainSet& terrains, const TRay& ray, D3DXVECTOR3* pick)
+{
+	const float limit = std::min(ray.range, MAX_PICK_RANGE);
+	const D3DXVECTOR3 dir = (ray.end - ray.start) / ray.range;
+
+	const float u = ray.start.x;
+	const float v = -ray.start.y;
+	const float dir_u = dir.x;
+	const float dir_v = -dir.y;
+	const float sector_size = static_cast<float>(CTerrainImpl::TERRAIN_XSIZE);
+
+	int sector_x = static_cast<int>(floorf(u / sector_size));
+	int sector_y = static_cast<int>(floorf(v / sector_size));
+	const int step_x = (dir_u > 0.0f) ? 1 : ((dir_u < 0.0f) ? -1 : 0);
+	const int step_y = (dir_v > 0.0f) ? 1 : ((dir_v < 0.0f) ? -1 : 0);
+
+	float next_x = step_x ? ((sector_x + (step_x > 0)) * sector_size - u) / dir_u : FLT_MAX;
+	float next_y = step_y ? ((sector_y + (step_y > 0)) * sector_size - v) / dir_v : FLT_MAX;
+	const float delta_x = step_x ? sector_size / fabsf(dir_u) : FLT_MAX;
+	const float delta_y = step_y ? sector_size / fabsf(dir_v) : FLT_MAX;
+
+	float t = 0.0f;
+	for (;;) {
+		const int offset_x = sector_x - CENTER_COORD;
+		const int offset_y = sector_y - CENTER_COORD;
+
+		if ((offset_x > LOAD_SIZE_WIDTH && step_x >= 0) || (offset_x < -LOAD_SIZE_WIDTH && step_x <= 0) ||
+			(offset_y > LOAD_SIZE_WIDTH && step_y >= 0) || (offset_y < -LOAD_SIZE_WIDTH && step_y <= 0))
+			return false;
+
+		const float exit = std::min(std::min(next_x, next_y), limit);
+
+		if (CTerrain* terrain = terrains.GetTerrain(offset_x, offset_y)) {
+			float hit;
+			if (terrain->IntersectRay(ray.start, dir, t, exit, &hit)) {
+				*pick = ray.start + dir * hit;
+				return true;
+			}
+		}
+
+		if (exit >= limit)
+			return false;
+
+		if (next_x < next_y) {
+			sector_x += step_x;
+			t = next_x;
+			next_x += delta_x;
+		}
+		else {
+			sector_y += step_y;
+			t = next_y;
+			next_y += delta_y;
+		}
+	}
+}
+
+// A camera orbiting a player 5-20 m away and 20-60 degrees down, rays through random
+// points of the screen
+static std::vector<TRay> MakeRays(int count, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const float sector_size = static_cast<float>(CTerrainImpl::TERRAIN_XSIZE);
+
+	std::vector<TRay> rays(count);
+	for (TRay& ray : rays) {
+		const float player_x = CENTER_COORD * sector_size + unit(random) * sector_size;
+		const float player_y = -(CENTER_COORD * sector_size + unit(random) * sector_size);
+		const float player_z = GetSurfaceHeight(player_x, player_y);
+
+		const float yaw = unit(random) * 2.0f * D3DX_PI;
+		const float pitch = D3DXToRadian(20.0f + unit(random) * 40.0f);
+		const float distance = 500.0f + unit(random) * 1500.0f;
+
+		const D3DXVECTOR3 camera(player_x - cosf(yaw) * cosf(pitch) * distance, player_y - sinf(yaw) * cosf(pitch) * distance,
+			player_z + 150.0f + sinf(pitch) * distance);
+
+		const float ray_yaw = yaw + (unit(random) - 0.5f) * 1.2f;
+		const float ray_pitch = pitch + (unit(random) - 0.5f) * 0.9f;
+		const D3DXVECTOR3 dir(cosf(ray_yaw) * cosf(ray_pitch), sinf(ray_yaw) * cosf(ray_pitch), -sinf(ray_pitch));
+
+		ray.start = camera;
+		ray.range = 2.0f * MAX_PICK_RANGE;
+		ray.end = camera + dir * ray.range;
+	}
+
+	return rays;
+}
+
+template<typename TFunc>
+static double TimeRays(const std::vector<TRay>& rays, std::vector<TPick>& picks, int runs, TFunc pick)
+{
+	std::vector<double> us(runs);
+	for (int run = 0; run < runs; ++run) {
+		const auto begin = TClock::now();
+		for (size_t i = 0; i < rays.size(); ++i)
+			picks[i].hit = pick(rays[i], &picks[i].point);
+		us[run] = std::chrono::duration<double, std::micro>(TClock::now() - begin).count() / rays.size();
+	}
+
+	std::sort(us.begin(), us.end());
+	return us[runs / 2];
+}
+
+static float Distance(const D3DXVECTOR3& a, const D3DXVECTOR3& b)
+{
+	const D3DXVECTOR3 d = a - b;
+	return sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+}
+
+static bool Run(const CTerrainSet& terrains, const TBenchOptions& options)
+{
+	std::mt19937 random(3);
+	const std::vector<TRay> rays = MakeRays(options.rays, random);
+
+	std::vector<TPick> old_picks(rays.size()), new_picks(rays.size());
+	const double old_us = TimeRays(rays, old_picks, options.runs, [&](const TRay& ray, D3DXVECTOR3* pick) { return PickByMarching(terrains, ray, pick); });
+	const double new_us = TimeRays(rays, new_picks, options.runs, [&](const TRay& ray, D3DXVECTOR3* pick) { return PickBySectors(terrains, ray, pick); });
+
+	size_t both = 0, only_old = 0, only_new = 0, old_tunnels = 0, new_tunnels = 0, missed = 0, under = 0;
+	float max_surface_error = 0.0f;
+	double distance_sum = 0.0;
+
+	for (size_t i = 0; i < rays.size(); ++i) {
+		const TRay& ray = rays[i];
+		const TPick& old_pick = old_picks[i];
+		const TPick& new_pick = new_picks[i];
+
+		// Both pick the start of a ray that begins under the ground
+		if (ray.start.z <= GetSurfaceHeight(ray.start.x, ray.start.y)) {
+			++under;
+			continue;
+		}
+
+		if (new_pick.hit) {
+			const float error = fabsf(new_pick.point.z - GetSurfaceHeight(new_pick.point.x, new_pick.point.y));
+			max_surface_error = std::max(max_surface_error, error);
+
+			if (error > SURFACE_TOLERANCE) {
+				std::cerr << "Ray " << i << " hits " << error << " units off the surface" << std::endl;
+				return false;
+			}
+
+			for (int sample = 1; sample < PATH_SAMPLES; ++sample) {
+				const D3DXVECTOR3 point = ray.start + (new_pick.point - ray.start) * (float(sample) / PATH_SAMPLES);
+				if (point.z < GetSurfaceHeight(point.x, point.y) - SURFACE_TOLERANCE) {
+					std::cerr << "Ray " << i << " passes under the surface before its hit" << std::endl;
+					return false;
+				}
+			}
+		}
+
+		// GetHeight truncates to whole units, so the marcher may stop a little above the surface
+		const bool old_on_surface = old_pick.hit && old_pick.point.z <= GetSurfaceHeight(old_pick.point.x, old_pick.point.y);
+
+		if (old_pick.hit && new_pick.hit) {
+			++both;
+
+			const float old_distance = Distance(old_pick.point, ray.start);
+			const float new_distance = Distance(new_pick.point, ray.start);
+			distance_sum += old_distance - new_distance;
+
+			old_tunnels += old_distance - new_distance > TUNNEL_DISTANCE;
+			new_tunnels += old_on_surface && new_distance - old_distance > TUNNEL_DISTANCE;
+		}
+		else if (old_pick.hit) {
+			++only_old;
+			missed += old_on_surface;
+		}
+		else if (new_pick.hit) {
+			++only_new;
+		}
+	}
+
+	printf("%zu rays, median of %d runs, %zu start under the ground\n", rays.size(), options.runs, under);
+	printf("marcher      %8.2f us/ray\n", old_us);
+	printf("IntersectRay %8.2f us/ray\n", new_us);
+	printf("hit by both %zu, only by the marcher %zu, only by IntersectRay %zu\n", both, only_old, only_new);
+	printf("went through a nearer surface: marcher %zu, IntersectRay %zu\n", old_tunnels, new_tunnels);
+	printf("mean marcher - IntersectRay distance %.2f units, max |z - surface| %.4f\n", both ? distance_sum / both : 0.0, max_surface_error);
+
+	if (missed || new_tunnels) {
+		std::cerr << "IntersectRay missed " << missed << " hits of the marcher and went past one on " << new_tunnels << " rays" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("TerrainPickBench");
+
+	program.add_argument("--rays")
+		.default_value(20000)
+		.scan<'i', int>()
+		.help("Camera rays picked per run");
+
+	program.add_argument("--runs")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Runs per picker, the median is reported");
+
+	program.add_argument("--work-dir")
+		.default_value(std::string("terrain_pick_bench"))
+		.help("Scratch folder for the height maps, removed afterwards");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.rays = std::max(1, program.get<int>("--rays"));
+	options.runs = std::max(1, program.get<int>("--runs"));
+
+	const std::filesystem::path work_dir = std::filesystem::absolute(program.get<std::string>("--work-dir"));
+	const std::filesystem::path start_dir = std::filesystem::current_path();
+
+	std::error_code ec;
+	std::filesystem::remove_all(work_dir, ec);
+	if (!std::filesystem::create_directories(work_dir, ec)) {
+		std::cerr << "Cannot create " << work_dir.string() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	bool success;
+	{
+		CPackManager pack_manager;
+
+		// The height maps come from the scratch folder
+		pack_manager.SetFileLoadMode();
+		std::filesystem::current_path(work_dir);
+
+		CTerrainSet terrains;
+		success = terrains.Load(work_dir) && Run(terrains, options);
+	}
+
+	std::filesystem::current_path(start_dir);
+	std::filesystem::remove_all(work_dir, ec);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,268 @@
+#include "EterLib/StdAfx.h"
+#include "EterLib/LabelLayout.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <random>
+#include <vector>
+
+#include <argparse.hpp>
+
+// Lays out synthetic item name tails, random 40-160 px labels over the screen, the way
+// CPythonTextTail::ArrangeItemTextTail does every frame, once with the list scan it used
+// before CLabelLayout and once with CLabelLayout, with no tails moving and with a share of
+// them moving a few pixels per frame. Reports ms per frame and the overlapping pairs left.
+// Exits with EXIT_FAILURE if CLabelLayout moves a label above its anchor or moves a label
+// between two frames in which no anchor moved.
+
+using TClock = std::chrono::steady_clock;
+using TLabel = CLabelLayout::TLabel;
+
+static const float LABEL_HEIGHT = 14.0f;
+
+struct TBenchOptions
+{
+	int width;
+	int height;
+	int frames;
+	int old_frames;
+	double moving;
+};
+
+static std::vector<TLabel> MakeLabels(int count, const TBenchOptions& options, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> x(0.0f, static_cast<float>(options.width));
+	std::uniform_real_distribution<float> y(0.0f, static_cast<float>(options.height));
+	std::uniform_int_distribution<int> width(40, 160);
+
+	std::vector<TLabel> labels(count);
+	for (int i = 0; i < count; ++i) {
+		TLabel& label = labels[i];
+		const int text_width = width(random);
+
+		// Same box as CPythonTextTail::RegisterTextTail around a text of that size
+		label.dwVirtualID = static_cast<DWORD>(i + 1);
+		label.x = floorf(x(random));
+		label.y = floorf(y(random));
+		label.xStart = static_cast<float>(-text_width / 2 - 2);
+		label.yStart = -2.0f;
+		label.xEnd = static_cast<float>(text_width / 2 + 2);
+		label.yEnd = LABEL_HEIGHT;
+		label.xLast = 0.0f;
+		label.yLast = 0.0f;
+		label.yArranged = 0.0f;
+		label.isArranged = false;
+	}
+
+	return labels;
+}
+
+// ArrangeTextTail before CLabelLayout: every tail against the whole list, from the start
+// again after every push, at most 20 pushes
+static void ArrangeByListScan(std::list<TLabel*>& tails)
+{
+	for (auto it = tails.begin(); it != tails.end(); ++it) {
+		TLabel* insert = *it;
+		int limit_count = 0;
+
+		for (auto compare = tails.begin(); compare != tails.end();) {
+			if (*compare == insert) {
+				++compare;
+				continue;
+			}
+
+			if (limit_count >= 20)
+				break;
+
+			if (CLabelLayout::IsOverlapped(insert, *compare)) {
+				insert->y = (*compare)->y + (*compare)->yEnd + 5;
+				compare = tails.begin();
+				++limit_count;
+				continue;
+			}
+
+			++compare;
+		}
+	}
+}
+
+// Moves a share of the anchors a few pixels, like the drops around a walking player
+static void MoveAnchors(std::vector<TLabel>& anchors, double share, std::mt19937& random)
+{
+	std::uniform_real_distribution<double> pick(0.0, 1.0);
+	std::uniform_int_distribution<int> step(-3, 3);
+
+	for (TLabel& anchor : anchors) {
+		if (pick(random) >= share)
+			continue;
+
+		anchor.x += static_cast<float>(step(random));
+		anchor.y += static_cast<float>(step(random));
+	}
+}
+
+// The game projects every tail again before arranging, so y starts at the anchor each frame
+static void Project(std::vector<TLabel>& labels, const std::vector<TLabel>& anchors)
+{
+	for (size_t i = 0; i < labels.size(); ++i) {
+		labels[i].x = anchors[i].x;
+		labels[i].y = anchors[i].y;
+	}
+}
+
+static size_t CountOverlaps(const std::vector<TLabel>& labels)
+{
+	size_t overlaps = 0;
+	for (size_t i = 0; i < labels.size(); ++i)
+		for (size_t j = i + 1; j < labels.size(); ++j)
+			overlaps += CLabelLayout::IsOverlapped(&labels[i], &labels[j]);
+
+	return overlaps;
+}
+
+static double RunListScan(const std::vector<TLabel>& start, const TBenchOptions& options, size_t& overlaps)
+{
+	std::vector<TLabel> anchors = start;
+	std::vector<TLabel> labels = start;
+	std::list<TLabel*> tails;
+	for (TLabel& label : labels)
+		tails.push_back(&label);
+
+	std::mt19937 random(7);
+	double total_ms = 0.0;
+
+	for (int frame = 0; frame < options.old_frames; ++frame) {
+		MoveAnchors(anchors, options.moving, random);
+		Project(labels, anchors);
+
+		const auto begin = TClock::now();
+		ArrangeByListScan(tails);
+		total_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+	}
+
+	overlaps = CountOverlaps(labels);
+	return total_ms / options.old_frames;
+}
+
+static double RunLabelLayout(const std::vector<TLabel>& start, const TBenchOptions& options, double moving, size_t& overlaps, bool& success)
+{
+	std::vector<TLabel> anchors = start;
+	std::vector<TLabel> labels = start;
+	std::vector<TLabel*> order;
+	std::vector<float> last_y(labels.size());
+
+	CLabelLayout layout;
+	std::mt19937 random(7);
+	double total_ms = 0.0;
+
+	for (int frame = 0; frame < options.frames; ++frame) {
+		MoveAnchors(anchors, moving, random);
+		Project(labels, anchors);
+
+		order.clear();
+		for (TLabel& label : labels)
+			order.push_back(&label);
+
+		const auto begin = TClock::now();
+		layout.Arrange(order);
+		total_ms += std::chrono::duration<double, std::milli>(TClock::now() - begin).count();
+
+		for (size_t i = 0; i < labels.size(); ++i) {
+			if (labels[i].y < anchors[i].y) {
+				std::cerr << "Label " << labels[i].dwVirtualID << " placed above its anchor" << std::endl;
+				success = false;
+				return 0.0;
+			}
+
+			if (moving == 0.0 && frame > 0 && labels[i].y != last_y[i]) {
+				std::cerr << "Label " << labels[i].dwVirtualID << " moved from " << last_y[i] << " to " << labels[i].y
+					<< " while no anchor moved" << std::endl;
+				success = false;
+				return 0.0;
+			}
+
+			last_y[i] = labels[i].y;
+		}
+	}
+
+	overlaps = CountOverlaps(labels);
+	return total_ms / options.frames;
+}
+
+int main(int argc, char* argv[])
+{
+	argparse::ArgumentParser program("TextTailBench");
+
+	program.add_argument("--labels")
+		.nargs(argparse::nargs_pattern::at_least_one)
+		.default_value(std::vector<int>{ 1000, 5000 })
+		.scan<'i', int>()
+		.help("Item tails on screen, one run per count");
+
+	program.add_argument("--width")
+		.default_value(1920)
+		.scan<'i', int>()
+		.help("Screen width in pixels");
+
+	program.add_argument("--height")
+		.default_value(1080)
+		.scan<'i', int>()
+		.help("Screen height in pixels");
+
+	program.add_argument("--frames")
+		.default_value(60)
+		.scan<'i', int>()
+		.help("Frames laid out with CLabelLayout");
+
+	program.add_argument("--old-frames")
+		.default_value(5)
+		.scan<'i', int>()
+		.help("Frames laid out with the list scan, it is slow");
+
+	program.add_argument("--moving")
+		.default_value(0.1)
+		.scan<'g', double>()
+		.help("Share of the tails that move every frame in the moving run");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	TBenchOptions options;
+	options.width = std::max(1, program.get<int>("--width"));
+	options.height = std::max(1, program.get<int>("--height"));
+	options.frames = std::max(2, program.get<int>("--frames"));
+	options.old_frames = std::max(1, program.get<int>("--old-frames"));
+	options.moving = std::clamp(program.get<double>("--moving"), 0.0, 1.0);
+
+	printf("%dx%d screen, %d frames (list scan %d), %.0f%% moving\n", options.width, options.height, options.frames,
+		options.old_frames, options.moving * 100.0);
+	printf("%7s %12s %12s %12s %10s %10s\n", "labels", "list scan", "static", "moving", "overlaps", "before");
+
+	bool success = true;
+	std::mt19937 random(1);
+
+	for (int count : program.get<std::vector<int>>("--labels")) {
+		const std::vector<TLabel> start = MakeLabels(std::max(1, count), options, random);
+
+		size_t old_overlaps, static_overlaps, moving_overlaps;
+		const double old_ms = RunListScan(start, options, old_overlaps);
+		const double static_ms = RunLabelLayout(start, options, 0.0, static_overlaps, success);
+		const double moving_ms = RunLabelLayout(start, options, options.moving, moving_overlaps, success);
+
+		if (!success)
+			break;
+
+		printf("%7zu %9.2f ms %9.2f ms %9.2f ms %10zu %10zu\n", start.size(), old_ms, static_ms, moving_ms, moving_overlaps, old_overlaps);
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
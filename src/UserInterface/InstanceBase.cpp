@@ -382,7 +382,7 @@ const float NPC_DUST_RANGE = 1000.0f;
 
 DWORD CInstanceBase::ms_dwUpdateCounter=0;
 DWORD CInstanceBase::ms_dwRenderCounter=0;
-DWORD CInstanceBase::ms_dwDeformCounter=0;
+std::atomic<DWORD> CInstanceBase::ms_dwDeformCounter(0);
 
 CDynamicPool<CInstanceBase> CInstanceBase::ms_kPool;
 
@@ -6,6 +6,8 @@
 #include "StdAfx.h"
 #include "AffectFlagContainer.h"
 
+#include <atomic>
+
 class CInstanceBase
 {	
 	public:
@@ -795,6 +797,7 @@ class CInstanceBase
 
 	protected:
 		UINT					__LessRenderOrder_GetLODLevel();
+		void					__FindCollisionCandidates(DWORD dwTypeMask, std::vector<CInstanceBase*>* pkVct_pkInst);
 		void					__Initialize();
 		void					__InitializeRotationSpeed();
 
@@ -1113,7 +1116,7 @@ class CInstanceBase
 	protected:
 		static DWORD ms_dwUpdateCounter;
 		static DWORD ms_dwRenderCounter;
-		static DWORD ms_dwDeformCounter;
+		static std::atomic<DWORD> ms_dwDeformCounter; // Deform runs on pool workers
 
 	public:		
 		DWORD					GetDuelMode();
@@ -483,6 +483,25 @@ void CInstanceBase::RunComboAttack(float fAtkDirRot, DWORD wMotionIndex)
 	m_GraphicThingInstance.ComboAttack(wMotionIndex, fAtkDirRot);
 }
 
+struct FInstanceBaseLessVID
+{
+	bool operator () (CInstanceBase* pkInstLeft, CInstanceBase* pkInstRight) const
+	{
+		return pkInstLeft->GetVirtualID() < pkInstRight->GetVirtualID();
+	}
+};
+
+void CInstanceBase::__FindCollisionCandidates(DWORD dwTypeMask, std::vector<CInstanceBase*>* pkVct_pkInst)
+{
+	const TPixelPosition& c_rkPPosCur = NEW_GetCurPixelPositionRef();
+
+	const CInstanceGrid& c_rkInstGrid = CPythonCharacterManager::Instance().GetInstanceGrid();
+	c_rkInstGrid.FindInRadius(c_rkPPosCur.x, c_rkPPosCur.y, CInstanceGrid::CELL_SIZE + CInstanceGrid::POSITION_SLACK, dwTypeMask, pkVct_pkInst);
+
+	// Same order as the alive map, the first collision adjusts the movement for the rest
+	std::sort(pkVct_pkInst->begin(), pkVct_pkInst->end(), FInstanceBaseLessVID());
+}
+
 // 리턴값 TRUE가 무엇인가가 있다
 BOOL CInstanceBase::CheckAdvancing()
 {
@@ -494,8 +513,11 @@ BOOL CInstanceBase::CheckAdvancing()
 	{
 		if (IsPC() && IsWalking())
 		{
-			CPythonCharacterManager& rkChrMgr=CPythonCharacterManager::Instance();
-			for(CPythonCharacterManager::CharacterIterator i = rkChrMgr.CharacterInstanceBegin(); i!=rkChrMgr.CharacterInstanceEnd();++i)
+			static CInstanceGrid::TInstanceVector s_kVct_pkInstDoor;
+			s_kVct_pkInstDoor.clear();
+			__FindCollisionCandidates(CInstanceGrid::TypeMask(CActorInstance::TYPE_DOOR), &s_kVct_pkInstDoor);
+
+			for (CInstanceGrid::TInstanceVector::iterator i = s_kVct_pkInstDoor.begin(); i != s_kVct_pkInstDoor.end(); ++i)
 			{
 				CInstanceBase* pkInstEach=*i;
 				if (pkInstEach==this)
@@ -525,8 +547,11 @@ BOOL CInstanceBase::CheckAdvancing()
 	m_dwAdvActorVID = 0;
 	UINT uCollisionCount=0;
 
-	CPythonCharacterManager& rkChrMgr=CPythonCharacterManager::Instance();
-	for(CPythonCharacterManager::CharacterIterator i = rkChrMgr.CharacterInstanceBegin(); i!=rkChrMgr.CharacterInstanceEnd();++i)
+	static CInstanceGrid::TInstanceVector s_kVct_pkInstNear;
+	s_kVct_pkInstNear.clear();
+	__FindCollisionCandidates(bUsingSkill ? CInstanceGrid::TypeMask(CActorInstance::TYPE_DOOR) : CInstanceGrid::TYPE_MASK_ALL, &s_kVct_pkInstNear);
+
+	for (CInstanceGrid::TInstanceVector::iterator i = s_kVct_pkInstNear.begin(); i != s_kVct_pkInstNear.end(); ++i)
 	{
 		CInstanceBase* pkInstEach=*i;
 		if (pkInstEach==this)
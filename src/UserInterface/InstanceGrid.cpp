@@ -0,0 +1,18 @@
+#include "StdAfx.h"
+#include "InstanceGrid.h"
+
+CInstanceGrid::CInstanceGrid()
+{
+}
+
+CInstanceGrid::~CInstanceGrid()
+{
+}
+
+void CInstanceGrid::Refresh(CInstanceBase* pkInst)
+{
+	CActorInstance& rkActor = pkInst->GetGraphicThingInstanceRef();
+	const TPixelPosition& c_rkPPos = rkActor.NEW_GetCurPixelPositionRef();
+
+	Refresh(pkInst, c_rkPPos.x, c_rkPPos.y, TypeMask(rkActor.GetActorType()));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "InstanceBase.h"
+
+#include "EterLib/PositionGrid.h"
+
+// Live character instances by pixel position, filtered by sets of CActorInstance::EType.
+// CELL_SIZE is also how far CActorInstance::TestActorCollision looks.
+class CInstanceGrid : public CPositionGrid<CInstanceBase>
+{
+	public:
+		enum
+		{
+			POSITION_SLACK = 200,	// how far an instance may move between two refreshes
+		};
+
+		typedef TObjectVector TInstanceVector;
+
+	public:
+		CInstanceGrid();
+		~CInstanceGrid();
+
+		using CPositionGrid<CInstanceBase>::Refresh;
+
+		// Takes the current pixel position and actor type of the instance
+		void Refresh(CInstanceBase* pkInst);
+};
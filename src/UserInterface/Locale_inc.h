@@ -3,4 +3,5 @@
 #define ENABLE_DRAGON_SOUL_SYSTEM
 #define ENABLE_NEW_EQUIPMENT_SYSTEM
 //#define ENABLE_DISCORD_RPC
-#define ENABLE_SUPPORT_SYSTEM
\ No newline at end of file
+#define ENABLE_SUPPORT_SYSTEM
+//#define ENABLE_NETWORK_THREAD
\ No newline at end of file
@@ -164,6 +164,8 @@ void CPythonApplication::Exit()
 
 void CPythonApplication::RenderGame()
 {
+	PROFILE_FUNCTION();
+
 	float fAspect = m_kWndMgr.GetAspect();
 	float fFarClip = m_pyBackground.GetFarClip();
 
@@ -216,6 +218,8 @@ void CPythonApplication::RenderGame()
 
 void CPythonApplication::UpdateGame()
 {
+	PROFILE_FUNCTION();
+
 	POINT ptMouse;
 	GetMousePosition(&ptMouse);
 
@@ -260,7 +264,8 @@ bool CPythonApplication::Process()
 {
 	ELTimer_SetFrameMSec();
 
-	// 	m_Profiler.Clear();
+	CProfiler::Instance().Frame();
+
 	DWORD dwStart = ELTimer_GetMSec();
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -286,9 +291,6 @@ bool CPythonApplication::Process()
 	static BOOL s_bFrameSkip = false;
 	static UINT s_uiNextFrameTime = ELTimer_GetMSec();
 
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime1=ELTimer_GetMSec();
-#endif
 	CTimer& rkTimer=CTimer::Instance();
 	rkTimer.Advance();
 
@@ -299,80 +301,52 @@ bool CPythonApplication::Process()
 	s_uiNextFrameTime += uiFrameTime;	//17 - 1ÃÊ´ç 60fps±âÁØ.
 
 	DWORD updatestart = ELTimer_GetMSec();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime2=ELTimer_GetMSec();
-#endif
-	// Network I/O	
-	m_pyNetworkStream.Process();	
-	//m_pyNetworkDatagram.Process();
+	{
+		PROFILE_ZONE("Network");
 
-	m_kGuildMarkUploader.Process();
+		// Network I/O	
+		m_pyNetworkStream.Process();	
+		//m_pyNetworkDatagram.Process();
 
-	m_kGuildMarkDownloader.Process();
-	m_kAccountConnector.Process();
+		m_kGuildMarkUploader.Process();
 
-#ifdef __PERFORMANCE_CHECK__		
-	DWORD dwUpdateTime3=ELTimer_GetMSec();
-#endif
-	//////////////////////
-	// Input Process
-	// Keyboard
-	UpdateKeyboard();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime4=ELTimer_GetMSec();
-#endif
-	// Mouse
-	POINT Point;
-	if (GetCursorPos(&Point)) [[likely]] {
-		ScreenToClient(m_hWnd, &Point);
-		OnMouseMove(Point.x, Point.y);		
+		m_kGuildMarkDownloader.Process();
+		m_kAccountConnector.Process();
+	}
+
+	{
+		PROFILE_ZONE("Input");
+
+		//////////////////////
+		// Input Process
+		// Keyboard
+		UpdateKeyboard();
+		// Mouse
+		POINT Point;
+		if (GetCursorPos(&Point)) [[likely]] {
+			ScreenToClient(m_hWnd, &Point);
+			OnMouseMove(Point.x, Point.y);		
+		}
+		//////////////////////
 	}
-	//////////////////////
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime5=ELTimer_GetMSec();
-#endif
 	//!@# Alt+Tab Áß SetTransfor ¿¡¼­ Æ¨±è Çö»ó ÇØ°áÀ» À§ÇØ - [levites]
 	//if (m_isActivateWnd)
 	__UpdateCamera();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime6=ELTimer_GetMSec();
-#endif
-	// Update Game Playing
-	CResourceManager::Instance().Update();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime7=ELTimer_GetMSec();
-#endif
+
+	{
+		PROFILE_ZONE("Resources");
+
+		// Update Game Playing
+		CResourceManager::Instance().Update();
+	}
+
 	OnCameraUpdate();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime8=ELTimer_GetMSec();
-#endif
 	OnMouseUpdate();
-#ifdef __PERFORMANCE_CHECK__
-	DWORD dwUpdateTime9=ELTimer_GetMSec();
-#endif
-	OnUIUpdate();
-
-#ifdef __PERFORMANCE_CHECK__		
-	DWORD dwUpdateTime10=ELTimer_GetMSec();
-
-	if (dwUpdateTime10-dwUpdateTime1>10)
-	{			
-		static FILE* fp=fopen("perf_app_update.txt", "w");
-
-		fprintf(fp, "AU.Total %d (Time %d)\n", dwUpdateTime9-dwUpdateTime1, ELTimer_GetMSec());
-		fprintf(fp, "AU.TU %d\n", dwUpdateTime2-dwUpdateTime1);
-		fprintf(fp, "AU.NU %d\n", dwUpdateTime3-dwUpdateTime2);
-		fprintf(fp, "AU.KU %d\n", dwUpdateTime4-dwUpdateTime3);
-		fprintf(fp, "AU.MP %d\n", dwUpdateTime5-dwUpdateTime4);
-		fprintf(fp, "AU.CP %d\n", dwUpdateTime6-dwUpdateTime5);
-		fprintf(fp, "AU.RU %d\n", dwUpdateTime7-dwUpdateTime6);
-		fprintf(fp, "AU.CU %d\n", dwUpdateTime8-dwUpdateTime7);
-		fprintf(fp, "AU.MU %d\n", dwUpdateTime9-dwUpdateTime8);
-		fprintf(fp, "AU.UU %d\n", dwUpdateTime10-dwUpdateTime9);			
-		fprintf(fp, "----------------------------------\n");
-		fflush(fp);
-	}		
-#endif
+
+	{
+		PROFILE_ZONE("UI update");
+		OnUIUpdate();
+	}
 
 	//UpdateÇÏ´Âµ¥ °É¸°½Ã°£.delta°ª
 	m_dwCurUpdateTime = ELTimer_GetMSec() - updatestart;
@@ -453,6 +427,8 @@ bool CPythonApplication::Process()
 
 		if (canRender) [[likely]]
 		{
+			PROFILE_ZONE("Render");
+
 			// RestoreLostDevice
 			CCullingManager::Instance().Update();
 			if (m_pyGraphic.Begin()) [[likely]] {
@@ -550,7 +526,6 @@ bool CPythonApplication::Process()
 	++s_dwUpdateFrameCount;
 
 	s_uiLoad += ELTimer_GetMSec() - dwStart;
-	//m_Profiler.ProfileByScreen();	
 	return true;
 }
 
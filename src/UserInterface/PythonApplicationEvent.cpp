@@ -130,6 +130,18 @@ void CPythonApplication::OnKeyDown(int iIndex)
 {
 	UI::CWindowManager& rkWndMgr=UI::CWindowManager::Instance();
 
+	// Ctrl+F11 writes the recent frames of the profiler
+	if (DIK_F11 == iIndex && (IsPressed(DIK_LCONTROL) || IsPressed(DIK_RCONTROL)))
+	{
+		CProfiler& rkProfiler=CProfiler::Instance();
+		if (rkProfiler.IsEnabled())
+		{
+			std::string stFileName=rkProfiler.Dump();
+			Tracenf("CPythonApplication::OnKeyDown: profiler trace written to %s", stFileName.c_str());
+			return;
+		}
+	}
+
 	if (DIK_ESCAPE == iIndex)
 	{
 		rkWndMgr.RunPressEscapeKey();
@@ -1169,6 +1169,55 @@ PyObject* appReloadLocale(PyObject* poSelf, PyObject* poArgs)
 	return Py_BuildValue("i", 1);
 }
 
+PyObject* appGetResourceStats(PyObject* poSelf, PyObject* poArgs)
+{
+	CResourceManager::TResidencyStats kTotal;
+	std::vector<CResourceManager::TResidencyStats> kVct_kStats;
+	CResourceManager::Instance().GetResidencyStats(&kTotal, &kVct_kStats);
+	kVct_kStats.insert(kVct_kStats.begin(), kTotal);
+
+	// (type, budget KB, resident KB, resident count, idle count, hits, misses, evictions), "total" first
+	PyObject* poList = PyList_New(0);
+
+	for (size_t i = 0; i < kVct_kStats.size(); ++i)
+	{
+		const CResourceManager::TResidencyStats& c_rkStats = kVct_kStats[i];
+		PyObject* poStats = Py_BuildValue("(sKKIIKKK)", c_rkStats.stName.c_str(),
+			(unsigned long long)(c_rkStats.uBudget >> 10), (unsigned long long)(c_rkStats.uResidentBytes >> 10),
+			c_rkStats.uResidentCount, c_rkStats.uEvictableCount,
+			(unsigned long long)c_rkStats.uHitCount, (unsigned long long)c_rkStats.uMissCount, (unsigned long long)c_rkStats.uEvictionCount);
+		PyList_Append(poList, poStats);
+		Py_DECREF(poStats);
+	}
+
+	return poList;
+}
+
+PyObject* appDumpResourceStats(PyObject* poSelf, PyObject* poArgs)
+{
+	char* szFileName;
+	if (!PyTuple_GetString(poArgs, 0, &szFileName))
+		return Py_BuildException();
+
+	return Py_BuildValue("i", CResourceManager::Instance().DumpResidencyStats(szFileName) ? 1 : 0);
+}
+
+PyObject* appSetResourceBudget(PyObject* poSelf, PyObject* poArgs)
+{
+	char* szType;
+	if (!PyTuple_GetString(poArgs, 0, &szType))
+		return Py_BuildException();
+
+	int iMegaBytes;
+	if (!PyTuple_GetInteger(poArgs, 1, &iMegaBytes))
+		return Py_BuildException();
+
+	if (!CResourceManager::Instance().SetResidencyBudget(szType, size_t(std::max(iMegaBytes, 0)) << 20))
+		return Py_BuildException("unknown resource type %s", szType);
+
+	return Py_BuildNone();
+}
+
 void initapp()
 {
 	static PyMethodDef s_methods[] =
@@ -1190,6 +1239,9 @@ void initapp()
 		{ "SetMinFog",					appSetMinFog,					METH_VARARGS },
 		{ "SetFrameSkip",				appSetFrameSkip,				METH_VARARGS },
 		{ "GetImageInfo",				appGetImageInfo,				METH_VARARGS },
+		{ "GetResourceStats",			appGetResourceStats,			METH_VARARGS },
+		{ "DumpResourceStats",			appDumpResourceStats,			METH_VARARGS },
+		{ "SetResourceBudget",			appSetResourceBudget,			METH_VARARGS },
 		{ "GetInfo",					appGetInfo,						METH_VARARGS },
 		{ "UpdateGame",					appUpdateGame,					METH_VARARGS },
 		{ "RenderGame",					appRenderGame,					METH_VARARGS },
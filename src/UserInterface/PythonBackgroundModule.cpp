@@ -415,7 +415,17 @@ PyObject * backgroundSetBGLoading(PyObject * poSelf, PyObject * poArgs)
 	if (!PyTuple_GetBoolean(poArgs, 0, &bBGLoading))
 		return Py_BadArgument();
 
-	//CPythonBackground::Instance().BGLoadingEnable(bBGLoading);
+	CAreaLoaderThread::SetEnable(bBGLoading);
+	return Py_BuildNone();
+}
+
+PyObject * backgroundSetStreamingSectorBudget(PyObject * poSelf, PyObject * poArgs)
+{
+	int iSectorCount;
+	if (!PyTuple_GetInteger(poArgs, 0, &iSectorCount))
+		return Py_BadArgument();
+
+	CAreaLoaderThread::SetSectorBudget(std::max(iSectorCount, 0));
 	return Py_BuildNone();
 }
 
@@ -572,6 +582,7 @@ void initBackground()
 		{ "GetFarClip",							backgroundGetFarClip,						METH_VARARGS },
 		{ "GetDistanceSetInfo",					backgroundGetDistanceSetInfo,				METH_VARARGS },
 		{ "SetBGLoading",						backgroundSetBGLoading,						METH_VARARGS },
+		{ "SetStreamingSectorBudget",			backgroundSetStreamingSectorBudget,			METH_VARARGS },
 		{ "SetRenderSort",						backgroundSetRenderSort,					METH_VARARGS },
 		{ "SetTransparentTree",					backgroundSetTransparentTree,				METH_VARARGS },
 		{ "SetXMasTree",						backgroundSetXMasTree,						METH_VARARGS },
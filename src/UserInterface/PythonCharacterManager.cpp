@@ -6,12 +6,18 @@
 #include "packet.h"
 
 #include "EterLib/Camera.h"
+#include "EterLib/Profiler.h"
+#include "EterLib/ParallelFor.h"
+#include "EterGrnLib/ModelInstance.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Frame Process
 
 int CHAR_STAGE_VIEW_BOUND = 200*100;
 
+// Characters skinned per pool task
+const size_t DEFORM_GRAIN_SIZE = 4;
+
 struct FCharacterManagerCharacterInstanceUpdate
 {
 	inline void operator () (const std::pair<DWORD,CInstanceBase *>& cr_Pair)
@@ -25,8 +31,19 @@ void CPythonCharacterManager::AdjustCollisionWithOtherObjects(CActorInstance* pI
 	if( !pInst->IsPC() )
 		return;
 
-	CPythonCharacterManager& rkChrMgr=CPythonCharacterManager::Instance();
-	for(CPythonCharacterManager::CharacterIterator i = rkChrMgr.CharacterInstanceBegin(); i!=rkChrMgr.CharacterInstanceEnd();++i)
+	// TestPhysicsBlendingCollision does not reach past CELL_SIZE from the blending position
+	TPixelPosition kPPosBlend;
+	pInst->GetBlendingPosition(&kPPosBlend);
+
+	const DWORD c_dwTypeMask = CInstanceGrid::TYPE_MASK_ALL
+		& ~CInstanceGrid::TypeMask(CActorInstance::TYPE_PC) & ~CInstanceGrid::TypeMask(CActorInstance::TYPE_SUPPORT)
+		& ~CInstanceGrid::TypeMask(CActorInstance::TYPE_NPC) & ~CInstanceGrid::TypeMask(CActorInstance::TYPE_ENEMY);
+
+	static CInstanceGrid::TInstanceVector s_kVct_pkInstNear;
+	s_kVct_pkInstNear.clear();
+	m_kInstGrid.FindInRadius(kPPosBlend.x, kPPosBlend.y, CInstanceGrid::CELL_SIZE + CInstanceGrid::POSITION_SLACK, c_dwTypeMask, &s_kVct_pkInstNear);
+
+	for (CInstanceGrid::TInstanceVector::iterator i = s_kVct_pkInstNear.begin(); i != s_kVct_pkInstNear.end(); ++i)
 	{
 		CInstanceBase*  pkInstEach=*i;
 		CActorInstance* rkActorEach=pkInstEach->GetGraphicThingInstancePtr();
@@ -150,84 +167,68 @@ bool CPythonCharacterManager::IsCacheMode()
 
 void CPythonCharacterManager::Update()
 {
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t1=timeGetTime();
-#endif
+	PROFILE_FUNCTION();
+
 	CInstanceBase::ResetPerformanceCounter();
 
 	CInstanceBase* pkInstMain=GetMainInstancePtr();
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t2=timeGetTime();
-#endif
 	DWORD dwDeadInstCount=0;
 	DWORD dwForceVisibleInstCount=0;
 
-	TCharacterInstanceMap::iterator i=m_kAliveInstMap.begin(); 
-	while (m_kAliveInstMap.end()!=i)
 	{
-		TCharacterInstanceMap::iterator c=i++;
-
-		CInstanceBase* pkInstEach=c->second;
-		pkInstEach->Update();
+		PROFILE_ZONE("Update instances");
 
-		if (pkInstMain)
+		TCharacterInstanceMap::iterator i=m_kAliveInstMap.begin(); 
+		while (m_kAliveInstMap.end()!=i)
 		{
-			if (pkInstEach->IsForceVisible()) [[unlikely]] {
-				dwForceVisibleInstCount++;
-				continue;
-			}
+			TCharacterInstanceMap::iterator c=i++;
+
+			CInstanceBase* pkInstEach=c->second;
+			pkInstEach->Update();
 
-			// Optimized: Use squared distance to avoid sqrt
-			float fDistanceSquared = pkInstEach->NEW_GetDistanceFromDestInstanceSquared(*pkInstMain);
-			const float fViewBoundSquared = (CHAR_STAGE_VIEW_BOUND + 10) * (CHAR_STAGE_VIEW_BOUND + 10);
-			if (fDistanceSquared > fViewBoundSquared) [[unlikely]] {
-				__DeleteBlendOutInstance(pkInstEach);
-				m_kAliveInstMap.erase(c);
-				dwDeadInstCount++;
+			if (pkInstMain)
+			{
+				if (pkInstEach->IsForceVisible()) [[unlikely]] {
+					dwForceVisibleInstCount++;
+					continue;
+				}
+
+				// Optimized: Use squared distance to avoid sqrt
+				float fDistanceSquared = pkInstEach->NEW_GetDistanceFromDestInstanceSquared(*pkInstMain);
+				const float fViewBoundSquared = (CHAR_STAGE_VIEW_BOUND + 10) * (CHAR_STAGE_VIEW_BOUND + 10);
+				if (fDistanceSquared > fViewBoundSquared) [[unlikely]] {
+					m_kInstGrid.Remove(pkInstEach);
+					__DeleteBlendOutInstance(pkInstEach);
+					m_kAliveInstMap.erase(c);
+					dwDeadInstCount++;
+				}
 			}
 		}
 	}
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t3=timeGetTime();
-#endif
-	UpdateTransform();
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t4=timeGetTime();
-#endif
 
-	UpdateDeleting();
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t5=timeGetTime();
-#endif
+	{
+		PROFILE_ZONE("Refresh instance grid");
+		__RefreshInstanceGrid();
+	}
 
-	__NEW_Pick();
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t6=timeGetTime();
-#endif
+	UpdateTransform();
+	UpdateDeleting();
 
-#ifdef __PERFORMANCE_CHECKER__
 	{
-		static FILE* fp=fopen("perf_chrmgr_update.txt", "w");
-
-		if (t6-t1>1)
-		{
-			fprintf(fp, "CU.Total %d (Time %d, Alive %d, Dead %d)\n", 
-				t6-t1, ELTimer_GetMSec(),
-				m_kAliveInstMap.size(),
-				m_kDeadInstList.size());
-			fprintf(fp, "CU.Counter %d\n", t2-t1);
-			fprintf(fp, "CU.ForEach %d\n", t3-t2);
-			fprintf(fp, "CU.Trans %d\n", t4-t3);
-			fprintf(fp, "CU.Del %d\n", t5-t4);
-			fprintf(fp, "CU.Pick %d\n", t6-t5);
-			fprintf(fp, "CU.AI %d\n", m_kAliveInstMap.size());
-			fprintf(fp, "CU.DI %d\n", dwDeadInstCount);
-			fprintf(fp, "CU.FVI %d\n", dwForceVisibleInstCount);
-			fprintf(fp, "-------------------------------- \n");
-			fflush(fp);
-		}
+		PROFILE_ZONE("Pick");
+		__NEW_Pick();
 	}
-#endif
+
+	PROFILE_COUNTER("Alive instances", m_kAliveInstMap.size());
+	PROFILE_COUNTER("Dead instances", m_kDeadInstList.size());
+	PROFILE_COUNTER("Blended out instances", dwDeadInstCount);
+	PROFILE_COUNTER("Force visible instances", dwForceVisibleInstCount);
+}
+
+void CPythonCharacterManager::__RefreshInstanceGrid()
+{
+	for (TCharacterInstanceMap::iterator i = m_kAliveInstMap.begin(); i != m_kAliveInstMap.end(); ++i)
+		m_kInstGrid.Refresh(i->second);
 }
 
 void CPythonCharacterManager::ShowPointEffect(DWORD ePoint, DWORD dwVID)
@@ -261,30 +262,30 @@ bool CPythonCharacterManager::RegisterPointEffect(DWORD ePoint, const char* c_sz
 
 void CPythonCharacterManager::UpdateTransform()
 {
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t1=timeGetTime();
-	DWORD t2=timeGetTime();
-#endif
+	PROFILE_FUNCTION();
 
 	CInstanceBase * pMainInstance = GetMainInstancePtr();
 	if (pMainInstance)
 	{
 		CPythonBackground& rkBG=CPythonBackground::Instance();
-		for (TCharacterInstanceMap::iterator i = m_kAliveInstMap.begin(); i != m_kAliveInstMap.end(); ++i)
+
 		{
-			CInstanceBase * pSrcInstance = i->second;
+			PROFILE_ZONE("Check advancing instances");
+
+			for (TCharacterInstanceMap::iterator i = m_kAliveInstMap.begin(); i != m_kAliveInstMap.end(); ++i)
+			{
+				CInstanceBase * pSrcInstance = i->second;
 
-			pSrcInstance->CheckAdvancing();
+				pSrcInstance->CheckAdvancing();
 
-			// 2004.08.02.myevan.IsAttacked 일 경우 죽었을때도 체크하므로, 
-			// 실질적으로 거리가 변경되는 IsPushing일때만 체크하도록 한다
-			if (pSrcInstance->IsPushing())
-				rkBG.CheckAdvancing(pSrcInstance);
+				// 2004.08.02.myevan.IsAttacked 일 경우 죽었을때도 체크하므로, 
+				// 실질적으로 거리가 변경되는 IsPushing일때만 체크하도록 한다
+				if (pSrcInstance->IsPushing())
+					rkBG.CheckAdvancing(pSrcInstance);
+			}
 		}
-#ifdef __PERFORMANCE_CHECKER__
-		t2=timeGetTime();
-#endif
 
+		PROFILE_ZONE("Check advancing background");
 #ifdef __MOVIE_MODE__
 		if (!m_pkInstMain->IsMovieMode())
 		{
@@ -295,46 +296,21 @@ void CPythonCharacterManager::UpdateTransform()
 #endif
 	}
 
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t3=timeGetTime();
-#endif
-
 	{
+		PROFILE_ZONE("Transform");
+
 		for (TCharacterInstanceMap::iterator itor = m_kAliveInstMap.begin(); itor != m_kAliveInstMap.end(); ++itor)
 		{
 			CInstanceBase * pInstance = itor->second;
 			pInstance->Transform();
 		}
 	}
-
-#ifdef __PERFORMANCE_CHECKER__
-	DWORD t4=timeGetTime();
-#endif
-
-#ifdef __PERFORMANCE_CHECKER__
-	{
-		static FILE* fp=fopen("perf_chrmgr_updatetransform.txt", "w");
-
-		if (t4-t1>5)
-		{
-			fprintf(fp, "CUT.Total %d (Time %f, Alive %d, Dead %d)\n", 
-				t4-t1, ELTimer_GetMSec()/1000.0f,
-				m_kAliveInstMap.size(),
-				m_kDeadInstList.size());
-			fprintf(fp, "CUT.ChkAdvInst %d\n", t2-t1);
-			fprintf(fp, "CUT.ChkAdvBG %d\n", t3-t2);
-			fprintf(fp, "CUT.Trans %d\n", t4-t3);
-
-			fprintf(fp, "-------------------------------- \n");
-			fflush(fp);
-		}
-
-		fflush(fp);
-	}
-#endif
 }
+
 void CPythonCharacterManager::UpdateDeleting()
 {
+	PROFILE_FUNCTION();
+
 	TCharacterInstanceList::iterator itor = m_kDeadInstList.begin();
 	for (; itor != m_kDeadInstList.end();)
 	{
@@ -350,14 +326,6 @@ void CPythonCharacterManager::UpdateDeleting()
 	}
 }
 
-struct FCharacterManagerCharacterInstanceDeform
-{
-	inline void operator () (const std::pair<DWORD,CInstanceBase *>& cr_Pair)
-	{
-		cr_Pair.second->Deform();
-		//pInstance->Update();
-	}
-};
 struct FCharacterManagerCharacterInstanceListDeform
 {
 	inline void operator () (CInstanceBase * pInstance)
@@ -368,8 +336,17 @@ struct FCharacterManagerCharacterInstanceListDeform
 
 void CPythonCharacterManager::Deform()
 {
-	std::for_each(m_kAliveInstMap.begin(), m_kAliveInstMap.end(), FCharacterManagerCharacterInstanceDeform());
-	std::for_each(m_kDeadInstList.begin(), m_kDeadInstList.end(), FCharacterManagerCharacterInstanceListDeform());
+	// Instances skin independently of each other, so spread them over the pool
+	m_kVct_pkInstDeform.clear();
+	m_kVct_pkInstDeform.reserve(m_kAliveInstMap.size() + m_kDeadInstList.size());
+
+	for (TCharacterInstanceMap::iterator i = m_kAliveInstMap.begin(); i != m_kAliveInstMap.end(); ++i)
+		m_kVct_pkInstDeform.push_back(i->second);
+
+	m_kVct_pkInstDeform.insert(m_kVct_pkInstDeform.end(), m_kDeadInstList.begin(), m_kDeadInstList.end());
+
+	ParallelForEach(m_kVct_pkInstDeform.begin(), m_kVct_pkInstDeform.end(), DEFORM_GRAIN_SIZE, FCharacterManagerCharacterInstanceListDeform());
+	CGrannyModelInstance::FlushDeferredDeforms();
 }
 
 
@@ -626,6 +603,7 @@ void CPythonCharacterManager::DeleteInstance(DWORD dwDelVID)
 	if (pkInstDel == m_pkInstPick)
 		m_pkInstPick = NULL;
 
+	m_kInstGrid.Remove(pkInstDel);
 	CInstanceBase::Delete(pkInstDel);
 
 	m_kAliveInstMap.erase(itor);
@@ -647,6 +625,7 @@ void CPythonCharacterManager::DeleteInstanceByFade(DWORD dwVID)
 	{
 		return;
 	}
+	m_kInstGrid.Remove(f->second);
 	__DeleteBlendOutInstance(f->second);
 	m_kAliveInstMap.erase(f);	
 }
@@ -882,32 +861,28 @@ int CPythonCharacterManager::PickAll()
 	return -1;
 }
 
-CInstanceBase * CPythonCharacterManager::GetCloseInstance(CInstanceBase * pInstance)
+static bool IsBattleEventInstance(CInstanceBase * pInstance)
 {
-	float fMinDistance = 10000.0f;
-	CInstanceBase * pCloseInstance = NULL;
-
-	TCharacterInstanceMap::iterator itor = m_kAliveInstMap.begin();
-	for (; itor != m_kAliveInstMap.end(); ++itor)
-	{
-		CInstanceBase * pTargetInstance = itor->second;
+	return CPythonNonPlayer::ON_CLICK_EVENT_BATTLE == CPythonNonPlayer::Instance().GetEventType(pInstance->GetVirtualNumber());
+}
 
-		if (pTargetInstance == pInstance)
-			continue;
+CInstanceBase * CPythonCharacterManager::GetCloseInstance(CInstanceBase * pInstance)
+{
+	TPixelPosition kPPosSrc;
+	pInstance->NEW_GetPixelPosition(&kPPosSrc);
 
-		DWORD dwVirtualNumber = pTargetInstance->GetVirtualNumber();
-		if (CPythonNonPlayer::ON_CLICK_EVENT_BATTLE != CPythonNonPlayer::Instance().GetEventType(dwVirtualNumber))
-			continue;
+	// Two, in case the source itself is the nearest
+	static CInstanceGrid::TInstanceVector s_kVct_pkInstClose;
+	s_kVct_pkInstClose.clear();
+	m_kInstGrid.FindNearest(kPPosSrc.x, kPPosSrc.y, 2, 10000.0f, CInstanceGrid::TYPE_MASK_ALL, &s_kVct_pkInstClose, IsBattleEventInstance);
 
-		float fDistance = pInstance->GetDistance(pTargetInstance);
-		if (fDistance < fMinDistance)
-		{
-			fMinDistance = fDistance;
-			pCloseInstance = pTargetInstance;
-		}
+	for (CInstanceGrid::TInstanceVector::iterator itor = s_kVct_pkInstClose.begin(); itor != s_kVct_pkInstClose.end(); ++itor)
+	{
+		if (*itor != pInstance)
+			return *itor;
 	}
 
-	return pCloseInstance;
+	return NULL;
 }
 
 void CPythonCharacterManager::RefreshAllPCTextTail()
@@ -952,6 +927,7 @@ void CPythonCharacterManager::DestroyAliveInstanceMap()
 		CInstanceBase::Delete(i->second);
 
 	m_kAliveInstMap.clear();
+	m_kInstGrid.Clear();
 }
 
 void CPythonCharacterManager::DestroyDeadInstanceList()
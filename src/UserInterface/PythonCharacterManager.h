@@ -2,6 +2,7 @@
 
 #include "AbstractCharacterManager.h"
 #include "InstanceBase.h"
+#include "InstanceGrid.h"
 #include "GameLib/PhysicsObject.h"
 
 class CPythonCharacterManager : public CSingleton<CPythonCharacterManager>, public IAbstractCharacterManager, public IObjectManager
@@ -77,6 +78,9 @@ class CPythonCharacterManager : public CSingleton<CPythonCharacterManager>, publ
 		inline CharacterIterator			CharacterInstanceBegin() { return CharacterIterator(m_kAliveInstMap.begin());}
 		inline CharacterIterator			CharacterInstanceEnd() { return CharacterIterator(m_kAliveInstMap.end());}
 
+		// Alive instances by position, refreshed every Update before the collision checks
+		const CInstanceGrid &				GetInstanceGrid() const { return m_kInstGrid; }
+
 		// Access Instance
 		void								SelectInstance(DWORD VirtualID);
 		CInstanceBase *						GetSelectedInstancePtr();
@@ -100,6 +104,7 @@ class CPythonCharacterManager : public CSingleton<CPythonCharacterManager>, publ
 		void __Initialize();
 
 		void __DeleteBlendOutInstance(CInstanceBase* pkInstDel);
+		void __RefreshInstanceGrid();
 
 		void __OLD_Pick();
 		void __NEW_Pick();
@@ -120,7 +125,10 @@ class CPythonCharacterManager : public CSingleton<CPythonCharacterManager>, publ
 		TCharacterInstanceMap				m_kAliveInstMap;
 		TCharacterInstanceList				m_kDeadInstList;
 
+		CInstanceGrid						m_kInstGrid;
+
 		std::vector<CInstanceBase*>			m_kVct_pkInstPicked;
+		std::vector<CInstanceBase*>			m_kVct_pkInstDeform;
 
 		DWORD								m_adwPointEffect[POINT_MAX_NUM];
 
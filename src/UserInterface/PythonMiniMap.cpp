@@ -111,8 +111,14 @@ void CPythonMiniMap::Update(float fCenterX, float fCenterY)
 	if (!pkInstMain)
 		return;
 
-	CPythonCharacterManager::CharacterIterator i;
-	for(i = rkChrMgr.CharacterInstanceBegin(); i!=rkChrMgr.CharacterInstanceEnd(); ++i)
+	// Only the instances around the center can land inside the radar circle
+	static CInstanceGrid::TInstanceVector s_kVct_pkInstNear;
+	s_kVct_pkInstNear.clear();
+	const float fPixelRadius = m_fMiniMapRadius / (fooCellScale * m_fScale) + CInstanceGrid::POSITION_SLACK;
+	rkChrMgr.GetInstanceGrid().FindInRadius(m_fCenterX, m_fCenterY, fPixelRadius, CInstanceGrid::TYPE_MASK_ALL, &s_kVct_pkInstNear);
+
+	CInstanceGrid::TInstanceVector::iterator i;
+	for(i = s_kVct_pkInstNear.begin(); i!=s_kVct_pkInstNear.end(); ++i)
 	{
 		CInstanceBase* pkInstEach=*i;
 
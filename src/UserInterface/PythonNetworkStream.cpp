@@ -320,26 +320,29 @@ void CPythonNetworkStream::SetLoginKey(DWORD dwLoginKey)
 }
 
 // Table-driven packet dispatch — replaces CheckPacket() + per-phase switch statements.
+// The frame header is read straight from the recv buffer; reader handlers parse the frame in place.
 // Returns true if a packet was processed and more may follow.
 // Returns false to exit the phase loop (no data, error, or exitPhase handler).
 bool CPythonNetworkStream::DispatchPacket(const PacketHandlerMap& handlers)
 {
 	TPacketHeader header;
-	if (!Peek(sizeof(TPacketHeader), &header))
-		return false;
-
-	// Skip zero-padding (can occur from encryption alignment)
-	while (0 == header)
+	for (;;)
 	{
-		if (!Recv(sizeof(TPacketHeader), &header))
-			return false;
-		if (!Peek(sizeof(TPacketHeader), &header))
+		if (GetRecvReadableBytes() < sizeof(TPacketHeader))
 			return false;
+
+		memcpy(&header, GetRecvReadPtr(), sizeof(TPacketHeader));
+
+		// Skip zero-padding (can occur from encryption alignment)
+		if (0 != header)
+			break;
+
+		ConsumeRecv(sizeof(TPacketHeader));
 	}
 
 	// Look up handler in this phase's table
-	auto it = handlers.find(header);
-	if (it == handlers.end())
+	const PacketHandlerEntry* pEntry = handlers.Find(header);
+	if (!pEntry)
 	{
 		TraceError("Unknown packet header: 0x%04X (recv_seq #%u), Phase: %s", header, m_dwRecvPacketSeq, m_strPhase.c_str());
 		DumpRecentPackets();
@@ -348,10 +351,12 @@ bool CPythonNetworkStream::DispatchPacket(const PacketHandlerMap& handlers)
 	}
 
 	// All packets use uniform framing: [header:2][length:2][payload...]
-	TDynamicSizePacketHeader packetFrame;
-	if (!Peek(sizeof(TDynamicSizePacketHeader), &packetFrame))
+	if (GetRecvReadableBytes() < sizeof(TDynamicSizePacketHeader))
 		return false;
 
+	TDynamicSizePacketHeader packetFrame;
+	memcpy(&packetFrame, GetRecvReadPtr(), sizeof(TDynamicSizePacketHeader));
+
 	constexpr uint16_t MAX_PACKET_LENGTH = 65000;
 	if (packetFrame.length < PACKET_HEADER_SIZE || packetFrame.length > MAX_PACKET_LENGTH)
 	{
@@ -364,16 +369,39 @@ bool CPythonNetworkStream::DispatchPacket(const PacketHandlerMap& handlers)
 	}
 
 	// Wait for full packet to be received
-	if (!Peek(packetFrame.length))
+	if (GetRecvReadableBytes() < packetFrame.length)
 		return false;
 
 	// Log this packet
 	LogRecvPacket(header, packetFrame.length);
 
-	// Call handler
-	bool ret = (this->*(it->second.handler))();
+	if (!pEntry->readerHandler)
+	{
+		bool ret = (this->*(pEntry->handler))();
+
+		if (!ret || pEntry->exitPhase)
+			return false;
+
+		return true;
+	}
+
+	const uint8_t* pFrame = GetRecvReadPtr();
+	if (packetFrame.length < pEntry->minSize)
+	{
+		TraceError("DispatchPacket: Short packet: header 0x%04X length: %u (expected %u), recv_seq #%u",
+			header, packetFrame.length, pEntry->minSize, m_dwRecvPacketSeq - 1);
+		ConsumeRecv(packetFrame.length);
+		return true;
+	}
+
+	PacketReader kReader(pFrame, packetFrame.length);
+	bool ret = (this->*(pEntry->readerHandler))(kReader);
 
-	if (!ret || it->second.exitPhase)
+	// The handler may have cleared the buffer (disconnect, phase change), only drop the frame if it is still there
+	if (GetRecvReadPtr() == pFrame && GetRecvReadableBytes() >= packetFrame.length)
+		ConsumeRecv(packetFrame.length);
+
+	if (!ret || pEntry->exitPhase)
 		return false;
 
 	return true;
@@ -659,6 +687,10 @@ CPythonNetworkStream::CPythonNetworkStream()
 	SetRecvBufferSize(65536);  // 64KB recv buffer
 	SetSendBufferSize(65536);  // 64KB send buffer
 
+#ifdef ENABLE_NETWORK_THREAD
+	SetNetworkThreadEnabled(true);
+#endif
+
 	m_phaseProcessFunc.Clear();
 
 	m_dwEmpireID = 0;
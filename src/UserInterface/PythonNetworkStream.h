@@ -2,9 +2,11 @@
 
 #include <unordered_map>
 #include <vector>
+#include <array>
 
 #include "EterLib/FuncObject.h"
 #include "EterLib/NetStream.h"
+#include "EterLib/PacketReader.h"
 
 #include "InsultChecker.h"
 
@@ -19,12 +21,64 @@ class CPythonNetworkStream : public CNetworkStream, public CSingleton<CPythonNet
 {
 	public:
 		// Table-driven packet dispatch (Phase 5)
+		// A handler either Recv()s the packet itself, or takes a PacketReader over the complete
+		// frame while it is still in the recv buffer (no copy, the frame is dropped afterwards).
 		struct PacketHandlerEntry {
-			bool (CPythonNetworkStream::*handler)();
-			uint16_t minSize;
-			bool exitPhase;		// true = stop dispatch loop after handling (phase-changing packets)
+			using Handler = bool (CPythonNetworkStream::*)();
+			using ReaderHandler = bool (CPythonNetworkStream::*)(PacketReader&);
+
+			Handler handler = nullptr;
+			ReaderHandler readerHandler = nullptr;
+			uint16_t minSize = 0;
+			bool exitPhase = false;		// true = stop dispatch loop after handling (phase-changing packets)
+
+			PacketHandlerEntry() = default;
+			PacketHandlerEntry(Handler h, uint16_t size, bool exit) : handler(h), minSize(size), exitPhase(exit) {}
+			PacketHandlerEntry(ReaderHandler h, uint16_t size, bool exit) : readerHandler(h), minSize(size), exitPhase(exit) {}
+		};
+
+		// Header -> handler in two array reads: the high byte of the header selects a page of
+		// 256 slots, a slot holds the index of the entry. Pages only exist for used header ranges.
+		class PacketHandlerMap
+		{
+			public:
+				PacketHandlerMap() { m_pageIndex.fill(0); }
+
+				PacketHandlerEntry& operator[](uint16_t header)
+				{
+					uint8_t& rPage = m_pageIndex[header >> 8];
+					if (!rPage)
+					{
+						m_pages.emplace_back();
+						m_pages.back().fill(0);
+						rPage = static_cast<uint8_t>(m_pages.size());
+					}
+
+					uint16_t& rSlot = m_pages[rPage - 1][header & 0xFF];
+					if (!rSlot)
+					{
+						m_entries.emplace_back();
+						rSlot = static_cast<uint16_t>(m_entries.size());
+					}
+
+					return m_entries[rSlot - 1];
+				}
+
+				const PacketHandlerEntry* Find(uint16_t header) const
+				{
+					const uint8_t page = m_pageIndex[header >> 8];
+					if (!page)
+						return nullptr;
+
+					const uint16_t slot = m_pages[page - 1][header & 0xFF];
+					return slot ? &m_entries[slot - 1] : nullptr;
+				}
+
+			private:
+				std::array<uint8_t, 256> m_pageIndex;				// 0 = no page, else page + 1
+				std::vector<std::array<uint16_t, 256>> m_pages;	// 0 = no handler, else entry + 1
+				std::vector<PacketHandlerEntry> m_entries;
 		};
-		using PacketHandlerMap = std::unordered_map<uint16_t, PacketHandlerEntry>;
 
 	public:
 		enum
@@ -425,22 +479,22 @@ class CPythonNetworkStream : public CNetworkStream, public CSingleton<CPythonNet
 		bool RecvPVPPacket();
 		bool RecvDuelStartPacket();
         bool RecvGlobalTimePacket();
-		bool RecvCharacterAppendPacket();
-		bool RecvCharacterAdditionalInfo();
+		bool RecvCharacterAppendPacket(PacketReader& rkReader);
+		bool RecvCharacterAdditionalInfo(PacketReader& rkReader);
 		bool RecvCharacterAppendPacketNew();
-		bool RecvCharacterUpdatePacket();
+		bool RecvCharacterUpdatePacket(PacketReader& rkReader);
 		bool RecvCharacterUpdatePacketNew();
-		bool RecvCharacterDeletePacket();
+		bool RecvCharacterDeletePacket(PacketReader& rkReader);
 		bool RecvChatPacket();
 		bool RecvOwnerShipPacket();
-		bool RecvSyncPositionPacket();
+		bool RecvSyncPositionPacket(PacketReader& rkReader);
 		bool RecvWhisperPacket();
 		bool RecvPointChange();					// Alarm to python
 		bool RecvChangeSpeedPacket();
 
 		bool RecvStunPacket();
 		bool RecvDeadPacket();
-		bool RecvCharacterMovePacket();
+		bool RecvCharacterMovePacket(PacketReader& rkReader);
 
 		bool RecvItemDelPacket();					// Alarm to python
 		bool RecvItemSetPacket();					// Alarm to python
@@ -500,7 +554,7 @@ class CPythonNetworkStream : public CNetworkStream, public CSingleton<CPythonNet
 		// Target
 		bool RecvTargetPacket();
 		bool RecvViewEquipPacket();
-		bool RecvDamageInfoPacket();
+		bool RecvDamageInfoPacket(PacketReader& rkReader);
 
 		// Mount
 		bool RecvMountPacket();
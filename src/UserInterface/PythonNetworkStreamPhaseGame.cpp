@@ -148,82 +148,41 @@ void CPythonNetworkStream::__SetGuildID(DWORD id)
 	}
 }
 
-struct PERF_PacketInfo
-{
-	DWORD dwCount;
-	DWORD dwTime;
-
-	PERF_PacketInfo()
-	{
-		dwCount=0;
-		dwTime=0;
-	}
-};
-
-
-#ifdef __PERFORMANCE_CHECK__
-
-class PERF_PacketTimeAnalyzer
-{
-	public:
-		~PERF_PacketTimeAnalyzer()
-		{
-			FILE* fp=fopen("perf_dispatch_packet_result.txt", "w");		
-
-			for (std::map<DWORD, PERF_PacketInfo>::iterator i=m_kMap_kPacketInfo.begin(); i!=m_kMap_kPacketInfo.end(); ++i)
-			{
-				if (i->second.dwTime>0)
-					fprintf(fp, "header %d: count %d, time %d, tpc %d\n", i->first, i->second.dwCount, i->second.dwTime, i->second.dwTime/i->second.dwCount);
-			}
-			fclose(fp);
-		}
-
-	public:
-		std::map<DWORD, PERF_PacketInfo> m_kMap_kPacketInfo;
-};
-
-PERF_PacketTimeAnalyzer gs_kPacketTimeAnalyzer;
-
-#endif
-
 // Game Phase ---------------------------------------------------------------------------
 void CPythonNetworkStream::GamePhase()
 {
+	PROFILE_FUNCTION();
+
 	if (!m_kQue_stHack.empty())
 	{
 		__SendHack(m_kQue_stHack.front().c_str());
 		m_kQue_stHack.pop_front();
 	}
 
-#ifdef __PERFORMANCE_CHECK__
-	DWORD timeBeginDispatch=timeGetTime();
-#endif
-
-	const DWORD MAX_RECV_COUNT = 32;
+	// Packets are dispatched until the frame's time budget is spent. A minimum count keeps
+	// slow frames making progress, and a backed up recv buffer is drained regardless.
+	const DWORD MIN_RECV_COUNT = 32;
+	const DWORD RECV_TIME_BUDGET = 4;
 	const DWORD SAFE_RECV_BUFSIZE = 8192;
+	const DWORD dwDispatchStart = ELTimer_GetMSec();
 	DWORD dwRecvCount = 0;
 
-	while (true)
 	{
-		if (dwRecvCount++ >= MAX_RECV_COUNT-1 && GetRecvBufferSize() < SAFE_RECV_BUFSIZE
-			&& m_strPhase == "Game")
-			break;
-
-		if (!DispatchPacket(m_gameHandlers))
-			break;
-	}
+		PROFILE_ZONE("Dispatch packets");
 
-#ifdef __PERFORMANCE_CHECK__
-	DWORD timeEndDispatch=timeGetTime();
+		while (true)
+		{
+			if (dwRecvCount++ >= MIN_RECV_COUNT && ELTimer_GetMSec() - dwDispatchStart >= RECV_TIME_BUDGET
+				&& GetRecvBufferSize() < SAFE_RECV_BUFSIZE && m_strPhase == "Game")
+				break;
 
-	if (timeEndDispatch-timeBeginDispatch>2)
-	{
-		static FILE* fp=fopen("perf_dispatch_packet.txt", "w");
-		fprintf(fp, "delay %d\n", timeEndDispatch-timeBeginDispatch);
-		fputs("=====================================================\n", fp);
-		fflush(fp);
+			if (!DispatchPacket(m_gameHandlers))
+				break;
+		}
 	}
-#endif
+
+	// The last round found nothing to dispatch or ran out of budget
+	PROFILE_COUNTER("Dispatched packets", dwRecvCount - 1);
 
 	static DWORD s_nextRefreshTime = ELTimer_GetMSec();
 
@@ -2155,11 +2114,11 @@ bool CPythonNetworkStream::RecvSkillLevelNew()
 }
 
 
-bool CPythonNetworkStream::RecvDamageInfoPacket()
+bool CPythonNetworkStream::RecvDamageInfoPacket(PacketReader& rkReader)
 {
 	TPacketGCDamageInfo DamageInfoPacket;
 
-	if (!Recv(sizeof(TPacketGCDamageInfo), &DamageInfoPacket))
+	if (!rkReader.ReadStruct(DamageInfoPacket))
 	{
 		Tracen("Recv Target Packet Error");
 		return false;
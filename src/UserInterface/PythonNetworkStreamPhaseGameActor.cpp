@@ -88,10 +88,10 @@ bool IsInvisibleRace(WORD raceNum)
 static SNetworkActorData s_kNetActorData;
 
 
-bool CPythonNetworkStream::RecvCharacterAppendPacket()
+bool CPythonNetworkStream::RecvCharacterAppendPacket(PacketReader& rkReader)
 {
 	TPacketGCCharacterAdd chrAddPacket;
-	if (!Recv(sizeof(chrAddPacket), &chrAddPacket))
+	if (!rkReader.ReadStruct(chrAddPacket))
 		return false;
 
 	__GlobalPositionToLocalPosition(chrAddPacket.x, chrAddPacket.y);
@@ -147,10 +147,10 @@ bool CPythonNetworkStream::RecvCharacterAppendPacket()
 	return true;
 }
 
-bool CPythonNetworkStream::RecvCharacterAdditionalInfo()
+bool CPythonNetworkStream::RecvCharacterAdditionalInfo(PacketReader& rkReader)
 {
 	TPacketGCCharacterAdditionalInfo chrInfoPacket;
-	if (!Recv(sizeof(chrInfoPacket), &chrInfoPacket))
+	if (!rkReader.ReadStruct(chrInfoPacket))
 		return false;
 
 	
@@ -233,10 +233,10 @@ bool CPythonNetworkStream::RecvCharacterAppendPacketNew()
 	return true;
 }
 
-bool CPythonNetworkStream::RecvCharacterUpdatePacket()
+bool CPythonNetworkStream::RecvCharacterUpdatePacket(PacketReader& rkReader)
 {
 	TPacketGCCharacterUpdate chrUpdatePacket;
-	if (!Recv(sizeof(chrUpdatePacket), &chrUpdatePacket))
+	if (!rkReader.ReadStruct(chrUpdatePacket))
 		return false;
 
 	SNetworkUpdateActorData kNetUpdateActorData;
@@ -357,11 +357,11 @@ void CPythonNetworkStream::__RecvCharacterUpdatePacket(SNetworkUpdateActorData *
 	}
 }
 
-bool CPythonNetworkStream::RecvCharacterDeletePacket()
+bool CPythonNetworkStream::RecvCharacterDeletePacket(PacketReader& rkReader)
 {
 	TPacketGCCharacterDelete chrDelPacket;
 
-	if (!Recv(sizeof(chrDelPacket), &chrDelPacket))
+	if (!rkReader.ReadStruct(chrDelPacket))
 	{
 		TraceError("CPythonNetworkStream::RecvCharacterDeletePacket - Recv Error");
 		return false;
@@ -415,10 +415,10 @@ bool CPythonNetworkStream::RecvSupportUseSkill()
 }
 #endif
 
-bool CPythonNetworkStream::RecvCharacterMovePacket()
+bool CPythonNetworkStream::RecvCharacterMovePacket(PacketReader& rkReader)
 {
 	TPacketGCMove kMovePacket;
-	if (!Recv(sizeof(TPacketGCMove), &kMovePacket))
+	if (!rkReader.ReadStruct(kMovePacket))
 	{
 		Tracen("CPythonNetworkStream::RecvCharacterMovePacket - PACKET READ ERROR");
 		return false;
@@ -453,18 +453,18 @@ bool CPythonNetworkStream::RecvOwnerShipPacket()
 	return true;
 }
 
-bool CPythonNetworkStream::RecvSyncPositionPacket()
+bool CPythonNetworkStream::RecvSyncPositionPacket(PacketReader& rkReader)
 {
 	TPacketGCSyncPosition kPacketSyncPos;
-	if (!Recv(sizeof(kPacketSyncPos), &kPacketSyncPos))
+	if (!rkReader.ReadStruct(kPacketSyncPos))
 		return false;
 
 	TPacketGCSyncPositionElement kSyncPos;
 
-	UINT uSyncPosCount=(kPacketSyncPos.length-sizeof(kPacketSyncPos))/sizeof(kSyncPos);
+	UINT uSyncPosCount=rkReader.Remaining()/sizeof(kSyncPos);
 	for (UINT iSyncPos=0; iSyncPos<uSyncPosCount; ++iSyncPos)
 	{		
-		if (!Recv(sizeof(TPacketGCSyncPositionElement), &kSyncPos))
+		if (!rkReader.ReadStruct(kSyncPos))
 			return false;
 
 #ifdef __MOVIE_MODE__
@@ -5,6 +5,8 @@
 #include "NetworkActorManager.h"
 #include "AbstractPlayer.h"
 #include "PackLib/PackManager.h"
+#include "EterLib/TextFileLoader.h"
+#include "EterLib/ResourceManager.h"
 
 void CPythonNetworkStream::EnableChatInsultFilter(bool isEnable)
 {
@@ -193,7 +195,14 @@ bool CPythonNetworkStream::__RecvPlayerPoints()
 
 void CPythonNetworkStream::StartGame()
 {
+	static bool s_isStarted = false;
+
 	m_isStartGame=TRUE;
+
+	// Scripts parsed since the last report, the first time covers the whole startup
+	CTextFileLoader::TraceLoadStats(s_isStarted ? "warp" : "startup");
+	CResourceManager::Instance().TraceBackgroundLoadingStats(s_isStarted ? "warp" : "startup");
+	s_isStarted = true;
 }
 
 bool CPythonNetworkStream::SendEnterGame()
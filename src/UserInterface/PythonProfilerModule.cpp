@@ -7,6 +7,10 @@ PyObject * profilerPush(PyObject * poSelf, PyObject * poArgs)
 	if (!PyTuple_GetString(poArgs, 0, &szName))
 		return Py_BuildException();
 
+	CProfiler& rkProfiler = CProfiler::Instance();
+	if (rkProfiler.IsEnabled())
+		CProfiler::Begin(rkProfiler.Intern(szName));
+
 	return Py_BuildNone();
 }
 
@@ -16,6 +20,70 @@ PyObject * profilerPop(PyObject * poSelf, PyObject * poArgs)
 	if (!PyTuple_GetString(poArgs, 0, &szName))
 		return Py_BuildException();
 
+	// Ends close the innermost zone, the name is not kept
+	CProfiler::End(NULL);
+	return Py_BuildNone();
+}
+
+PyObject * profilerCounter(PyObject * poSelf, PyObject * poArgs)
+{
+	char * szName;
+	if (!PyTuple_GetString(poArgs, 0, &szName))
+		return Py_BuildException();
+
+	float fValue;
+	if (!PyTuple_GetFloat(poArgs, 1, &fValue))
+		return Py_BuildException();
+
+	CProfiler& rkProfiler = CProfiler::Instance();
+	if (rkProfiler.IsEnabled())
+		CProfiler::Counter(rkProfiler.Intern(szName), fValue);
+
+	return Py_BuildNone();
+}
+
+PyObject * profilerEnable(PyObject * poSelf, PyObject * poArgs)
+{
+	bool isEnable;
+	if (!PyTuple_GetBoolean(poArgs, 0, &isEnable))
+		return Py_BuildException();
+
+	CProfiler::Instance().SetEnable(isEnable);
+	return Py_BuildNone();
+}
+
+PyObject * profilerIsEnabled(PyObject * poSelf, PyObject * poArgs)
+{
+	return Py_BuildValue("i", CProfiler::Instance().IsEnabled());
+}
+
+// Dump([fileName[, frameCount]]), returns the name of the written file
+PyObject * profilerDump(PyObject * poSelf, PyObject * poArgs)
+{
+	char * szFileName = NULL;
+	if (PyTuple_Size(poArgs) > 0 && !PyTuple_GetString(poArgs, 0, &szFileName))
+		return Py_BuildException();
+
+	int iFrameCount = CProfiler::DEFAULT_DUMP_FRAME_COUNT;
+	if (PyTuple_Size(poArgs) > 1 && !PyTuple_GetInteger(poArgs, 1, &iFrameCount))
+		return Py_BuildException();
+
+	std::string stFileName = CProfiler::Instance().Dump(szFileName, std::max(1, iFrameCount));
+	return Py_BuildValue("s", stFileName.c_str());
+}
+
+// SetSpikeDump(thresholdMS, frameCount), a threshold of 0 turns it off
+PyObject * profilerSetSpikeDump(PyObject * poSelf, PyObject * poArgs)
+{
+	int iThreshold;
+	if (!PyTuple_GetInteger(poArgs, 0, &iThreshold))
+		return Py_BuildException();
+
+	int iFrameCount;
+	if (!PyTuple_GetInteger(poArgs, 1, &iFrameCount))
+		return Py_BuildException();
+
+	CProfiler::Instance().SetSpikeDump(std::max(0, iThreshold), std::max(1, iFrameCount));
 	return Py_BuildNone();
 }
 
@@ -25,9 +93,14 @@ void initProfiler()
 	{
 		{ "Push",				profilerPush,				METH_VARARGS },
 		{ "Pop",				profilerPop,				METH_VARARGS },
+		{ "Counter",			profilerCounter,			METH_VARARGS },
+		{ "Enable",				profilerEnable,				METH_VARARGS },
+		{ "IsEnabled",			profilerIsEnabled,			METH_VARARGS },
+		{ "Dump",				profilerDump,				METH_VARARGS },
+		{ "SetSpikeDump",		profilerSetSpikeDump,		METH_VARARGS },
 
 		{ NULL,					NULL,						NULL		 },
 	};
 
 	Py_InitModule("profiler", s_methods);
-}
\ No newline at end of file
+}
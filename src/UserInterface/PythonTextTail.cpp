@@ -157,61 +157,10 @@ void CPythonTextTail::UpdateTextTail(TTextTail * pTextTail)
 void CPythonTextTail::ArrangeTextTail()
 {
 	TTextTailList::iterator itor;
-	TTextTailList::iterator itorCompare;
 
 	DWORD dwTime = CTimer::Instance().GetCurrentMillisecond();
 
-	for (itor = m_ItemTextTailList.begin(); itor != m_ItemTextTailList.end(); ++itor)
-	{
-		TTextTail * pInsertTextTail = *itor;
-
-		int yTemp = 5;
-		int LimitCount = 0;
-
-		for (itorCompare = m_ItemTextTailList.begin(); itorCompare != m_ItemTextTailList.end();)
-		{
-			TTextTail * pCompareTextTail = *itorCompare;
-
-			if (*itorCompare == *itor)
-			{
-				++itorCompare;
-				continue;
-			}
-
-			if (LimitCount >= 20)
-				break;
-
-			if (isIn(pInsertTextTail, pCompareTextTail))
-			{
-				pInsertTextTail->y = (pCompareTextTail->y + pCompareTextTail->yEnd + yTemp);
-
-				itorCompare = m_ItemTextTailList.begin();
-				++LimitCount;
-				continue;
-			}
-
-			++itorCompare;
-		}
-
-
-		if (pInsertTextTail->pOwnerTextInstance)
-		{
-			pInsertTextTail->pOwnerTextInstance->SetPosition(pInsertTextTail->x, pInsertTextTail->y, pInsertTextTail->z);
-			pInsertTextTail->pOwnerTextInstance->Update();
-
-			pInsertTextTail->pTextInstance->SetColor(pInsertTextTail->Color.r, pInsertTextTail->Color.g, pInsertTextTail->Color.b);
-			pInsertTextTail->pTextInstance->SetPosition(pInsertTextTail->x, pInsertTextTail->y + 15.0f, pInsertTextTail->z);
-			pInsertTextTail->pTextInstance->Update();
-
-		}
-		else
-		{
-			pInsertTextTail->pTextInstance->SetColor(pInsertTextTail->Color.r, pInsertTextTail->Color.g, pInsertTextTail->Color.b);
-			pInsertTextTail->pTextInstance->SetPosition(pInsertTextTail->x, pInsertTextTail->y, pInsertTextTail->z);
-			pInsertTextTail->pTextInstance->Update();
-
-		}
-	}
+	ArrangeItemTextTail();
 
 	for (itor = m_CharacterTextTailList.begin(); itor != m_CharacterTextTailList.end(); ++itor)
 	{
@@ -423,24 +372,31 @@ void CPythonTextTail::ShowItemTextTail(DWORD VirtualID)
 	m_ItemTextTailList.push_back(pTextTail);
 }
 
-bool CPythonTextTail::isIn(CPythonTextTail::TTextTail * pSource, CPythonTextTail::TTextTail * pTarget)
+void CPythonTextTail::ArrangeItemTextTail()
 {
-	float x1Source = pSource->x + pSource->xStart;
-	float y1Source = pSource->y + pSource->yStart;
-	float x2Source = pSource->x + pSource->xEnd;
-	float y2Source = pSource->y + pSource->yEnd;
-	float x1Target = pTarget->x + pTarget->xStart;
-	float y1Target = pTarget->y + pTarget->yStart;
-	float x2Target = pTarget->x + pTarget->xEnd;
-	float y2Target = pTarget->y + pTarget->yEnd;
+	m_ArrangeList.assign(m_ItemTextTailList.begin(), m_ItemTextTailList.end());
+	m_ItemLabelLayout.Arrange(m_ArrangeList);
 
-	if (x1Source <= x2Target && x2Source >= x1Target &&
-	    y1Source <= y2Target && y2Source >= y1Target)
+	for (size_t i = 0; i < m_ArrangeList.size(); ++i)
 	{
-		return true;
-	}
+		TTextTail * pTextTail = static_cast<TTextTail *>(m_ArrangeList[i]);
 
-	return false;
+		if (pTextTail->pOwnerTextInstance)
+		{
+			pTextTail->pOwnerTextInstance->SetPosition(pTextTail->x, pTextTail->y, pTextTail->z);
+			pTextTail->pOwnerTextInstance->Update();
+
+			pTextTail->pTextInstance->SetColor(pTextTail->Color.r, pTextTail->Color.g, pTextTail->Color.b);
+			pTextTail->pTextInstance->SetPosition(pTextTail->x, pTextTail->y + 15.0f, pTextTail->z);
+			pTextTail->pTextInstance->Update();
+		}
+		else
+		{
+			pTextTail->pTextInstance->SetColor(pTextTail->Color.r, pTextTail->Color.g, pTextTail->Color.b);
+			pTextTail->pTextInstance->SetPosition(pTextTail->x, pTextTail->y, pTextTail->z);
+			pTextTail->pTextInstance->Update();
+		}
+	}
 }
 
 void CPythonTextTail::RegisterCharacterTextTail(DWORD dwGuildID, DWORD dwVirtualID, const D3DXCOLOR & c_rColor, float fAddHeight)
@@ -751,6 +707,10 @@ CPythonTextTail::TTextTail * CPythonTextTail::RegisterTextTail(DWORD dwVirtualID
 	pTextTail->x = -100.0f;
 	pTextTail->y = -100.0f;
 	pTextTail->z = 0.0f;
+	pTextTail->xLast = 0.0f;
+	pTextTail->yLast = 0.0f;
+	pTextTail->yArranged = 0.0f;
+	pTextTail->isArranged = false;
 	pTextTail->pMarkInstance = NULL;
 	pTextTail->pGuildNameTextInstance = NULL;
 	pTextTail->pTitleTextInstance = NULL;
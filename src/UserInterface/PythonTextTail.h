@@ -1,6 +1,7 @@
 #pragma once
 
 #include "EterBase/Singleton.h"
+#include "EterLib/LabelLayout.h"
 
 /*
  *	따라다니는 텍스트 처리
@@ -8,7 +9,8 @@
 class CPythonTextTail : public CSingleton<CPythonTextTail>
 {
 	public:
-		typedef struct STextTail
+		// The label part is the box ArrangeTextTail lays out for item tails
+		typedef struct STextTail : public CLabelLayout::SLabel
 		{
 			CGraphicTextInstance*			pTextInstance;
 			CGraphicTextInstance*			pOwnerTextInstance;
@@ -24,16 +26,11 @@ class CPythonTextTail : public CSingleton<CPythonTextTail>
 			//        도중 캐릭터가 없어질 경우 튕길 가능성이 있음
 			CGraphicObjectInstance *		pOwner;
 
-			DWORD							dwVirtualID;
-
-			float							x, y, z;
+			float							z;
 			float							fDistanceFromPlayer;
 			D3DXCOLOR						Color;
 			BOOL							bNameFlag;		// 이름도 함께 켤것인지의 플래그
 
-			float							xStart, yStart;
-			float							xEnd, yEnd;
-
 			DWORD							LivingTime;
 
 			float							fHeight;
@@ -99,7 +96,7 @@ class CPythonTextTail : public CSingleton<CPythonTextTail>
 		void RenderTextTailName(TTextTail * pTextTail);
 		void UpdateDistance(const TPixelPosition & c_rCenterPosition, TTextTail * pTextTail);
 
-		bool isIn(TTextTail * pSource, TTextTail * pTarget);
+		void ArrangeItemTextTail();
 
 	protected:
 		TTextTailMap				m_CharacterTextTailMap;
@@ -109,6 +106,9 @@ class CPythonTextTail : public CSingleton<CPythonTextTail>
 		TTextTailList				m_CharacterTextTailList;
 		TTextTailList				m_ItemTextTailList;
 
+		CLabelLayout							m_ItemLabelLayout;
+		std::vector<CLabelLayout::TLabel*>		m_ArrangeList;
+
 	private:
 		CDynamicPool<STextTail>		m_TextTailPool;
 };
@@ -11,6 +11,7 @@
 
 #include "eterLib/Util.h"
 #include "EterLib/GameThreadPool.h"
+#include "EterLib/Profiler.h"
 #include "EterBase/lzo.h"
 
 #include "PackLib/PackManager.h"
@@ -150,7 +151,7 @@ bool PackInitialize(const char * c_pszFolder)
 	};
 
 	Tracef("PackInitialize: Loading root.pck...");
-	if (!CPackManager::instance().AddPack(std::format("{}/root.pck", c_pszFolder)))
+	if (!CPackManager::instance().AddPack(std::format("{}/root.pck", c_pszFolder), 0))
 	{
 		TraceError("Failed to load root.pck");
 		return false;
@@ -174,7 +175,8 @@ bool PackInitialize(const char * c_pszFolder)
 			for (size_t i = start; i < end; ++i)
 			{
 				std::string packPath = std::format("{}/{}.pck", c_pszFolder, packFiles[i]);
-				if (!CPackManager::instance().AddPack(packPath))
+				// Packs later in the list override earlier ones regardless of which thread mounts them
+				if (!CPackManager::instance().AddPack(packPath, static_cast<int>(i + 1)))
 				{
 					TraceError("Failed to load %s", packPath.c_str());
 					failedCount++;
@@ -189,6 +191,8 @@ bool PackInitialize(const char * c_pszFolder)
 		thread.join();
 	}
 
+	CPackManager::instance().Freeze();
+
 	Tracef("PackInitialize: Completed! Failed: %d / %d", failedCount.load(), packFiles.size());
 	return true;
 }
@@ -290,6 +294,17 @@ static bool Main(HINSTANCE hInstance, LPSTR lpCmdLine)
 		return false;
 	}
 
+	// Records the pack file access order for PackMaker --trace
+	if (lpCmdLine && strstr(lpCmdLine, "--pack-trace"))
+		packMgr.StartTrace("pack_trace.txt");
+
+	// Outlives the thread pool, its workers record into it until they are joined
+	static CProfiler profiler;
+	CProfiler::SetThreadName("Main");
+
+	if (lpCmdLine && strstr(lpCmdLine, "--profile"))
+		profiler.SetEnable(true);
+
 	// Create game thread pool singleton before CPythonApplication
 	static CGameThreadPool gameThreadPool;
 